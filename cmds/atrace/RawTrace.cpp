@@ -0,0 +1,530 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RawTrace.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+
+namespace android {
+namespace atrace {
+
+namespace {
+
+using android::base::unique_fd;
+
+// Pages read or spliced at once from each CPU buffer.
+constexpr size_t kChunkPages = 32;
+// How often streaming readers check whether the trace was aborted while their buffer is empty.
+constexpr int kPollTimeoutMs = 100;
+// How much text unpackRawTrace() skips looking for the header.
+constexpr size_t kMaxLeadingTextSize = 4096;
+// Largest record unpackRawTrace() accepts, to not trust a corrupted size.
+constexpr uint32_t kMaxRecordSize = 64 * 1024 * 1024;
+
+// Files that describe the ring buffer pages, in addition to the formats of the enabled events.
+const char* const kMetadataFiles[] = {
+    "events/header_page",
+    "events/header_event",
+    "saved_cmdlines",
+    "saved_tgids",
+    "trace_clock",
+};
+
+std::string joinPath(const std::string& folder, const std::string& path) {
+    if (!folder.empty() && folder.back() != '/') {
+        return folder + "/" + path;
+    }
+    return folder + path;
+}
+
+std::vector<std::string> listDirectory(const std::string& path) {
+    std::vector<std::string> names;
+    std::unique_ptr<DIR, int (*)(DIR*)> dir(opendir(path.c_str()), closedir);
+    if (!dir) {
+        return names;
+    }
+    while (struct dirent* entry = readdir(dir.get())) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            names.push_back(entry->d_name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Returns the CPUs that have a per_cpu/cpuN folder.
+std::vector<uint32_t> listCpus(const std::string& traceFolder) {
+    std::vector<uint32_t> cpus;
+    for (const std::string& name : listDirectory(joinPath(traceFolder, "per_cpu"))) {
+        char* end = nullptr;
+        if (name.compare(0, 3, "cpu") != 0 || name.size() == 3) {
+            continue;
+        }
+        unsigned long cpu = strtoul(name.c_str() + 3, &end, 10);
+        if (*end == '\0') {
+            cpus.push_back(static_cast<uint32_t>(cpu));
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+// Returns the paths of the files needed to decode the pages, relative to the trace folder.
+std::vector<std::string> listMetadataFiles(const std::string& traceFolder) {
+    std::vector<std::string> paths(std::begin(kMetadataFiles), std::end(kMetadataFiles));
+    for (const std::string& group : listDirectory(joinPath(traceFolder, "events"))) {
+        const std::string groupPath = "events/" + group;
+        for (const std::string& event : listDirectory(joinPath(traceFolder, groupPath))) {
+            const std::string eventPath = groupPath + "/" + event;
+            std::string enable;
+            if (android::base::ReadFileToString(joinPath(traceFolder, eventPath + "/enable"),
+                                                &enable) &&
+                !enable.empty() && enable[0] == '1') {
+                paths.push_back(eventPath + "/format");
+            }
+        }
+    }
+    return paths;
+}
+
+// Waits until |fd| is readable. Returns false if the trace was aborted first.
+bool waitForData(int fd, const std::atomic<bool>& aborted) {
+    while (!aborted) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        int result = poll(&pfd, 1, kPollTimeoutMs);
+        if (result > 0) {
+            return true;
+        }
+        if (result < 0 && errno != EINTR) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Serializes the records of all the CPU readers to the output.
+class RawTraceWriter {
+public:
+    explicit RawTraceWriter(int fd) : mFd(fd) {}
+
+    bool writeHeader(const RawTraceHeader& header) {
+        std::lock_guard<std::mutex> lock(mLock);
+        return writeLocked(&header, sizeof(header));
+    }
+
+    bool writeRecord(uint32_t type, uint32_t cpu, const void* data, uint32_t size,
+                     uint32_t storedSize) {
+        const RawTraceRecord record = {type, cpu, size, storedSize};
+        std::lock_guard<std::mutex> lock(mLock);
+        return writeLocked(&record, sizeof(record)) && writeLocked(data, storedSize);
+    }
+
+    // Writes a record of the next |size| bytes of |pipeFd|, moving them without a copy if the
+    // output allows it.
+    bool spliceRecord(uint32_t cpu, int pipeFd, uint32_t size) {
+        const RawTraceRecord record = {RAW_TRACE_PAGES, cpu, size, size};
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!writeLocked(&record, sizeof(record))) {
+            return false;
+        }
+        size_t remaining = size;
+        while (remaining > 0 && mCanSplice) {
+            ssize_t n = splice(pipeFd, nullptr, mFd, nullptr, remaining, SPLICE_F_MOVE);
+            if (n > 0) {
+                remaining -= n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else if (n < 0 && errno == EINVAL) {
+                // Terminals and files opened for appending can't be spliced to.
+                mCanSplice = false;
+            } else {
+                fprintf(stderr, "error splicing trace: %s (%d)\n", strerror(errno), errno);
+                return false;
+            }
+        }
+        char buf[4096];
+        while (remaining > 0) {
+            ssize_t n = TEMP_FAILURE_RETRY(read(pipeFd, buf, std::min(remaining, sizeof(buf))));
+            if (n <= 0 || !writeLocked(buf, n)) {
+                fprintf(stderr, "error copying trace: %s (%d)\n", strerror(errno), errno);
+                return false;
+            }
+            remaining -= n;
+        }
+        return true;
+    }
+
+private:
+    bool writeLocked(const void* data, size_t size) {
+        if (!android::base::WriteFully(mFd, data, size)) {
+            fprintf(stderr, "error writing trace: %s (%d)\n", strerror(errno), errno);
+            return false;
+        }
+        return true;
+    }
+
+    std::mutex mLock;
+    const int mFd;
+    bool mCanSplice = true;
+};
+
+class CpuReader {
+public:
+    CpuReader(uint32_t cpu, unique_fd fd, size_t pageSize, RawTraceWriter& writer,
+              const std::atomic<bool>& aborted)
+          : mCpu(cpu),
+            mFd(std::move(fd)),
+            mChunkSize(pageSize * kChunkPages),
+            mWriter(writer),
+            mAborted(aborted) {}
+
+    bool capture(bool compress, bool stream) {
+        if (!compress) {
+            switch (splicePages(stream)) {
+                case SpliceResult::ERROR:
+                    return false;
+                case SpliceResult::UNSUPPORTED:
+                    break;
+                case SpliceResult::DONE:
+                    // Splicing only moves full pages, so the partially filled page of each
+                    // buffer is only returned by read().
+                    return readPages(compress, false);
+            }
+        }
+        return readPages(compress, stream);
+    }
+
+private:
+    enum class SpliceResult { DONE, UNSUPPORTED, ERROR };
+
+    SpliceResult splicePages(bool stream) {
+        int pipeFds[2];
+        if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+            return SpliceResult::UNSUPPORTED;
+        }
+        unique_fd readEnd(pipeFds[0]);
+        unique_fd writeEnd(pipeFds[1]);
+        // The pipe must hold a whole chunk, or splicing it from the buffer would block.
+        int pipeSize = fcntl(writeEnd.get(), F_SETPIPE_SZ, static_cast<int>(mChunkSize));
+        const size_t chunkSize = pipeSize > 0 ? std::min<size_t>(mChunkSize, pipeSize)
+                                              : mChunkSize / kChunkPages;
+
+        while (!(stream && mAborted)) {
+            ssize_t n = splice(mFd.get(), nullptr, writeEnd.get(), nullptr, chunkSize,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                mSpliced = true;
+                if (!mWriter.spliceRecord(mCpu, readEnd.get(), static_cast<uint32_t>(n))) {
+                    return SpliceResult::ERROR;
+                }
+            } else if (n == 0) {
+                break;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN) {
+                if (stream && waitForData(mFd.get(), mAborted)) {
+                    continue;
+                }
+                break;
+            } else if (errno == EINVAL && !mSpliced) {
+                return SpliceResult::UNSUPPORTED;
+            } else {
+                fprintf(stderr, "error splicing cpu%u buffer: %s (%d)\n", mCpu, strerror(errno),
+                        errno);
+                return SpliceResult::ERROR;
+            }
+        }
+        return SpliceResult::DONE;
+    }
+
+    bool readPages(bool compress, bool stream) {
+        std::vector<uint8_t> pages(mChunkSize);
+        std::vector<uint8_t> deflated(compress ? compressBound(mChunkSize) : 0);
+        size_t filled = 0;
+        auto flush = [&]() {
+            if (filled == 0) {
+                return true;
+            }
+            const uint32_t size = static_cast<uint32_t>(filled);
+            filled = 0;
+            if (!compress) {
+                return mWriter.writeRecord(RAW_TRACE_PAGES, mCpu, pages.data(), size, size);
+            }
+            uLongf deflatedSize = deflated.size();
+            int result = compress2(deflated.data(), &deflatedSize, pages.data(), size,
+                                   Z_DEFAULT_COMPRESSION);
+            if (result != Z_OK) {
+                fprintf(stderr, "error deflating cpu%u buffer: %d\n", mCpu, result);
+                return false;
+            }
+            return mWriter.writeRecord(RAW_TRACE_PAGES_DEFLATED, mCpu, deflated.data(), size,
+                                       static_cast<uint32_t>(deflatedSize));
+        };
+
+        for (;;) {
+            ssize_t n = read(mFd.get(), pages.data() + filled, mChunkSize - filled);
+            if (n > 0) {
+                filled += n;
+                if (filled == mChunkSize && !flush()) {
+                    return false;
+                }
+            } else if (n == 0) {
+                break;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN) {
+                if (!stream) {
+                    break;
+                }
+                // Don't hold back what was read while waiting for more.
+                if (!flush()) {
+                    return false;
+                }
+                if (!waitForData(mFd.get(), mAborted)) {
+                    break;
+                }
+            } else {
+                fprintf(stderr, "error reading cpu%u buffer: %s (%d)\n", mCpu, strerror(errno),
+                        errno);
+                return false;
+            }
+        }
+        return flush();
+    }
+
+    const uint32_t mCpu;
+    const unique_fd mFd;
+    const size_t mChunkSize;
+    RawTraceWriter& mWriter;
+    const std::atomic<bool>& mAborted;
+    bool mSpliced = false;
+};
+
+// Reads from |fd|, first consuming the bytes already read past the header.
+class RawTraceReader {
+public:
+    RawTraceReader(int fd, std::string pending) : mFd(fd), mPending(std::move(pending)) {}
+
+    // Returns false at the end of the input, or if there is less than |size| bytes left.
+    bool read(void* data, size_t size) {
+        const size_t fromPending = std::min(size, mPending.size() - mPendingOffset);
+        memcpy(data, mPending.data() + mPendingOffset, fromPending);
+        mPendingOffset += fromPending;
+        return android::base::ReadFully(mFd, static_cast<uint8_t*>(data) + fromPending,
+                                        size - fromPending);
+    }
+
+private:
+    const int mFd;
+    const std::string mPending;
+    size_t mPendingOffset = 0;
+};
+
+bool makeDirectories(const std::string& path) {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos;
+         slash = path.find('/', slash + 1)) {
+        if (mkdir(path.substr(0, slash).c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "error creating %s: %s\n", path.substr(0, slash).c_str(),
+                    strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isSafeRelativePath(const std::string& path) {
+    return !path.empty() && path[0] != '/' && path.find("..") == std::string::npos;
+}
+
+} // namespace
+
+bool captureRawTrace(const std::string& traceFolder, int outFd, bool compress, bool stream,
+                     const std::atomic<bool>& aborted) {
+    const std::vector<uint32_t> cpus = listCpus(traceFolder);
+    if (cpus.empty()) {
+        fprintf(stderr, "error: no per-CPU buffers in %s\n",
+                joinPath(traceFolder, "per_cpu").c_str());
+        return false;
+    }
+
+    std::vector<unique_fd> fds;
+    for (uint32_t cpu : cpus) {
+        const std::string path =
+                joinPath(traceFolder, "per_cpu/cpu" + std::to_string(cpu) + "/trace_pipe_raw");
+        unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)));
+        if (fd == -1) {
+            fprintf(stderr, "error opening %s: %s (%d)\n", path.c_str(), strerror(errno), errno);
+            return false;
+        }
+        fds.push_back(std::move(fd));
+    }
+
+    RawTraceWriter writer(outFd);
+    RawTraceHeader header = {};
+    memcpy(header.magic, kRawTraceMagic, sizeof(header.magic));
+    header.pageSize = static_cast<uint32_t>(getpagesize());
+    header.cpuCount = cpus.back() + 1;
+    if (!writer.writeHeader(header)) {
+        return false;
+    }
+
+    for (const std::string& path : listMetadataFiles(traceFolder)) {
+        std::string contents;
+        if (!android::base::ReadFileToString(joinPath(traceFolder, path), &contents)) {
+            continue;
+        }
+        std::string payload = path;
+        payload.push_back('\0');
+        payload += contents;
+        const uint32_t size = static_cast<uint32_t>(payload.size());
+        if (!writer.writeRecord(RAW_TRACE_FILE, 0, payload.data(), size, size)) {
+            return false;
+        }
+    }
+
+    // One reader per CPU, so a busy CPU doesn't delay draining the others.
+    std::vector<std::unique_ptr<CpuReader>> readers;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        readers.push_back(std::make_unique<CpuReader>(cpus[i], std::move(fds[i]),
+                                                      header.pageSize, writer, aborted));
+    }
+    std::vector<char> results(readers.size(), false);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < readers.size(); i++) {
+        threads.emplace_back([&, i]() { results[i] = readers[i]->capture(compress, stream); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return std::all_of(results.begin(), results.end(), [](char ok) { return ok; });
+}
+
+bool unpackRawTrace(int inFd, const std::string& outFolder) {
+    // Find the header, after any text printed before it.
+    std::string start(kMaxLeadingTextSize + sizeof(RawTraceHeader), '\0');
+    size_t startSize = 0;
+    ssize_t n;
+    while (startSize < start.size() &&
+           (n = TEMP_FAILURE_RETRY(read(inFd, &start[startSize], start.size() - startSize))) > 0) {
+        startSize += n;
+    }
+    start.resize(startSize);
+    const size_t headerOffset = start.find(kRawTraceMagic, 0, sizeof(kRawTraceMagic));
+    if (headerOffset == std::string::npos ||
+        startSize - headerOffset < sizeof(RawTraceHeader)) {
+        fprintf(stderr, "error: not a raw trace\n");
+        return false;
+    }
+    RawTraceHeader header;
+    memcpy(&header, start.data() + headerOffset, sizeof(header));
+    RawTraceReader reader(inFd, start.substr(headerOffset + sizeof(header)));
+
+    std::map<uint32_t, unique_fd> cpuFds;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> inflated;
+    RawTraceRecord record;
+    while (reader.read(&record, sizeof(record))) {
+        if (record.size > kMaxRecordSize || record.storedSize > kMaxRecordSize) {
+            fprintf(stderr, "error: record of %u bytes is too large\n", record.size);
+            return false;
+        }
+        payload.resize(record.storedSize);
+        if (!reader.read(payload.data(), payload.size())) {
+            fprintf(stderr, "error: truncated record\n");
+            return false;
+        }
+
+        if (record.type == RAW_TRACE_FILE) {
+            auto nul = std::find(payload.begin(), payload.end(), '\0');
+            const std::string path(payload.begin(), nul);
+            if (nul == payload.end() || !isSafeRelativePath(path)) {
+                fprintf(stderr, "error: invalid file record\n");
+                return false;
+            }
+            const std::string outPath = joinPath(outFolder, path);
+            if (!makeDirectories(outPath) ||
+                !android::base::WriteStringToFile(std::string(nul + 1, payload.end()), outPath)) {
+                fprintf(stderr, "error writing %s\n", outPath.c_str());
+                return false;
+            }
+            continue;
+        }
+
+        if (record.type != RAW_TRACE_PAGES && record.type != RAW_TRACE_PAGES_DEFLATED) {
+            fprintf(stderr, "error: unknown record type %u\n", record.type);
+            return false;
+        }
+        if (record.cpu >= header.cpuCount) {
+            fprintf(stderr, "error: record for cpu%u out of %u\n", record.cpu, header.cpuCount);
+            return false;
+        }
+        const std::vector<uint8_t>* pages = &payload;
+        if (record.type == RAW_TRACE_PAGES_DEFLATED) {
+            inflated.resize(record.size);
+            uLongf inflatedSize = inflated.size();
+            if (uncompress(inflated.data(), &inflatedSize, payload.data(), payload.size()) !=
+                        Z_OK ||
+                inflatedSize != record.size) {
+                fprintf(stderr, "error inflating cpu%u pages\n", record.cpu);
+                return false;
+            }
+            pages = &inflated;
+        }
+
+        unique_fd& fd = cpuFds[record.cpu];
+        if (fd == -1) {
+            const std::string path = joinPath(outFolder,
+                                              "per_cpu/cpu" + std::to_string(record.cpu) +
+                                                      "/trace_pipe_raw");
+            if (!makeDirectories(path)) {
+                return false;
+            }
+            fd.reset(TEMP_FAILURE_RETRY(
+                    open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)));
+            if (fd == -1) {
+                fprintf(stderr, "error opening %s: %s\n", path.c_str(), strerror(errno));
+                return false;
+            }
+        }
+        if (!android::base::WriteFully(fd, pages->data(), pages->size())) {
+            fprintf(stderr, "error writing cpu%u pages: %s\n", record.cpu, strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace atrace
+} // namespace android
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+namespace android {
+namespace atrace {
+
+/*
+ * Raw trace format, as written by captureRawTrace(). All integers are in host byte order.
+ *
+ *   RawTraceHeader
+ *   RawTraceRecord, followed by storedSize bytes
+ *   ...
+ *
+ * The records of a CPU are in the order they were read, but records of different CPUs are
+ * interleaved arbitrarily. The file records come first, before any page.
+ */
+constexpr char kRawTraceMagic[8] = {'A', 'T', 'R', 'A', 'C', 'E', 'R', '1'};
+
+struct RawTraceHeader {
+    char magic[8];
+    uint32_t pageSize;
+    uint32_t cpuCount;
+};
+
+enum RawTraceRecordType : uint32_t {
+    // A tracefs file needed to decode the pages, like events/header_page or the format of an
+    // enabled event. The payload is the path relative to the trace folder, NUL terminated,
+    // followed by the file contents.
+    RAW_TRACE_FILE = 1,
+    // Ring buffer pages read from per_cpu/cpuN/trace_pipe_raw.
+    RAW_TRACE_PAGES = 2,
+    // The same, deflated with zlib.
+    RAW_TRACE_PAGES_DEFLATED = 3,
+};
+
+struct RawTraceRecord {
+    uint32_t type;
+    uint32_t cpu;
+    // Size of the payload once inflated.
+    uint32_t size;
+    // Size of the payload that follows.
+    uint32_t storedSize;
+};
+
+// Reads per_cpu/cpuN/trace_pipe_raw of |traceFolder| with one thread per CPU, and writes them to
+// |outFd| in the format above. Pages are spliced to |outFd| without being copied to userspace if
+// it allows it, or deflated in parallel by each thread if |compress| is set.
+//
+// If |stream| is set, it keeps reading until |aborted| is set. Otherwise it stops once all the
+// buffers are drained.
+bool captureRawTrace(const std::string& traceFolder, int outFd, bool compress, bool stream,
+                     const std::atomic<bool>& aborted);
+
+// Unpacks a trace written by captureRawTrace() into |outFolder|, laid out like the trace folder
+// it was captured from: pages are appended to per_cpu/cpuN/trace_pipe_raw, and files are written
+// at their path. Text printed before the header, like atrace's "TRACE:", is skipped.
+bool unpackRawTrace(int inFd, const std::string& outFolder);
+
+} // namespace atrace
+} // namespace android
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <android-base/unique_fd.h>
+
+#include "RawTrace.h"
+
+// Unpacks the output of `atrace --raw` into a folder laid out like tracefs, with the per-CPU
+// buffers in per_cpu/cpuN/trace_pipe_raw and the event formats under events/, which is what
+// offline ftrace parsers expect.
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <atrace --raw output> <output folder>\n", argv[0]);
+        return 1;
+    }
+    android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(argv[1], O_RDONLY | O_CLOEXEC)));
+    if (fd == -1) {
+        fprintf(stderr, "error opening %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    if (mkdir(argv[2], 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "error creating %s: %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+    return android::atrace::unpackRawTrace(fd.get(), argv[2]) ? 0 : 1;
+}
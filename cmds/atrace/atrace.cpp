@@ -30,6 +30,7 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <atomic>
 #include <fstream>
 #include <memory>
 
@@ -52,6 +53,8 @@
 #include <android-base/strings.h>
 #include <android-base/stringprintf.h>
 
+#include "RawTrace.h"
+
 using namespace android;
 using pdx::default_transport::ServiceUtility;
 using hardware::hidl_vec;
@@ -296,10 +299,11 @@ static const char* g_categoriesFile = nullptr;
 static const char* g_kernelTraceFuncs = nullptr;
 static const char* g_debugAppCmdLine = "";
 static const char* g_outputFile = nullptr;
+static bool g_rawTrace = false;
 
 /* Global state */
 static bool g_tracePdx = false;
-static bool g_traceAborted = false;
+static std::atomic<bool> g_traceAborted = false;
 static bool g_categoryEnables[arraysize(k_categories)] = {};
 static std::string g_traceFolder;
 static std::vector<TracingVendorFileCategory> g_vendorFileCategories;
@@ -921,6 +925,11 @@ static void stopTrace()
 // Read data from the tracing pipe and forward to stdout
 static void streamTrace()
 {
+    if (g_rawTrace) {
+        atrace::captureRawTrace(g_traceFolder, STDOUT_FILENO, g_compress, true, g_traceAborted);
+        return;
+    }
+
     char trace_data[4096];
     int traceFD = open((g_traceFolder + k_traceStreamPath).c_str(), O_RDWR);
     if (traceFD == -1) {
@@ -947,6 +956,11 @@ static void streamTrace()
 static void dumpTrace(int outFd)
 {
     ALOGI("Dumping trace");
+    if (g_rawTrace) {
+        atrace::captureRawTrace(g_traceFolder, outFd, g_compress, false, g_traceAborted);
+        return;
+    }
+
     int traceFD = open((g_traceFolder + k_tracePath).c_str(), O_RDWR);
     if (traceFD == -1) {
         fprintf(stderr, "error opening %s: %s (%d)\n", k_tracePath,
@@ -1098,6 +1112,9 @@ static void showHelp(const char *cmd)
                     "  -s N            sleep for N seconds before tracing [default 0]\n"
                     "  -t N            trace for N seconds [default 5]\n"
                     "  -z              compress the trace dump\n"
+                    "  --raw           dump or stream the binary per-CPU buffers, read in\n"
+                    "                    parallel; with -z, they are compressed in parallel\n"
+                    "                    too. Unpack the output with atrace_raw_convert.\n"
                     "  --async_start   start circular trace and return immediately\n"
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
@@ -1276,6 +1293,7 @@ int main(int argc, char **argv)
             {"only_userspace",    no_argument, nullptr,  0 },
             {"list_categories",   no_argument, nullptr,  0 },
             {"stream",            no_argument, nullptr,  0 },
+            {"raw",               no_argument, nullptr,  0 },
             {nullptr,                       0, nullptr,  0 }
         };
 
@@ -1348,6 +1366,8 @@ int main(int argc, char **argv)
                 } else if (!strcmp(long_options[option_index].name, "stream")) {
                     traceStream = true;
                     traceDump = false;
+                } else if (!strcmp(long_options[option_index].name, "raw")) {
+                    g_rawTrace = true;
                 } else if (!strcmp(long_options[option_index].name, "list_categories")) {
                     listSupportedCategories();
                     exit(0);
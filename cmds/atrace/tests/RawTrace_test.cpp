@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "../RawTrace.h"
+
+namespace android {
+namespace atrace {
+
+namespace {
+
+constexpr int kCpuCount = 4;
+
+std::string readFile(const std::string& path) {
+    std::string contents;
+    EXPECT_TRUE(android::base::ReadFileToString(path, &contents)) << path;
+    return contents;
+}
+
+void writeFile(const std::string& path, const std::string& contents) {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos;
+         slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+    }
+    ASSERT_TRUE(android::base::WriteStringToFile(contents, path)) << path;
+}
+
+// Not a multiple of the page size, so some reads return partial pages.
+std::string makePages(int cpu) {
+    std::string pages((cpu + 1) * 100 * 1024 + 123, '\0');
+    uint32_t state = cpu + 1;
+    for (char& c : pages) {
+        state = state * 1664525u + 1013904223u;
+        c = static_cast<char>(state >> 24);
+    }
+    // Make it compressible, like real pages that are mostly headers and padding.
+    std::fill(pages.begin(), pages.begin() + pages.size() / 2, '\0');
+    return pages;
+}
+
+std::string cpuBufferPath(const std::string& folder, int cpu) {
+    return folder + "/per_cpu/cpu" + std::to_string(cpu) + "/trace_pipe_raw";
+}
+
+} // namespace
+
+// Captures a fake tracefs folder, and checks that unpacking gives it back.
+class RawTraceTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        for (int cpu = 0; cpu < kCpuCount; cpu++) {
+            writeFile(cpuBufferPath(mTraceFolder.path, cpu), makePages(cpu));
+        }
+        writeFile(std::string(mTraceFolder.path) + "/events/header_page", "header page format");
+        writeFile(std::string(mTraceFolder.path) + "/events/sched/sched_switch/enable", "1\n");
+        writeFile(std::string(mTraceFolder.path) + "/events/sched/sched_switch/format",
+                  "sched_switch format");
+        writeFile(std::string(mTraceFolder.path) + "/events/irq/irq_handler_entry/enable", "0\n");
+        writeFile(std::string(mTraceFolder.path) + "/events/irq/irq_handler_entry/format",
+                  "irq_handler_entry format");
+    }
+
+    bool captureAndUnpack(bool compress, bool stream) {
+        android::base::TemporaryFile output;
+        // Like atrace, which prints this before the trace.
+        EXPECT_TRUE(android::base::WriteStringToFd("TRACE:\n", output.fd));
+        std::atomic<bool> aborted = false;
+        if (!captureRawTrace(mTraceFolder.path, output.fd, compress, stream, aborted)) {
+            return false;
+        }
+        android::base::unique_fd fd(open(output.path, O_RDONLY | O_CLOEXEC));
+        return unpackRawTrace(fd.get(), mUnpackedFolder.path);
+    }
+
+    android::base::TemporaryDir mTraceFolder;
+    android::base::TemporaryDir mUnpackedFolder;
+};
+
+TEST_P(RawTraceTest, DumpRoundTrips) {
+    ASSERT_TRUE(captureAndUnpack(GetParam(), /*stream=*/false));
+    for (int cpu = 0; cpu < kCpuCount; cpu++) {
+        EXPECT_EQ(makePages(cpu), readFile(cpuBufferPath(mUnpackedFolder.path, cpu)))
+                << "cpu" << cpu;
+    }
+    EXPECT_EQ("header page format",
+              readFile(std::string(mUnpackedFolder.path) + "/events/header_page"));
+    EXPECT_EQ("sched_switch format",
+              readFile(std::string(mUnpackedFolder.path) + "/events/sched/sched_switch/format"));
+    // Only the formats of the enabled events are needed.
+    EXPECT_NE(0, access((std::string(mUnpackedFolder.path) +
+                         "/events/irq/irq_handler_entry/format")
+                                .c_str(),
+                        F_OK));
+}
+
+TEST_P(RawTraceTest, StreamStopsAtEndOfBuffers) {
+    ASSERT_TRUE(captureAndUnpack(GetParam(), /*stream=*/true));
+    for (int cpu = 0; cpu < kCpuCount; cpu++) {
+        EXPECT_EQ(makePages(cpu), readFile(cpuBufferPath(mUnpackedFolder.path, cpu)))
+                << "cpu" << cpu;
+    }
+}
+
+TEST_P(RawTraceTest, FailsWithoutPerCpuBuffers) {
+    android::base::TemporaryDir emptyFolder;
+    android::base::TemporaryFile output;
+    std::atomic<bool> aborted = false;
+    EXPECT_FALSE(captureRawTrace(emptyFolder.path, output.fd, GetParam(), false, aborted));
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, RawTraceTest, ::testing::Bool(),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "Deflated" : "Spliced";
+                         });
+
+TEST(RawTraceUnpackTest, RejectsOtherFiles) {
+    android::base::TemporaryFile input;
+    ASSERT_TRUE(android::base::WriteStringToFd("# tracer: nop\n", input.fd));
+    android::base::TemporaryDir unpackedFolder;
+    android::base::unique_fd fd(open(input.path, O_RDONLY | O_CLOEXEC));
+    EXPECT_FALSE(unpackRawTrace(fd.get(), unpackedFolder.path));
+}
+
+} // namespace atrace
+} // namespace android
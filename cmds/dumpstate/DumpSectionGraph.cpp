@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "dumpstate"
+
+#include "DumpSectionGraph.h"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <array>
+
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+
+#include "DumpPool.h"
+#include "dumpstate.h"
+#include "DumpstateInternal.h"
+#include "DumpstateUtil.h"
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+using android::base::StringAppendF;
+using android::base::StringPrintf;
+
+namespace {
+
+const char* ResourceClassName(ResourceClass resource_class) {
+    switch (resource_class) {
+        case ResourceClass::CPU:
+            return "cpu";
+        case ResourceClass::BINDER:
+            return "binder";
+        case ResourceClass::IO:
+            return "io";
+    }
+    return "unknown";
+}
+
+int64_t ToMillis(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+}  // namespace
+
+DumpSectionGraph::DumpSectionGraph(const std::string& tmp_root)
+    : tmp_root_(tmp_root), started_(false), shutdown_(false), log_duration_(true) {
+    assert(!tmp_root.empty());
+}
+
+DumpSectionGraph::~DumpSectionGraph() {
+    std::unique_lock lock(lock_);
+    shutdown_ = true;
+    for (auto& node : nodes_) {
+        if (node.state == State::PENDING || node.state == State::READY) {
+            node.state = State::SKIPPED;
+        }
+    }
+    condition_variable_.notify_all();
+    lock.unlock();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+
+    for (auto& node : nodes_) {
+        if (!node.output_path.empty() && unlink(node.output_path.c_str())) {
+            MYLOGE("Failed to unlink (%s): %s\n", node.output_path.c_str(), strerror(errno));
+        }
+    }
+}
+
+bool DumpSectionGraph::addSection(DumpSection section) {
+    std::unique_lock lock(lock_);
+    assert(!started_);
+    if (index_by_title_.count(section.title)) {
+        MYLOGE("Duplicate dump section: %s\n", section.title.c_str());
+        return false;
+    }
+
+    // Dependencies must be added first, which also guarantees the graph has no cycles.
+    size_t index = nodes_.size();
+    std::vector<size_t> dependencies;
+    for (const auto& dependency : section.dependencies) {
+        auto it = index_by_title_.find(dependency);
+        if (it == index_by_title_.end()) {
+            MYLOGE("Dump section %s depends on unknown section %s\n", section.title.c_str(),
+                   dependency.c_str());
+            return false;
+        }
+        dependencies.push_back(it->second);
+    }
+
+    for (size_t dependency : dependencies) {
+        nodes_[dependency].dependents.push_back(index);
+    }
+    index_by_title_[section.title] = index;
+    Node& node = nodes_.emplace_back();
+    node.remaining_dependencies = dependencies.size();
+    node.section = std::move(section);
+    return true;
+}
+
+void DumpSectionGraph::setMaxConcurrency(ResourceClass resource_class, int max_concurrency) {
+    assert(max_concurrency > 0);
+    std::unique_lock lock(lock_);
+    max_concurrency_[resource_class] = max_concurrency;
+}
+
+void DumpSectionGraph::start(int thread_count) {
+    assert(thread_count > 0);
+    std::unique_lock lock(lock_);
+    assert(!started_);
+    if (thread_count > MAX_THREAD_COUNT) {
+        thread_count = MAX_THREAD_COUNT;
+    }
+    MYLOGI("Start dump section graph: %zu sections, %d threads\n", nodes_.size(), thread_count);
+    started_ = true;
+    start_time_ = Clock::now();
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        if (nodes_[i].remaining_dependencies == 0) {
+            markReadyLocked(i, -1);
+        }
+    }
+    for (int i = 0; i < thread_count; i++) {
+        threads_.emplace_back(std::thread([=]() {
+            std::array<char, 15> name;
+            snprintf(name.data(), name.size(), "dumpsection_%d", i + 1);
+            pthread_setname_np(pthread_self(), name.data());
+            loop();
+        }));
+    }
+}
+
+void DumpSectionGraph::waitForSection(const std::string& title, int out_fd) {
+    std::unique_lock lock(lock_);
+    auto it = index_by_title_.find(title);
+    if (it == index_by_title_.end()) {
+        MYLOGE("Waiting for unknown dump section: %s\n", title.c_str());
+        return;
+    }
+    waitForSectionLocked(it->second, out_fd, lock);
+}
+
+void DumpSectionGraph::waitForAll(int out_fd) {
+    std::unique_lock lock(lock_);
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        waitForSectionLocked(i, out_fd, lock);
+    }
+}
+
+std::string DumpSectionGraph::getTimingReport() {
+    std::unique_lock lock(lock_);
+    static const char* kStateNames[] = {"pending", "ready", "running", "timed_out", "done",
+                                        "skipped"};
+    std::string report = StringPrintf("%-48s %-7s %5s %-9s %9s %9s %9s\n", "SECTION", "CLASS",
+                                      "PRIO", "STATE", "READY_MS", "START_MS", "TOTAL_MS");
+    ssize_t last = -1;
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        const Node& node = nodes_[i];
+        bool ran = node.start_time != Clock::time_point();
+        bool finished = node.end_time != Clock::time_point();
+        StringAppendF(&report, "%-48s %-7s %5d %-9s %9s %9s %9s\n", node.section.title.c_str(),
+                      ResourceClassName(node.section.resource_class), node.section.priority,
+                      kStateNames[static_cast<int>(node.state)],
+                      node.ready_time == Clock::time_point()
+                              ? "-"
+                              : std::to_string(ToMillis(node.ready_time - start_time_)).c_str(),
+                      ran ? std::to_string(ToMillis(node.start_time - start_time_)).c_str() : "-",
+                      finished ? std::to_string(ToMillis(node.end_time - node.start_time)).c_str()
+                               : "-");
+        if (finished && (last < 0 || node.end_time > nodes_[last].end_time)) {
+            last = i;
+        }
+    }
+
+    if (last < 0) {
+        return report;
+    }
+
+    // Walk back from the section that finished last through the dependencies that gated each
+    // section's start.
+    std::vector<size_t> path;
+    for (ssize_t i = last; i >= 0; i = nodes_[i].gating_dependency) {
+        path.push_back(i);
+    }
+    std::reverse(path.begin(), path.end());
+    StringAppendF(&report, "\nCritical path (%" PRId64 " ms):",
+                  ToMillis(nodes_[last].end_time - start_time_));
+    for (size_t i = 0; i < path.size(); i++) {
+        const Node& node = nodes_[path[i]];
+        StringAppendF(&report, "%s %s", i == 0 ? "" : " ->", node.section.title.c_str());
+        if (node.end_time != Clock::time_point()) {
+            StringAppendF(&report, " (%" PRId64 " ms)", ToMillis(node.end_time - node.start_time));
+        } else {
+            report += " (timed out)";
+        }
+    }
+    report += "\n";
+    return report;
+}
+
+void DumpSectionGraph::setLogDuration(bool log_duration) {
+    log_duration_ = log_duration;
+}
+
+void DumpSectionGraph::loop() {
+    std::unique_lock lock(lock_);
+    while (!shutdown_) {
+        Clock::time_point deadline = checkTimeoutsLocked();
+        ssize_t index = pickReadySectionLocked();
+        if (index < 0) {
+            if (deadline == Clock::time_point::max()) {
+                condition_variable_.wait(lock);
+            } else {
+                condition_variable_.wait_until(lock, deadline);
+            }
+            continue;
+        }
+        runSection(index, lock);
+    }
+}
+
+void DumpSectionGraph::runSection(size_t index, std::unique_lock<std::mutex>& lock) {
+    // nodes_ isn't resized once the graph is started, so the reference stays valid while unlocked.
+    Node& node = nodes_[index];
+    node.state = State::RUNNING;
+    node.start_time = Clock::now();
+    running_[node.section.resource_class]++;
+    lock.unlock();
+
+    int fd = -1;
+    std::string output_path = createTempFile(&fd);
+    android::base::unique_fd out_fd(fd);
+    if (out_fd.get() != -1) {
+        {
+            DurationReporter duration_reporter(node.section.title, /*logcat_only =*/!log_duration_,
+                                               /*verbose =*/false, out_fd.get());
+            std::invoke(node.section.dump_func, out_fd.get());
+        }
+        fsync(out_fd.get());
+    }
+    out_fd.reset();
+
+    lock.lock();
+    node.end_time = Clock::now();
+    running_[node.section.resource_class]--;
+    if (node.consumed) {
+        // The output was abandoned after the section timed out.
+        if (!output_path.empty() && unlink(output_path.c_str())) {
+            MYLOGE("Failed to unlink (%s): %s\n", output_path.c_str(), strerror(errno));
+        }
+    } else {
+        node.output_path = std::move(output_path);
+    }
+    node.state = State::DONE;
+    releaseDependentsLocked(index);
+    condition_variable_.notify_all();
+}
+
+ssize_t DumpSectionGraph::pickReadySectionLocked() {
+    ssize_t picked = -1;
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        const Node& node = nodes_[i];
+        if (node.state != State::READY) {
+            continue;
+        }
+        auto max_it = max_concurrency_.find(node.section.resource_class);
+        int max_concurrency = max_it == max_concurrency_.end() ? static_cast<int>(threads_.size())
+                                                               : max_it->second;
+        if (running_[node.section.resource_class] >= max_concurrency) {
+            continue;
+        }
+        if (picked < 0 || node.section.priority > nodes_[picked].section.priority ||
+            (node.section.priority == nodes_[picked].section.priority &&
+             node.ready_time < nodes_[picked].ready_time)) {
+            picked = i;
+        }
+    }
+    return picked;
+}
+
+void DumpSectionGraph::markReadyLocked(size_t index, ssize_t gating_dependency) {
+    Node& node = nodes_[index];
+    node.state = State::READY;
+    node.ready_time = Clock::now();
+    node.gating_dependency = gating_dependency;
+}
+
+void DumpSectionGraph::releaseDependentsLocked(size_t index) {
+    Node& node = nodes_[index];
+    if (node.released) {
+        return;
+    }
+    node.released = true;
+    for (size_t dependent : node.dependents) {
+        if (--nodes_[dependent].remaining_dependencies == 0 &&
+            nodes_[dependent].state == State::PENDING) {
+            markReadyLocked(dependent, index);
+        }
+    }
+}
+
+DumpSectionGraph::Clock::time_point DumpSectionGraph::checkTimeoutsLocked() {
+    Clock::time_point now = Clock::now();
+    Clock::time_point next_deadline = Clock::time_point::max();
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        Node& node = nodes_[i];
+        if (node.state != State::RUNNING || node.section.timeout.count() == 0) {
+            continue;
+        }
+        Clock::time_point deadline = node.start_time + node.section.timeout;
+        if (now < deadline) {
+            next_deadline = std::min(next_deadline, deadline);
+            continue;
+        }
+        MYLOGE("Dump section %s timed out after %" PRId64 " ms\n", node.section.title.c_str(),
+               static_cast<int64_t>(node.section.timeout.count()));
+        node.state = State::TIMED_OUT;
+        releaseDependentsLocked(i);
+        condition_variable_.notify_all();
+    }
+    return next_deadline;
+}
+
+void DumpSectionGraph::waitForSectionLocked(size_t index, int out_fd,
+                                            std::unique_lock<std::mutex>& lock) {
+    if (!started_) {
+        MYLOGE("Waiting for dump section before the graph was started\n");
+        return;
+    }
+    Node& node = nodes_[index];
+    if (node.consumed) {
+        return;
+    }
+    DurationReporter duration_reporter("Wait for " + node.section.title, true);
+    while (!isSettled(node)) {
+        Clock::time_point deadline = checkTimeoutsLocked();
+        if (isSettled(node)) {
+            break;
+        }
+        if (deadline == Clock::time_point::max()) {
+            condition_variable_.wait(lock);
+        } else {
+            condition_variable_.wait_until(lock, deadline);
+        }
+    }
+    node.consumed = true;
+
+    if (node.state == State::TIMED_OUT) {
+        dprintf(out_fd, "*** %s timed out after %" PRId64 " ms, its output was skipped\n",
+                node.section.title.c_str(), static_cast<int64_t>(node.section.timeout.count()));
+        return;
+    }
+    if (node.output_path.empty()) {
+        return;
+    }
+
+    std::string output_path = std::move(node.output_path);
+    node.output_path.clear();
+    lock.unlock();
+    DumpFileToFd(out_fd, "", output_path);
+    if (unlink(output_path.c_str())) {
+        MYLOGE("Failed to unlink (%s): %s\n", output_path.c_str(), strerror(errno));
+    }
+    lock.lock();
+}
+
+bool DumpSectionGraph::isSettled(const Node& node) const {
+    return node.state == State::DONE || node.state == State::TIMED_OUT ||
+            node.state == State::SKIPPED;
+}
+
+std::string DumpSectionGraph::createTempFile(int* fd) {
+    // Shares the DumpPool prefix so leftovers are cleaned up by DumpPool::deleteTempFiles().
+    std::string path = tmp_root_ + "/" + DumpPool::PREFIX_TMPFILE_NAME + "XXXXXX";
+    *fd = TEMP_FAILURE_RETRY(mkostemp(path.data(), O_CLOEXEC));
+    if (*fd == -1) {
+        MYLOGE("open(%s, %s)\n", path.c_str(), strerror(errno));
+        return "";
+    }
+    return path;
+}
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
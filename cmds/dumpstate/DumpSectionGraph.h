@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORK_NATIVE_CMD_DUMPSECTIONGRAPH_H_
+#define FRAMEWORK_NATIVE_CMD_DUMPSECTIONGRAPH_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/macros.h>
+#include <unistd.h>
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+class DumpSectionGraphTest;
+
+/*
+ * The kind of resource a dump section mostly waits on. Sections of the same class are
+ * throttled together, e.g. so that binder heavy sections don't all hit system_server at once.
+ */
+enum class ResourceClass {
+    CPU = 0,
+    BINDER,
+    IO,
+};
+
+/*
+ * A single unit of work in the bugreport, declared up front so it can be scheduled in parallel.
+ */
+struct DumpSection {
+    /* The name of the section. It's also the title of its output and DurationReporter log. */
+    std::string title;
+
+    /* Callable that writes the section's output to the given fd. */
+    std::function<void(int)> dump_func;
+
+    ResourceClass resource_class = ResourceClass::IO;
+
+    /* Among runnable sections, higher priorities are started first. */
+    int priority = 0;
+
+    /*
+     * How long the section may run before it's considered timed out, 0 for no limit. A timed out
+     * section keeps running, but no longer blocks its dependents or waitForSection().
+     */
+    std::chrono::milliseconds timeout{0};
+
+    /* Titles of sections, added before this one, that must finish before this one starts. */
+    std::vector<std::string> dependencies;
+};
+
+/*
+ * Runs a graph of dump sections on a fixed number of threads. Each section runs once all its
+ * dependencies are done, subject to a concurrency limit per ResourceClass, and writes its output
+ * to a temporary file. The output is copied to the bugreport when the section is waited on, so
+ * the report keeps a stable order regardless of the order in which sections actually ran.
+ *
+ * DumpSectionGraph graph(tmp_root);
+ * graph.setMaxConcurrency(ResourceClass::BINDER, 2);
+ * graph.addSection({.title = "FOO", .dump_func = &DumpFoo});
+ * graph.addSection({.title = "BAR", .dump_func = &DumpBar, .dependencies = {"FOO"}});
+ * graph.start();
+ * ...
+ * graph.waitForSection("FOO");
+ * graph.waitForSection("BAR");
+ * ds.AddTextZipEntry("dumpstate_section_timings.txt", graph.getTimingReport());
+ */
+class DumpSectionGraph {
+  friend class android::os::dumpstate::DumpSectionGraphTest;
+
+  public:
+    /*
+     * |tmp_root| A path to a temporary folder for sections to write their output to.
+     */
+    explicit DumpSectionGraph(const std::string& tmp_root);
+
+    /*
+     * Waits for running sections to finish. Sections which haven't started yet are skipped.
+     */
+    ~DumpSectionGraph();
+
+    /*
+     * Adds a section to the graph. Must be called before start(). Returns false if the title is
+     * already used or a dependency hasn't been added yet.
+     */
+    bool addSection(DumpSection section);
+
+    /*
+     * Limits how many sections of |resource_class| may run at the same time. Must be called
+     * before start(). Defaults to the number of threads.
+     */
+    void setMaxConcurrency(ResourceClass resource_class, int max_concurrency);
+
+    /*
+     * Starts the threads which run the sections.
+     */
+    void start(int thread_count = MAX_THREAD_COUNT);
+
+    /*
+     * Waits until the section finishes or times out, then dumps its output to |out_fd|.
+     */
+    void waitForSection(const std::string& title, int out_fd = STDOUT_FILENO);
+
+    /*
+     * Waits for every section that hasn't been waited on yet, dumping their output to |out_fd| in
+     * the order they were added.
+     */
+    void waitForAll(int out_fd = STDOUT_FILENO);
+
+    /*
+     * Returns a human readable report of when each section was queued, started and finished,
+     * followed by the critical path through the graph.
+     */
+    std::string getTimingReport();
+
+    static const int MAX_THREAD_COUNT = 4;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State {
+        PENDING = 0,  // Waiting on dependencies.
+        READY,        // Waiting on a thread or resource class slot.
+        RUNNING,
+        TIMED_OUT,    // Still running, but past its timeout.
+        DONE,
+        SKIPPED,      // Never ran because the graph was destroyed first.
+    };
+
+    struct Node {
+        DumpSection section;
+        std::vector<size_t> dependents;
+        size_t remaining_dependencies = 0;
+        State state = State::PENDING;
+        // Whether the dependents of this section have been released.
+        bool released = false;
+        // Whether the output has been dumped, or abandoned because the section timed out.
+        bool consumed = false;
+        std::string output_path;
+        // The dependency that finished last, i.e. the one which gated this section's start.
+        ssize_t gating_dependency = -1;
+        Clock::time_point ready_time;
+        Clock::time_point start_time;
+        Clock::time_point end_time;
+    };
+
+    void loop();
+    void runSection(size_t index, std::unique_lock<std::mutex>& lock);
+    ssize_t pickReadySectionLocked();
+    void markReadyLocked(size_t index, ssize_t gating_dependency);
+    void releaseDependentsLocked(size_t index);
+    // Marks running sections past their timeout as TIMED_OUT, and returns the next deadline.
+    Clock::time_point checkTimeoutsLocked();
+    void waitForSectionLocked(size_t index, int out_fd, std::unique_lock<std::mutex>& lock);
+    bool isSettled(const Node& node) const;
+    std::string createTempFile(int* fd);
+
+    /*
+     * For test purpose only. Enables or disables logging duration of the sections.
+     */
+    void setLogDuration(bool log_duration);
+
+    std::string tmp_root_;
+    bool started_;
+    bool shutdown_;
+    bool log_duration_;  // For test purpose only, the default value is true.
+    Clock::time_point start_time_;
+
+    std::mutex lock_;  // A lock for everything below.
+    std::condition_variable condition_variable_;
+    std::vector<Node> nodes_;
+    std::map<std::string, size_t> index_by_title_;
+    std::map<ResourceClass, int> max_concurrency_;
+    std::map<ResourceClass, int> running_;
+    std::vector<std::thread> threads_;
+
+    DISALLOW_COPY_AND_ASSIGN(DumpSectionGraph);
+};
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
+
+#endif  // FRAMEWORK_NATIVE_CMD_DUMPSECTIONGRAPH_H_
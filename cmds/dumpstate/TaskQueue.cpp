@@ -16,6 +16,8 @@
 
 #include "TaskQueue.h"
 
+#include <pthread.h>
+
 namespace android {
 namespace os {
 namespace dumpstate {
@@ -24,8 +26,43 @@ TaskQueue::~TaskQueue() {
     run(/* do_cancel = */true);
 }
 
+void TaskQueue::start() {
+    std::unique_lock lock(lock_);
+    if (thread_.joinable()) {
+        return;
+    }
+    stopping_ = false;
+    thread_ = std::thread([this]() {
+        pthread_setname_np(pthread_self(), "dumpstate_zip");
+        loop();
+    });
+}
+
+void TaskQueue::loop() {
+    std::unique_lock lock(lock_);
+    while (true) {
+        condition_variable_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+        if (stopping_) {
+            // Leaves the remaining tasks to run(), which knows whether to cancel them.
+            return;
+        }
+        auto task = tasks_.front();
+        tasks_.pop();
+        lock.unlock();
+        std::invoke(task, /* cancelled = */false);
+        lock.lock();
+    }
+}
+
 void TaskQueue::run(bool do_cancel) {
     std::unique_lock lock(lock_);
+    if (thread_.joinable()) {
+        stopping_ = true;
+        lock.unlock();
+        condition_variable_.notify_all();
+        thread_.join();
+        lock.lock();
+    }
     while (!tasks_.empty()) {
         auto task = tasks_.front();
         tasks_.pop();
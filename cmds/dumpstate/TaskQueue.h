@@ -17,8 +17,11 @@
 #ifndef FRAMEWORK_NATIVE_CMD_TASKQUEUE_H_
 #define FRAMEWORK_NATIVE_CMD_TASKQUEUE_H_
 
+#include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <queue>
+#include <thread>
 
 #include <android-base/macros.h>
 
@@ -26,13 +29,21 @@ namespace android {
 namespace os {
 namespace dumpstate {
 
+class TaskQueueTest;
+
 /*
  * A task queue for dumpstate to collect tasks such as adding file to the zip
  * which are needed to run in a single thread. The task is a callable function
  * included a cancel task boolean parameter. The TaskQueue could
  * cancel the task in the destructor if the task has never been called.
+ *
+ * By default tasks only run when run() is called. After start(), a worker
+ * thread runs them in order as soon as they're added, so that e.g. zip entries
+ * are compressed while the rest of the bugreport is still being dumped.
  */
 class TaskQueue {
+  friend class android::os::dumpstate::TaskQueueTest;
+
   public:
     TaskQueue() = default;
     ~TaskQueue();
@@ -51,20 +62,33 @@ class TaskQueue {
         tasks_.emplace([=](bool cancelled) {
             std::invoke(func, cancelled);
         });
+        condition_variable_.notify_one();
     }
 
     /*
-     * Invokes all tasks in the task queue.
+     * Starts a worker thread which runs the tasks, one at a time, as soon as
+     * they're added.
+     */
+    void start();
+
+    /*
+     * Stops the worker thread, if any, once it finishes its current task, then
+     * invokes all remaining tasks in the task queue.
      *
-     * |do_cancel| true to cancel all tasks in the queue.
+     * |do_cancel| true to cancel all remaining tasks in the queue.
      */
     void run(bool do_cancel);
 
   private:
     using Task = std::function<void(bool)>;
 
+    void loop();
+
     std::mutex lock_;
+    std::condition_variable condition_variable_;
     std::queue<Task> tasks_;
+    bool stopping_ = false;
+    std::thread thread_;
 
     DISALLOW_COPY_AND_ASSIGN(TaskQueue);
 };
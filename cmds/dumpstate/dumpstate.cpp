@@ -95,6 +95,7 @@
 #include <utility>
 #include <vector>
 
+#include "DumpSectionGraph.h"
 #include "DumpstateInternal.h"
 #include "DumpstateService.h"
 
@@ -124,7 +125,9 @@ using android::os::IDumpstateListener;
 using android::os::dumpstate::CommandOptions;
 using android::os::dumpstate::DumpFileToFd;
 using android::os::dumpstate::DumpPool;
+using android::os::dumpstate::DumpSectionGraph;
 using android::os::dumpstate::PropertiesHelper;
+using android::os::dumpstate::ResourceClass;
 using android::os::dumpstate::TaskQueue;
 using android::os::dumpstate::WaitForTask;
 
@@ -239,6 +242,11 @@ static const std::string SHUTDOWN_CHECKPOINTS_FILE_PREFIX = "checkpoints-";
     WaitForTask(future);                     \
     RETURN_IF_USER_DENIED_CONSENT();
 
+#define WAIT_SECTION_WITH_CONSENT_CHECK(sections, title) \
+    RETURN_IF_USER_DENIED_CONSENT();                     \
+    sections->waitForSection(title);                     \
+    RETURN_IF_USER_DENIED_CONSENT();
+
 static const char* WAKE_LOCK_NAME = "dumpstate_wakelock";
 
 // Names of parallel tasks, they are used for the DumpPool to identify the dump
@@ -250,6 +258,24 @@ static const std::string DUMP_HALS_TASK = "DUMP HALS";
 static const std::string DUMP_BOARD_TASK = "dumpstate_board()";
 static const std::string DUMP_CHECKINS_TASK = "DUMP CHECKINS";
 static const std::string SERIALIZE_PERFETTO_TRACE_TASK = "SERIALIZE PERFETTO TRACE";
+static const std::string CPU_INFO_SECTION = "CPU INFO";
+static const std::string PROCESSES_AND_THREADS_SECTION = "PROCESSES AND THREADS";
+static const std::string NETSTAT_SECTION = "NETSTAT";
+static const std::string MODULES_INFO_SECTION = "MODULES INFO";
+static const std::string LIST_OF_OPEN_FILES_SECTION = "LIST OF OPEN FILES";
+
+// Kernel memory files dumped one after the other. Reading some of them takes kernel locks that
+// can stall for a while, so they're read on the section graph when the parallel run is enabled.
+static const std::vector<std::pair<std::string, std::string>> MEMORY_FILE_SECTIONS = {
+        {"VIRTUAL MEMORY STATS", "/proc/vmstat"},
+        {"VMALLOC INFO", "/proc/vmallocinfo"},
+        {"SLAB INFO", "/proc/slabinfo"},
+        {"ZONEINFO", "/proc/zoneinfo"},
+        {"PAGETYPEINFO", "/proc/pagetypeinfo"},
+        {"BUDDYINFO", "/proc/buddyinfo"},
+};
+// A read of a kernel file can't be interrupted, so stop waiting for it after this long.
+static const std::chrono::milliseconds FILE_SECTION_TIMEOUT = std::chrono::seconds(10);
 
 namespace android {
 namespace os {
@@ -366,8 +392,9 @@ static void RunDumpsys(const std::string& title, const std::vector<std::string>&
                        int out_fd) {
     return ds.RunDumpsys(title, dumpsysArgs, Dumpstate::DEFAULT_DUMPSYS, 0, out_fd);
 }
-static int DumpFile(const std::string& title, const std::string& path) {
-    return ds.DumpFile(title, path);
+static int DumpFile(const std::string& title, const std::string& path,
+                    int out_fd = STDOUT_FILENO) {
+    return ds.DumpFile(title, path, out_fd);
 }
 
 // Relative directory (inside the zip) for all files copied as-is into the bugreport.
@@ -862,6 +889,7 @@ status_t Dumpstate::AddZipEntryFromFd(const std::string& entry_name, int fd,
 
     // Logging statement  below is useful to time how long each entry takes, but it's too verbose.
     // MYLOGD("Adding zip entry %s\n", entry_name.c_str());
+    std::lock_guard<std::mutex> lock(zip_writer_lock_);
     size_t flags = ZipWriter::kCompress | ZipWriter::kDefaultCompression;
     int32_t err = zip_writer_->StartEntryWithTime(valid_name.c_str(), flags,
                                                   get_mtime(fd, ds.now_));
@@ -955,6 +983,7 @@ void Dumpstate::AddDir(const std::string& dir, bool recursive) {
 
 bool Dumpstate::AddTextZipEntry(const std::string& entry_name, const std::string& content) {
     MYLOGD("Adding zip text entry %s\n", entry_name.c_str());
+    std::lock_guard<std::mutex> lock(zip_writer_lock_);
     size_t flags = ZipWriter::kCompress | ZipWriter::kDefaultCompression;
     int32_t err = zip_writer_->StartEntryWithTime(entry_name.c_str(), flags, ds.now_);
     if (err != 0) {
@@ -1364,7 +1393,10 @@ static Dumpstate::RunStatus RunDumpsysProto(const std::string& title, int priori
             dumpsys.stopDumpThread(dumpTerminated);
         }
         ZipWriter::FileEntry file_entry;
-        ds.zip_writer_->GetLastEntry(&file_entry);
+        {
+            std::lock_guard<std::mutex> lock(ds.zip_writer_lock_);
+            ds.zip_writer_->GetLastEntry(&file_entry);
+        }
 
         auto elapsed_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now() - start);
@@ -1654,22 +1686,119 @@ static void DumpAppInfos(int out_fd = STDOUT_FILENO) {
 Dumpstate::RunStatus Dumpstate::dumpstate() {
     DurationReporter duration_reporter("DUMPSTATE");
 
-    // Enqueue slow functions into the thread pool, if the parallel run is enabled.
-    std::future<std::string> dump_hals, dump_incident_report, dump_board, dump_checkins,
-        dump_netstats_report;
+    struct stat s;
+    const bool has_proc_modules = stat("/proc/modules", &s) == 0;
+
+    // Schedule slow sections to run in parallel, if the parallel run is enabled. Sections are
+    // started in priority order, which follows the order they're waited on below. Their output is
+    // still copied into the report at the point where they would have run serially. Every other
+    // section depends on CPU INFO, so that top runs alone on the graph and its snapshot isn't
+    // skewed by the dump itself; the main thread meanwhile dumps the small sections before it.
+    std::unique_ptr<DumpSectionGraph> sections;
     if (ds.dump_pool_) {
-        // Pool was shutdown in DumpstateDefaultAfterCritical method in order to
-        // drop root user. Restarts it.
-        ds.dump_pool_->start(/* thread_counts = */3);
-
-        dump_hals = ds.dump_pool_->enqueueTaskWithFd(DUMP_HALS_TASK, &DumpHals, _1);
-        dump_incident_report = ds.dump_pool_->enqueueTask(
-            DUMP_INCIDENT_REPORT_TASK, &DumpIncidentReport);
-        dump_netstats_report = ds.dump_pool_->enqueueTask(
-            DUMP_NETSTATS_PROTO_TASK, &DumpNetstatsProto);
-        dump_board = ds.dump_pool_->enqueueTaskWithFd(
-            DUMP_BOARD_TASK, &Dumpstate::DumpstateBoard, &ds, _1);
-        dump_checkins = ds.dump_pool_->enqueueTaskWithFd(DUMP_CHECKINS_TASK, &DumpCheckins, _1);
+        sections = std::make_unique<DumpSectionGraph>(ds.bugreport_internal_dir_);
+        // Binder bound sections mostly wait on system_server and HALs, so don't let them all pile
+        // onto those at once.
+        sections->setMaxConcurrency(ResourceClass::BINDER, 2);
+        sections->setMaxConcurrency(ResourceClass::CPU, 1);
+
+        sections->addSection({.title = CPU_INFO_SECTION,
+                              .dump_func =
+                                      [](int out_fd) {
+                                          RunCommand(CPU_INFO_SECTION,
+                                                     {"top", "-b", "-n", "1", "-H", "-s", "6",
+                                                      "-o",
+                                                      "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,"
+                                                      "cmd,name"},
+                                                     CommandOptions::DEFAULT, false, out_fd);
+                                      },
+                              .resource_class = ResourceClass::CPU,
+                              .priority = 10});
+        for (const auto& file_section : MEMORY_FILE_SECTIONS) {
+            sections->addSection({.title = file_section.first,
+                                  .dump_func =
+                                          [&file_section](int out_fd) {
+                                              DumpFile(file_section.first, file_section.second,
+                                                       out_fd);
+                                          },
+                                  .resource_class = ResourceClass::IO,
+                                  .priority = 9,
+                                  .timeout = FILE_SECTION_TIMEOUT,
+                                  .dependencies = {CPU_INFO_SECTION}});
+        }
+        sections->addSection({.title = PROCESSES_AND_THREADS_SECTION,
+                              .dump_func =
+                                      [](int out_fd) {
+                                          RunCommand(PROCESSES_AND_THREADS_SECTION,
+                                                     {"ps", "-A", "-T", "-Z", "-O",
+                                                      "pri,nice,rtprio,sched,pcy,time"},
+                                                     CommandOptions::DEFAULT, false, out_fd);
+                                      },
+                              .resource_class = ResourceClass::CPU,
+                              .priority = 8,
+                              .dependencies = {CPU_INFO_SECTION}});
+        sections->addSection({.title = DUMP_HALS_TASK,
+                              .dump_func = &DumpHals,
+                              .resource_class = ResourceClass::BINDER,
+                              .priority = 7,
+                              .dependencies = {CPU_INFO_SECTION}});
+        sections->addSection({.title = NETSTAT_SECTION,
+                              .dump_func =
+                                      [](int out_fd) {
+                                          RunCommand(NETSTAT_SECTION, {"netstat", "-nW"},
+                                                     CommandOptions::DEFAULT, false, out_fd);
+                                      },
+                              .resource_class = ResourceClass::IO,
+                              .priority = 6,
+                              .dependencies = {CPU_INFO_SECTION}});
+        if (has_proc_modules) {
+            sections->addSection({.title = MODULES_INFO_SECTION,
+                                  .dump_func =
+                                          [](int out_fd) {
+                                              RunCommand(MODULES_INFO_SECTION,
+                                                         {"sh", "-c",
+                                                          "cat /proc/modules | cut -d' ' -f1 | "
+                                                          "    while read MOD ; do echo "
+                                                          "modinfo:$MOD ; modinfo $MOD ; done"},
+                                                         CommandOptions::AS_ROOT, false, out_fd);
+                                          },
+                                  .resource_class = ResourceClass::IO,
+                                  .priority = 5,
+                                  .dependencies = {CPU_INFO_SECTION}});
+        }
+        sections->addSection({.title = LIST_OF_OPEN_FILES_SECTION,
+                              .dump_func =
+                                      [](int out_fd) {
+                                          RunCommand(LIST_OF_OPEN_FILES_SECTION, {"lsof"},
+                                                     CommandOptions::AS_ROOT, false, out_fd);
+                                      },
+                              .resource_class = ResourceClass::CPU,
+                              .priority = 4,
+                              .dependencies = {CPU_INFO_SECTION}});
+        sections->addSection({.title = DUMP_BOARD_TASK,
+                              .dump_func = [](int out_fd) { ds.DumpstateBoard(out_fd); },
+                              .resource_class = ResourceClass::BINDER,
+                              .priority = 3,
+                              .dependencies = {CPU_INFO_SECTION}});
+        sections->addSection({.title = DUMP_CHECKINS_TASK,
+                              .dump_func = &DumpCheckins,
+                              .resource_class = ResourceClass::BINDER,
+                              .priority = 2,
+                              .dependencies = {CPU_INFO_SECTION}});
+        sections->addSection({.title = DUMP_NETSTATS_PROTO_TASK,
+                              .dump_func = [](int) { DumpNetstatsProto(); },
+                              .resource_class = ResourceClass::BINDER,
+                              .priority = 1,
+                              .dependencies = {CPU_INFO_SECTION}});
+        sections->addSection({.title = DUMP_INCIDENT_REPORT_TASK,
+                              .dump_func = [](int) { DumpIncidentReport(); },
+                              .resource_class = ResourceClass::BINDER,
+                              .priority = 0,
+                              .dependencies = {CPU_INFO_SECTION}});
+
+        // The pool was shutdown in DumpstateDefaultAfterCritical method in order to drop root
+        // user, so these threads are created without root as well.
+        sections->start(/* thread_count = */ 3);
     }
 
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
@@ -1679,44 +1808,60 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
     RunCommand("UPTIME", {"uptime"});
     DumpBlockStatFiles();
     DumpFile("MEMORY INFO", "/proc/meminfo");
-    RunCommand("CPU INFO", {"top", "-b", "-n", "1", "-H", "-s", "6", "-o",
-                            "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,cmd,name"});
+    if (sections) {
+        sections->waitForSection(CPU_INFO_SECTION);
+    } else {
+        RunCommand(CPU_INFO_SECTION, {"top", "-b", "-n", "1", "-H", "-s", "6", "-o",
+                                      "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,cmd,name"});
+    }
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunCommand, "BUGREPORT_PROCDUMP", {"bugreport_procdump"},
                                          CommandOptions::AS_ROOT);
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(DumpVisibleWindowViews);
 
-    DumpFile("VIRTUAL MEMORY STATS", "/proc/vmstat");
-    DumpFile("VMALLOC INFO", "/proc/vmallocinfo");
-    DumpFile("SLAB INFO", "/proc/slabinfo");
-    DumpFile("ZONEINFO", "/proc/zoneinfo");
-    DumpFile("PAGETYPEINFO", "/proc/pagetypeinfo");
-    DumpFile("BUDDYINFO", "/proc/buddyinfo");
+    for (const auto& [title, path] : MEMORY_FILE_SECTIONS) {
+        if (sections) {
+            sections->waitForSection(title);
+        } else {
+            DumpFile(title, path);
+        }
+    }
     DumpExternalFragmentationInfo();
 
     DumpFile("KERNEL CPUFREQ", "/sys/devices/system/cpu/cpu0/cpufreq/stats/time_in_state");
 
-    RunCommand("PROCESSES AND THREADS",
-               {"ps", "-A", "-T", "-Z", "-O", "pri,nice,rtprio,sched,pcy,time"});
+    if (sections) {
+        sections->waitForSection(PROCESSES_AND_THREADS_SECTION);
+    } else {
+        RunCommand(PROCESSES_AND_THREADS_SECTION,
+                   {"ps", "-A", "-T", "-Z", "-O", "pri,nice,rtprio,sched,pcy,time"});
+    }
 
-    if (ds.dump_pool_) {
-        WAIT_TASK_WITH_CONSENT_CHECK(std::move(dump_hals));
+    if (sections) {
+        WAIT_SECTION_WITH_CONSENT_CHECK(sections, DUMP_HALS_TASK);
     } else {
         RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK_AND_LOG(DUMP_HALS_TASK, DumpHals);
     }
 
     RunCommand("PRINTENV", {"printenv"});
-    RunCommand("NETSTAT", {"netstat", "-nW"});
-    struct stat s;
-    if (stat("/proc/modules", &s) != 0) {
+    if (sections) {
+        sections->waitForSection(NETSTAT_SECTION);
+    } else {
+        RunCommand(NETSTAT_SECTION, {"netstat", "-nW"});
+    }
+    if (!has_proc_modules) {
         MYLOGD("Skipping 'lsmod' because /proc/modules does not exist\n");
     } else {
         RunCommand("LSMOD", {"lsmod"});
-        RunCommand("MODULES INFO",
-                   {"sh", "-c", "cat /proc/modules | cut -d' ' -f1 | "
-                    "    while read MOD ; do echo modinfo:$MOD ; modinfo $MOD ; "
-                    "done"}, CommandOptions::AS_ROOT);
+        if (sections) {
+            sections->waitForSection(MODULES_INFO_SECTION);
+        } else {
+            RunCommand(MODULES_INFO_SECTION,
+                       {"sh", "-c", "cat /proc/modules | cut -d' ' -f1 | "
+                        "    while read MOD ; do echo modinfo:$MOD ; modinfo $MOD ; "
+                        "done"}, CommandOptions::AS_ROOT);
+        }
     }
 
     if (android::base::GetBoolProperty("ro.logd.kernel", false)) {
@@ -1727,7 +1872,11 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
 
     DumpVintf();
 
-    RunCommand("LIST OF OPEN FILES", {"lsof"}, CommandOptions::AS_ROOT);
+    if (sections) {
+        sections->waitForSection(LIST_OF_OPEN_FILES_SECTION);
+    } else {
+        RunCommand(LIST_OF_OPEN_FILES_SECTION, {"lsof"}, CommandOptions::AS_ROOT);
+    }
 
     for_each_tid(show_wchan, "BLOCKED PROCESS WAIT-CHANNELS");
     for_each_pid(show_showtime, "PROCESS TIMES (pid cmd user system iowait+percentage)");
@@ -1802,8 +1951,8 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
 
     ds.AddDir(SNAPSHOTCTL_LOG_DIR, false);
 
-    if (ds.dump_pool_) {
-        WAIT_TASK_WITH_CONSENT_CHECK(std::move(dump_board));
+    if (sections) {
+        WAIT_SECTION_WITH_CONSENT_CHECK(sections, DUMP_BOARD_TASK);
     } else {
         RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK_AND_LOG(DUMP_BOARD_TASK, ds.DumpstateBoard);
     }
@@ -1831,8 +1980,8 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
     /* Dump Bluetooth HCI logs after getting bluetooth_manager dumpsys */
     ds.AddDir("/data/misc/bluetooth/logs", true);
 
-    if (ds.dump_pool_) {
-        WAIT_TASK_WITH_CONSENT_CHECK(std::move(dump_checkins));
+    if (sections) {
+        WAIT_SECTION_WITH_CONSENT_CHECK(sections, DUMP_CHECKINS_TASK);
     } else {
         RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK_AND_LOG(DUMP_CHECKINS_TASK, DumpCheckins);
     }
@@ -1865,15 +2014,15 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
     /* Dump frozen cgroupfs */
     dump_frozen_cgroupfs();
 
-    if (ds.dump_pool_) {
-        WAIT_TASK_WITH_CONSENT_CHECK(std::move(dump_netstats_report));
+    if (sections) {
+        WAIT_SECTION_WITH_CONSENT_CHECK(sections, DUMP_NETSTATS_PROTO_TASK);
     } else {
         RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK_AND_LOG(DUMP_NETSTATS_PROTO_TASK,
                 DumpNetstatsProto);
     }
 
-    if (ds.dump_pool_) {
-        WAIT_TASK_WITH_CONSENT_CHECK(std::move(dump_incident_report));
+    if (sections) {
+        WAIT_SECTION_WITH_CONSENT_CHECK(sections, DUMP_INCIDENT_REPORT_TASK);
     } else {
         RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK_AND_LOG(DUMP_INCIDENT_REPORT_TASK,
                 DumpIncidentReport);
@@ -1881,6 +2030,11 @@ Dumpstate::RunStatus Dumpstate::dumpstate() {
 
     MaybeAddUiTracesToZip();
 
+    if (sections) {
+        sections->waitForAll();
+        ds.AddTextZipEntry("dumpstate_section_timings.txt", sections->getTimingReport());
+    }
+
     return Dumpstate::RunStatus::OK;
 }
 
@@ -1987,6 +2141,7 @@ Dumpstate::RunStatus Dumpstate::DumpstateDefaultAfterCritical() {
     if (!DropRootUser()) {
         return Dumpstate::RunStatus::ERROR;
     }
+    StartZipEntryTasksIfNeeded();
 
     RETURN_IF_USER_DENIED_CONSENT();
     Dumpstate::RunStatus status = dumpstate();
@@ -2056,6 +2211,7 @@ static void DumpstateTelephonyOnly(const std::string& calling_package) {
     if (!DropRootUser()) {
         return;
     }
+    ds.StartZipEntryTasksIfNeeded();
 
     // Starts thread pool after the root user is dropped, and two additional threads
     // are created for DumpHals in the DumpstateRadioCommon and DumpstateBoard.
@@ -2167,6 +2323,7 @@ static void DumpstateWifiOnly() {
     if (!DropRootUser()) {
         return;
     }
+    ds.StartZipEntryTasksIfNeeded();
 
     // Starts thread pool after the root user is dropped. Only one additional
     // thread is needed for DumpHals in the DumpstateRadioCommon.
@@ -3647,6 +3804,15 @@ void Dumpstate::EnableParallelRunIfNeeded() {
     zip_entry_tasks_ = std::make_unique<TaskQueue>();
 }
 
+void Dumpstate::StartZipEntryTasksIfNeeded() {
+    // The worker thread reads, adds and unlinks the files of the queued entries, so like the
+    // threads of dump_pool_ it must be created after root is dropped: setuid only changes the
+    // calling thread.
+    if (zip_entry_tasks_ && getuid() != 0) {
+        zip_entry_tasks_->start();
+    }
+}
+
 void Dumpstate::ShutdownDumpPool() {
     if (dump_pool_) {
         dump_pool_.reset();
@@ -4275,10 +4441,10 @@ void do_dmesg() {
     return;
 }
 
-int Dumpstate::DumpFile(const std::string& title, const std::string& path) {
-    DurationReporter duration_reporter(title);
+int Dumpstate::DumpFile(const std::string& title, const std::string& path, int out_fd) {
+    DurationReporter duration_reporter(title, false /* logcat_only */, false /* verbose */, out_fd);
 
-    int status = DumpFileToFd(STDOUT_FILENO, title, path);
+    int status = DumpFileToFd(out_fd, title, path);
 
     UpdateProgress(WEIGHT_FILE);
 
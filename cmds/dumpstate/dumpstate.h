@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -262,8 +263,10 @@ class Dumpstate {
      * |title| description of the command printed on `stdout` (or empty to skip
      * description).
      * |path| location of the file to be dumped.
+     * |out_fd| A fd to support the DumpPool to output results to a temporary
+     * file. Using STDOUT_FILENO if it's not running in the parallel task.
      */
-    int DumpFile(const std::string& title, const std::string& path);
+    int DumpFile(const std::string& title, const std::string& path, int out_fd = STDOUT_FILENO);
 
     /*
      * Adds a new entry to the existing zip file.
@@ -400,6 +403,13 @@ class Dumpstate {
     void EnqueueAddZipEntryAndCleanupIfNeeded(const std::string& entry_name,
             const std::string& entry_path);
 
+    /*
+     * Starts the thread of the dumpstate's TaskQueue, if the parallel run is enabled, so that
+     * enqueued entries are added while the rest of the bugreport is dumped. Must only be called
+     * once root has been dropped.
+     */
+    void StartZipEntryTasksIfNeeded();
+
     /*
      * Structure to hold options that determine the behavior of dumpstate.
      */
@@ -519,6 +529,10 @@ class Dumpstate {
     // Pointer to the zip structure.
     std::unique_ptr<ZipWriter> zip_writer_;
 
+    // Serializes zip entries, which may be added from the zip_entry_tasks_ thread while the
+    // main thread adds its own. Held from the start to the end of each entry.
+    std::mutex zip_writer_lock_;
+
     // Binder object listening to progress.
     android::sp<android::os::IDumpstateListener> listener_;
 
@@ -538,7 +552,7 @@ class Dumpstate {
     std::unique_ptr<android::os::dumpstate::DumpPool> dump_pool_;
 
     // A task queue to collect adding zip entry tasks inside dump tasks if the
-    // parallel run is enabled.
+    // parallel run is enabled. Its thread compresses the entries while the dump goes on.
     std::unique_ptr<android::os::dumpstate::TaskQueue> zip_entry_tasks_;
 
     // A callback to IncidentCompanion service, which checks user consent for sharing the
@@ -38,10 +38,14 @@
 #include <unistd.h>
 #include <ziparchive/zip_archive.h>
 
+#include <atomic>
 #include <filesystem>
+#include <future>
+#include <mutex>
 #include <thread>
 
 #include "DumpPool.h"
+#include "DumpSectionGraph.h"
 #include "DumpstateInternal.h"
 #include "DumpstateService.h"
 #include "android/os/BnDumpstate.h"
@@ -1782,12 +1786,151 @@ TEST_F(DumpPoolTest, EnqueueTask_withDurationLog) {
     EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
 }
 
+class DumpSectionGraphTest : public DumpPoolTest {
+  public:
+    void SetUp() {
+        DumpPoolTest::SetUp();
+        graph_ = std::make_unique<DumpSectionGraph>(kTestDataPath);
+        graph_->setLogDuration(/* log_duration = */false);
+    }
+
+    std::unique_ptr<DumpSectionGraph> graph_;
+};
+
+TEST_F(DumpSectionGraphTest, WaitForSectionsInOrder) {
+    graph_->addSection({.title = "A", .dump_func = [](int out_fd) { dprintf(out_fd, "A"); }});
+    graph_->addSection({.title = "B", .dump_func = [](int out_fd) {
+                            dprintf(out_fd, "B");
+                            sleep(1);
+                        }});
+    graph_->addSection({.title = "C", .dump_func = [](int out_fd) { dprintf(out_fd, "C"); }});
+    graph_->start();
+
+    graph_->waitForSection("A", out_fd_.get());
+    graph_->waitForSection("B", out_fd_.get());
+    graph_->waitForSection("C", out_fd_.get());
+
+    std::string result;
+    ReadFileToString(out_path_, &result);
+    EXPECT_THAT(result, StrEq("A\nB\nC\n"));
+    EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
+}
+
+TEST_F(DumpSectionGraphTest, RejectsUnknownDependenciesAndDuplicates) {
+    EXPECT_TRUE(graph_->addSection({.title = "A", .dump_func = [](int) {}}));
+    EXPECT_FALSE(graph_->addSection({.title = "A", .dump_func = [](int) {}}));
+    EXPECT_FALSE(
+            graph_->addSection({.title = "B", .dump_func = [](int) {}, .dependencies = {"C"}}));
+}
+
+TEST_F(DumpSectionGraphTest, DependenciesFinishFirst) {
+    std::atomic<bool> a_done = false;
+    bool a_done_before_b = false;
+    graph_->addSection({.title = "A", .dump_func = [&](int) {
+                            usleep(200 * 1000);
+                            a_done = true;
+                        }});
+    graph_->addSection({.title = "B",
+                        .dump_func = [&](int) { a_done_before_b = a_done; },
+                        .priority = 10,
+                        .dependencies = {"A"}});
+    graph_->start();
+    graph_->waitForAll(out_fd_.get());
+
+    EXPECT_TRUE(a_done_before_b);
+    EXPECT_THAT(getTempFileCounts(kTestDataPath), Eq(0));
+}
+
+TEST_F(DumpSectionGraphTest, ResourceClassLimitsConcurrency) {
+    std::atomic<int> running = 0;
+    std::atomic<int> max_running = 0;
+    auto dump_func = [&](int) {
+        int now_running = ++running;
+        int expected = max_running;
+        while (now_running > expected &&
+               !max_running.compare_exchange_weak(expected, now_running)) {
+        }
+        usleep(100 * 1000);
+        running--;
+    };
+    graph_->setMaxConcurrency(ResourceClass::BINDER, 1);
+    for (const char* title : {"A", "B", "C"}) {
+        graph_->addSection({.title = title,
+                            .dump_func = dump_func,
+                            .resource_class = ResourceClass::BINDER});
+    }
+    graph_->start(/* thread_count = */ 3);
+    graph_->waitForAll(out_fd_.get());
+
+    EXPECT_THAT(max_running.load(), Eq(1));
+}
+
+TEST_F(DumpSectionGraphTest, HigherPriorityRunsFirst) {
+    std::mutex order_lock;
+    std::string order;
+    auto record = [&](const std::string& title) {
+        return [&, title](int) {
+            std::lock_guard lock(order_lock);
+            order += title;
+        };
+    };
+    graph_->addSection({.title = "low", .dump_func = record("L"), .priority = 1});
+    graph_->addSection({.title = "high", .dump_func = record("H"), .priority = 3});
+    graph_->addSection({.title = "medium", .dump_func = record("M"), .priority = 2});
+    graph_->start(/* thread_count = */ 1);
+    graph_->waitForAll(out_fd_.get());
+
+    EXPECT_THAT(order, StrEq("HML"));
+}
+
+TEST_F(DumpSectionGraphTest, TimedOutSectionReleasesDependents) {
+    graph_->addSection({.title = "slow",
+                        .dump_func = [](int) { sleep(2); },
+                        .timeout = std::chrono::milliseconds(100)});
+    graph_->addSection({.title = "after",
+                        .dump_func = [](int out_fd) { dprintf(out_fd, "after"); },
+                        .dependencies = {"slow"}});
+    graph_->start(/* thread_count = */ 2);
+
+    uint64_t start = Nanotime();
+    graph_->waitForSection("slow", out_fd_.get());
+    graph_->waitForSection("after", out_fd_.get());
+    EXPECT_LT(Nanotime() - start, NANOS_PER_SEC);
+
+    std::string result;
+    ReadFileToString(out_path_, &result);
+    EXPECT_THAT(result, HasSubstr("*** slow timed out after 100 ms"));
+    EXPECT_THAT(result, HasSubstr("after"));
+}
+
+TEST_F(DumpSectionGraphTest, TimingReportShowsCriticalPath) {
+    graph_->addSection({.title = "first", .dump_func = [](int) { usleep(100 * 1000); }});
+    graph_->addSection({.title = "independent", .dump_func = [](int) {}});
+    graph_->addSection({.title = "second",
+                        .dump_func = [](int) { usleep(100 * 1000); },
+                        .dependencies = {"first"}});
+    graph_->start();
+    graph_->waitForAll(out_fd_.get());
+
+    std::string report = graph_->getTimingReport();
+    EXPECT_THAT(report, HasSubstr("independent"));
+    EXPECT_THAT(report, HasSubstr("Critical path"));
+    EXPECT_THAT(report, HasSubstr(" first ("));
+    EXPECT_THAT(report, HasSubstr(" -> second ("));
+}
+
 class TaskQueueTest : public DumpstateBaseTest {
 public:
     void SetUp() {
         DumpstateBaseTest::SetUp();
     }
 
+    // Blocks until run() has asked the worker thread to stop.
+    void WaitForStopping() {
+        std::unique_lock lock(task_queue_.lock_);
+        task_queue_.condition_variable_.wait(lock, [this]() { return task_queue_.stopping_; });
+    }
+
     TaskQueue task_queue_;
 };
 
@@ -1833,6 +1976,53 @@ TEST_F(TaskQueueTest, runTask_withCancelled) {
     EXPECT_TRUE(is_task2_cancelled);
 }
 
+TEST_F(TaskQueueTest, runTask_afterStart) {
+    std::promise<bool> task_run;
+    auto task = [&](bool task_cancelled) {
+        task_run.set_value(!task_cancelled);
+    };
+    task_queue_.start();
+    task_queue_.add(task, std::placeholders::_1);
+
+    // The task runs on the worker thread without waiting for run().
+    auto future = task_run.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_TRUE(future.get());
+
+    task_queue_.run(/* do_cancel = */false);
+}
+
+TEST_F(TaskQueueTest, runTask_afterStart_withCancelled) {
+    std::promise<void> task1_started;
+    std::promise<void> task1_release;
+    auto task1_release_future = task1_release.get_future();
+    bool is_task1_cancelled = true;
+    bool is_task2_cancelled = false;
+    auto task_1 = [&](bool task_cancelled) {
+        is_task1_cancelled = task_cancelled;
+        task1_started.set_value();
+        task1_release_future.wait();
+    };
+    auto task_2 = [&](bool task_cancelled) {
+        is_task2_cancelled = task_cancelled;
+    };
+    task_queue_.start();
+    task_queue_.add(task_1, std::placeholders::_1);
+    task_queue_.add(task_2, std::placeholders::_1);
+    task1_started.get_future().wait();
+
+    std::thread release_thread([&]() {
+        WaitForStopping();
+        task1_release.set_value();
+    });
+    // Waits for the running task, then cancels the one still in the queue.
+    task_queue_.run(/* do_cancel = */true);
+    release_thread.join();
+
+    EXPECT_FALSE(is_task1_cancelled);
+    EXPECT_TRUE(is_task2_cancelled);
+}
+
 
 }  // namespace dumpstate
 }  // namespace os
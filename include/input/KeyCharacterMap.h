@@ -17,7 +17,8 @@
 #pragma once
 
 #include <stdint.h>
-#include <list>
+#include <optional>
+#include <vector>
 
 #include <binder/IBinder.h>
 
@@ -180,7 +181,16 @@ private:
 
         /* The list of key behaviors sorted from most specific to least specific
          * meta key binding. */
-        std::list<Behavior> behaviors;
+        std::vector<Behavior> behaviors;
+    };
+
+    /* A key and meta state that generate a character. */
+    struct CharacterKey {
+        char16_t character = 0;
+        int32_t keyCode = 0;
+        int32_t metaState = 0;
+
+        bool operator==(const CharacterKey&) const = default;
     };
 
     class Parser {
@@ -224,7 +234,11 @@ private:
         status_t parseCharacterLiteral(char16_t* outCharacter);
     };
 
-    std::map<int32_t, Key> mKeys;
+    /* Keys indexed by key code. The table ends with the highest key code that has a key. */
+    std::vector<std::optional<Key>> mKeys;
+    /* The key to press for each character that can be typed, sorted by character. Derived from
+     * mKeys whenever the keys change. */
+    std::vector<CharacterKey> mKeysByCharacter;
     KeyboardType mType = KeyboardType::UNKNOWN;
     std::string mLoadFileName;
     bool mLayoutOverlayApplied = false;
@@ -236,6 +250,10 @@ private:
     KeyCharacterMap(const std::string& filename);
 
     const Key* getKey(int32_t keyCode) const;
+    /* Returns the key for a valid key code, adding an empty one if there is none yet. */
+    Key& editKey(int32_t keyCode);
+    /* Rebuilds mKeysByCharacter from mKeys. */
+    void updateKeysByCharacter();
     const Behavior* getKeyBehavior(int32_t keyCode, int32_t metaState) const;
     static bool matchesMetaState(int32_t eventMetaState, int32_t behaviorMetaState);
 
@@ -23,6 +23,7 @@
 #include <utils/Errors.h>
 #include <utils/Tokenizer.h>
 #include <set>
+#include <vector>
 
 namespace android {
 
@@ -99,8 +100,9 @@ private:
         int32_t sensorDataIndex;
     };
 
-    std::unordered_map<int32_t, Key> mKeysByScanCode;
-    std::unordered_map<int32_t, Key> mKeysByUsageCode;
+    // Sorted by scan or usage code, so that lookups are a binary search over contiguous memory.
+    std::vector<std::pair<int32_t, Key>> mKeysByScanCode;
+    std::vector<std::pair<int32_t, Key>> mKeysByUsageCode;
     std::unordered_map<int32_t, AxisInfo> mAxes;
     std::unordered_map<int32_t, Led> mLedsByScanCode;
     std::unordered_map<int32_t, Led> mLedsByUsageCode;
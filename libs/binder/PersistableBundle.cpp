@@ -18,7 +18,11 @@
 
 #include <binder/PersistableBundle.h>
 
+#include <string.h>
+
 #include <limits>
+#include <type_traits>
+#include <unordered_map>
 
 #include <binder/IBinder.h>
 #include <binder/Parcel.h>
@@ -47,6 +51,8 @@ enum {
     // Keep them in sync with BUNDLE_MAGIC* in frameworks/base/core/java/android/os/BaseBundle.java.
     BUNDLE_MAGIC = 0x4C444E42,
     BUNDLE_MAGIC_NATIVE = 0x4C444E44,
+    // Written by writeToParcelCompact(), only known to the native implementation.
+    BUNDLE_MAGIC_COMPACT = 0x4C444E43,
 };
 
 namespace {
@@ -67,6 +73,11 @@ set<android::String16> getKeys(const map<android::String16, T>& map) {
     }
     return keys;
 }
+
+// Whether |parcel| has enough data left for |count| elements of |size| bytes.
+bool hasElements(const android::Parcel* parcel, int32_t count, size_t size) {
+    return count >= 0 && static_cast<size_t>(count) <= parcel->dataAvail() / size;
+}
 }  // namespace
 
 namespace android {
@@ -90,24 +101,160 @@ namespace os {
         }                                     \
     }
 
-status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
-    /*
-     * Keep implementation in sync with writeToParcelInner() in
-     * frameworks/base/core/java/android/os/BaseBundle.java.
-     */
+/*
+ * Key table of the compact encoding. Keys are written in the order the bundle is traversed, and
+ * the keys of a bundle are unique, so without nested bundles the index of a key is just its
+ * position. Keys of nested bundles are interned by identity: copies of a String16 share their
+ * buffer, so a key put into several nested bundles, or read from a compact parcel, is written
+ * once. Equal keys in distinct buffers are simply written once each.
+ */
+class PersistableBundle::KeyTable {
+public:
+    explicit KeyTable(const PersistableBundle& bundle)
+          : mInterned(!bundle.mPersistableBundleMap.empty()) {
+        if (mInterned) mIndices.reserve(bundle.size());
+        mKeys.reserve(bundle.size());
+    }
 
-    // Special case for empty bundles.
-    if (empty()) {
-        RETURN_IF_FAILED(parcel->writeInt32(0));
-        return NO_ERROR;
+    template <typename T>
+    void add(const map<String16, T>& values) {
+        for (const auto& key_val_pair : values) {
+            const String16& key = key_val_pair.first;
+            if (!mInterned ||
+                mIndices.emplace(key.c_str(), static_cast<int32_t>(mKeys.size())).second) {
+                mKeys.push_back(&key);
+            }
+        }
+    }
+
+    // Returns the index of the next key written. Keys must be written in the order they were
+    // added.
+    int32_t nextIndex(const String16& key) const {
+        return mInterned ? mIndices.find(key.c_str())->second : mNextIndex++;
+    }
+
+    const vector<const String16*>& keys() const { return mKeys; }
+
+private:
+    const bool mInterned;
+    std::unordered_map<const char16_t*, int32_t> mIndices;
+    vector<const String16*> mKeys;
+    mutable int32_t mNextIndex = 0;
+};
+
+namespace {
+
+/*
+ * Helpers for the compact encoding. Each value type is written as the number of entries, the
+ * key table index of each entry as one array, and then the values: one array for scalar types,
+ * one value after the other for the others. Maps are iterated in key order, so the reader can
+ * append each entry at the end of its map.
+ */
+template <typename T, typename KeyTable>
+status_t writeCompactKeys(Parcel* parcel, const map<String16, T>& values,
+                          const KeyTable& keyTable) {
+    RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(values.size())));
+    if (values.empty()) return NO_ERROR;
+    auto* indices = static_cast<int32_t*>(parcel->writeInplace(values.size() * sizeof(int32_t)));
+    if (indices == nullptr) return NO_MEMORY;
+    for (const auto& key_val_pair : values) {
+        *indices++ = keyTable.nextIndex(key_val_pair.first);
+    }
+    return NO_ERROR;
+}
+
+template <typename T, typename KeyTable>
+status_t writeCompactScalars(Parcel* parcel, const map<String16, T>& values,
+                             const KeyTable& keyTable) {
+    static_assert(std::is_arithmetic_v<T>);
+    RETURN_IF_FAILED(writeCompactKeys(parcel, values, keyTable));
+    if (values.empty()) return NO_ERROR;
+    auto* out = static_cast<uint8_t*>(parcel->writeInplace(values.size() * sizeof(T)));
+    if (out == nullptr) return NO_MEMORY;
+    for (const auto& key_val_pair : values) {
+        memcpy(out, &key_val_pair.second, sizeof(T));
+        out += sizeof(T);
+    }
+    return NO_ERROR;
+}
+
+template <typename T, typename KeyTable, typename WriteValue>
+status_t writeCompactValues(Parcel* parcel, const map<String16, T>& values,
+                            const KeyTable& keyTable, WriteValue writeValue) {
+    RETURN_IF_FAILED(writeCompactKeys(parcel, values, keyTable));
+    for (const auto& key_val_pair : values) {
+        RETURN_IF_FAILED(writeValue(key_val_pair.second));
+    }
+    return NO_ERROR;
+}
+
+status_t readCompactKeys(const Parcel* parcel, const vector<String16>& keys,
+                         vector<const String16*>* out) {
+    int32_t count;
+    RETURN_IF_FAILED(parcel->readInt32(&count));
+    if (!hasElements(parcel, count, sizeof(int32_t))) {
+        ALOGE("Bad number of entries in PersistableBundle: %d", count);
+        return BAD_VALUE;
+    }
+    out->resize(static_cast<size_t>(count));
+    if (count == 0) return NO_ERROR;
+    const auto* indices =
+            static_cast<const int32_t*>(parcel->readInplace(out->size() * sizeof(int32_t)));
+    if (indices == nullptr) return NOT_ENOUGH_DATA;
+    for (auto& key : *out) {
+        const int32_t index = *indices++;
+        if (index < 0 || static_cast<size_t>(index) >= keys.size()) {
+            ALOGE("Bad key index in PersistableBundle: %d", index);
+            return BAD_VALUE;
+        }
+        key = &keys[static_cast<size_t>(index)];
+    }
+    return NO_ERROR;
+}
+
+template <typename T>
+status_t readCompactScalars(const Parcel* parcel, const vector<String16>& keys,
+                            vector<const String16*>* entryKeys, map<String16, T>* values) {
+    static_assert(std::is_arithmetic_v<T>);
+    RETURN_IF_FAILED(readCompactKeys(parcel, keys, entryKeys));
+    if (entryKeys->empty()) return NO_ERROR;
+    const auto* in = static_cast<const uint8_t*>(parcel->readInplace(entryKeys->size() * sizeof(T)));
+    if (in == nullptr) return NOT_ENOUGH_DATA;
+    for (const String16* key : *entryKeys) {
+        T value;
+        if constexpr (std::is_same_v<T, bool>) {
+            value = *in != 0;
+        } else {
+            memcpy(&value, in, sizeof(T));
+        }
+        in += sizeof(T);
+        values->emplace_hint(values->end(), *key, value);
+    }
+    return NO_ERROR;
+}
+
+template <typename T, typename ReadValue>
+status_t readCompactValues(const Parcel* parcel, const vector<String16>& keys,
+                           vector<const String16*>* entryKeys, map<String16, T>* values,
+                           ReadValue readValue) {
+    RETURN_IF_FAILED(readCompactKeys(parcel, keys, entryKeys));
+    for (const String16* key : *entryKeys) {
+        auto it = values->emplace_hint(values->end(), *key, T{});
+        RETURN_IF_FAILED(readValue(&it->second));
     }
+    return NO_ERROR;
+}
 
+// Writes the length and |magic| header of a non-empty bundle, then the body written by
+// |writeBody|, and backpatches the length.
+template <typename WriteBody>
+status_t writeLengthPrefixed(Parcel* parcel, int32_t magic, WriteBody writeBody) {
     size_t length_pos = parcel->dataPosition();
     RETURN_IF_FAILED(parcel->writeInt32(1));  // dummy, will hold length
-    RETURN_IF_FAILED(parcel->writeInt32(BUNDLE_MAGIC_NATIVE));
+    RETURN_IF_FAILED(parcel->writeInt32(magic));
 
     size_t start_pos = parcel->dataPosition();
-    RETURN_IF_FAILED(writeToParcelInner(parcel));
+    RETURN_IF_FAILED(writeBody());
     size_t end_pos = parcel->dataPosition();
 
     // Backpatch length. This length value includes the length header.
@@ -122,6 +269,46 @@ status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
     return NO_ERROR;
 }
 
+}  // namespace
+
+status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
+    /*
+     * Keep implementation in sync with writeToParcelInner() in
+     * frameworks/base/core/java/android/os/BaseBundle.java.
+     */
+
+    // Special case for empty bundles.
+    if (empty()) {
+        RETURN_IF_FAILED(parcel->writeInt32(0));
+        return NO_ERROR;
+    }
+
+    return writeLengthPrefixed(parcel, BUNDLE_MAGIC_NATIVE,
+                               [&] { return writeToParcelInner(parcel); });
+}
+
+status_t PersistableBundle::writeToParcelCompact(Parcel* parcel) const {
+    if (empty()) {
+        RETURN_IF_FAILED(parcel->writeInt32(0));
+        return NO_ERROR;
+    }
+
+    return writeLengthPrefixed(parcel, BUNDLE_MAGIC_COMPACT, [&]() -> status_t {
+        KeyTable keyTable(*this);
+        collectKeys(&keyTable);
+        const auto& keys = keyTable.keys();
+        if (keys.size() > std::numeric_limits<int32_t>::max()) {
+            ALOGE("Too many keys in PersistableBundle (%zu)", keys.size());
+            return BAD_VALUE;
+        }
+        RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(keys.size())));
+        for (const String16* key : keys) {
+            RETURN_IF_FAILED(parcel->writeString16(*key));
+        }
+        return writeToParcelCompactInner(parcel, keyTable);
+    });
+}
+
 status_t PersistableBundle::readFromParcel(const Parcel* parcel) {
     /*
      * Keep implementation in sync with readFromParcelInner() in
@@ -397,11 +584,26 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
 
     int32_t magic;
     RETURN_IF_FAILED(parcel->readInt32(&magic));
-    if (magic != BUNDLE_MAGIC && magic != BUNDLE_MAGIC_NATIVE) {
+    if (magic != BUNDLE_MAGIC && magic != BUNDLE_MAGIC_NATIVE && magic != BUNDLE_MAGIC_COMPACT) {
         ALOGE("Bad magic number for PersistableBundle: 0x%08x", magic);
         return BAD_VALUE;
     }
 
+    if (magic == BUNDLE_MAGIC_COMPACT) {
+        int32_t num_keys;
+        RETURN_IF_FAILED(parcel->readInt32(&num_keys));
+        // Every key takes at least its length.
+        if (!hasElements(parcel, num_keys, sizeof(int32_t))) {
+            ALOGE("Bad number of keys in PersistableBundle: %d", num_keys);
+            return BAD_VALUE;
+        }
+        vector<String16> keys(static_cast<size_t>(num_keys));
+        for (auto& key : keys) {
+            RETURN_IF_FAILED(parcel->readString16(&key));
+        }
+        return readFromParcelCompactInner(parcel, keys);
+    }
+
     /*
      * To keep this implementation in sync with unparcel() in
      * frameworks/base/core/java/android/os/BaseBundle.java, the number of
@@ -477,6 +679,93 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
     return NO_ERROR;
 }
 
+void PersistableBundle::collectKeys(KeyTable* keyTable) const {
+    keyTable->add(mBoolMap);
+    keyTable->add(mIntMap);
+    keyTable->add(mLongMap);
+    keyTable->add(mDoubleMap);
+    keyTable->add(mStringMap);
+    keyTable->add(mBoolVectorMap);
+    keyTable->add(mIntVectorMap);
+    keyTable->add(mLongVectorMap);
+    keyTable->add(mDoubleVectorMap);
+    keyTable->add(mStringVectorMap);
+    keyTable->add(mPersistableBundleMap);
+    for (const auto& key_val_pair : mPersistableBundleMap) {
+        key_val_pair.second.collectKeys(keyTable);
+    }
+}
+
+status_t PersistableBundle::writeToParcelCompactInner(Parcel* parcel,
+                                                      const KeyTable& keyTable) const {
+    // Nested bundles are written without length and magic, and share the key table.
+    RETURN_IF_FAILED(writeCompactScalars(parcel, mBoolMap, keyTable));
+    RETURN_IF_FAILED(writeCompactScalars(parcel, mIntMap, keyTable));
+    RETURN_IF_FAILED(writeCompactScalars(parcel, mLongMap, keyTable));
+    RETURN_IF_FAILED(writeCompactScalars(parcel, mDoubleMap, keyTable));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mStringMap, keyTable,
+                                        [&](const String16& v) { return parcel->writeString16(v); }));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mBoolVectorMap, keyTable,
+                                        [&](const vector<bool>& v) {
+                                            return parcel->writeBoolVector(v);
+                                        }));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mIntVectorMap, keyTable,
+                                        [&](const vector<int32_t>& v) {
+                                            return parcel->writeInt32Vector(v);
+                                        }));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mLongVectorMap, keyTable,
+                                        [&](const vector<int64_t>& v) {
+                                            return parcel->writeInt64Vector(v);
+                                        }));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mDoubleVectorMap, keyTable,
+                                        [&](const vector<double>& v) {
+                                            return parcel->writeDoubleVector(v);
+                                        }));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mStringVectorMap, keyTable,
+                                        [&](const vector<String16>& v) {
+                                            return parcel->writeString16Vector(v);
+                                        }));
+    RETURN_IF_FAILED(writeCompactValues(parcel, mPersistableBundleMap, keyTable,
+                                        [&](const PersistableBundle& v) {
+                                            return v.writeToParcelCompactInner(parcel, keyTable);
+                                        }));
+    return NO_ERROR;
+}
+
+status_t PersistableBundle::readFromParcelCompactInner(const Parcel* parcel,
+                                                       const vector<String16>& keys) {
+    vector<const String16*> entryKeys;
+    RETURN_IF_FAILED(readCompactScalars(parcel, keys, &entryKeys, &mBoolMap));
+    RETURN_IF_FAILED(readCompactScalars(parcel, keys, &entryKeys, &mIntMap));
+    RETURN_IF_FAILED(readCompactScalars(parcel, keys, &entryKeys, &mLongMap));
+    RETURN_IF_FAILED(readCompactScalars(parcel, keys, &entryKeys, &mDoubleMap));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mStringMap,
+                                       [&](String16* v) { return parcel->readString16(v); }));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mBoolVectorMap,
+                                       [&](vector<bool>* v) { return parcel->readBoolVector(v); }));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mIntVectorMap,
+                                       [&](vector<int32_t>* v) {
+                                           return parcel->readInt32Vector(v);
+                                       }));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mLongVectorMap,
+                                       [&](vector<int64_t>* v) {
+                                           return parcel->readInt64Vector(v);
+                                       }));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mDoubleVectorMap,
+                                       [&](vector<double>* v) {
+                                           return parcel->readDoubleVector(v);
+                                       }));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mStringVectorMap,
+                                       [&](vector<String16>* v) {
+                                           return parcel->readString16Vector(v);
+                                       }));
+    RETURN_IF_FAILED(readCompactValues(parcel, keys, &entryKeys, &mPersistableBundleMap,
+                                       [&](PersistableBundle* v) {
+                                           return v->readFromParcelCompactInner(parcel, keys);
+                                       }));
+    return NO_ERROR;
+}
+
 }  // namespace os
 
 }  // namespace android
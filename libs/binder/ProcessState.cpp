@@ -293,17 +293,48 @@ void ProcessState::setCallRestriction(CallRestriction restriction) {
     mCallRestriction = restriction;
 }
 
-ProcessState::handle_entry* ProcessState::lookupHandleLocked(int32_t handle)
+ProcessState::handle_directory::handle_directory(size_t size)
+      : size(size), segments(new std::atomic<handle_segment*>[size]()) {}
+
+ProcessState::handle_entry* ProcessState::lookupHandle(int32_t handle)
 {
-    const size_t N=mHandleToObject.size();
-    if (N <= (size_t)handle) {
-        handle_entry e;
-        e.binder = nullptr;
-        e.refs = nullptr;
-        status_t err = mHandleToObject.insertAt(e, N, handle+1-N);
-        if (err < NO_ERROR) return nullptr;
+    if (handle < 0) return nullptr;
+    const size_t index = static_cast<size_t>(handle) >> kHandleSegmentShift;
+    const size_t offset = static_cast<size_t>(handle) & (kHandleSegmentSize - 1);
+
+    handle_directory* directory = mHandleDirectory.load(std::memory_order_acquire);
+    if (directory != nullptr && index < directory->size) {
+        handle_segment* segment = directory->segments[index].load(std::memory_order_acquire);
+        if (segment != nullptr) return &segment->entries[offset];
     }
-    return &mHandleToObject.editItemAt(handle);
+
+    std::unique_lock<std::mutex> _l(mLock);
+    directory = mHandleDirectory.load(std::memory_order_relaxed);
+    if (directory == nullptr || index >= directory->size) {
+        size_t size = directory != nullptr ? directory->size * 2 : 1;
+        while (size <= index) size *= 2;
+        auto grown = std::make_unique<handle_directory>(size);
+        if (directory != nullptr) {
+            for (size_t i = 0; i < directory->size; i++) {
+                grown->segments[i].store(directory->segments[i].load(std::memory_order_relaxed),
+                                         std::memory_order_relaxed);
+            }
+            mRetiredHandleDirectories.emplace_back(directory);
+        }
+        directory = grown.release();
+        mHandleDirectory.store(directory, std::memory_order_release);
+    }
+    handle_segment* segment = directory->segments[index].load(std::memory_order_relaxed);
+    if (segment == nullptr) {
+        segment = new handle_segment();
+        directory->segments[index].store(segment, std::memory_order_release);
+    }
+    return &segment->entries[offset];
+}
+
+std::mutex& ProcessState::handleLock(int32_t handle)
+{
+    return mHandleLocks[static_cast<size_t>(handle) & (kHandleLockCount - 1)];
 }
 
 // see b/166779391: cannot change the VNDK interface, so access like this
@@ -313,17 +344,20 @@ sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 {
     sp<IBinder> result;
 
-    std::unique_lock<std::mutex> _l(mLock);
-
-    if (handle == 0 && the_context_object != nullptr) return the_context_object;
+    if (handle == 0) {
+        std::unique_lock<std::mutex> _l(mLock);
+        if (the_context_object != nullptr) return the_context_object;
+    }
 
-    handle_entry* e = lookupHandleLocked(handle);
+    handle_entry* e = lookupHandle(handle);
 
     if (e != nullptr) {
+        std::unique_lock<std::mutex> _l(handleLock(handle));
+
         // We need to create a new BpBinder if there isn't currently one, OR we
         // are unable to acquire a weak reference on this current one.  The
         // attemptIncWeak() is safe because we know the BpBinder destructor will always
-        // call expungeHandle(), which acquires the same lock we are holding now.
+        // call expungeHandle(), which acquires the same handle lock we are holding now.
         // We need to do this because there is a race condition between someone
         // releasing a reference on this BpBinder, and a new reference on its handle
         // arriving from the driver.
@@ -377,14 +411,15 @@ sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 
 void ProcessState::expungeHandle(int32_t handle, IBinder* binder)
 {
-    std::unique_lock<std::mutex> _l(mLock);
+    handle_entry* e = lookupHandle(handle);
+    if (e == nullptr) return;
 
-    handle_entry* e = lookupHandleLocked(handle);
+    std::unique_lock<std::mutex> _l(handleLock(handle));
 
     // This handle may have already been replaced with a new BpBinder
     // (if someone failed the AttemptIncWeak() above); we don't want
     // to overwrite it.
-    if (e && e->binder == binder) e->binder = nullptr;
+    if (e->binder == binder) e->binder = nullptr;
 }
 
 String8 ProcessState::makeBinderThreadName() {
@@ -562,6 +597,7 @@ ProcessState::ProcessState(const char* driver)
         mCurrentThreads(0),
         mKernelStartedThreads(0),
         mStarvationStartTimeMs(0),
+        mHandleDirectory(nullptr),
         mForked(false),
         mThreadPoolStarted(false),
         mThreadPoolSeq(1),
@@ -601,6 +637,13 @@ ProcessState::~ProcessState()
         close(mDriverFD);
     }
     mDriverFD = -1;
+
+    if (handle_directory* directory = mHandleDirectory.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < directory->size; i++) {
+            delete directory->segments[i].load(std::memory_order_relaxed);
+        }
+        delete directory;
+    }
 }
 
 } // namespace android
@@ -42,6 +42,15 @@ public:
     status_t writeToParcel(Parcel* parcel) const override;
     status_t readFromParcel(const Parcel* parcel) override;
 
+    /*
+     * Writes this bundle in a compact encoding: every distinct key of the bundle and of its
+     * nested bundles is written once into a key table, and the values of each scalar type are
+     * written as one contiguous array. readFromParcel() reads both encodings, but the Java
+     * implementation only reads the one written by writeToParcel(), so only use this when the
+     * reader is known to be native.
+     */
+    status_t writeToParcelCompact(Parcel* parcel) const;
+
     bool empty() const;
     size_t size() const;
     size_t erase(const String16& key);
@@ -111,6 +120,10 @@ public:
 private:
     status_t writeToParcelInner(Parcel* parcel) const;
     status_t readFromParcelInner(const Parcel* parcel, size_t length);
+    class KeyTable;
+    void collectKeys(KeyTable* keyTable) const;
+    status_t writeToParcelCompactInner(Parcel* parcel, const KeyTable& keyTable) const;
+    status_t readFromParcelCompactInner(const Parcel* parcel, const std::vector<String16>& keys);
 
     std::map<String16, bool> mBoolMap;
     std::map<String16, int32_t> mIntMap;
@@ -23,7 +23,10 @@
 
 #include <pthread.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 // ---------------------------------------------------------------------------
 namespace android {
@@ -152,11 +155,35 @@ private:
     String8 makeBinderThreadName();
 
     struct handle_entry {
-        IBinder* binder;
-        RefBase::weakref_type* refs;
+        IBinder* binder = nullptr;
+        RefBase::weakref_type* refs = nullptr;
     };
 
-    handle_entry* lookupHandleLocked(int32_t handle);
+    // The handle table is a two level radix tree: the high bits of a handle select a segment
+    // from the directory, the low bits the entry in the segment. Segments never move once
+    // created, and a full directory is replaced by a bigger copy rather than resized in place,
+    // so lookups read the table without taking mLock.
+    static constexpr size_t kHandleSegmentShift = 8;
+    static constexpr size_t kHandleSegmentSize = 1 << kHandleSegmentShift;
+
+    struct handle_segment {
+        handle_entry entries[kHandleSegmentSize];
+    };
+
+    struct handle_directory {
+        explicit handle_directory(size_t size);
+
+        const size_t size;
+        const std::unique_ptr<std::atomic<handle_segment*>[]> segments;
+    };
+
+    // Returns the entry for |handle|, creating it if needed. Only takes mLock to add a segment.
+    handle_entry* lookupHandle(int32_t handle);
+
+    // Serializes creating a proxy for a handle against expungeHandle() of the old one. The locks
+    // are striped by handle rather than held in each entry, to keep the segments small.
+    static constexpr size_t kHandleLockCount = 32;
+    std::mutex& handleLock(int32_t handle);
 
     String8 mDriverName;
     int mDriverFD;
@@ -179,9 +206,15 @@ private:
     // Time when thread pool was emptied
     int64_t mStarvationStartTimeMs;
 
+    // Current directory of the handle table. Written with mLock held, read without.
+    std::atomic<handle_directory*> mHandleDirectory;
+    std::mutex mHandleLocks[kHandleLockCount];
+
     mutable std::mutex mLock; // protects everything below.
 
-    Vector<handle_entry> mHandleToObject;
+    // Directories replaced by a bigger one. Lookups that started before the replacement may
+    // still be reading them, so they are only freed with the ProcessState.
+    std::vector<std::unique_ptr<handle_directory>> mRetiredHandleDirectories;
 
     bool mForked;
     bool mThreadPoolStarted;
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/Parcel.h>
+#include <binder/PersistableBundle.h>
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+// Usage: atest binderPersistableBundleBenchmark
+
+using android::Parcel;
+using android::status_t;
+using android::String16;
+using android::os::PersistableBundle;
+
+static PersistableBundle createLargePersistableBundle(size_t numEntries) {
+    PersistableBundle pb{};
+    for (size_t i = 0; i < numEntries; i++) {
+        const std::string suffix = std::to_string(i);
+        pb.putBoolean(String16(("bool" + suffix).c_str()), i % 2);
+        pb.putInt(String16(("int" + suffix).c_str()), static_cast<int32_t>(i));
+        pb.putLong(String16(("long" + suffix).c_str()), static_cast<int64_t>(i) << 32);
+        pb.putDouble(String16(("double" + suffix).c_str()), i * 0.5);
+        pb.putString(String16(("string" + suffix).c_str()), String16(suffix.c_str()));
+        pb.putIntVector(String16(("intVector" + suffix).c_str()), {1, 2, static_cast<int32_t>(i)});
+    }
+    return pb;
+}
+
+// Writes a bundle with the given encoding and reads it back. Arg: the number of entries of each
+// type in the bundle.
+static void BM_PersistableBundleRoundTrip(benchmark::State& state,
+                                          status_t (PersistableBundle::*write)(Parcel*) const) {
+    const PersistableBundle pb = createLargePersistableBundle(state.range(0));
+    while (state.KeepRunning()) {
+        Parcel p;
+        if ((pb.*write)(&p) != android::OK) {
+            state.SkipWithError("failed to write the bundle");
+            break;
+        }
+        p.setDataPosition(0);
+        PersistableBundle out;
+        if (out.readFromParcel(&p) != android::OK) {
+            state.SkipWithError("failed to read the bundle");
+            break;
+        }
+    }
+}
+
+static void BM_PersistableBundleDefault(benchmark::State& state) {
+    BM_PersistableBundleRoundTrip(state, &PersistableBundle::writeToParcel);
+}
+
+static void BM_PersistableBundleCompact(benchmark::State& state) {
+    BM_PersistableBundleRoundTrip(state, &PersistableBundle::writeToParcelCompact);
+}
+
+BENCHMARK(BM_PersistableBundleDefault)->Arg(10)->Arg(200);
+BENCHMARK(BM_PersistableBundleCompact)->Arg(10)->Arg(200);
+
+BENCHMARK_MAIN();
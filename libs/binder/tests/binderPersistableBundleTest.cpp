@@ -132,3 +132,68 @@ TEST(PersistableBundle, OverwriteKey) {
     EXPECT_TRUE(pb.getDouble(kKey, &out));
     EXPECT_EQ(out, 0.5);
 }
+
+static PersistableBundle createLargePersistableBundle(size_t numEntries) {
+    PersistableBundle pb{};
+    for (size_t i = 0; i < numEntries; i++) {
+        const std::string suffix = std::to_string(i);
+        pb.putBoolean(String16(("bool" + suffix).c_str()), i % 2);
+        pb.putInt(String16(("int" + suffix).c_str()), static_cast<int32_t>(i));
+        pb.putLong(String16(("long" + suffix).c_str()), static_cast<int64_t>(i) << 32);
+        pb.putDouble(String16(("double" + suffix).c_str()), i * 0.5);
+        pb.putString(String16(("string" + suffix).c_str()), String16(suffix.c_str()));
+        pb.putIntVector(String16(("intVector" + suffix).c_str()), {1, 2, static_cast<int32_t>(i)});
+    }
+    return pb;
+}
+
+TEST(PersistableBundle, ParcelAndUnparcelCompact) {
+    PersistableBundle expected = createLargePersistableBundle(10);
+    expected.putPersistableBundle(String16("nested"), createLargePersistableBundle(3));
+    expected.putPersistableBundle(String16("empty"), PersistableBundle{});
+    PersistableBundle out{};
+
+    Parcel p{};
+    EXPECT_EQ(expected.writeToParcelCompact(&p), 0);
+    p.setDataPosition(0);
+    EXPECT_EQ(out.readFromParcel(&p), 0);
+    EXPECT_EQ(p.dataAvail(), 0u);
+
+    EXPECT_EQ(expected, out);
+}
+
+TEST(PersistableBundle, ParcelAndUnparcelCompactEmpty) {
+    PersistableBundle out{};
+
+    Parcel p{};
+    EXPECT_EQ(PersistableBundle{}.writeToParcelCompact(&p), 0);
+    p.setDataPosition(0);
+    EXPECT_EQ(out.readFromParcel(&p), 0);
+
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(PersistableBundle, CompactEncodingWritesSharedKeysOnce) {
+    PersistableBundle pb{};
+    for (int i = 0; i < 10; i++) {
+        pb.putPersistableBundle(String16(std::to_string(i).c_str()), createSimplePersistableBundle());
+    }
+
+    Parcel defaultParcel{};
+    Parcel compactParcel{};
+    EXPECT_EQ(pb.writeToParcel(&defaultParcel), 0);
+    EXPECT_EQ(pb.writeToParcelCompact(&compactParcel), 0);
+    EXPECT_LT(compactParcel.dataSize(), defaultParcel.dataSize());
+}
+
+TEST(PersistableBundle, ReadCompactRejectsTruncatedParcel) {
+    Parcel p{};
+    EXPECT_EQ(createLargePersistableBundle(10).writeToParcelCompact(&p), 0);
+    // Only the length header missing reads as an empty bundle.
+    for (size_t size = sizeof(int32_t); size < p.dataSize(); size += sizeof(int32_t)) {
+        Parcel truncated{};
+        EXPECT_EQ(truncated.setData(p.data(), size), 0);
+        PersistableBundle out{};
+        EXPECT_NE(out.readFromParcel(&truncated), 0) << "size " << size;
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/BpBinder.h>
+#include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+
+#include <vector>
+
+// Usage: atest binderProcessStateBenchmark
+
+using namespace android;
+
+namespace {
+
+// Proxies for the services registered with the service manager, so that the handles looked up
+// below are spread over the handle table like in a system process.
+struct Proxies {
+    std::vector<sp<IBinder>> binders;
+    std::vector<int32_t> handles;
+};
+
+const Proxies& getProxies() {
+    static const Proxies* proxies = [] {
+        auto* proxies = new Proxies();
+        const sp<IServiceManager> sm = defaultServiceManager();
+        for (const auto& name : sm->listServices()) {
+            sp<IBinder> binder = sm->checkService(name);
+            if (binder == nullptr || binder->remoteBinder() == nullptr) continue;
+            const auto handle = binder->remoteBinder()->getDebugBinderHandle();
+            if (!handle) continue;
+            proxies->handles.push_back(*handle);
+            proxies->binders.push_back(std::move(binder));
+        }
+        return proxies;
+    }();
+    return *proxies;
+}
+
+} // namespace
+
+// What every binder thread does for each binder object it receives: look up the proxy of the
+// handle. Run with as many threads as a busy system process has binder threads.
+static void BM_getStrongProxyForHandle(benchmark::State& state) {
+    const auto& handles = getProxies().handles;
+    if (handles.empty()) {
+        state.SkipWithError("no services to look up");
+        return;
+    }
+    const sp<ProcessState> process = ProcessState::self();
+    size_t i = static_cast<size_t>(state.thread_index()) * 7;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(process->getStrongProxyForHandle(handles[i % handles.size()]));
+        i++;
+    }
+}
+
+BENCHMARK(BM_getStrongProxyForHandle)->Threads(1)->Threads(4)->Threads(16)->Threads(32);
+
+BENCHMARK_MAIN();
@@ -48,6 +48,7 @@
 
 #include <gui/ISurfaceComposer.h>
 #include <gui/LayerState.h>
+#include <gui/SurfaceComposerClient.h>
 #include <private/gui/ComposerService.h>
 #include <private/gui/ComposerServiceAIDL.h>
 
@@ -1915,6 +1916,8 @@ int Surface::connect(
 int Surface::disconnect(int api, IGraphicBufferProducer::DisconnectMode mode) {
     ATRACE_CALL();
     ALOGV("Surface::disconnect");
+    // Every buffer may be freed here; uncache them together once the lock is released.
+    SurfaceComposerClient::Transaction::BufferUncacheBatch uncacheBatch;
     Mutex::Autolock lock(mMutex);
     mRemovedBuffers.clear();
     mSharedBufferSlot = BufferItem::INVALID_BUFFER_SLOT;
@@ -620,7 +620,9 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId);
  *        which is per process Unique. The server side cache is larger than the client side
  *        cache so that the server will never evict entries before the client.
  *     2. When the client evicts an entry it notifies the server via an uncacheBuffer
- *        transaction.
+ *        transaction. Buffers destroyed while such a transaction is being sent, or while a
+ *        BufferUncacheBatch is alive, are uncached together in the next one, or with the next
+ *        transaction applied by the process.
  *     3. The client only references the Buffers by ID, and uses buffer->addDeathCallback
  *        to auto-evict destroyed buffers.
  */
@@ -660,13 +662,91 @@ public:
     }
 
     void uncache(uint64_t cacheId) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mBuffers.erase(cacheId)) {
+                return;
+            }
+            mPendingUncacheIds.push_back(cacheId);
+            // Don't let a batch keep too many destroyed buffers alive in SurfaceFlinger.
+            const bool holdBack = mNumBatches > 0 &&
+                    mPendingUncacheIds.size() <
+                            SurfaceComposerClient::Transaction::MAX_PENDING_UNCACHES;
+            if (holdBack || mFlushing) {
+                return;
+            }
+            mFlushing = true;
+        }
+        flushPendingUncaches();
+    }
+
+    void beginBatch() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNumBatches++;
+    }
+
+    void endBatch() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mNumBatches > 0 || mFlushing || mPendingUncacheIds.empty()) {
+                return;
+            }
+            mFlushing = true;
+        }
+        flushPendingUncaches();
+    }
+
+    // Takes the ids of the buffers waiting to be uncached, so that they are uncached by a
+    // transaction that is about to be sent anyway. The caller must pass them back to
+    // finishPendingUncaches once the transaction is sent, or failed to be.
+    std::vector<uint64_t> takePendingUncaches() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::vector<uint64_t> cacheIds;
+        std::swap(cacheIds, mPendingUncacheIds);
+        return cacheIds;
+    }
+
+    void finishPendingUncaches(const std::vector<uint64_t>& cacheIds, bool sent) {
+        if (cacheIds.empty()) {
+            return;
+        }
         std::lock_guard<std::mutex> lock(mMutex);
-        if (mBuffers.erase(cacheId)) {
-            SurfaceComposerClient::doUncacheBufferTransaction(cacheId);
+        if (sent) {
+            mUncacheStats.uncachedBuffers += cacheIds.size();
+        } else {
+            // SurfaceFlinger still holds these buffers; uncache them with the next transaction.
+            mPendingUncacheIds.insert(mPendingUncacheIds.begin(), cacheIds.begin(),
+                                      cacheIds.end());
         }
     }
 
+    SurfaceComposerClient::Transaction::BufferUncacheStats getUncacheStats() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mUncacheStats;
+    }
+
 private:
+    // Sends the pending uncaches, without holding the lock so that buffers destroyed in the
+    // meantime are added to the next transaction rather than sent one by one. Only one thread
+    // flushes at a time; mFlushing must have been set by the caller.
+    void flushPendingUncaches() {
+        std::vector<uint64_t> cacheIds;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mPendingUncacheIds.empty()) {
+                    mFlushing = false;
+                    return;
+                }
+                std::swap(cacheIds, mPendingUncacheIds);
+                mUncacheStats.uncachedBuffers += cacheIds.size();
+                mUncacheStats.uncacheTransactions++;
+            }
+            SurfaceComposerClient::doUncacheBufferTransaction(cacheIds);
+            cacheIds.clear();
+        }
+    }
+
     client_cache_t findLeastRecentlyUsedBuffer() REQUIRES(mMutex) {
         auto itr = mBuffers.begin();
         uint64_t minCounter = itr->second;
@@ -691,7 +771,11 @@ private:
     }
 
     std::mutex mMutex;
-    std::map<uint64_t /*Cache id*/, uint64_t /*counter*/> mBuffers GUARDED_BY(mMutex);
+    std::unordered_map<uint64_t /*Cache id*/, uint64_t /*counter*/> mBuffers GUARDED_BY(mMutex);
+    std::vector<uint64_t /*Cache id*/> mPendingUncacheIds GUARDED_BY(mMutex);
+    int mNumBatches GUARDED_BY(mMutex) = 0;
+    bool mFlushing GUARDED_BY(mMutex) = false;
+    SurfaceComposerClient::Transaction::BufferUncacheStats mUncacheStats GUARDED_BY(mMutex);
 
     // Used by ISurfaceComposer to identify which process is sending the cached buffer.
     sp<IBinder> token;
@@ -704,6 +788,19 @@ void removeDeadBufferCallback(void* /*context*/, uint64_t graphicBufferId) {
     BufferCache::getInstance().uncache(graphicBufferId);
 }
 
+SurfaceComposerClient::Transaction::BufferUncacheBatch::BufferUncacheBatch() {
+    BufferCache::getInstance().beginBatch();
+}
+
+SurfaceComposerClient::Transaction::BufferUncacheBatch::~BufferUncacheBatch() {
+    BufferCache::getInstance().endBatch();
+}
+
+SurfaceComposerClient::Transaction::BufferUncacheStats
+SurfaceComposerClient::Transaction::getBufferUncacheStats() {
+    return BufferCache::getInstance().getUncacheStats();
+}
+
 // ---------------------------------------------------------------------------
 
 SurfaceComposerClient::Transaction::Transaction() {
@@ -1053,16 +1150,23 @@ std::vector<uint64_t> SurfaceComposerClient::Transaction::getMergedTransactionId
 }
 
 void SurfaceComposerClient::doUncacheBufferTransaction(uint64_t cacheId) {
+    doUncacheBufferTransaction(std::vector<uint64_t>{cacheId});
+}
+
+void SurfaceComposerClient::doUncacheBufferTransaction(const std::vector<uint64_t>& cacheIds) {
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
 
-    client_cache_t uncacheBuffer;
-    uncacheBuffer.token = BufferCache::getInstance().getToken();
-    uncacheBuffer.id = cacheId;
+    const sp<IBinder> cacheToken = BufferCache::getInstance().getToken();
+    std::vector<client_cache_t> uncacheBuffers;
+    uncacheBuffers.reserve(cacheIds.size());
+    for (uint64_t cacheId : cacheIds) {
+        uncacheBuffers.push_back({.token = cacheToken, .id = cacheId});
+    }
     Vector<ComposerState> composerStates;
     status_t status = sf->setTransactionState(FrameTimelineInfo{}, composerStates, {},
                                               ISurfaceComposer::eOneWay,
                                               Transaction::getDefaultApplyToken(), {}, systemTime(),
-                                              true, {uncacheBuffer}, false, {}, generateId(), {});
+                                              true, uncacheBuffers, false, {}, generateId(), {});
     if (status != NO_ERROR) {
         ALOGE_AND_TRACE("SurfaceComposerClient::doUncacheBufferTransaction - %s",
                         strerror(-status));
@@ -1200,6 +1304,14 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
     }
 
     cacheBuffers();
+    BufferCache& bufferCache = BufferCache::getInstance();
+    const std::vector<uint64_t> pendingUncacheIds = bufferCache.takePendingUncaches();
+    if (!pendingUncacheIds.empty()) {
+        const sp<IBinder> cacheToken = bufferCache.getToken();
+        for (uint64_t cacheId : pendingUncacheIds) {
+            mUncacheBuffers.push_back({.token = cacheToken, .id = cacheId});
+        }
+    }
 
     Vector<ComposerState> composerStates;
     Vector<DisplayState> displayStates;
@@ -1235,10 +1347,12 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous, bool oneWay
     sp<IBinder> applyToken = mApplyToken ? mApplyToken : getDefaultApplyToken();
 
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
-    sf->setTransactionState(mFrameTimelineInfo, composerStates, displayStates, flags, applyToken,
-                            mInputWindowCommands, mDesiredPresentTime, mIsAutoTimestamp,
-                            mUncacheBuffers, hasListenerCallbacks, listenerCallbacks, mId,
-                            mMergedTransactionIds);
+    status_t status =
+            sf->setTransactionState(mFrameTimelineInfo, composerStates, displayStates, flags,
+                                    applyToken, mInputWindowCommands, mDesiredPresentTime,
+                                    mIsAutoTimestamp, mUncacheBuffers, hasListenerCallbacks,
+                                    listenerCallbacks, mId, mMergedTransactionIds);
+    bufferCache.finishPendingUncaches(pendingUncacheIds, status == NO_ERROR);
     mId = generateId();
 
     // Clear the current states and flags
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
+
 #include <android/gui/ISurfaceComposer.h>
 #include <gui/AidlStatusUtil.h>
 #include <gui/WindowInfosListenerReporter.h>
@@ -78,6 +80,7 @@ status_t WindowInfosListenerReporter::removeWindowInfosListener(
             // stale values
             mLastWindowInfos.clear();
             mLastDisplayInfos.clear();
+            mLastVsyncId.reset();
         }
 
         if (status == OK) {
@@ -92,19 +95,41 @@ binder::Status WindowInfosListenerReporter::onWindowInfosChanged(
         const gui::WindowInfosUpdate& update) {
     std::unordered_set<sp<WindowInfosListener>, gui::SpHash<WindowInfosListener>>
             windowInfosListeners;
+    std::optional<gui::WindowInfosUpdate> fullUpdate;
 
     {
         std::scoped_lock lock(mListenersMutex);
-        for (auto listener : mWindowInfosListeners) {
-            windowInfosListeners.insert(listener);
+        if (update.isDelta) {
+            fullUpdate = update;
+            if (!mLastVsyncId || fullUpdate->applyDelta(mLastWindowInfos, *mLastVsyncId) != OK) {
+                fullUpdate.reset();
+            }
         }
 
-        mLastWindowInfos = update.windowInfos;
-        mLastDisplayInfos = update.displayInfos;
+        if (!update.isDelta || fullUpdate) {
+            for (auto listener : mWindowInfosListeners) {
+                windowInfosListeners.insert(listener);
+            }
+
+            const gui::WindowInfosUpdate& newUpdate = fullUpdate ? *fullUpdate : update;
+            mLastWindowInfos = newUpdate.windowInfos;
+            mLastDisplayInfos = newUpdate.displayInfos;
+            mLastVsyncId = newUpdate.vsyncId;
+        }
+    }
+
+    if (update.isDelta && !fullUpdate) {
+        // An update was missed, so the delta can't be applied. Keep the last window infos until
+        // they're sent again in full.
+        ALOGW("Dropping window infos delta for vsync id %" PRId64 " against vsync id %" PRId64,
+              update.vsyncId, update.baseVsyncId);
+        mWindowInfosPublisher->requestWindowInfosResync(mListenerId);
+        mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
+        return binder::Status::ok();
     }
 
     for (auto listener : windowInfosListeners) {
-        listener->onWindowInfosChanged(update);
+        listener->onWindowInfosChanged(fullUpdate ? *fullUpdate : update);
     }
 
     mWindowInfosPublisher->ackWindowInfosReceived(update.vsyncId, mListenerId);
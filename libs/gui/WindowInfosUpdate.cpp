@@ -14,11 +14,81 @@
  * limitations under the License.
  */
 
+#include <unordered_map>
+
 #include <gui/WindowInfosUpdate.h>
 #include <private/gui/ParcelUtils.h>
 
 namespace android::gui {
 
+namespace {
+
+// WindowInfo::operator== leaves out some of the fields that are sent to the listeners.
+bool isSameWindow(const WindowInfo& lhs, const WindowInfo& rhs) {
+    return lhs == rhs && lhs.alpha == rhs.alpha && lhs.windowToken == rhs.windowToken &&
+            lhs.touchableRegionCropHandle == rhs.touchableRegionCropHandle &&
+            lhs.focusTransferTarget == rhs.focusTransferTarget;
+}
+
+} // namespace
+
+std::optional<WindowInfosUpdate> WindowInfosUpdate::makeDelta(const WindowInfosUpdate& base,
+                                                              const WindowInfosUpdate& update) {
+    std::unordered_map<int32_t, size_t> baseIndices;
+    baseIndices.reserve(base.windowInfos.size());
+    for (size_t i = 0; i < base.windowInfos.size(); i++) {
+        baseIndices.try_emplace(base.windowInfos[i].id, i);
+    }
+
+    WindowInfosUpdate delta{{}, update.displayInfos, update.vsyncId, update.timestamp};
+    delta.isDelta = true;
+    delta.baseVsyncId = base.vsyncId;
+    delta.deltaWindowIndices.reserve(update.windowInfos.size());
+    for (const WindowInfo& windowInfo : update.windowInfos) {
+        auto it = baseIndices.find(windowInfo.id);
+        if (it != baseIndices.end() && isSameWindow(base.windowInfos[it->second], windowInfo)) {
+            delta.deltaWindowIndices.push_back(static_cast<int32_t>(it->second));
+            continue;
+        }
+        delta.deltaWindowIndices.push_back(-static_cast<int32_t>(delta.windowInfos.size()) - 1);
+        delta.windowInfos.push_back(windowInfo);
+        // Once most windows changed, sending them all is about as cheap and simpler to apply.
+        if (delta.windowInfos.size() * 2 > update.windowInfos.size()) {
+            return std::nullopt;
+        }
+    }
+    return delta;
+}
+
+status_t WindowInfosUpdate::applyDelta(const std::vector<WindowInfo>& lastWindowInfos,
+                                       int64_t lastVsyncId) {
+    if (!isDelta) {
+        return OK;
+    }
+    if (lastVsyncId != baseVsyncId) {
+        return BAD_VALUE;
+    }
+
+    std::vector<WindowInfo> changedWindowInfos = std::move(windowInfos);
+    windowInfos.clear();
+    windowInfos.reserve(deltaWindowIndices.size());
+    for (int32_t index : deltaWindowIndices) {
+        if (index >= 0 && static_cast<size_t>(index) < lastWindowInfos.size()) {
+            windowInfos.push_back(lastWindowInfos[index]);
+        } else if (index < 0 && static_cast<size_t>(-(index + 1)) < changedWindowInfos.size()) {
+            windowInfos.push_back(std::move(changedWindowInfos[-(index + 1)]));
+        } else {
+            ALOGE("%s: Invalid window index %d", __func__, index);
+            return BAD_VALUE;
+        }
+    }
+
+    isDelta = false;
+    baseVsyncId = 0;
+    deltaWindowIndices.clear();
+    return OK;
+}
+
 status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     if (parcel == nullptr) {
         ALOGE("%s: Null parcel", __func__);
@@ -44,6 +114,12 @@ status_t WindowInfosUpdate::readFromParcel(const android::Parcel* parcel) {
     SAFE_PARCEL(parcel->readInt64, &vsyncId);
     SAFE_PARCEL(parcel->readInt64, &timestamp);
 
+    SAFE_PARCEL(parcel->readBool, &isDelta);
+    if (isDelta) {
+        SAFE_PARCEL(parcel->readInt64, &baseVsyncId);
+        SAFE_PARCEL(parcel->readInt32Vector, &deltaWindowIndices);
+    }
+
     return OK;
 }
 
@@ -66,6 +142,12 @@ status_t WindowInfosUpdate::writeToParcel(android::Parcel* parcel) const {
     SAFE_PARCEL(parcel->writeInt64, vsyncId);
     SAFE_PARCEL(parcel->writeInt64, timestamp);
 
+    SAFE_PARCEL(parcel->writeBool, isDelta);
+    if (isDelta) {
+        SAFE_PARCEL(parcel->writeInt64, baseVsyncId);
+        SAFE_PARCEL(parcel->writeInt32Vector, deltaWindowIndices);
+    }
+
     return OK;
 }
 
@@ -258,6 +258,8 @@ public:
      * in order with other transactions that use buffers.
      */
     static void doUncacheBufferTransaction(uint64_t cacheId);
+    // Uncaches several buffers with a single transaction.
+    static void doUncacheBufferTransaction(const std::vector<uint64_t>& cacheIds);
 
     // Queries whether a given display is wide color display.
     static status_t isWideColorDisplay(const sp<IBinder>& display, bool* outIsWideColorDisplay);
@@ -784,6 +786,30 @@ public:
         static void setDefaultApplyToken(sp<IBinder> applyToken);
 
         static status_t sendSurfaceFlushJankDataTransaction(const sp<SurfaceControl>& sc);
+
+        /**
+         * Buffers are uncached as soon as they are destroyed. While a BufferUncacheBatch is alive,
+         * the buffers destroyed are instead uncached together when the last batch goes away, with
+         * the next transaction applied, or once MAX_PENDING_UNCACHES of them are waiting. Meant to
+         * be held around code that drops many buffers at once.
+         */
+        class BufferUncacheBatch {
+        public:
+            BufferUncacheBatch();
+            ~BufferUncacheBatch();
+            BufferUncacheBatch(const BufferUncacheBatch&) = delete;
+            BufferUncacheBatch& operator=(const BufferUncacheBatch&) = delete;
+        };
+        static constexpr size_t MAX_PENDING_UNCACHES = 64;
+
+        struct BufferUncacheStats {
+            // Buffers uncached, on their own or along with other transactions.
+            uint64_t uncachedBuffers = 0;
+            // Transactions sent only to uncache buffers.
+            uint64_t uncacheTransactions = 0;
+        };
+        // For Testing Only
+        static BufferUncacheStats getBufferUncacheStats();
     };
 
     status_t clearLayerFrameStats(const sp<IBinder>& token) const;
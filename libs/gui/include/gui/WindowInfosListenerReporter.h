@@ -23,6 +23,7 @@
 #include <gui/SpHash.h>
 #include <gui/WindowInfosListener.h>
 #include <gui/WindowInfosUpdate.h>
+#include <optional>
 #include <unordered_set>
 
 namespace android {
@@ -46,6 +47,8 @@ private:
 
     std::vector<gui::WindowInfo> mLastWindowInfos GUARDED_BY(mListenersMutex);
     std::vector<gui::DisplayInfo> mLastDisplayInfos GUARDED_BY(mListenersMutex);
+    // Vsync id of the last update received, which delta updates are made against.
+    std::optional<int64_t> mLastVsyncId GUARDED_BY(mListenersMutex);
 
     sp<gui::IWindowInfosPublisher> mWindowInfosPublisher;
     int64_t mListenerId;
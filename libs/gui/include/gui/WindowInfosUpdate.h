@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include <binder/Parcelable.h>
 #include <gui/DisplayInfo.h>
 #include <gui/WindowInfo.h>
@@ -37,6 +39,27 @@ struct WindowInfosUpdate : public Parcelable {
     int64_t vsyncId;
     int64_t timestamp;
 
+    /*
+     * Set on updates that only carry the windows that changed since the update with the vsync id
+     * baseVsyncId, which the receiver must already hold. windowInfos then only holds the windows
+     * that were added or changed, and deltaWindowIndices describes all the windows in order: an
+     * index >= 0 reuses that window from the base update, and an index i < 0 takes window
+     * -(i + 1) from windowInfos.
+     */
+    bool isDelta = false;
+    int64_t baseVsyncId = 0;
+    std::vector<int32_t> deltaWindowIndices;
+
+    // Returns the delta from |base| to |update|, or nullopt if it wouldn't be smaller than
+    // |update| itself. |base| must not be a delta.
+    static std::optional<WindowInfosUpdate> makeDelta(const WindowInfosUpdate& base,
+                                                      const WindowInfosUpdate& update);
+
+    // Turns a delta back into a full update, given the windows and the vsync id of the last
+    // update the receiver holds. Returns BAD_VALUE if the delta wasn't made against that update,
+    // in which case the update must be dropped.
+    status_t applyDelta(const std::vector<WindowInfo>& lastWindowInfos, int64_t lastVsyncId);
+
     status_t writeToParcel(android::Parcel*) const override;
     status_t readFromParcel(const android::Parcel*) override;
 };
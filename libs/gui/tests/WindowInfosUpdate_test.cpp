@@ -0,0 +1,128 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <binder/Parcel.h>
+
+#include <gui/WindowInfosUpdate.h>
+
+namespace android {
+
+using gui::WindowInfo;
+using gui::WindowInfosUpdate;
+
+namespace test {
+
+namespace {
+
+WindowInfo makeWindow(int32_t id) {
+    WindowInfo info;
+    info.id = id;
+    info.name = "Window " + std::to_string(id);
+    info.frame = Rect(0, 0, 100, 100);
+    return info;
+}
+
+WindowInfosUpdate makeUpdate(int64_t vsyncId, size_t windowCount) {
+    WindowInfosUpdate update{{}, {}, vsyncId, /*timestamp=*/vsyncId * 1000};
+    for (size_t i = 0; i < windowCount; i++) {
+        update.windowInfos.push_back(makeWindow(static_cast<int32_t>(i + 1)));
+    }
+    return update;
+}
+
+WindowInfosUpdate parcelRoundTrip(const WindowInfosUpdate& update) {
+    Parcel p;
+    EXPECT_EQ(OK, update.writeToParcel(&p));
+    p.setDataPosition(0);
+    WindowInfosUpdate result;
+    EXPECT_EQ(OK, result.readFromParcel(&p));
+    return result;
+}
+
+} // namespace
+
+TEST(WindowInfosUpdate, DeltaOnlyCarriesChangedWindows) {
+    const WindowInfosUpdate base = makeUpdate(1, 10);
+    WindowInfosUpdate update = makeUpdate(2, 10);
+    update.windowInfos[3].frame = Rect(10, 10, 110, 110);
+    // Moves the last window to the front, and adds a new one.
+    std::rotate(update.windowInfos.rbegin(), update.windowInfos.rbegin() + 1,
+                update.windowInfos.rend());
+    update.windowInfos.push_back(makeWindow(42));
+
+    std::optional<WindowInfosUpdate> delta = WindowInfosUpdate::makeDelta(base, update);
+    ASSERT_TRUE(delta);
+    EXPECT_TRUE(delta->isDelta);
+    EXPECT_EQ(1, delta->baseVsyncId);
+    EXPECT_EQ(2u, delta->windowInfos.size());
+
+    WindowInfosUpdate received = parcelRoundTrip(*delta);
+    ASSERT_EQ(OK, received.applyDelta(base.windowInfos, base.vsyncId));
+    EXPECT_FALSE(received.isDelta);
+    EXPECT_EQ(update.vsyncId, received.vsyncId);
+    EXPECT_EQ(update.timestamp, received.timestamp);
+    ASSERT_EQ(update.windowInfos.size(), received.windowInfos.size());
+    for (size_t i = 0; i < update.windowInfos.size(); i++) {
+        EXPECT_EQ(update.windowInfos[i], received.windowInfos[i]) << "window " << i;
+    }
+}
+
+TEST(WindowInfosUpdate, DeltaDetectsFieldsOutsideOfEquality) {
+    const WindowInfosUpdate base = makeUpdate(1, 4);
+    WindowInfosUpdate update = makeUpdate(2, 4);
+    update.windowInfos[0].alpha = 0.5f;
+
+    std::optional<WindowInfosUpdate> delta = WindowInfosUpdate::makeDelta(base, update);
+    ASSERT_TRUE(delta);
+    ASSERT_EQ(1u, delta->windowInfos.size());
+    EXPECT_EQ(0.5f, delta->windowInfos[0].alpha);
+}
+
+TEST(WindowInfosUpdate, NoDeltaWhenMostWindowsChanged) {
+    const WindowInfosUpdate base = makeUpdate(1, 4);
+    WindowInfosUpdate update = makeUpdate(2, 4);
+    for (WindowInfo& info : update.windowInfos) {
+        info.frame = Rect(1, 1, 2, 2);
+    }
+    EXPECT_FALSE(WindowInfosUpdate::makeDelta(base, update));
+}
+
+TEST(WindowInfosUpdate, DeltaAgainstAnotherUpdateIsRejected) {
+    const WindowInfosUpdate base = makeUpdate(1, 4);
+    WindowInfosUpdate update = makeUpdate(2, 4);
+    update.windowInfos[0].frame = Rect(1, 1, 2, 2);
+
+    std::optional<WindowInfosUpdate> delta = WindowInfosUpdate::makeDelta(base, update);
+    ASSERT_TRUE(delta);
+    WindowInfosUpdate received = parcelRoundTrip(*delta);
+    EXPECT_EQ(BAD_VALUE, received.applyDelta(base.windowInfos, /*baseVsyncId=*/0));
+}
+
+TEST(WindowInfosUpdate, FullUpdateIsLeftUnchanged) {
+    const WindowInfosUpdate update = makeUpdate(1, 3);
+    WindowInfosUpdate received = parcelRoundTrip(update);
+    EXPECT_FALSE(received.isDelta);
+    ASSERT_EQ(OK, received.applyDelta({}, /*baseVsyncId=*/0));
+    EXPECT_EQ(update.windowInfos.size(), received.windowInfos.size());
+}
+
+} // namespace test
+} // namespace android
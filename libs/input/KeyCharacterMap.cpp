@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include <android/keycodes.h>
 #include <attestation/HmacKeyManager.h>
@@ -31,6 +32,8 @@
 #include <utils/Timers.h>
 #include <utils/Tokenizer.h>
 
+#include "KeymapCache.h"
+
 // Enables debug output for the parser.
 #define DEBUG_PARSER 0
 
@@ -79,6 +82,19 @@ static String8 toString(const char16_t* chars, size_t numChars) {
 }
 #endif
 
+// Key character maps can be modified after they have been loaded (overlays, key remappings), so
+// the cache holds pristine copies and every load returns a map of its own.
+static input::KeymapCache<KeyCharacterMap>& getKeyCharacterMapCache() {
+    static input::KeymapCache<KeyCharacterMap> cache;
+    return cache;
+}
+
+static std::string getCacheKey(const std::string& filename, KeyCharacterMap::Format format,
+                               bool fromContents) {
+    return std::string(fromContents ? "contents:" : "file:") +
+            std::to_string(static_cast<int>(format)) + ":" + filename;
+}
+
 
 // --- KeyCharacterMap ---
 
@@ -86,6 +102,16 @@ KeyCharacterMap::KeyCharacterMap(const std::string& filename) : mLoadFileName(fi
 
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::string& filename,
                                                                      Format format) {
+    const std::string cacheKey = getCacheKey(filename, format, /*fromContents=*/false);
+    std::optional<std::string> version = input::getKeymapFileVersion(filename);
+    if (version) {
+        std::shared_ptr<const KeyCharacterMap> cached =
+                getKeyCharacterMapCache().get(cacheKey, *version);
+        if (cached) {
+            return std::make_shared<KeyCharacterMap>(*cached);
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
     if (status) {
@@ -100,6 +126,10 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::
     std::unique_ptr<Tokenizer> t(tokenizer);
     status = map->load(t.get(), format);
     if (status == OK) {
+        if (version) {
+            getKeyCharacterMapCache().put(cacheKey, std::move(*version),
+                                          std::make_shared<const KeyCharacterMap>(*map));
+        }
         return map;
     }
     return Errorf("Load KeyCharacterMap failed {}.", status);
@@ -107,6 +137,15 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::load(const std::
 
 base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadContents(
         const std::string& filename, const char* contents, Format format) {
+    // Overlays are handed over as contents on every keyboard layout switch. The contents
+    // themselves are the version, so a cached map is only used for the exact same text.
+    const std::string cacheKey = getCacheKey(filename, format, /*fromContents=*/true);
+    std::shared_ptr<const KeyCharacterMap> cached =
+            getKeyCharacterMapCache().get(cacheKey, contents);
+    if (cached) {
+        return std::make_shared<KeyCharacterMap>(*cached);
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::fromContents(String8(filename.c_str()), contents, &tokenizer);
     if (status) {
@@ -122,6 +161,8 @@ base::Result<std::shared_ptr<KeyCharacterMap>> KeyCharacterMap::loadContents(
     std::unique_ptr<Tokenizer> t(tokenizer);
     status = map->load(t.get(), format);
     if (status == OK) {
+        getKeyCharacterMapCache().put(cacheKey, contents,
+                                      std::make_shared<const KeyCharacterMap>(*map));
         return map;
     }
     return Errorf("Load KeyCharacterMap failed {}.", status);
@@ -141,37 +182,48 @@ status_t KeyCharacterMap::load(Tokenizer* tokenizer, Format format) {
 #endif
     if (status != OK) {
         ALOGE("Loading KeyCharacterMap failed with status %s", statusToString(status).c_str());
+        return status;
     }
-    return status;
+    updateKeysByCharacter();
+    return OK;
 }
 
 void KeyCharacterMap::clear() {
     mKeysByScanCode.clear();
     mKeysByUsageCode.clear();
     mKeys.clear();
+    mKeysByCharacter.clear();
     mLayoutOverlayApplied = false;
     mType = KeyboardType::UNKNOWN;
 }
 
 status_t KeyCharacterMap::reloadBaseFromFile() {
     clear();
-    Tokenizer* tokenizer;
-    status_t status = Tokenizer::open(String8(mLoadFileName.c_str()), &tokenizer);
-    if (status) {
-        ALOGE("Error %s opening key character map file %s.", statusToString(status).c_str(),
-              mLoadFileName.c_str());
-        return status;
+    // Goes through the cache, so that switching between overlays doesn't reparse the base map.
+    base::Result<std::shared_ptr<KeyCharacterMap>> base =
+            load(mLoadFileName, KeyCharacterMap::Format::BASE);
+    if (!base.ok()) {
+        ALOGE("Error reloading key character map file %s: %s", mLoadFileName.c_str(),
+              base.error().message().c_str());
+        return BAD_VALUE;
     }
-    std::unique_ptr<Tokenizer> t(tokenizer);
-    return load(t.get(), KeyCharacterMap::Format::BASE);
+    KeyCharacterMap& map = **base;
+    mKeys = std::move(map.mKeys);
+    mKeysByCharacter = std::move(map.mKeysByCharacter);
+    mType = map.mType;
+    mKeysByScanCode = std::move(map.mKeysByScanCode);
+    mKeysByUsageCode = std::move(map.mKeysByUsageCode);
+    return OK;
 }
 
 void KeyCharacterMap::combine(const KeyCharacterMap& overlay) {
     if (mLayoutOverlayApplied) {
         reloadBaseFromFile();
     }
-    for (const auto& [keyCode, key] : overlay.mKeys) {
-        mKeys.insert_or_assign(keyCode, key);
+    for (size_t keyCode = 0; keyCode < overlay.mKeys.size(); keyCode++) {
+        if (overlay.mKeys[keyCode]) {
+            editKey(static_cast<int32_t>(keyCode)) = *overlay.mKeys[keyCode];
+        }
     }
 
     for (const auto& [fromScanCode, toAndroidKeyCode] : overlay.mKeysByScanCode) {
@@ -181,6 +233,7 @@ void KeyCharacterMap::combine(const KeyCharacterMap& overlay) {
     for (const auto& [fromHidUsageCode, toAndroidKeyCode] : overlay.mKeysByUsageCode) {
         mKeysByUsageCode.insert_or_assign(fromHidUsageCode, toAndroidKeyCode);
     }
+    updateKeysByCharacter();
     mLayoutOverlayApplied = true;
 }
 
@@ -419,11 +472,56 @@ std::pair<int32_t, int32_t> KeyCharacterMap::applyKeyBehavior(int32_t fromKeyCod
 }
 
 const KeyCharacterMap::Key* KeyCharacterMap::getKey(int32_t keyCode) const {
-    auto it = mKeys.find(keyCode);
-    if (it != mKeys.end()) {
-        return &it->second;
+    if (keyCode < 0 || static_cast<size_t>(keyCode) >= mKeys.size() || !mKeys[keyCode]) {
+        return nullptr;
     }
-    return nullptr;
+    return &*mKeys[keyCode];
+}
+
+KeyCharacterMap::Key& KeyCharacterMap::editKey(int32_t keyCode) {
+    LOG_ALWAYS_FATAL_IF(keyCode < 0 || keyCode >= MAX_KEYS, "Invalid key code %d", keyCode);
+    if (static_cast<size_t>(keyCode) >= mKeys.size()) {
+        mKeys.resize(keyCode + 1);
+    }
+    std::optional<Key>& key = mKeys[keyCode];
+    if (!key) {
+        key.emplace();
+    }
+    return *key;
+}
+
+void KeyCharacterMap::updateKeysByCharacter() {
+    mKeysByCharacter.clear();
+    for (size_t keyCode = 0; keyCode < mKeys.size(); keyCode++) {
+        if (!mKeys[keyCode]) {
+            continue;
+        }
+        for (const Behavior& behavior : mKeys[keyCode]->behaviors) {
+            if (behavior.character) {
+                mKeysByCharacter.push_back({.character = behavior.character,
+                                            .keyCode = static_cast<int32_t>(keyCode),
+                                            .metaState = behavior.metaState});
+            }
+        }
+    }
+    // Keep the key with the lowest key code for each character and, of its behaviors, the most
+    // general one that maps to the character. For example, the base key behavior will usually be
+    // last in the list.
+    std::stable_sort(mKeysByCharacter.begin(), mKeysByCharacter.end(),
+                     [](const CharacterKey& lhs, const CharacterKey& rhs) {
+                         return lhs.character < rhs.character;
+                     });
+    auto out = mKeysByCharacter.begin();
+    for (auto it = mKeysByCharacter.begin(); it != mKeysByCharacter.end(); it++) {
+        if (out != mKeysByCharacter.begin() && std::prev(out)->character == it->character) {
+            if (std::prev(out)->keyCode == it->keyCode) {
+                *std::prev(out) = *it;
+            }
+            continue;
+        }
+        *out++ = *it;
+    }
+    mKeysByCharacter.erase(out, mKeysByCharacter.end());
 }
 
 const KeyCharacterMap::Behavior* KeyCharacterMap::getKeyBehavior(int32_t keyCode,
@@ -475,22 +573,16 @@ bool KeyCharacterMap::findKey(char16_t ch, int32_t* outKeyCode, int32_t* outMeta
         return false;
     }
 
-    for (const auto& [keyCode, key] : mKeys) {
-        // Try to find the most general behavior that maps to this character.
-        // For example, the base key behavior will usually be last in the list.
-        const Behavior* found = nullptr;
-        for (const Behavior& behavior : key.behaviors) {
-            if (behavior.character == ch) {
-                found = &behavior;
-            }
-        }
-        if (found != nullptr) {
-            *outKeyCode = keyCode;
-            *outMetaState = found->metaState;
-            return true;
-        }
+    auto it = std::lower_bound(mKeysByCharacter.begin(), mKeysByCharacter.end(), ch,
+                               [](const CharacterKey& characterKey, char16_t c) {
+                                   return characterKey.character < c;
+                               });
+    if (it == mKeysByCharacter.end() || it->character != ch) {
+        return false;
     }
-    return false;
+    *outKeyCode = it->keyCode;
+    *outMetaState = it->metaState;
+    return true;
 }
 
 void KeyCharacterMap::addKey(Vector<KeyEvent>& outEvents, int32_t deviceId, int32_t keyCode,
@@ -636,6 +728,10 @@ std::unique_ptr<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel)
         if (parcel->errorCheck()) {
             return nullptr;
         }
+        if (keyCode < 0 || keyCode >= MAX_KEYS) {
+            ALOGE("Invalid key code in KeyCharacterMap (%d)", keyCode);
+            return nullptr;
+        }
 
         Key key{.label = label, .number = number};
         while (parcel->readInt32()) {
@@ -654,7 +750,9 @@ std::unique_ptr<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel)
                     .replacementKeyCode = replacementKeyCode,
             });
         }
-        map->mKeys.emplace(keyCode, std::move(key));
+        if (map->getKey(keyCode) == nullptr) {
+            map->editKey(keyCode) = std::move(key);
+        }
 
         if (parcel->errorCheck()) {
             return nullptr;
@@ -696,6 +794,7 @@ std::unique_ptr<KeyCharacterMap> KeyCharacterMap::readFromParcel(Parcel* parcel)
             return nullptr;
         }
     }
+    map->updateKeysByCharacter();
     return map;
 }
 
@@ -708,9 +807,14 @@ void KeyCharacterMap::writeToParcel(Parcel* parcel) const {
     parcel->writeInt32(static_cast<int32_t>(mType));
     parcel->writeBool(mLayoutOverlayApplied);
 
-    size_t numKeys = mKeys.size();
+    size_t numKeys = std::count_if(mKeys.begin(), mKeys.end(),
+                                   [](const std::optional<Key>& key) { return key.has_value(); });
     parcel->writeInt32(numKeys);
-    for (const auto& [keyCode, key] : mKeys) {
+    for (size_t keyCode = 0; keyCode < mKeys.size(); keyCode++) {
+        if (!mKeys[keyCode]) {
+            continue;
+        }
+        const Key& key = *mKeys[keyCode];
         parcel->writeInt32(keyCode);
         parcel->writeInt32(key.label);
         parcel->writeInt32(key.number);
@@ -926,7 +1030,7 @@ status_t KeyCharacterMap::Parser::parseKey() {
               keyCodeToken.c_str());
         return BAD_VALUE;
     }
-    if (mMap->mKeys.find(*keyCode) != mMap->mKeys.end()) {
+    if (mMap->getKey(*keyCode) != nullptr) {
         ALOGE("%s: Duplicate entry for key code '%s'.", mTokenizer->getLocation().c_str(),
                 keyCodeToken.c_str());
         return BAD_VALUE;
@@ -942,13 +1046,13 @@ status_t KeyCharacterMap::Parser::parseKey() {
 
     ALOGD_IF(DEBUG_PARSER, "Parsed beginning of key: keyCode=%d.", *keyCode);
     mKeyCode = *keyCode;
-    mMap->mKeys.emplace(*keyCode, Key{});
+    mMap->editKey(*keyCode);
     mState = STATE_KEY;
     return NO_ERROR;
 }
 
 status_t KeyCharacterMap::Parser::parseKeyProperty() {
-    Key& key = mMap->mKeys[mKeyCode];
+    Key& key = mMap->editKey(mKeyCode);
     String8 token = mTokenizer->nextToken(WHITESPACE_OR_PROPERTY_DELIMITER);
     if (token == "}") {
         mState = STATE_TOP;
@@ -1113,7 +1217,7 @@ status_t KeyCharacterMap::Parser::parseKeyProperty() {
             }
             Behavior newBehavior = behavior;
             newBehavior.metaState = property.metaState;
-            key.behaviors.push_front(newBehavior);
+            key.behaviors.insert(key.behaviors.begin(), newBehavior);
             ALOGD_IF(DEBUG_PARSER,
                      "Parsed key meta: keyCode=%d, meta=0x%x, char=%d, fallback=%d replace=%d.",
                      mKeyCode, key.behaviors.front().metaState, key.behaviors.front().character,
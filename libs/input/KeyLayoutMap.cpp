@@ -30,10 +30,13 @@
 #include <vintf/KernelConfigs.h>
 #endif
 
+#include <algorithm>
 #include <cstdlib>
 #include <string_view>
 #include <unordered_map>
 
+#include "KeymapCache.h"
+
 /**
  * Log debug output for the parser.
  * Enable this via "adb shell setprop log.tag.KeyLayoutMapParser DEBUG" (requires restart)
@@ -125,6 +128,22 @@ bool kernelConfigsArePresent(const std::set<std::string>& configs) {
 #endif
 }
 
+// Returns the entry for |code| in |entries|, which are sorted by code, or nullptr if there is none.
+template <typename T>
+const T* findEntry(const std::vector<std::pair<int32_t, T>>& entries, int32_t code) {
+    auto it = std::lower_bound(entries.begin(), entries.end(), code,
+                               [](const auto& entry, int32_t c) { return entry.first < c; });
+    if (it == entries.end() || it->first != code) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+input::KeymapCache<KeyLayoutMap>& getKeyLayoutMapCache() {
+    static input::KeymapCache<KeyLayoutMap> cache;
+    return cache;
+}
+
 } // namespace
 
 KeyLayoutMap::KeyLayoutMap() = default;
@@ -137,6 +156,20 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::loadContents(const std
 
 base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string& filename,
                                                                const char* contents) {
+    // Key layout maps are immutable once loaded, so a file that hasn't changed since it was last
+    // loaded shares the map parsed back then.
+    std::optional<std::string> version;
+    if (contents == nullptr) {
+        version = input::getKeymapFileVersion(filename);
+        if (version) {
+            std::shared_ptr<const KeyLayoutMap> cached =
+                    getKeyLayoutMapCache().get(filename, *version);
+            if (cached) {
+                return std::const_pointer_cast<KeyLayoutMap>(cached);
+            }
+        }
+    }
+
     Tokenizer* tokenizer;
     status_t status;
     if (contents == nullptr) {
@@ -160,6 +193,9 @@ base::Result<std::shared_ptr<KeyLayoutMap>> KeyLayoutMap::load(const std::string
         return Errorf("Missing kernel config");
     }
     map->mLoadFileName = filename;
+    if (version) {
+        getKeyLayoutMapCache().put(filename, std::move(*version), map);
+    }
     return ret;
 }
 
@@ -224,16 +260,13 @@ base::Result<std::pair<InputDeviceSensorType, int32_t>> KeyLayoutMap::mapSensor(
 
 const KeyLayoutMap::Key* KeyLayoutMap::getKey(int32_t scanCode, int32_t usageCode) const {
     if (usageCode) {
-        auto it = mKeysByUsageCode.find(usageCode);
-        if (it != mKeysByUsageCode.end()) {
-            return &it->second;
+        const Key* key = findEntry(mKeysByUsageCode, usageCode);
+        if (key) {
+            return key;
         }
     }
     if (scanCode) {
-        auto it = mKeysByScanCode.find(scanCode);
-        if (it != mKeysByScanCode.end()) {
-            return &it->second;
-        }
+        return findEntry(mKeysByScanCode, scanCode);
     }
     return nullptr;
 }
@@ -368,9 +401,11 @@ status_t KeyLayoutMap::Parser::parseKey() {
                 mapUsage ? "usage" : "scan code", codeToken.c_str());
         return BAD_VALUE;
     }
-    std::unordered_map<int32_t, Key>& map =
+    std::vector<std::pair<int32_t, Key>>& keys =
             mapUsage ? mMap->mKeysByUsageCode : mMap->mKeysByScanCode;
-    if (map.find(*code) != map.end()) {
+    auto position = std::lower_bound(keys.begin(), keys.end(), *code,
+                                     [](const auto& entry, int32_t c) { return entry.first < c; });
+    if (position != keys.end() && position->first == *code) {
         ALOGE("%s: Duplicate entry for key %s '%s'.", mTokenizer->getLocation().c_str(),
                 mapUsage ? "usage" : "scan code", codeToken.c_str());
         return BAD_VALUE;
@@ -411,7 +446,7 @@ status_t KeyLayoutMap::Parser::parseKey() {
     Key key;
     key.keyCode = *keyCode;
     key.flags = flags;
-    map.insert({*code, key});
+    keys.insert(position, {*code, key});
     return NO_ERROR;
 }
 
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <android-base/stringprintf.h>
+#include <android-base/thread_annotations.h>
+
+namespace android::input {
+
+/**
+ * Returns a string that changes whenever the file at |path| is replaced or modified, or nullopt if
+ * the file can't be stat'ed.
+ */
+inline std::optional<std::string> getKeymapFileVersion(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return std::nullopt;
+    }
+    return base::StringPrintf("%llu:%llu:%lld:%lld.%09ld",
+                              static_cast<unsigned long long>(st.st_dev),
+                              static_cast<unsigned long long>(st.st_ino),
+                              static_cast<long long>(st.st_size),
+                              static_cast<long long>(st.st_mtim.tv_sec), st.st_mtim.tv_nsec);
+}
+
+/**
+ * Process wide cache of parsed key maps.
+ *
+ * Devices are opened, closed and reopened (e.g. on Bluetooth reconnects) with the same key
+ * layout and key character map files, and keyboard layout overlays are switched back and forth.
+ * Parsing the text files is by far the most expensive part of loading a key map, so the result
+ * is kept here, keyed by file name, together with the version of the source it was parsed from.
+ * An entry whose version doesn't match the current source is never returned.
+ */
+template <typename T>
+class KeymapCache {
+public:
+    // Upper bound on the number of cached maps. There are only a handful of key maps in use at
+    // any time; when the bound is reached the cache simply starts over.
+    static constexpr size_t kMaxEntries = 64;
+
+    std::shared_ptr<const T> get(const std::string& key, const std::string& version) const {
+        std::scoped_lock lock(mLock);
+        auto it = mEntries.find(key);
+        if (it == mEntries.end() || it->second.version != version) {
+            return nullptr;
+        }
+        return it->second.value;
+    }
+
+    void put(const std::string& key, std::string version, std::shared_ptr<const T> value) {
+        std::scoped_lock lock(mLock);
+        if (mEntries.size() >= kMaxEntries && mEntries.find(key) == mEntries.end()) {
+            mEntries.clear();
+        }
+        mEntries.insert_or_assign(key, Entry{std::move(version), std::move(value)});
+    }
+
+private:
+    struct Entry {
+        std::string version;
+        std::shared_ptr<const T> value;
+    };
+
+    mutable std::mutex mLock;
+    std::unordered_map<std::string, Entry> mEntries GUARDED_BY(mLock);
+};
+
+} // namespace android::input
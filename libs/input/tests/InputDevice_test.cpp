@@ -202,6 +202,107 @@ TEST(InputDeviceKeyLayoutTest, HidUsageCodesFallbackMapping) {
     }
 }
 
+TEST(InputDeviceKeyLayoutTest, SharesMapUntilFileChanges) {
+    TemporaryFile klFile;
+    ASSERT_TRUE(base::WriteStringToFile("key 30 A\nkey 2 1\nkey usage 0x070004 A\n",
+                                        klFile.path));
+
+    base::Result<std::shared_ptr<KeyLayoutMap>> first = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(first.ok()) << "Unable to load KeyLayout at " << klFile.path;
+    base::Result<std::shared_ptr<KeyLayoutMap>> second = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(second.ok()) << "Unable to load KeyLayout at " << klFile.path;
+    ASSERT_EQ(first->get(), second->get()) << "Unchanged file should not be parsed again";
+
+    int32_t outKeyCode;
+    uint32_t outFlags;
+    ASSERT_EQ(OK, (*second)->mapKey(30, 0, &outKeyCode, &outFlags));
+    ASSERT_EQ(AKEYCODE_A, outKeyCode);
+    ASSERT_EQ(OK, (*second)->mapKey(2, 0, &outKeyCode, &outFlags));
+    ASSERT_EQ(AKEYCODE_1, outKeyCode);
+    ASSERT_EQ(OK, (*second)->mapKey(0, 0x070004, &outKeyCode, &outFlags));
+    ASSERT_EQ(AKEYCODE_A, outKeyCode);
+    ASSERT_EQ(NAME_NOT_FOUND, (*second)->mapKey(3, 0, &outKeyCode, &outFlags));
+    ASSERT_EQ(std::vector<int32_t>({30}), (*second)->findScanCodesForKey(AKEYCODE_A));
+
+    ASSERT_TRUE(base::WriteStringToFile("key 30 B\n", klFile.path));
+    base::Result<std::shared_ptr<KeyLayoutMap>> changed = KeyLayoutMap::load(klFile.path);
+    ASSERT_TRUE(changed.ok()) << "Unable to load KeyLayout at " << klFile.path;
+    ASSERT_NE(first->get(), changed->get()) << "Changed file should be parsed again";
+    ASSERT_EQ(OK, (*changed)->mapKey(30, 0, &outKeyCode, &outFlags));
+    ASSERT_EQ(AKEYCODE_B, outKeyCode);
+    ASSERT_EQ(NAME_NOT_FOUND, (*changed)->mapKey(2, 0, &outKeyCode, &outFlags));
+}
+
+TEST(InputDeviceKeyCharacterMapTest, LoadsIndependentCopiesOfSameFile) {
+    std::string kcmPath = base::GetExecutableDirectory() + "/data/german.kcm";
+    base::Result<std::shared_ptr<KeyCharacterMap>> first =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(first.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+    base::Result<std::shared_ptr<KeyCharacterMap>> second =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(second.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+    ASSERT_NE(first->get(), second->get());
+    ASSERT_EQ(**first, **second);
+
+    // Changes made to one of the maps must not leak into maps loaded later.
+    (*first)->addKeyRemapping(AKEYCODE_A, AKEYCODE_B);
+    base::Result<std::shared_ptr<KeyCharacterMap>> third =
+            KeyCharacterMap::load(kcmPath, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(third.ok()) << "Cannot load KeyCharacterMap at " << kcmPath;
+    ASSERT_EQ(AKEYCODE_A, (*third)->applyKeyRemapping(AKEYCODE_A));
+    ASSERT_EQ(**second, **third);
+}
+
+TEST(InputDeviceKeyCharacterMapTest, GetEventsPrefersLowestKeyCodeAndMostGeneralBehavior) {
+    static constexpr const char* KCM = R"(
+type OVERLAY
+key A {
+    label: 'A'
+    base: 'a'
+    shift, capslock: 'A'
+}
+key B {
+    label: 'B'
+    base: 'b'
+    shift: 'A'
+}
+)";
+    base::Result<std::shared_ptr<KeyCharacterMap>> ret =
+            KeyCharacterMap::loadContents("test.kcm", KCM, KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(ret.ok()) << "Cannot load KeyCharacterMap from contents";
+    const std::shared_ptr<KeyCharacterMap>& map = *ret;
+
+    const char16_t chars[] = {u'A', u'b'};
+    Vector<KeyEvent> events;
+    ASSERT_TRUE(map->getEvents(/*deviceId=*/1, chars, 2, events));
+    ASSERT_EQ(6u, events.size());
+    ASSERT_EQ(AKEYCODE_SHIFT_LEFT, events[0].getKeyCode());
+    ASSERT_EQ(AKEYCODE_A, events[1].getKeyCode());
+    ASSERT_EQ(AMETA_SHIFT_ON | AMETA_SHIFT_LEFT_ON, events[1].getMetaState());
+    ASSERT_EQ(AKEYCODE_A, events[2].getKeyCode());
+    ASSERT_EQ(AKEYCODE_SHIFT_LEFT, events[3].getKeyCode());
+    ASSERT_EQ(AKEYCODE_B, events[4].getKeyCode());
+    ASSERT_EQ(0, events[4].getMetaState());
+    ASSERT_EQ(AKEYCODE_B, events[5].getKeyCode());
+
+    const char16_t unmapped[] = {u'c'};
+    ASSERT_FALSE(map->getEvents(/*deviceId=*/1, unmapped, 1, events));
+
+    // Once key A no longer generates 'A', the character comes from key B.
+    base::Result<std::shared_ptr<KeyCharacterMap>> overlay =
+            KeyCharacterMap::loadContents("overlay.kcm", "type OVERLAY\nkey A {\n base: 'c'\n}\n",
+                                          KeyCharacterMap::Format::OVERLAY);
+    ASSERT_TRUE(overlay.ok()) << "Cannot load KeyCharacterMap from contents";
+    map->combine(**overlay);
+    events.clear();
+    ASSERT_TRUE(map->getEvents(/*deviceId=*/1, chars, 1, events));
+    ASSERT_EQ(4u, events.size());
+    ASSERT_EQ(AKEYCODE_B, events[1].getKeyCode());
+    events.clear();
+    ASSERT_TRUE(map->getEvents(/*deviceId=*/1, unmapped, 1, events));
+    ASSERT_EQ(AKEYCODE_A, events[0].getKeyCode());
+}
+
 TEST(InputDeviceKeyLayoutTest, DoesNotLoadWhenRequiredKernelConfigIsMissing) {
 #if !defined(__ANDROID__)
     GTEST_SKIP() << "Can't check kernel configs on host";
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <android-base/stringprintf.h>
+#include <input/KeyCharacterMap.h>
+
+namespace android {
+
+namespace {
+
+// A full keyboard with the letters, digits and space, similar to the generic key character map.
+std::string makeKeyCharacterMapContents() {
+    std::string contents = "type FULL\n";
+    for (char letter = 'A'; letter <= 'Z'; letter++) {
+        const char lower = static_cast<char>(letter - 'A' + 'a');
+        contents += base::StringPrintf("key %c {\n"
+                                       "    label: '%c'\n"
+                                       "    base: '%c'\n"
+                                       "    shift, capslock: '%c'\n"
+                                       "    shift+capslock: '%c'\n"
+                                       "}\n",
+                                       letter, letter, lower, letter, lower);
+    }
+    for (char digit = '0'; digit <= '9'; digit++) {
+        contents += base::StringPrintf("key %c {\n"
+                                       "    label: '%c'\n"
+                                       "    base: '%c'\n"
+                                       "}\n",
+                                       digit, digit, digit);
+    }
+    contents += "key SPACE {\n"
+                "    label: ' '\n"
+                "    base: ' '\n"
+                "}\n";
+    return contents;
+}
+
+std::u16string makeText(size_t length) {
+    static constexpr char16_t TEXT[] = u"The quick brown fox jumps over the lazy dog 0123456789 ";
+    std::u16string text;
+    text.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        text.push_back(TEXT[i % (std::size(TEXT) - 1)]);
+    }
+    return text;
+}
+
+} // namespace
+
+// Injecting text, as IMEs and automation tools do, resolves every character to a key through
+// getEvents. Arg: the length of the injected string.
+static void BM_getEvents(benchmark::State& state) {
+    base::Result<std::shared_ptr<KeyCharacterMap>> map =
+            KeyCharacterMap::loadContents("benchmark.kcm", makeKeyCharacterMapContents().c_str(),
+                                          KeyCharacterMap::Format::BASE);
+    if (!map.ok()) {
+        state.SkipWithError("Cannot load KeyCharacterMap");
+        return;
+    }
+    const std::u16string text = makeText(static_cast<size_t>(state.range(0)));
+    Vector<KeyEvent> events;
+    for (auto _ : state) {
+        events.clear();
+        benchmark::DoNotOptimize((*map)->getEvents(/*deviceId=*/1, text.data(), text.size(),
+                                                   events));
+    }
+}
+BENCHMARK(BM_getEvents)->ArgName("chars")->Arg(16)->Arg(256)->Arg(4096);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -27,6 +27,7 @@
 #include <binder/IInterface.h>
 
 #include <sensor/BitTube.h>
+#include <sensor/SensorEventRing.h>
 
 namespace android {
 // ----------------------------------------------------------------------------
@@ -38,6 +39,7 @@ enum {
     FLUSH_SENSOR,
     CONFIGURE_CHANNEL,
     DESTROY,
+    GET_SENSOR_EVENT_RING,
 };
 
 class BpSensorEventConnection : public BpInterface<ISensorEventConnection>
@@ -98,6 +100,21 @@ public:
         return reply.readInt32();
     }
 
+    virtual sp<SensorEventRing> getSensorEventRing() {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISensorEventConnection::getInterfaceDescriptor());
+        remote()->transact(GET_SENSOR_EVENT_RING, data, &reply);
+        if (reply.readInt32() != NO_ERROR) {
+            return nullptr;
+        }
+        int fd = dup(reply.readFileDescriptor());
+        if (fd < 0) {
+            ALOGE("getSensorEventRing: can't dup filedescriptor (%s)", strerror(errno));
+            return nullptr;
+        }
+        return SensorEventRing::map(fd);
+    }
+
     virtual void onLastStrongRef(const void* id) {
         destroy();
         BpInterface<ISensorEventConnection>::onLastStrongRef(id);
@@ -166,6 +183,17 @@ status_t BnSensorEventConnection::onTransact(
             destroy();
             return NO_ERROR;
         }
+        case GET_SENSOR_EVENT_RING: {
+            CHECK_INTERFACE(ISensorEventConnection, data, reply);
+            sp<SensorEventRing> ring(getSensorEventRing());
+            if (ring == nullptr) {
+                reply->writeInt32(INVALID_OPERATION);
+                return NO_ERROR;
+            }
+            reply->writeInt32(NO_ERROR);
+            reply->writeDupFileDescriptor(ring->getFd());
+            return NO_ERROR;
+        }
 
     }
     return BBinder::onTransact(code, data, reply, flags);
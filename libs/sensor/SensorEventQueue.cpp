@@ -27,12 +27,17 @@
 #include <sensor/Sensor.h>
 #include <sensor/BitTube.h>
 #include <sensor/ISensorEventConnection.h>
+#include <sensor/SensorEventRing.h>
 
 #include <android/sensor.h>
 #include <hardware/sensors-base.h>
 
 using std::min;
 
+static_assert(android::SensorEventRing::CAPACITY <=
+                      android::SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT,
+              "a single read must be able to drain the shared event ring");
+
 // ----------------------------------------------------------------------------
 namespace android {
 // ----------------------------------------------------------------------------
@@ -65,8 +70,9 @@ ssize_t SensorEventQueue::write(const sp<BitTube>& tube,
 
 ssize_t SensorEventQueue::read(ASensorEvent* events, size_t numEvents) {
     if (mAvailable == 0) {
-        ssize_t err = BitTube::recvObjects(mSensorChannel,
-                mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT);
+        ssize_t err = mEventRing != nullptr
+                ? readFromEventRing()
+                : BitTube::recvObjects(mSensorChannel, mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT);
         if (err < 0) {
             return err;
         }
@@ -80,6 +86,39 @@ ssize_t SensorEventQueue::read(ASensorEvent* events, size_t numEvents) {
     return static_cast<ssize_t>(count);
 }
 
+ssize_t SensorEventQueue::readFromEventRing() {
+    bool wakeProducer = false;
+    ssize_t count = mEventRing->read(mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT, &wakeProducer);
+    if (count == 0) {
+        // The ring is empty. Consume the doorbells which woke us up and re-arm the doorbell, then
+        // look again for events written in between, which wouldn't have rung it.
+        uint64_t token;
+        while (::recv(mSensorChannel->getFd(), &token, sizeof(token), MSG_DONTWAIT) > 0) {
+        }
+        mEventRing->rearmDoorbell();
+        count = mEventRing->read(mRecBuffer, MAX_RECEIVE_BUFFER_EVENT_COUNT, &wakeProducer);
+    }
+    if (wakeProducer) {
+        // The service is holding events which didn't fit in the ring, tell it there's room now.
+        ssize_t size = ::send(mSensorChannel->getFd(), &SensorEventRing::kWakeToken,
+                              sizeof(SensorEventRing::kWakeToken), MSG_DONTWAIT | MSG_NOSIGNAL);
+        ALOGE_IF(size < 0, "SensorEventQueue: can't wake up the service (%s)", strerror(errno));
+    }
+    return count;
+}
+
+status_t SensorEventQueue::enableSharedEventRing() {
+    if (mEventRing != nullptr) {
+        return NO_ERROR;
+    }
+    sp<SensorEventRing> ring = mSensorEventConnection->getSensorEventRing();
+    if (ring == nullptr) {
+        return INVALID_OPERATION;
+    }
+    mEventRing = ring;
+    return NO_ERROR;
+}
+
 sp<Looper> SensorEventQueue::getLooper() const
 {
     Mutex::Autolock _l(mLock);
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Sensors"
+
+#include <sensor/SensorEventRing.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <new>
+
+#include <android/sensor.h>
+#include <cutils/ashmem.h>
+#include <log/log.h>
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+namespace {
+
+constexpr uint32_t kRingMagic = 0x53455652;  // "SEVR"
+
+static_assert((SensorEventRing::CAPACITY & (SensorEventRing::CAPACITY - 1)) == 0,
+              "the ring capacity must be a power of two");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "atomics shared across processes must be lock free");
+
+}  // namespace
+
+// Lives at the start of the shared memory, followed by the events. Indices are free running and
+// wrap around; they're reduced modulo CAPACITY when accessing the events.
+struct alignas(64) SensorEventRing::Header {
+    uint32_t magic;
+    uint32_t capacity;
+    // Only written by the producer.
+    std::atomic<uint32_t> writeIndex;
+    // Only written by the consumer.
+    std::atomic<uint32_t> readIndex;
+    // Set by the producer when it writes kWakeToken, cleared by the consumer in rearmDoorbell().
+    std::atomic<uint32_t> doorbellPending;
+    // Set by the producer when a write didn't fit, cleared by the consumer when it wakes it up.
+    std::atomic<uint32_t> producerWaiting;
+};
+
+sp<SensorEventRing> SensorEventRing::create() {
+    const size_t size = sizeof(Header) + CAPACITY * sizeof(ASensorEvent);
+    int fd = ashmem_create_region("SensorEventRing", size);
+    if (fd < 0) {
+        ALOGE("SensorEventRing: can't create shared memory (%s)", strerror(errno));
+        return nullptr;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ALOGE("SensorEventRing: can't map shared memory (%s)", strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    Header* header = new (base) Header();
+    header->magic = kRingMagic;
+    header->capacity = CAPACITY;
+    return new SensorEventRing(fd, base, size);
+}
+
+sp<SensorEventRing> SensorEventRing::map(int fd) {
+    const size_t size = sizeof(Header) + CAPACITY * sizeof(ASensorEvent);
+    int regionSize = ashmem_get_size_region(fd);
+    if (regionSize < 0 || static_cast<size_t>(regionSize) != size) {
+        ALOGE("SensorEventRing: unexpected shared memory size %d", regionSize);
+        close(fd);
+        return nullptr;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ALOGE("SensorEventRing: can't map shared memory (%s)", strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    const Header* header = static_cast<const Header*>(base);
+    if (header->magic != kRingMagic || header->capacity != CAPACITY) {
+        ALOGE("SensorEventRing: invalid header");
+        munmap(base, size);
+        close(fd);
+        return nullptr;
+    }
+    sp<SensorEventRing> ring = new SensorEventRing(fd, base, size);
+    ring->mIndex = header->readIndex.load(std::memory_order_acquire);
+    return ring;
+}
+
+SensorEventRing::SensorEventRing(int fd, void* base, size_t size)
+      : mFd(fd),
+        mBase(base),
+        mSize(size),
+        mHeader(static_cast<Header*>(base)),
+        mIndex(0),
+        mEventsWritten(0),
+        mDoorbellsRung(0),
+        mFullCount(0) {}
+
+SensorEventRing::~SensorEventRing() {
+    munmap(mBase, mSize);
+    close(mFd);
+}
+
+int SensorEventRing::getFd() const {
+    return mFd;
+}
+
+ASensorEvent* SensorEventRing::events() const {
+    return reinterpret_cast<ASensorEvent*>(static_cast<uint8_t*>(mBase) + sizeof(Header));
+}
+
+ssize_t SensorEventRing::write(ASensorEvent const* events, size_t count, bool* outWakeConsumer) {
+    *outWakeConsumer = false;
+    if (count == 0) {
+        return 0;
+    }
+    if (count > CAPACITY) {
+        return -EINVAL;
+    }
+    uint32_t used = mIndex - mHeader->readIndex.load(std::memory_order_acquire);
+    if (used > CAPACITY) {
+        ALOGE("SensorEventRing: consumer index is out of range");
+        return -EINVAL;
+    }
+    if (CAPACITY - used < count) {
+        // Ask for a wakeup, then check again in case the consumer made room in the meantime and
+        // missed the flag.
+        mHeader->producerWaiting.store(1);
+        used = mIndex - mHeader->readIndex.load();
+        if (used > CAPACITY) {
+            return -EINVAL;
+        }
+        if (CAPACITY - used < count) {
+            mFullCount++;
+            return -EAGAIN;
+        }
+    }
+
+    const uint32_t offset = mIndex & (CAPACITY - 1);
+    const size_t first = std::min<size_t>(count, CAPACITY - offset);
+    memcpy(this->events() + offset, events, first * sizeof(ASensorEvent));
+    memcpy(this->events(), events + first, (count - first) * sizeof(ASensorEvent));
+    mIndex += count;
+    mHeader->writeIndex.store(mIndex);
+    mEventsWritten += count;
+
+    if (mHeader->doorbellPending.exchange(1) == 0) {
+        *outWakeConsumer = true;
+        mDoorbellsRung++;
+    }
+    return static_cast<ssize_t>(count);
+}
+
+ssize_t SensorEventRing::read(ASensorEvent* events, size_t maxCount, bool* outWakeProducer) {
+    *outWakeProducer = false;
+    // Sequentially consistent, so it can't be reordered before the store in rearmDoorbell().
+    const uint32_t available = mHeader->writeIndex.load() - mIndex;
+    if (available > CAPACITY) {
+        ALOGE("SensorEventRing: producer index is out of range");
+        return -EINVAL;
+    }
+    const size_t count = std::min<size_t>(available, maxCount);
+    if (count == 0) {
+        return 0;
+    }
+
+    const uint32_t offset = mIndex & (CAPACITY - 1);
+    const size_t first = std::min<size_t>(count, CAPACITY - offset);
+    memcpy(events, this->events() + offset, first * sizeof(ASensorEvent));
+    memcpy(events + first, this->events(), (count - first) * sizeof(ASensorEvent));
+    mIndex += count;
+    mHeader->readIndex.store(mIndex);
+
+    if (mHeader->producerWaiting.load() != 0 && mHeader->producerWaiting.exchange(0) != 0) {
+        *outWakeProducer = true;
+    }
+    return static_cast<ssize_t>(count);
+}
+
+void SensorEventRing::rearmDoorbell() {
+    mHeader->doorbellPending.store(0);
+}
+
+// ----------------------------------------------------------------------------
+}; // namespace android
@@ -30,6 +30,7 @@ namespace android {
 
 class BitTube;
 class Parcel;
+class SensorEventRing;
 
 class ISensorEventConnection : public IInterface
 {
@@ -42,6 +43,10 @@ public:
     virtual status_t setEventRate(int handle, nsecs_t ns) = 0;
     virtual status_t flush() = 0;
     virtual int32_t configureChannel(int32_t handle, int32_t rateLevel) = 0;
+    // Switches the connection to deliver events through a shared memory ring, with the sensor
+    // channel only used as a doorbell. Must be called before any sensor is enabled. Returns
+    // nullptr if the connection doesn't support it.
+    virtual sp<SensorEventRing> getSensorEventRing() = 0;
 protected:
     virtual void destroy() = 0; // synchronously release resource hold by remote object
 };
@@ -43,6 +43,7 @@ namespace android {
 
 class ISensorEventConnection;
 class Sensor;
+class SensorEventRing;
 class Looper;
 
 // ----------------------------------------------------------------------------
@@ -94,6 +95,10 @@ public:
 
     status_t injectSensorEvent(const ASensorEvent& event);
 
+    // Opts in to receive events through a shared memory ring instead of the socket, which only
+    // wakes up the reader. Must be called before any sensor is enabled on this queue.
+    status_t enableSharedEventRing();
+
     // Filters the given sensor events in place and returns the new number of events.
     //
     // The filtering is controlled by ASensorEventQueue.requestAdditionalInfo, and if this value is
@@ -102,8 +107,10 @@ public:
 
 private:
     sp<Looper> getLooper() const;
+    ssize_t readFromEventRing();
     sp<ISensorEventConnection> mSensorEventConnection;
     sp<BitTube> mSensorChannel;
+    sp<SensorEventRing> mEventRing;
     mutable Mutex mLock;
     mutable sp<Looper> mLooper;
     ASensorEvent* mRecBuffer;
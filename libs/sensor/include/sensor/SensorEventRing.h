@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <atomic>
+
+#include <utils/Errors.h>
+#include <utils/RefBase.h>
+
+struct ASensorEvent;
+
+namespace android {
+// ----------------------------------------------------------------------------
+
+/*
+ * A single producer, single consumer ring of sensor events in shared memory, used by a
+ * SensorEventConnection instead of writing every batch of events to its BitTube.
+ *
+ * The BitTube is still the fd clients poll, but it only carries doorbells: the producer writes
+ * kWakeToken to it when it publishes events and no doorbell is pending yet, so a burst of batches
+ * costs a single wakeup. The consumer re-arms the doorbell once it has found the ring empty. In
+ * the other direction, when the ring is full the producer raises a flag and the consumer writes
+ * kWakeToken back once it has made room.
+ */
+class SensorEventRing : public RefBase
+{
+public:
+    // Number of events in the ring. It matches SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT so
+    // a single read always drains the ring, and no larger batch is ever written to a connection.
+    static constexpr uint32_t CAPACITY = 256;
+
+    // Message written to the BitTube, in either direction, to wake up the other side.
+    static constexpr uint64_t kWakeToken = 0x52494e4757414b45;  // "RINGWAKE"
+
+    // Creates a new ring in shared memory, for the producer side.
+    static sp<SensorEventRing> create();
+
+    // Maps a ring created by create() from its fd, for the consumer side. Takes ownership of |fd|.
+    // Returns nullptr if the fd doesn't hold a valid ring.
+    static sp<SensorEventRing> map(int fd);
+
+    virtual ~SensorEventRing();
+
+    // Returns the fd of the shared memory, to be sent to the consumer.
+    int getFd() const;
+
+    // Producer side. Writes all |count| events or none. Returns |count|, -EAGAIN if there isn't
+    // enough room, or -EINVAL if the shared state is corrupt. |outWakeConsumer| is set when the
+    // caller must write kWakeToken to the BitTube.
+    ssize_t write(ASensorEvent const* events, size_t count, bool* outWakeConsumer);
+
+    // Consumer side. Reads up to |maxCount| events and returns how many were read, or -EINVAL if
+    // the shared state is corrupt. |outWakeProducer| is set when the caller must write kWakeToken
+    // to the BitTube.
+    ssize_t read(ASensorEvent* events, size_t maxCount, bool* outWakeProducer);
+
+    // Consumer side. Re-arms the doorbell. Must be called after the ring was found empty and the
+    // pending doorbells were read from the BitTube, and followed by another read().
+    void rearmDoorbell();
+
+    // Producer side statistics.
+    uint64_t getEventsWritten() const { return mEventsWritten; }
+    uint64_t getDoorbellsRung() const { return mDoorbellsRung; }
+    uint64_t getFullCount() const { return mFullCount; }
+
+private:
+    struct Header;
+
+    SensorEventRing(int fd, void* base, size_t size);
+
+    ASensorEvent* events() const;
+
+    int mFd;
+    void* mBase;
+    size_t mSize;
+    Header* mHeader;
+    // Private copy of this side's index, as the peer may scribble over the shared one.
+    uint32_t mIndex;
+    uint64_t mEventsWritten;
+    uint64_t mDoorbellsRung;
+    uint64_t mFullCount;
+};
+
+// ----------------------------------------------------------------------------
+}; // namespace android
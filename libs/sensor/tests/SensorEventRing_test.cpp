@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <android/sensor.h>
+#include <sensor/SensorEventRing.h>
+
+namespace android {
+
+class SensorEventRingTest : public ::testing::Test {
+protected:
+    virtual void SetUp() override {
+        mProducer = SensorEventRing::create();
+        ASSERT_NE(mProducer, nullptr);
+        mConsumer = SensorEventRing::map(dup(mProducer->getFd()));
+        ASSERT_NE(mConsumer, nullptr);
+    }
+
+    static std::vector<ASensorEvent> makeEvents(size_t count, int64_t firstTimestamp) {
+        std::vector<ASensorEvent> events(count);
+        for (size_t i = 0; i < count; i++) {
+            events[i].type = ASENSOR_TYPE_ACCELEROMETER;
+            events[i].timestamp = firstTimestamp + i;
+        }
+        return events;
+    }
+
+    sp<SensorEventRing> mProducer;
+    sp<SensorEventRing> mConsumer;
+};
+
+TEST_F(SensorEventRingTest, RejectsInvalidFd) {
+    int pipeFds[2];
+    ASSERT_EQ(pipe(pipeFds), 0);
+    close(pipeFds[1]);
+    EXPECT_EQ(SensorEventRing::map(pipeFds[0]), nullptr);
+}
+
+TEST_F(SensorEventRingTest, EventsRoundTrip) {
+    bool wake = false;
+    auto events = makeEvents(10, 100);
+    ASSERT_EQ(mProducer->write(events.data(), events.size(), &wake), 10);
+
+    ASensorEvent received[SensorEventRing::CAPACITY];
+    ASSERT_EQ(mConsumer->read(received, SensorEventRing::CAPACITY, &wake), 10);
+    for (size_t i = 0; i < 10; i++) {
+        EXPECT_EQ(received[i].timestamp, events[i].timestamp);
+    }
+    EXPECT_EQ(mConsumer->read(received, SensorEventRing::CAPACITY, &wake), 0);
+}
+
+TEST_F(SensorEventRingTest, WrapsAround) {
+    bool wake = false;
+    ASensorEvent received[SensorEventRing::CAPACITY];
+    int64_t timestamp = 0;
+    // Batches that don't divide the capacity, so they eventually straddle the end of the ring.
+    for (int round = 0; round < 20; round++) {
+        auto events = makeEvents(100, timestamp);
+        ASSERT_EQ(mProducer->write(events.data(), events.size(), &wake), 100);
+        ASSERT_EQ(mConsumer->read(received, SensorEventRing::CAPACITY, &wake), 100);
+        for (size_t i = 0; i < 100; i++) {
+            ASSERT_EQ(received[i].timestamp, timestamp + int64_t(i));
+        }
+        timestamp += 100;
+    }
+}
+
+TEST_F(SensorEventRingTest, DoorbellRingsOncePerBatchOfWrites) {
+    bool wakeConsumer = false;
+    bool wakeProducer = false;
+    auto events = makeEvents(4, 0);
+
+    // Only the first write rings the doorbell until the consumer re-arms it.
+    ASSERT_EQ(mProducer->write(events.data(), events.size(), &wakeConsumer), 4);
+    EXPECT_TRUE(wakeConsumer);
+    ASSERT_EQ(mProducer->write(events.data(), events.size(), &wakeConsumer), 4);
+    EXPECT_FALSE(wakeConsumer);
+
+    ASensorEvent received[SensorEventRing::CAPACITY];
+    ASSERT_EQ(mConsumer->read(received, SensorEventRing::CAPACITY, &wakeProducer), 8);
+    ASSERT_EQ(mConsumer->read(received, SensorEventRing::CAPACITY, &wakeProducer), 0);
+    mConsumer->rearmDoorbell();
+
+    ASSERT_EQ(mProducer->write(events.data(), events.size(), &wakeConsumer), 4);
+    EXPECT_TRUE(wakeConsumer);
+    EXPECT_EQ(mProducer->getEventsWritten(), 12u);
+    EXPECT_EQ(mProducer->getDoorbellsRung(), 2u);
+}
+
+TEST_F(SensorEventRingTest, FullRingWakesProducerOnceDrained) {
+    bool wakeConsumer = false;
+    bool wakeProducer = false;
+    auto events = makeEvents(SensorEventRing::CAPACITY, 0);
+    ASSERT_EQ(mProducer->write(events.data(), events.size(), &wakeConsumer),
+              ssize_t(SensorEventRing::CAPACITY));
+
+    // Writes are all or nothing.
+    EXPECT_EQ(mProducer->write(events.data(), 1, &wakeConsumer), -EAGAIN);
+    EXPECT_EQ(mProducer->getFullCount(), 1u);
+
+    ASensorEvent received[SensorEventRing::CAPACITY];
+    ASSERT_EQ(mConsumer->read(received, 16, &wakeProducer), 16);
+    EXPECT_TRUE(wakeProducer);
+    // The producer is only woken up once per full ring.
+    ASSERT_EQ(mConsumer->read(received, 16, &wakeProducer), 16);
+    EXPECT_FALSE(wakeProducer);
+
+    EXPECT_EQ(mProducer->write(events.data(), 32, &wakeConsumer), 32);
+}
+
+TEST_F(SensorEventRingTest, RejectsOversizedWrite) {
+    bool wake = false;
+    auto events = makeEvents(SensorEventRing::CAPACITY + 1, 0);
+    EXPECT_EQ(mProducer->write(events.data(), events.size(), &wake), -EINVAL);
+}
+
+TEST_F(SensorEventRingTest, ConcurrentProducerAndConsumer) {
+    constexpr int64_t kEventCount = 200000;
+    std::thread producer([&]() {
+        int64_t timestamp = 0;
+        bool wake = false;
+        while (timestamp < kEventCount) {
+            auto events = makeEvents(std::min<int64_t>(7, kEventCount - timestamp), timestamp);
+            if (mProducer->write(events.data(), events.size(), &wake) > 0) {
+                timestamp += events.size();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    ASensorEvent received[SensorEventRing::CAPACITY];
+    int64_t expected = 0;
+    bool wake = false;
+    while (expected < kEventCount) {
+        ssize_t count = mConsumer->read(received, SensorEventRing::CAPACITY, &wake);
+        ASSERT_GE(count, 0);
+        for (ssize_t i = 0; i < count; i++) {
+            ASSERT_EQ(received[i].timestamp, expected++);
+        }
+    }
+    producer.join();
+}
+
+} // namespace android
@@ -73,7 +73,7 @@ struct LinearEffect {
 static inline bool operator==(const LinearEffect& lhs, const LinearEffect& rhs) {
     return lhs.inputDataspace == rhs.inputDataspace && lhs.outputDataspace == rhs.outputDataspace &&
             lhs.undoPremultipliedAlpha == rhs.undoPremultipliedAlpha &&
-            lhs.fakeOutputDataspace == rhs.fakeOutputDataspace;
+            lhs.fakeOutputDataspace == rhs.fakeOutputDataspace && lhs.type == rhs.type;
 }
 
 struct LinearEffectHasher {
@@ -86,7 +86,8 @@ struct LinearEffectHasher {
         size_t result = std::hash<ui::Dataspace>{}(le.inputDataspace);
         result = HashCombine(result, std::hash<ui::Dataspace>{}(le.outputDataspace));
         result = HashCombine(result, std::hash<bool>{}(le.undoPremultipliedAlpha));
-        return HashCombine(result, std::hash<ui::Dataspace>{}(le.fakeOutputDataspace));
+        result = HashCombine(result, std::hash<ui::Dataspace>{}(le.fakeOutputDataspace));
+        return HashCombine(result, std::hash<int>{}(le.type));
     }
 };
 
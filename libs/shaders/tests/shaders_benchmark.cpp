@@ -0,0 +1,39 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include "shaders/shaders.h"
+
+namespace android {
+namespace {
+
+// Time spent generating the SkSL of a LinearEffect, which RenderEngine pays for every effect it
+// compiles a runtime effect for.
+void BM_buildLinearEffectSkSL(benchmark::State& state) {
+    const auto effect = shaders::LinearEffect{.inputDataspace = ui::Dataspace::BT2020_ITU_PQ,
+                                              .outputDataspace = ui::Dataspace::SRGB,
+                                              .undoPremultipliedAlpha = true,
+                                              .fakeOutputDataspace = ui::Dataspace::V0_SRGB};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(shaders::buildLinearEffectSkSL(effect));
+    }
+}
+BENCHMARK(BM_buildLinearEffectSkSL);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
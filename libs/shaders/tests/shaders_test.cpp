@@ -93,4 +93,16 @@ TEST_F(ShadersTest, buildLinearEffectUniforms_selectsGamutTransformMatrices) {
     EXPECT_THAT(uniforms, Contains(UniformNameEq("in_colorTransform")));
 }
 
+TEST_F(ShadersTest, linearEffect_distinguishesSkSLType) {
+    const auto shader = shaders::LinearEffect{.inputDataspace = ui::Dataspace::BT2020_HLG,
+                                              .outputDataspace = ui::Dataspace::SRGB,
+                                              .type = shaders::LinearEffect::Shader};
+    const auto colorFilter = shaders::LinearEffect{.inputDataspace = ui::Dataspace::BT2020_HLG,
+                                                   .outputDataspace = ui::Dataspace::SRGB,
+                                                   .type = shaders::LinearEffect::ColorFilter};
+    EXPECT_NE(shaders::buildLinearEffectSkSL(shader), shaders::buildLinearEffectSkSL(colorFilter));
+    EXPECT_FALSE(shader == colorFilter);
+    EXPECT_NE(shaders::LinearEffectHasher{}(shader), shaders::LinearEffectHasher{}(colorFilter));
+}
+
 } // namespace android
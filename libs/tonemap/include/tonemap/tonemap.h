@@ -148,6 +148,25 @@ public:
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
             aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
             const std::vector<Color>& colors, const Metadata& metadata) = 0;
+
+    // Batch version of lookupTonemapGain(), for tonemapping whole images on the CPU such as HDR
+    // screenshots and thumbnails. Writes the gains of the count colors to outGains.
+    //
+    // In LookupMode::Exact, the gains are the ones lookupTonemapGain() returns. In
+    // LookupMode::Table, they are interpolated from a table of the tonemapping curve instead, which
+    // is much faster for large inputs. The table is built on first use and kept for as long as the
+    // dataspaces and the metadata don't change. Interpolated gains differ from the exact ones by
+    // at most kTableGainTolerance, relative to the exact gain.
+    enum class LookupMode {
+        Exact,
+        Table,
+    };
+    static constexpr double kTableGainTolerance = 0.005;
+    virtual void lookupTonemapGains(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const Color* colors, size_t count, const Metadata& metadata, LookupMode mode,
+            Gain* outGains) = 0;
 };
 
 // Retrieves a tonemapper instance.
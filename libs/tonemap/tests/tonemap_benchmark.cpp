@@ -0,0 +1,79 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <tonemap/tonemap.h>
+
+using namespace android;
+using aidl::android::hardware::graphics::common::Dataspace;
+
+namespace {
+
+constexpr size_t kFrameWidth = 3840;
+constexpr size_t kFrameHeight = 2160;
+
+// A 4K frame of PQ content, with most pixels below the display's peak and some highlights.
+std::vector<tonemap::Color> makeFrame() {
+    std::mt19937 random(0);
+    std::lognormal_distribution<float> nits(4.f, 1.5f);
+    std::vector<tonemap::Color> frame(kFrameWidth * kFrameHeight);
+    for (auto& color : frame) {
+        const float r = nits(random);
+        const float g = nits(random);
+        const float b = nits(random);
+        color.linearRGB = vec3(r, g, b);
+        color.xyz = vec3(0.64f * r + 0.14f * g + 0.17f * b, 0.26f * r + 0.68f * g + 0.06f * b,
+                         0.05f * g + 1.06f * b);
+    }
+    return frame;
+}
+
+} // namespace
+
+static void BM_lookupTonemapGain(benchmark::State& state) {
+    const auto frame = makeFrame();
+    const tonemap::Metadata metadata{.displayMaxLuminance = 750.f,
+                                     .currentDisplayLuminance = 500.f};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                tonemap::getToneMapper()->lookupTonemapGain(Dataspace::BT2020_ITU_PQ,
+                                                            Dataspace::DISPLAY_P3, frame,
+                                                            metadata));
+    }
+}
+BENCHMARK(BM_lookupTonemapGain)->Unit(benchmark::kMillisecond);
+
+// Arg: the lookup mode, 0 for exact and 1 for table.
+static void BM_lookupTonemapGains(benchmark::State& state) {
+    const auto frame = makeFrame();
+    const tonemap::Metadata metadata{.displayMaxLuminance = 750.f,
+                                     .currentDisplayLuminance = 500.f};
+    const auto mode = state.range(0) == 0 ? tonemap::ToneMapper::LookupMode::Exact
+                                          : tonemap::ToneMapper::LookupMode::Table;
+    std::vector<tonemap::ToneMapper::Gain> gains(frame.size());
+    for (auto _ : state) {
+        tonemap::getToneMapper()->lookupTonemapGains(Dataspace::BT2020_ITU_PQ,
+                                                     Dataspace::DISPLAY_P3, frame.data(),
+                                                     frame.size(), metadata, mode, gains.data());
+        benchmark::DoNotOptimize(gains.data());
+    }
+}
+BENCHMARK(BM_lookupTonemapGains)->ArgName("table")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
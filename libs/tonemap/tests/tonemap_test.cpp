@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 #include <tonemap/tonemap.h>
 #include <cmath>
+#include <vector>
 
 namespace android {
 
@@ -85,4 +86,69 @@ TEST_F(TonemapTest, generateTonemapGainShaderSkSL_containsEntryPointForHLG) {
     EXPECT_THAT(shader, HasSubstr("float libtonemap_LookupTonemapGain(vec3 linearRGB, vec3 xyz)"));
 }
 
+namespace {
+
+using aidl::android::hardware::graphics::common::Dataspace;
+
+// Colors spread over the whole range of luminances, plus black.
+std::vector<tonemap::Color> makeColors() {
+    std::vector<tonemap::Color> colors;
+    colors.push_back({});
+    for (float nits = 1.f / 8192.f; nits < 20000.f; nits *= 1.01f) {
+        const vec3 linearRGB(nits, nits * 0.5f, nits * 0.25f);
+        colors.push_back({.linearRGB = linearRGB, .xyz = vec3(nits * 0.6f, nits, nits * 0.3f)});
+    }
+    return colors;
+}
+
+} // namespace
+
+TEST_F(TonemapTest, lookupTonemapGains_exactMatchesLookupTonemapGain) {
+    const auto colors = makeColors();
+    const tonemap::Metadata metadata{.displayMaxLuminance = 750.f,
+                                     .contentMaxLuminance = 4000.f,
+                                     .currentDisplayLuminance = 500.f};
+    for (const auto source : {Dataspace::BT2020_ITU_PQ, Dataspace::BT2020_ITU_HLG}) {
+        for (const auto destination :
+             {Dataspace::BT2020_ITU_PQ, Dataspace::BT2020_ITU_HLG, Dataspace::DISPLAY_P3}) {
+            const auto expected =
+                    tonemap::getToneMapper()->lookupTonemapGain(source, destination, colors,
+                                                                metadata);
+            std::vector<tonemap::ToneMapper::Gain> gains(colors.size());
+            tonemap::getToneMapper()->lookupTonemapGains(source, destination, colors.data(),
+                                                         colors.size(), metadata,
+                                                         tonemap::ToneMapper::LookupMode::Exact,
+                                                         gains.data());
+            EXPECT_EQ(expected, gains);
+        }
+    }
+}
+
+TEST_F(TonemapTest, lookupTonemapGains_tableIsWithinTolerance) {
+    const auto colors = makeColors();
+    for (const float displayMaxLuminance : {100.f, 500.f, 1000.f, 10000.f}) {
+        const tonemap::Metadata metadata{.displayMaxLuminance = displayMaxLuminance,
+                                         .contentMaxLuminance = 4000.f,
+                                         .currentDisplayLuminance = displayMaxLuminance / 2};
+        for (const auto source : {Dataspace::BT2020_ITU_PQ, Dataspace::BT2020_ITU_HLG}) {
+            for (const auto destination :
+                 {Dataspace::BT2020_ITU_PQ, Dataspace::BT2020_ITU_HLG, Dataspace::DISPLAY_P3}) {
+                const auto expected =
+                        tonemap::getToneMapper()->lookupTonemapGain(source, destination, colors,
+                                                                    metadata);
+                std::vector<tonemap::ToneMapper::Gain> gains(colors.size());
+                tonemap::getToneMapper()->lookupTonemapGains(source, destination, colors.data(),
+                                                             colors.size(), metadata,
+                                                             tonemap::ToneMapper::LookupMode::Table,
+                                                             gains.data());
+                for (size_t i = 0; i < colors.size(); i++) {
+                    EXPECT_NEAR(expected[i], gains[i],
+                                tonemap::ToneMapper::kTableGainTolerance * expected[i])
+                            << "display " << displayMaxLuminance << " color " << i;
+                }
+            }
+        }
+    }
+}
+
 } // namespace android
@@ -18,7 +18,10 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <type_traits>
 
 namespace android::tonemap {
@@ -64,6 +67,133 @@ float computeHlgGamma(float currentDisplayBrightnessNits) {
     return 1.2 + 0.42 * std::log10(currentDisplayBrightnessNits / 1000);
 }
 
+using Gain = ToneMapper::Gain;
+
+// The gains of a tonemapping curve, sampled 128 times per doubling of the luminance from kMinNits
+// up to kMaxNits. The samples are evenly spaced in the bit representation of the luminance as a
+// float, which is linear within each octave, so the samples around a luminance are found with a
+// subtraction and a shift, and the gain is interpolated linearly between them.
+//
+// Steps of the table where interpolating isn't accurate enough, i.e. around the discontinuities of
+// the curve, are marked for the gain to be computed exactly instead.
+class GainTable {
+public:
+    static constexpr float kMinNits = 1.f / 4096.f;
+    static constexpr float kMaxNits = 16384.f;
+
+    template <typename Curve>
+    explicit GainTable(const Curve& curve) : mGains(kNumSteps + 1), mExactSteps(kNumSteps) {
+        for (uint32_t i = 0; i <= kNumSteps; i++) {
+            mGains[i] = static_cast<float>(curve.gain(floatFromBits(kMinBits + (i << kStepShift))));
+        }
+        // Half of the tolerance is left for the rounding of the gains to floats.
+        constexpr double kMaxError = ToneMapper::kTableGainTolerance / 2;
+        for (uint32_t i = 0; i < kNumSteps; i++) {
+            for (uint32_t quarter = 1; quarter < 4; quarter++) {
+                const float nits = floatFromBits(kMinBits + (i << kStepShift) +
+                                                 quarter * ((kStepMask + 1) / 4));
+                const double gain = curve.gain(nits);
+                if (std::abs(lookup(nits) - gain) > kMaxError * std::abs(gain)) {
+                    mExactSteps[i] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Whether the gain at |nits| must be computed with the curve rather than looked up.
+    bool needsExactGain(float nits) const {
+        return !(nits >= kMinNits && nits < kMaxNits) ||
+                mExactSteps[(bitsFromFloat(nits) - kMinBits) >> kStepShift];
+    }
+
+    // Returns the interpolated gain at |nits|. Luminances outside of the table are clamped to it,
+    // so that the lookup is free of branches.
+    float lookup(float nits) const {
+        const uint32_t offset = std::min(bitsFromFloat(nits) - kMinBits, kMaxOffset);
+        const uint32_t step = offset >> kStepShift;
+        const float t = static_cast<float>(offset & kStepMask) * (1.f / (kStepMask + 1));
+        return mGains[step] + (mGains[step + 1] - mGains[step]) * t;
+    }
+
+private:
+    static uint32_t bitsFromFloat(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static float floatFromBits(uint32_t bits) {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static constexpr uint32_t kStepShift = 23 - 7; // 23 mantissa bits, 2^7 steps per octave
+    static constexpr uint32_t kStepMask = (1u << kStepShift) - 1;
+
+    static constexpr uint32_t kMinBits = (127 - 12) << 23; // kMinNits
+    static constexpr uint32_t kMaxBits = (127 + 14) << 23; // kMaxNits
+    static constexpr uint32_t kMaxOffset = kMaxBits - kMinBits - 1;
+    static constexpr uint32_t kNumSteps = (kMaxBits - kMinBits) >> kStepShift;
+
+    std::vector<float> mGains;
+    std::vector<uint8_t> mExactSteps;
+};
+
+// The gain table of the curve that was last looked up in table mode. Screenshots and thumbnails
+// of a display are converted with the same dataspaces and metadata over and over, so there's no
+// need to keep more than one.
+template <typename Curve>
+class GainTableCache {
+public:
+    std::shared_ptr<const GainTable> get(const Curve& curve) {
+        std::lock_guard lock(mMutex);
+        if (!mTable || !(*mCurve == curve)) {
+            mCurve = curve;
+            mTable = std::make_shared<const GainTable>(curve);
+        }
+        return mTable;
+    }
+
+private:
+    std::mutex mMutex;
+    std::optional<Curve> mCurve;
+    std::shared_ptr<const GainTable> mTable;
+};
+
+// Computes the gains of |count| colors with |curve|, or interpolates them from |table| if given.
+// The colors are processed in blocks, with loops simple enough for the compiler to vectorize
+// reading the luminances and the table lookups. Luminances outside of the table, including those
+// that aren't positive, and around discontinuities of the curve are evaluated exactly.
+template <typename Curve>
+void lookupGains(const Curve& curve, const GainTable* table, const Color* colors, size_t count,
+                 Gain* outGains) {
+    constexpr size_t kBlockSize = 64;
+    float nits[kBlockSize];
+    for (size_t begin = 0; begin < count; begin += kBlockSize) {
+        const size_t size = std::min(kBlockSize, count - begin);
+        Gain* gains = outGains + begin;
+        for (size_t i = 0; i < size; i++) {
+            nits[i] = Curve::luminance(colors[begin + i]);
+        }
+        if (!table) {
+            for (size_t i = 0; i < size; i++) {
+                gains[i] = curve.gain(nits[i]);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < size; i++) {
+            gains[i] = table->lookup(nits[i]);
+        }
+        for (size_t i = 0; i < size; i++) {
+            if (table->needsExactGain(nits[i])) {
+                gains[i] = curve.gain(nits[i]);
+            }
+        }
+    }
+}
+
 class ToneMapperO : public ToneMapper {
 public:
     std::string generateTonemapGainShaderSkSL(
@@ -289,58 +419,92 @@ public:
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
             aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
             const std::vector<Color>& colors, const Metadata& metadata) override {
+        const Curve curve(sourceDataspace, destinationDataspace, metadata);
         std::vector<Gain> gains;
         gains.reserve(colors.size());
+        for (const auto& color : colors) {
+            gains.push_back(curve.gain(Curve::luminance(color)));
+        }
+        return gains;
+    }
+
+    void lookupTonemapGains(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const Color* colors, size_t count, const Metadata& metadata, LookupMode mode,
+            Gain* outGains) override {
+        const Curve curve(sourceDataspace, destinationDataspace, metadata);
+        const auto table = mode == LookupMode::Table ? mGainTables.get(curve) : nullptr;
+        lookupGains(curve, table.get(), colors, count, outGains);
+    }
 
-        for (const auto [_, xyz] : colors) {
-            if (xyz.y <= 0.0) {
-                gains.push_back(1.0);
-                continue;
+private:
+    // CPU implementation of the curve of the shader, for a pair of dataspaces and metadata.
+    class Curve {
+    public:
+        Curve(aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+              aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+              const Metadata& metadata)
+              : mSourceDataspaceInt(static_cast<int32_t>(sourceDataspace)),
+                mDestinationDataspaceInt(static_cast<int32_t>(destinationDataspace)),
+                mDisplayMaxLuminance(metadata.displayMaxLuminance),
+                mContentMaxLuminance(metadata.contentMaxLuminance) {}
+
+        bool operator==(const Curve&) const = default;
+
+        // The luminance that the gain is computed for.
+        static float luminance(const Color& color) { return color.xyz.y; }
+
+        Gain gain(double nits) const {
+            if (nits <= 0.0) {
+                return 1.0;
             }
-            const int32_t sourceDataspaceInt = static_cast<int32_t>(sourceDataspace);
-            const int32_t destinationDataspaceInt = static_cast<int32_t>(destinationDataspace);
+            return targetNits(nits) / nits;
+        }
 
+    private:
+        double targetNits(double nits) const {
             double targetNits = 0.0;
-            switch (sourceDataspaceInt & kTransferMask) {
+            switch (mSourceDataspaceInt & kTransferMask) {
                 case kTransferST2084:
                 case kTransferHLG:
-                    switch (destinationDataspaceInt & kTransferMask) {
+                    switch (mDestinationDataspaceInt & kTransferMask) {
                         case kTransferST2084:
-                            targetNits = xyz.y;
+                            targetNits = nits;
                             break;
                         case kTransferHLG:
                             // PQ has a wider luminance range (10,000 nits vs. 1,000 nits) than HLG,
                             // so we'll clamp the luminance range in case we're mapping from PQ
                             // input to HLG output.
-                            targetNits = std::clamp(xyz.y, 0.0f, 1000.0f);
+                            targetNits = std::clamp(nits, 0.0, 1000.0);
                             targetNits *= std::pow(targetNits / 1000.f, -0.2 / 1.2);
                             break;
                         default:
                             // Here we're mapping from HDR to SDR content, so interpolate using a
                             // Hermitian polynomial onto the smaller luminance range.
 
-                            targetNits = xyz.y;
+                            targetNits = nits;
 
-                            if ((sourceDataspaceInt & kTransferMask) == kTransferHLG) {
+                            if ((mSourceDataspaceInt & kTransferMask) == kTransferHLG) {
                                 targetNits *= std::pow(targetNits, 0.2);
                             }
                             // if the max input luminance is less than what we can output then
                             // no tone mapping is needed as all color values will be in range.
-                            if (metadata.contentMaxLuminance > metadata.displayMaxLuminance) {
+                            if (mContentMaxLuminance > mDisplayMaxLuminance) {
                                 // three control points
                                 const double x0 = 10.0;
                                 const double y0 = 17.0;
-                                double x1 = metadata.displayMaxLuminance * 0.75;
+                                double x1 = mDisplayMaxLuminance * 0.75;
                                 double y1 = x1;
-                                double x2 = x1 + (metadata.contentMaxLuminance - x1) / 2.0;
-                                double y2 = y1 + (metadata.displayMaxLuminance - y1) * 0.75;
+                                double x2 = x1 + (mContentMaxLuminance - x1) / 2.0;
+                                double y2 = y1 + (mDisplayMaxLuminance - y1) * 0.75;
 
                                 // horizontal distances between the last three control points
                                 double h12 = x2 - x1;
-                                double h23 = metadata.contentMaxLuminance - x2;
+                                double h23 = mContentMaxLuminance - x2;
                                 // tangents at the last three control points
                                 double m1 = (y2 - y1) / h12;
-                                double m3 = (metadata.displayMaxLuminance - y2) / h23;
+                                double m3 = (mDisplayMaxLuminance - y2) / h23;
                                 double m2 = (m1 + m3) / 2.0;
 
                                 if (targetNits < x0) {
@@ -363,7 +527,7 @@ public:
                                     double t = (targetNits - x2) / h23;
                                     targetNits = (y2 * (1.0 + 2.0 * t) + h23 * m2 * t) * (1.0 - t) *
                                                     (1.0 - t) +
-                                            (metadata.displayMaxLuminance * (3.0 - 2.0 * t) +
+                                            (mDisplayMaxLuminance * (3.0 - 2.0 * t) +
                                              h23 * m3 * (t - 1.0)) *
                                                     t * t;
                                 }
@@ -373,7 +537,7 @@ public:
                     break;
                 default:
                     // source is SDR
-                    switch (destinationDataspaceInt & kTransferMask) {
+                    switch (mDestinationDataspaceInt & kTransferMask) {
                         case kTransferST2084:
                         case kTransferHLG: {
                             // Map from SDR onto an HDR output buffer
@@ -383,18 +547,18 @@ public:
 
                             double x0 = 5.0;
                             double y0 = 2.5;
-                            double x1 = metadata.displayMaxLuminance * 0.7;
+                            double x1 = mDisplayMaxLuminance * 0.7;
                             double y1 = maxOutLumi * 0.15;
-                            double x2 = metadata.displayMaxLuminance * 0.9;
+                            double x2 = mDisplayMaxLuminance * 0.9;
                             double y2 = maxOutLumi * 0.45;
-                            double x3 = metadata.displayMaxLuminance;
+                            double x3 = mDisplayMaxLuminance;
                             double y3 = maxOutLumi;
 
                             double c1 = y1 / 3.0;
                             double c2 = y2 / 2.0;
                             double c3 = y3 / 1.5;
 
-                            targetNits = xyz.y;
+                            targetNits = nits;
 
                             if (targetNits <= x0) {
                                 // scale [0.0, x0] to [0.0, y0] linearly
@@ -417,26 +581,32 @@ public:
                                         t * t * y3;
                             }
 
-                            if ((destinationDataspaceInt & kTransferMask) == kTransferHLG) {
+                            if ((mDestinationDataspaceInt & kTransferMask) == kTransferHLG) {
                                 targetNits *= std::pow(targetNits / 1000.0, -0.2 / 1.2);
                             }
                         } break;
                         default:
                             // For completeness, this is tone-mapping from SDR to SDR, where this is
                             // just a no-op.
-                            targetNits = xyz.y;
+                            targetNits = nits;
                             break;
                     }
             }
-            gains.push_back(targetNits / xyz.y);
+            return targetNits;
         }
-        return gains;
-    }
+
+        int32_t mSourceDataspaceInt;
+        int32_t mDestinationDataspaceInt;
+        float mDisplayMaxLuminance;
+        float mContentMaxLuminance;
+    };
+
+    GainTableCache<Curve> mGainTables;
 };
 
 class ToneMapper13 : public ToneMapper {
 private:
-    double OETF_ST2084(double nits) {
+    static double OETF_ST2084(double nits) {
         nits = nits / 10000.0;
         double m1 = (2610.0 / 4096.0) / 4.0;
         double m2 = (2523.0 / 4096.0) * 128.0;
@@ -449,7 +619,7 @@ private:
         return std::pow(tmp, m2);
     }
 
-    double OETF_HLG(double nits) {
+    static double OETF_HLG(double nits) {
         nits = nits / 1000.0;
         const double a = 0.17883277;
         const double b = 0.28466892;
@@ -630,46 +800,82 @@ public:
             aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
             aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
             const std::vector<Color>& colors, const Metadata& metadata) override {
+        const Curve curve(sourceDataspace, destinationDataspace, metadata);
         std::vector<Gain> gains;
         gains.reserve(colors.size());
+        for (const auto& color : colors) {
+            gains.push_back(curve.gain(Curve::luminance(color)));
+        }
+        return gains;
+    }
 
-        // Precompute constants for HDR->SDR tonemapping parameters
-        constexpr double maxInLumi = 4000;
-        const double maxOutLumi = metadata.displayMaxLuminance;
-
-        const double x1 = maxOutLumi * 0.65;
-        const double y1 = x1;
-
-        const double x3 = maxInLumi;
-        const double y3 = maxOutLumi;
-
-        const double x2 = x1 + (x3 - x1) * 4.0 / 17.0;
-        const double y2 = maxOutLumi * 0.9;
-
-        const double greyNorm1 = OETF_ST2084(x1);
-        const double greyNorm2 = OETF_ST2084(x2);
-        const double greyNorm3 = OETF_ST2084(x3);
+    void lookupTonemapGains(
+            aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+            aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+            const Color* colors, size_t count, const Metadata& metadata, LookupMode mode,
+            Gain* outGains) override {
+        const Curve curve(sourceDataspace, destinationDataspace, metadata);
+        const auto table = mode == LookupMode::Table ? mGainTables.get(curve) : nullptr;
+        lookupGains(curve, table.get(), colors, count, outGains);
+    }
 
-        const double slope2 = (y2 - y1) / (greyNorm2 - greyNorm1);
-        const double slope3 = (y3 - y2) / (greyNorm3 - greyNorm2);
+private:
+    // CPU implementation of the curve of the shader, for a pair of dataspaces and metadata.
+    class Curve {
+    public:
+        Curve(aidl::android::hardware::graphics::common::Dataspace sourceDataspace,
+              aidl::android::hardware::graphics::common::Dataspace destinationDataspace,
+              const Metadata& metadata)
+              : mSourceDataspaceInt(static_cast<int32_t>(sourceDataspace)),
+                mDestinationDataspaceInt(static_cast<int32_t>(destinationDataspace)),
+                mDisplayMaxLuminance(metadata.displayMaxLuminance) {
+            // Precompute constants for HDR->SDR tonemapping parameters
+            const double maxOutLumi = mDisplayMaxLuminance;
+
+            x1 = maxOutLumi * 0.65;
+            y1 = x1;
+
+            x3 = kMaxInLumi;
+            y3 = maxOutLumi;
+
+            x2 = x1 + (x3 - x1) * 4.0 / 17.0;
+            y2 = maxOutLumi * 0.9;
+
+            greyNorm1 = OETF_ST2084(x1);
+            greyNorm2 = OETF_ST2084(x2);
+            greyNorm3 = OETF_ST2084(x3);
+
+            slope2 = (y2 - y1) / (greyNorm2 - greyNorm1);
+            slope3 = (y3 - y2) / (greyNorm3 - greyNorm2);
+
+            hlgGamma = computeHlgGamma(metadata.currentDisplayLuminance);
+        }
 
-        const double hlgGamma = computeHlgGamma(metadata.currentDisplayLuminance);
+        bool operator==(const Curve&) const = default;
 
-        for (const auto [linearRGB, _] : colors) {
-            double maxRGB = std::max({linearRGB.r, linearRGB.g, linearRGB.b});
+        // The luminance that the gain is computed for.
+        static float luminance(const Color& color) {
+            const auto& linearRGB = color.linearRGB;
+            return std::max({linearRGB.r, linearRGB.g, linearRGB.b});
+        }
 
+        Gain gain(double maxRGB) const {
             if (maxRGB <= 0.0) {
-                gains.push_back(1.0);
-                continue;
+                return 1.0;
             }
+            return targetNits(maxRGB) / maxRGB;
+        }
+
+    private:
+        static constexpr double kMaxInLumi = 4000;
 
-            const int32_t sourceDataspaceInt = static_cast<int32_t>(sourceDataspace);
-            const int32_t destinationDataspaceInt = static_cast<int32_t>(destinationDataspace);
+        double targetNits(double maxRGB) const {
+            const double maxOutLumi = mDisplayMaxLuminance;
 
             double targetNits = 0.0;
-            switch (sourceDataspaceInt & kTransferMask) {
+            switch (mSourceDataspaceInt & kTransferMask) {
                 case kTransferST2084:
-                    switch (destinationDataspaceInt & kTransferMask) {
+                    switch (mDestinationDataspaceInt & kTransferMask) {
                         case kTransferST2084:
                             targetNits = maxRGB;
                             break;
@@ -686,7 +892,7 @@ public:
                                 break;
                             }
 
-                            if (targetNits > maxInLumi) {
+                            if (targetNits > kMaxInLumi) {
                                 targetNits = maxOutLumi;
                                 break;
                             }
@@ -704,7 +910,7 @@ public:
                     }
                     break;
                 case kTransferHLG:
-                    switch (destinationDataspaceInt & kTransferMask) {
+                    switch (mDestinationDataspaceInt & kTransferMask) {
                         case kTransferST2084:
                             targetNits = maxRGB * pow(maxRGB / 1000.0, hlgGamma - 1);
                             break;
@@ -713,7 +919,7 @@ public:
                             break;
                         default:
                             targetNits = maxRGB * pow(maxRGB / 1000.0, hlgGamma - 1) *
-                                    metadata.displayMaxLuminance / 1000.0;
+                                    mDisplayMaxLuminance / 1000.0;
                             break;
                     }
                     break;
@@ -721,11 +927,20 @@ public:
                     targetNits = maxRGB;
                     break;
             }
-
-            gains.push_back(targetNits / maxRGB);
+            return targetNits;
         }
-        return gains;
-    }
+
+        int32_t mSourceDataspaceInt;
+        int32_t mDestinationDataspaceInt;
+        float mDisplayMaxLuminance;
+
+        double x1, y1, x2, y2, x3, y3;
+        double greyNorm1, greyNorm2, greyNorm3;
+        double slope2, slope3;
+        double hlgGamma;
+    };
+
+    GainTableCache<Curve> mGainTables;
 };
 
 } // namespace
@@ -16,9 +16,13 @@
 
 #include "BlobCache.h"
 
+#include <android-base/test_utils.h>
 #include <fcntl.h>
 #include <gtest/gtest.h>
 #include <stdio.h>
+#include <sys/stat.h>
+
+#include "FileBlobCache.h"
 
 #include <memory>
 
@@ -493,4 +497,35 @@ TEST_F(BlobCacheFlattenTest, SetAfterFailedUnflatten) {
     mBC2->set("dddddddddd", 10, "dddddddddd", 10);
 }
 
+TEST(FileBlobCacheTest, CompressedFileRoundTrip) {
+    const size_t kMaxKeySize = 16;
+    const size_t kMaxValueSize = 256;
+    const size_t kMaxTotalSize = 4096;
+    TemporaryFile tempFile;
+
+    // A compressible value
+    uint8_t value[kMaxValueSize];
+    for (size_t i = 0; i < kMaxValueSize; i++) {
+        value[i] = i % 8;
+    }
+
+    {
+        FileBlobCache fbc(kMaxKeySize, kMaxValueSize, kMaxTotalSize, &tempFile.path[0]);
+        fbc.setCompressionEnabled(true);
+        fbc.set("abcd", 4, value, kMaxValueSize);
+        fbc.writeToFile();
+    }
+
+    // The file should be smaller than the uncompressed contents
+    struct stat st;
+    ASSERT_EQ(0, stat(&tempFile.path[0], &st));
+    ASSERT_LT(static_cast<size_t>(st.st_size), kMaxValueSize);
+
+    // Loading does not depend on the compression setting
+    FileBlobCache fbc(kMaxKeySize, kMaxValueSize, kMaxTotalSize, &tempFile.path[0]);
+    uint8_t result[kMaxValueSize] = {};
+    ASSERT_EQ(kMaxValueSize, fbc.get("abcd", 4, result, kMaxValueSize));
+    ASSERT_EQ(0, memcmp(value, result, kMaxValueSize));
+}
+
 } // namespace android
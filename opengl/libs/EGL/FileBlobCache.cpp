@@ -26,12 +26,20 @@
 #include <unistd.h>
 
 #include <log/log.h>
+#include <lz4.h>
 #include <utils/Trace.h>
 
+#include <memory>
+
 // Cache file header
 static const char* cacheFileMagic = "EGL$";
 static const size_t cacheFileHeaderSize = 8;
 
+// Compressed cache file header: magic, CRC of the compressed contents and the
+// uncompressed size of the contents
+static const char* compressedCacheFileMagic = "EGLZ";
+static const size_t compressedCacheFileHeaderSize = 12;
+
 namespace android {
 
 uint32_t crc32c(const uint8_t* buf, size_t len) {
@@ -53,7 +61,8 @@ uint32_t crc32c(const uint8_t* buf, size_t len) {
 FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
         const std::string& filename)
         : BlobCache(maxKeySize, maxValueSize, maxTotalSize)
-        , mFilename(filename) {
+        , mFilename(filename)
+        , mCompressionEnabled(false) {
     ATRACE_CALL();
 
     if (mFilename.length() > 0) {
@@ -94,12 +103,21 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
         }
 
         // Check the file magic and CRC
-        size_t cacheSize = fileSize - headerSize;
-        if (memcmp(buf, cacheFileMagic, 4) != 0) {
+        bool compressed = memcmp(buf, compressedCacheFileMagic, 4) == 0;
+        if (compressed) {
+            headerSize = compressedCacheFileHeaderSize;
+        } else if (memcmp(buf, cacheFileMagic, 4) != 0) {
             ALOGE("cache file has bad mojo");
             close(fd);
             return;
         }
+        if (fileSize < headerSize) {
+            ALOGE("cache file is too small: %zu", fileSize);
+            munmap(buf, fileSize);
+            close(fd);
+            return;
+        }
+        size_t cacheSize = fileSize - headerSize;
         uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
         if (crc32c(buf + headerSize, cacheSize) != *crc) {
             ALOGE("cache file failed CRC check");
@@ -107,7 +125,32 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
             return;
         }
 
-        int err = unflatten(buf + headerSize, cacheSize);
+        // Decompress the contents if needed, the CRC covers the compressed form
+        const uint8_t* contents = buf + headerSize;
+        std::unique_ptr<uint8_t[]> decompressed;
+        if (compressed) {
+            uint32_t uncompressedSize = *reinterpret_cast<uint32_t*>(buf + 8);
+            if (uncompressedSize > mMaxTotalSize * 2) {
+                ALOGE("compressed cache file contents are too large: %u", uncompressedSize);
+                munmap(buf, fileSize);
+                close(fd);
+                return;
+            }
+            decompressed.reset(new uint8_t[uncompressedSize]);
+            int result = LZ4_decompress_safe(reinterpret_cast<const char*>(buf + headerSize),
+                                             reinterpret_cast<char*>(decompressed.get()),
+                                             cacheSize, uncompressedSize);
+            if (result < 0 || static_cast<uint32_t>(result) != uncompressedSize) {
+                ALOGE("error decompressing cache file: %d", result);
+                munmap(buf, fileSize);
+                close(fd);
+                return;
+            }
+            contents = decompressed.get();
+            cacheSize = uncompressedSize;
+        }
+
+        int err = unflatten(contents, cacheSize);
         if (err < 0) {
             ALOGE("error reading cache contents: %s (%d)", strerror(-err),
                     -err);
@@ -172,8 +215,33 @@ void FileBlobCache::writeToFile() {
             return;
         }
 
+        // Compress the contents if requested and worthwhile, keeping the
+        // uncompressed size in the header so it can be restored on load
+        bool compressed = false;
+        if (mCompressionEnabled) {
+            size_t compressedHeaderSize = compressedCacheFileHeaderSize;
+            int bound = LZ4_compressBound(cacheSize);
+            uint8_t* compressedBuf = new uint8_t [compressedHeaderSize + bound];
+            int compressedSize = LZ4_compress_default(
+                    reinterpret_cast<const char*>(buf + headerSize),
+                    reinterpret_cast<char*>(compressedBuf + compressedHeaderSize), cacheSize,
+                    bound);
+            if (compressedSize > 0 && static_cast<size_t>(compressedSize) < cacheSize) {
+                uint32_t* uncompressedSize = reinterpret_cast<uint32_t*>(compressedBuf + 8);
+                *uncompressedSize = static_cast<uint32_t>(cacheSize);
+                delete [] buf;
+                buf = compressedBuf;
+                headerSize = compressedHeaderSize;
+                cacheSize = compressedSize;
+                fileSize = headerSize + cacheSize;
+                compressed = true;
+            } else {
+                delete [] compressedBuf;
+            }
+        }
+
         // Write the file magic and CRC
-        memcpy(buf, cacheFileMagic, 4);
+        memcpy(buf, compressed ? compressedCacheFileMagic : cacheFileMagic, 4);
         uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
         *crc = crc32c(buf + headerSize, cacheSize);
 
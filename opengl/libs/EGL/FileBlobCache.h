@@ -38,9 +38,16 @@ public:
     // Return the total size of the cache
     size_t getSize();
 
+    // setCompressionEnabled controls whether writeToFile LZ4 compresses the
+    // cache contents. Files in either format are loaded transparently.
+    void setCompressionEnabled(bool enabled) { mCompressionEnabled = enabled; }
+
 private:
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mCompressionEnabled indicates whether writeToFile compresses the cache.
+    bool mCompressionEnabled;
 };
 
 } // namespace android
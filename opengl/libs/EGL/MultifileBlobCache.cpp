@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <log/log.h>
+#include <lz4.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -35,12 +36,16 @@
 #include <chrono>
 #include <limits>
 #include <locale>
+#include <memory>
+#include <vector>
 
 #include <utils/JenkinsHash.h>
 
 using namespace std::literals;
 
 constexpr uint32_t kMultifileMagic = 'MFB$';
+// Entries with this magic store an LZ4 compressed value, their header valueSize is uncompressed
+constexpr uint32_t kMultifileCompressedMagic = 'MFBZ';
 constexpr uint32_t kCrcPlaceholder = 0;
 
 namespace {
@@ -66,6 +71,8 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                                        size_t maxTotalEntries, const std::string& baseDir)
       : mInitialized(false),
         mCacheVersion(0),
+        mIndexValid(false),
+        mCompressionEnabled(false),
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
         mMaxTotalSize(maxTotalSize),
@@ -133,14 +140,22 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
         }
     }
 
-    if (statusGood) {
+    // Prefer the compact index when present, as it avoids opening and validating every entry up
+    // front. Entries tracked from the index are validated lazily when first loaded by get.
+    bool indexLoaded = statusGood && loadIndex();
+
+    if (indexLoaded) {
+        ALOGV("INIT: Loaded %zu entries from the cache index", mEntries.size());
+    } else if (statusGood) {
         // Read all the files and gather details, then preload their contents
         DIR* dir;
         struct dirent* entry;
         if ((dir = opendir(mMultifileDirName.c_str())) != nullptr) {
             while ((entry = readdir(dir)) != nullptr) {
                 if (entry->d_name == "."s || entry->d_name == ".."s ||
-                    strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0) {
+                    strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0 ||
+                    strncmp(entry->d_name, kMultifileBlobCacheIndexFile,
+                            strlen(kMultifileBlobCacheIndexFile)) == 0) {
                     continue;
                 }
 
@@ -188,7 +203,7 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                 }
 
                 // Verify header magic
-                if (header.magic != kMultifileMagic) {
+                if (header.magic != kMultifileMagic && header.magic != kMultifileCompressedMagic) {
                     ALOGE("INIT: Entry %u has bad magic (%u)! Removing.", entryHash, header.magic);
                     if (remove(fullPath.c_str()) != 0) {
                         ALOGE("INIT: Error removing %s: %s", fullPath.c_str(),
@@ -262,6 +277,14 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
                 }
             }
             closedir(dir);
+
+            // Directory order is arbitrary, so order the entries by their last access time
+            mLRUList.sort([this](uint32_t lhs, uint32_t rhs) {
+                return mEntryStats[lhs].accessTime < mEntryStats[rhs].accessTime;
+            });
+
+            // Write out an index so the next initialization doesn't need to scan the directory
+            queueWriteIndex();
         } else {
             ALOGE("Unable to open filename: %s", mMultifileDirName.c_str());
         }
@@ -308,6 +331,8 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
         return;
     }
 
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+
     // Ensure key and value are under their limits
     if (keySize > mMaxKeySize || valueSize > mMaxValueSize) {
         ALOGW("SET: keySize (%lu vs %zu) or valueSize (%lu vs %zu) too large", keySize, mMaxKeySize,
@@ -318,7 +343,35 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
     // Generate a hash of the key and use it to track this entry
     uint32_t entryHash = android::JenkinsHashMixBytes(0, static_cast<const uint8_t*>(key), keySize);
 
-    size_t fileSize = sizeof(MultifileHeader) + keySize + valueSize;
+    // Compress the value up front so the cache limits account for what is actually stored
+    std::unique_ptr<uint8_t[]> compressedValue;
+    int compressedSize = 0;
+    if (mCompressionEnabled) {
+        int bound = LZ4_compressBound(valueSize);
+        compressedValue.reset(new uint8_t[bound]);
+        compressedSize = LZ4_compress_default(static_cast<const char*>(value),
+                                              reinterpret_cast<char*>(compressedValue.get()),
+                                              valueSize, bound);
+        // Only keep the compressed form if it saves space
+        if (compressedSize >= valueSize) {
+            compressedSize = 0;
+        }
+    }
+    bool compressed = compressedSize > 0;
+    const void* storedValue = compressed ? compressedValue.get() : value;
+    size_t storedValueSize = compressed ? compressedSize : valueSize;
+
+    size_t fileSize = sizeof(MultifileHeader) + keySize + storedValueSize;
+
+    // The index no longer describes the contents of the cache once we start modifying it
+    queueRemoveIndex();
+
+    // If we are replacing an entry, drop the old one so it isn't accounted for twice
+    if (contains(entryHash)) {
+        ALOGV("SET: Replacing existing entry %u", entryHash);
+        removeFromHotCache(entryHash);
+        removeEntry(entryHash);
+    }
 
     // If we're going to be over the cache limit, kick off a trim to clear space
     if (getTotalSize() + fileSize > mMaxTotalSize || getTotalEntries() + 1 > mMaxTotalEntries) {
@@ -331,14 +384,15 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
     uint8_t* buffer = new uint8_t[fileSize];
 
     // Write placeholders for magic and CRC until deferred thread completes the write
-    android::MultifileHeader header = {kMultifileMagic, kCrcPlaceholder, keySize, valueSize};
+    android::MultifileHeader header = {compressed ? kMultifileCompressedMagic : kMultifileMagic,
+                                       kCrcPlaceholder, keySize, valueSize};
     memcpy(static_cast<void*>(buffer), static_cast<const void*>(&header),
            sizeof(android::MultifileHeader));
     // Write the key and value after the header
     memcpy(static_cast<void*>(buffer + sizeof(MultifileHeader)), static_cast<const void*>(key),
            keySize);
-    memcpy(static_cast<void*>(buffer + sizeof(MultifileHeader) + keySize),
-           static_cast<const void*>(value), valueSize);
+    memcpy(static_cast<void*>(buffer + sizeof(MultifileHeader) + keySize), storedValue,
+           storedValueSize);
 
     std::string fullPath = mMultifileDirName + "/" + std::to_string(entryHash);
 
@@ -380,6 +434,8 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
         return 0;
     }
 
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+
     // Ensure key and value are under their limits
     if (keySize > mMaxKeySize || valueSize > mMaxValueSize) {
         ALOGW("GET: keySize (%lu vs %zu) or valueSize (%lu vs %zu) too large", keySize, mMaxKeySize,
@@ -449,6 +505,7 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
         if (fd == -1) {
             ALOGE("Cache error - failed to open fullPath: %s, error: %s", fullPath.c_str(),
                   std::strerror(errno));
+            removeEntry(entryHash);
             return 0;
         }
 
@@ -464,6 +521,22 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
             return 0;
         }
 
+        // Entries tracked from the index have not been validated yet, so check the CRC now
+        MultifileHeader* loadedHeader = reinterpret_cast<MultifileHeader*>(cacheEntry);
+        if ((loadedHeader->magic != kMultifileMagic &&
+             loadedHeader->magic != kMultifileCompressedMagic) ||
+            loadedHeader->crc !=
+                    crc32c(cacheEntry + sizeof(MultifileHeader),
+                           fileSize - sizeof(MultifileHeader))) {
+            ALOGW("GET: Entry %u failed magic or CRC check! Removing.", entryHash);
+            munmap(cacheEntry, fileSize);
+            removeEntry(entryHash);
+            if (remove(fullPath.c_str()) != 0) {
+                ALOGE("GET: Error removing %s: %s", fullPath.c_str(), std::strerror(errno));
+            }
+            return 0;
+        }
+
         ALOGV("GET: Adding %u to hot cache", entryHash);
         if (!addToHotCache(entryHash, fd, cacheEntry, fileSize)) {
             ALOGE("GET: Failed to add %u to hot cache", entryHash);
@@ -494,7 +567,22 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
 
     // Remaining entry following the key is the value
     uint8_t* cachedValue = cacheEntry + (keySize + sizeof(MultifileHeader));
-    memcpy(value, cachedValue, cachedValueSize);
+    if (header->magic == kMultifileCompressedMagic) {
+        int storedValueSize = static_cast<int>(fileSize - sizeof(MultifileHeader) - keySize);
+        int result = LZ4_decompress_safe(reinterpret_cast<const char*>(cachedValue),
+                                         static_cast<char*>(value), storedValueSize,
+                                         cachedValueSize);
+        if (result != static_cast<int>(cachedValueSize)) {
+            ALOGW("GET: Failed to decompress entry %u (%d)", entryHash, result);
+            removeFromHotCache(entryHash);
+            return 0;
+        }
+    } else {
+        memcpy(value, cachedValue, cachedValueSize);
+    }
+
+    // Mark it as the most recently used entry
+    touchEntry(entryHash);
 
     return cachedValueSize;
 }
@@ -504,6 +592,11 @@ void MultifileBlobCache::finish() {
         return;
     }
 
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+
+    // Snapshot our tracking so the next initialization can skip scanning the directory
+    queueWriteIndex();
+
     // Wait for all deferred writes to complete
     ALOGV("FINISH: Waiting for work to complete.");
     waitForWorkComplete();
@@ -626,12 +719,164 @@ bool MultifileBlobCache::checkStatus(const std::string& baseDir) {
     return true;
 }
 
+bool MultifileBlobCache::loadIndex() {
+    std::string indexPath = mMultifileDirName + "/" + kMultifileBlobCacheIndexFile;
+
+    int fd = open(indexPath.c_str(), O_RDONLY);
+    if (fd == -1) {
+        ALOGV("INDEX(LOAD): No index file (%s), falling back to scanning entries",
+              indexPath.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(MultifileIndexHeader))) {
+        ALOGE("INDEX(LOAD): Index file (%s) has invalid stats!", indexPath.c_str());
+        close(fd);
+        return false;
+    }
+
+    // Note: Converting from off_t (signed) to size_t (unsigned)
+    size_t indexSize = static_cast<size_t>(st.st_size);
+    std::vector<uint8_t> buffer(indexSize);
+    ssize_t result = read(fd, buffer.data(), indexSize);
+    close(fd);
+    if (result != static_cast<ssize_t>(indexSize)) {
+        ALOGE("INDEX(LOAD): Error reading index (%s): %s", indexPath.c_str(),
+              std::strerror(errno));
+        return false;
+    }
+
+    MultifileIndexHeader* header = reinterpret_cast<MultifileIndexHeader*>(buffer.data());
+    if (header->magic != kMultifileMagic || header->cacheVersion != mCacheVersion) {
+        ALOGE("INDEX(LOAD): Index has bad magic (%u) or cacheVersion (%u)", header->magic,
+              header->cacheVersion);
+        return false;
+    }
+
+    // Checked by division first so that a corrupt entryCount can't overflow the size computation
+    if (header->entryCount >
+                (indexSize - sizeof(MultifileIndexHeader)) / sizeof(MultifileIndexEntry) ||
+        indexSize !=
+                sizeof(MultifileIndexHeader) + header->entryCount * sizeof(MultifileIndexEntry)) {
+        ALOGE("INDEX(LOAD): Index size (%zu) does not match entry count (%u)", indexSize,
+              header->entryCount);
+        return false;
+    }
+
+    if (header->crc !=
+        crc32c(buffer.data() + offsetof(MultifileIndexHeader, cacheVersion),
+               indexSize - offsetof(MultifileIndexHeader, cacheVersion))) {
+        ALOGE("INDEX(LOAD): Index failed CRC check!");
+        return false;
+    }
+
+    // Entries are stored from least to most recently used, so tracking them in order restores
+    // the LRU list as it was when the index was written
+    const MultifileIndexEntry* indexEntries = reinterpret_cast<const MultifileIndexEntry*>(
+            buffer.data() + sizeof(MultifileIndexHeader));
+    for (uint32_t i = 0; i < header->entryCount; i++) {
+        const MultifileIndexEntry& indexEntry = indexEntries[i];
+        if (indexEntry.valueSize == 0 || indexEntry.valueSize > mMaxValueSize ||
+            indexEntry.fileSize <= sizeof(MultifileHeader)) {
+            ALOGE("INDEX(LOAD): Entry %u has invalid sizes, discarding the index",
+                  indexEntry.entryHash);
+            mLRUList.clear();
+            mEntries.clear();
+            mEntryStats.clear();
+            mTotalCacheSize = 0;
+            mTotalCacheEntries = 0;
+            return false;
+        }
+        if (contains(indexEntry.entryHash)) {
+            ALOGE("INDEX(LOAD): Entry %u is listed more than once, skipping", indexEntry.entryHash);
+            continue;
+        }
+
+        trackEntry(indexEntry.entryHash, indexEntry.valueSize, indexEntry.fileSize,
+                   indexEntry.accessTime);
+        increaseTotalCacheSize(indexEntry.fileSize);
+    }
+
+    mIndexValid = true;
+    return true;
+}
+
+void MultifileBlobCache::queueWriteIndex() {
+    size_t indexSize =
+            sizeof(MultifileIndexHeader) + mLRUList.size() * sizeof(MultifileIndexEntry);
+    uint8_t* buffer = new uint8_t[indexSize];
+
+    MultifileIndexHeader* header = reinterpret_cast<MultifileIndexHeader*>(buffer);
+    header->magic = kMultifileMagic;
+    header->cacheVersion = mCacheVersion;
+    header->entryCount = static_cast<uint32_t>(mLRUList.size());
+
+    MultifileIndexEntry* indexEntry =
+            reinterpret_cast<MultifileIndexEntry*>(buffer + sizeof(MultifileIndexHeader));
+    for (uint32_t entryHash : mLRUList) {
+        const MultifileEntryStats& entryStats = mEntryStats[entryHash];
+        *indexEntry++ = {entryHash, static_cast<uint32_t>(entryStats.valueSize),
+                         entryStats.fileSize, entryStats.accessTime};
+    }
+
+    header->crc = crc32c(buffer + offsetof(MultifileIndexHeader, cacheVersion),
+                         indexSize - offsetof(MultifileIndexHeader, cacheVersion));
+
+    // The worker processes tasks in order, so the index lands after all pending entry writes
+    ALOGV("INDEX(WRITE): Queueing index with %zu entries", mLRUList.size());
+    DeferredTask task(TaskCommand::WriteIndex);
+    task.initWriteIndex(mMultifileDirName + "/" + kMultifileBlobCacheIndexFile, buffer, indexSize);
+    queueTask(std::move(task));
+    mIndexValid = true;
+}
+
+void MultifileBlobCache::queueRemoveIndex() {
+    if (!mIndexValid) {
+        return;
+    }
+
+    // Removing the index ahead of any entry writes ensures we never trust a stale index, even if
+    // the process dies before the next one is written
+    ALOGV("INDEX(REMOVE): Queueing index removal");
+    DeferredTask task(TaskCommand::RemoveIndex);
+    task.initRemoveIndex(mMultifileDirName + "/" + kMultifileBlobCacheIndexFile);
+    queueTask(std::move(task));
+    mIndexValid = false;
+}
+
 void MultifileBlobCache::trackEntry(uint32_t entryHash, EGLsizeiANDROID valueSize, size_t fileSize,
                                     time_t accessTime) {
-    mEntries.insert(entryHash);
+    auto entryIter = mEntries.find(entryHash);
+    if (entryIter != mEntries.end()) {
+        mLRUList.splice(mLRUList.end(), mLRUList, entryIter->second);
+    } else {
+        mEntries[entryHash] = mLRUList.insert(mLRUList.end(), entryHash);
+    }
     mEntryStats[entryHash] = {valueSize, fileSize, accessTime};
 }
 
+void MultifileBlobCache::touchEntry(uint32_t entryHash) {
+    auto entryIter = mEntries.find(entryHash);
+    if (entryIter != mEntries.end()) {
+        mLRUList.splice(mLRUList.end(), mLRUList, entryIter->second);
+        mEntryStats[entryHash].accessTime = time(0);
+    }
+}
+
+bool MultifileBlobCache::removeEntry(uint32_t entryHash) {
+    auto entryIter = mEntries.find(entryHash);
+    if (entryIter == mEntries.end()) {
+        return false;
+    }
+
+    decreaseTotalCacheSize(mEntryStats[entryHash].fileSize);
+    mLRUList.erase(entryIter->second);
+    mEntries.erase(entryIter);
+    mEntryStats.erase(entryHash);
+    return true;
+}
+
 bool MultifileBlobCache::contains(uint32_t hashEntry) const {
     return mEntries.find(hashEntry) != mEntries.end();
 }
@@ -717,19 +962,21 @@ bool MultifileBlobCache::removeFromHotCache(uint32_t entryHash) {
 }
 
 bool MultifileBlobCache::applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit) {
-    // Walk through our map of sorted last access times and remove files until under the limit
-    for (auto cacheEntryIter = mEntryStats.begin(); cacheEntryIter != mEntryStats.end();) {
-        uint32_t entryHash = cacheEntryIter->first;
+    // Walk through our list from least to most recently used and remove files until under the limit
+    while (!mLRUList.empty()) {
+        uint32_t entryHash = mLRUList.front();
 
         ALOGV("LRU: Removing entryHash %u", entryHash);
 
-        // Track the overall size
-        MultifileEntryStats entryStats = getEntryStats(entryHash);
-        decreaseTotalCacheSize(entryStats.fileSize);
-
         // Remove it from hot cache if present
         removeFromHotCache(entryHash);
 
+        // Delete the entry from our tracking, which also updates the overall size
+        if (!removeEntry(entryHash)) {
+            ALOGE("LRU: Failed to remove entryHash (%u) from tracking", entryHash);
+            return false;
+        }
+
         // Remove it from the system
         std::string entryPath = mMultifileDirName + "/" + std::to_string(entryHash);
         if (remove(entryPath.c_str()) != 0) {
@@ -737,16 +984,6 @@ bool MultifileBlobCache::applyLRU(size_t cacheSizeLimit, size_t cacheEntryLimit)
             return false;
         }
 
-        // Increment the iterator before clearing the entry
-        cacheEntryIter++;
-
-        // Delete the entry from our tracking
-        size_t count = mEntryStats.erase(entryHash);
-        if (count != 1) {
-            ALOGE("LRU: Failed to remove entryHash (%u) from mEntryStats", entryHash);
-            return false;
-        }
-
         // See if it has been reduced enough
         size_t totalCacheSize = getTotalSize();
         size_t totalCacheEntries = getTotalEntries();
@@ -872,6 +1109,49 @@ void MultifileBlobCache::processTask(DeferredTask& task) {
 
             return;
         }
+        case TaskCommand::WriteIndex: {
+            std::string& fullPath = task.getFullPath();
+            uint8_t* buffer = task.getBuffer();
+            size_t bufferSize = task.getBufferSize();
+
+            // Write to a temporary file and rename it so a partial index is never observed
+            std::string tempPath = fullPath + ".tmp";
+            int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+            if (fd == -1) {
+                ALOGE("DEFERRED: Failed to open index %s, error: %s", tempPath.c_str(),
+                      std::strerror(errno));
+                delete[] buffer;
+                return;
+            }
+
+            ssize_t result = write(fd, buffer, bufferSize);
+            close(fd);
+            delete[] buffer;
+            if (result != bufferSize) {
+                ALOGE("DEFERRED: Error writing index (%s): %s", tempPath.c_str(),
+                      std::strerror(errno));
+                remove(tempPath.c_str());
+                return;
+            }
+
+            if (rename(tempPath.c_str(), fullPath.c_str()) != 0) {
+                ALOGE("DEFERRED: Error renaming %s to %s: %s", tempPath.c_str(), fullPath.c_str(),
+                      std::strerror(errno));
+                remove(tempPath.c_str());
+                return;
+            }
+
+            ALOGV("DEFERRED: Completed index write for: %s", fullPath.c_str());
+            return;
+        }
+        case TaskCommand::RemoveIndex: {
+            std::string& fullPath = task.getFullPath();
+            if (remove(fullPath.c_str()) != 0 && errno != ENOENT) {
+                ALOGE("DEFERRED: Error removing index %s: %s", fullPath.c_str(),
+                      std::strerror(errno));
+            }
+            return;
+        }
         default: {
             ALOGE("DEFERRED: Unhandled task type");
             return;
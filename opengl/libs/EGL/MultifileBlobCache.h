@@ -23,12 +23,12 @@
 #include <android-base/thread_annotations.h>
 #include <cutils/properties.h>
 #include <future>
+#include <list>
 #include <map>
 #include <queue>
 #include <string>
 #include <thread>
 #include <unordered_map>
-#include <unordered_set>
 
 #include "FileBlobCache.h"
 
@@ -36,6 +36,7 @@ namespace android {
 
 constexpr uint32_t kMultifileBlobCacheVersion = 1;
 constexpr char kMultifileBlobCacheStatusFile[] = "cache.status";
+constexpr char kMultifileBlobCacheIndexFile[] = "cache.index";
 
 struct MultifileHeader {
     uint32_t magic;
@@ -57,6 +58,22 @@ struct MultifileStatus {
     char buildId[PROP_VALUE_MAX];
 };
 
+// The index file starts with this header, followed by entryCount MultifileIndexEntry records
+// ordered from least to most recently used.
+struct MultifileIndexHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t cacheVersion;
+    uint32_t entryCount;
+};
+
+struct MultifileIndexEntry {
+    uint32_t entryHash;
+    uint32_t valueSize;
+    uint64_t fileSize;
+    int64_t accessTime;
+};
+
 struct MultifileHotCache {
     int entryFd;
     uint8_t* entryBuffer;
@@ -66,6 +83,8 @@ struct MultifileHotCache {
 enum class TaskCommand {
     Invalid = 0,
     WriteToDisk,
+    WriteIndex,
+    RemoveIndex,
     Exit,
 };
 
@@ -85,6 +104,18 @@ public:
         mBufferSize = bufferSize;
     }
 
+    void initWriteIndex(std::string fullPath, uint8_t* buffer, size_t bufferSize) {
+        mCommand = TaskCommand::WriteIndex;
+        mFullPath = std::move(fullPath);
+        mBuffer = buffer;
+        mBufferSize = bufferSize;
+    }
+
+    void initRemoveIndex(std::string fullPath) {
+        mCommand = TaskCommand::RemoveIndex;
+        mFullPath = std::move(fullPath);
+    }
+
     uint32_t getEntryHash() { return mEntryHash; }
     std::string& getFullPath() { return mFullPath; }
     uint8_t* getBuffer() { return mBuffer; }
@@ -93,7 +124,7 @@ public:
 private:
     TaskCommand mCommand;
 
-    // Parameters for WriteToDisk
+    // Parameters for WriteToDisk and WriteIndex (which does not use mEntryHash)
     uint32_t mEntryHash;
     std::string mFullPath;
     uint8_t* mBuffer;
@@ -122,13 +153,22 @@ public:
     uint32_t getCurrentCacheVersion() const { return mCacheVersion; }
     void setCurrentCacheVersion(uint32_t cacheVersion) { mCacheVersion = cacheVersion; }
 
+    // When enabled, values are LZ4 compressed before being stored. Entries in either format are
+    // decompressed transparently by get.
+    void setCompressionEnabled(bool enabled) { mCompressionEnabled = enabled; }
+
 private:
     void trackEntry(uint32_t entryHash, EGLsizeiANDROID valueSize, size_t fileSize,
                     time_t accessTime);
+    void touchEntry(uint32_t entryHash);
     bool contains(uint32_t entryHash) const;
     bool removeEntry(uint32_t entryHash);
     MultifileEntryStats getEntryStats(uint32_t entryHash);
 
+    bool loadIndex();
+    void queueWriteIndex();
+    void queueRemoveIndex();
+
     bool createStatus(const std::string& baseDir);
     bool checkStatus(const std::string& baseDir);
 
@@ -151,10 +191,22 @@ private:
     std::string mBuildId;
     uint32_t mCacheVersion;
 
-    std::unordered_set<uint32_t> mEntries;
+    // Serializes set, get and finish so the cache can be shared by multiple GL threads. The worker
+    // thread never takes this lock, so it is safe to wait for deferred work while holding it.
+    std::mutex mCacheMutex;
+
+    // Entries are kept in least to most recently used order so LRU eviction is O(1) per entry.
+    // mEntries maps each entry to its position in that list.
+    std::list<uint32_t> mLRUList;
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> mEntries;
     std::unordered_map<uint32_t, MultifileEntryStats> mEntryStats;
     std::unordered_map<uint32_t, MultifileHotCache> mHotCache;
 
+    // Whether the on-disk index currently matches the entries on disk
+    bool mIndexValid;
+
+    bool mCompressionEnabled;
+
     size_t mMaxKeySize;
     size_t mMaxValueSize;
     size_t mMaxTotalSize;
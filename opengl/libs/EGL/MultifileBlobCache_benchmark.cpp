@@ -0,0 +1,128 @@
+/*
+ ** Copyright 2024, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "MultifileBlobCache.h"
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage: atest libEGL_benchmark
+
+namespace android {
+
+constexpr size_t kMaxKeySize = 2 * 1024;
+constexpr size_t kMaxValueSize = 6 * 1024;
+constexpr size_t kMaxTotalSize = 32 * 1024;
+constexpr size_t kMaxTotalEntries = 64;
+
+static std::unique_ptr<MultifileBlobCache> openCache(const TemporaryFile& tempFile) {
+    return std::make_unique<MultifileBlobCache>(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                                kMaxTotalEntries, tempFile.path);
+}
+
+// Threads getting and setting their own keys in a shared cache. The key space is larger than the
+// cache, so that trimming happens while other threads are reading. Arg: the number of threads.
+static void BM_MultithreadedGetSet(benchmark::State& state) {
+    constexpr int kIterations = 2000;
+    const int threadCount = static_cast<int>(state.range(0));
+
+    TemporaryFile tempFile;
+    std::unique_ptr<MultifileBlobCache> cache = openCache(tempFile);
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&cache, t]() {
+                for (int i = 0; i < kIterations; i++) {
+                    int key = t * kMaxTotalEntries + (i % kMaxTotalEntries);
+                    int result = -1;
+                    if (cache->get(&key, sizeof(key), &result, sizeof(result)) == 0) {
+                        cache->set(&key, sizeof(key), &key, sizeof(key));
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * threadCount * kIterations);
+}
+BENCHMARK(BM_MultithreadedGetSet)->Arg(1)->Arg(8)->UseRealTime();
+
+// Build a value resembling a compiled shader: mostly repeated instruction sequences with a few
+// entry specific constants sprinkled throughout.
+static std::vector<uint8_t> generateShaderBinary(int index, size_t size) {
+    static const char* kSnippets[] = {
+            "OpLoad %float %v_texcoord ", "OpFMul %vec4 %color %tint ",
+            "OpImageSampleImplicitLod %vec4 %sampler %uv ", "OpStore %frag_color %result ",
+            "OpAccessChain %_ptr_Uniform_mat4 %ubo %int_0 ", "OpMatrixTimesVector %vec4 %mvp %pos ",
+    };
+    std::vector<uint8_t> binary;
+    binary.reserve(size);
+    int instruction = 0;
+    while (binary.size() < size) {
+        std::string text = kSnippets[(index + instruction) % 6];
+        if (instruction % 8 == 0) {
+            text += std::to_string(index * 7919 + instruction) + " ";
+        }
+        binary.insert(binary.end(), text.begin(), text.end());
+        instruction++;
+    }
+    binary.resize(size);
+    return binary;
+}
+
+// Opening a cache filled with shaders and looking up every entry, as an app does on its first
+// frames. Arg: 1 to store the entries compressed. Also reports how many shaders fit in the cache.
+static void BM_ColdLoad(benchmark::State& state) {
+    constexpr int kCorpusSize = 256;
+    constexpr size_t kShaderSize = kMaxValueSize / 2;
+
+    TemporaryFile tempFile;
+    std::unique_ptr<MultifileBlobCache> cache = openCache(tempFile);
+    cache->setCompressionEnabled(state.range(0) != 0);
+    for (int i = 0; i < kCorpusSize; i++) {
+        std::vector<uint8_t> shader = generateShaderBinary(i, kShaderSize);
+        cache->set(&i, sizeof(i), shader.data(), shader.size());
+    }
+    const size_t entries = cache->getTotalEntries();
+
+    // Close the cache so everything writes out
+    cache->finish();
+    cache.reset();
+
+    std::vector<uint8_t> result(kShaderSize);
+    for (auto _ : state) {
+        cache = openCache(tempFile);
+        for (int i = 0; i < kCorpusSize; i++) {
+            benchmark::DoNotOptimize(cache->get(&i, sizeof(i), result.data(), result.size()));
+        }
+        state.PauseTiming();
+        cache.reset();
+        state.ResumeTiming();
+    }
+    state.counters["entries"] = entries;
+}
+BENCHMARK(BM_ColdLoad)->ArgName("compressed")->Arg(0)->Arg(1);
+
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -23,7 +23,11 @@
 #include <stdio.h>
 
 #include <fstream>
+#include <functional>
 #include <memory>
+#include <thread>
+
+#include "FileBlobCache.h"
 
 using namespace std::literals;
 
@@ -256,6 +260,311 @@ TEST_F(MultifileBlobCacheTest, CacheMinKeyAndValueSizeSucceeds) {
     ASSERT_EQ('y', buf[0]);
 }
 
+TEST_F(MultifileBlobCacheTest, LRUEvictsLeastRecentlyUsedEntries) {
+    // Fill the cache with max entries
+    for (int i = 0; i < kMaxTotalEntries; i++) {
+        mMBC->set(&i, sizeof(i), &i, sizeof(i));
+    }
+
+    // Touch the oldest entry so it becomes the most recently used
+    int key = 0;
+    int result = 0;
+    ASSERT_EQ(sizeof(key), mMBC->get(&key, sizeof(key), &result, sizeof(result)));
+
+    // Add another entry, which trims the cache
+    key = kMaxTotalEntries;
+    mMBC->set(&key, sizeof(key), &key, sizeof(key));
+    ASSERT_EQ(mMBC->getTotalEntries(), kMaxTotalEntries / 2 + 1);
+
+    // The entry we touched should have survived, while the next oldest ones were evicted
+    key = 0;
+    ASSERT_EQ(sizeof(key), mMBC->get(&key, sizeof(key), &result, sizeof(result)));
+    ASSERT_EQ(0, result);
+    key = 1;
+    ASSERT_EQ(size_t(0), mMBC->get(&key, sizeof(key), &result, sizeof(result)));
+    key = kMaxTotalEntries - 1;
+    ASSERT_EQ(sizeof(key), mMBC->get(&key, sizeof(key), &result, sizeof(result)));
+    ASSERT_EQ(kMaxTotalEntries - 1, result);
+}
+
+TEST_F(MultifileBlobCacheTest, IndexRestoresEntries) {
+    struct stat info;
+    std::stringstream indexFile;
+    indexFile << &mTempFile->path[0] << ".multifile/" << kMultifileBlobCacheIndexFile;
+
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        mMBC->set(&i, sizeof(i), &i, sizeof(i));
+    }
+    size_t totalSize = mMBC->getTotalSize();
+
+    // Close the cache so the index is written out
+    mMBC->finish();
+    mMBC.reset();
+    ASSERT_TRUE(stat(indexFile.str().c_str(), &info) == 0);
+
+    // Open the cache again, which should restore tracking from the index
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(mMBC->getTotalEntries(), kMaxTotalEntries / 2);
+    ASSERT_EQ(mMBC->getTotalSize(), totalSize);
+
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        int result = 0;
+        ASSERT_EQ(sizeof(i), mMBC->get(&i, sizeof(i), &result, sizeof(result)));
+        ASSERT_EQ(i, result);
+    }
+
+    // Modifying the cache invalidates the index until the next finish
+    int key = kMaxTotalEntries;
+    mMBC->set(&key, sizeof(key), &key, sizeof(key));
+    mMBC->finish();
+    mMBC.reset();
+
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(mMBC->getTotalEntries(), kMaxTotalEntries / 2 + 1);
+}
+
+TEST_F(MultifileBlobCacheTest, CorruptIndexFallsBackToScan) {
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        mMBC->set(&i, sizeof(i), &i, sizeof(i));
+    }
+
+    // Close the cache so the index is written out
+    mMBC->finish();
+    mMBC.reset();
+
+    // Stomp on the END of the index, modifying its contents
+    std::stringstream indexFile;
+    indexFile << &mTempFile->path[0] << ".multifile/" << kMultifileBlobCacheIndexFile;
+    const char* stomp = "BADF00D";
+    std::fstream fs(indexFile.str());
+    fs.seekp(-strlen(stomp), std::ios_base::end);
+    fs.write(stomp, strlen(stomp));
+    fs.flush();
+    fs.close();
+
+    // Open the cache again and ensure all entries are still found
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(mMBC->getTotalEntries(), kMaxTotalEntries / 2);
+
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        int result = 0;
+        ASSERT_EQ(sizeof(i), mMBC->get(&i, sizeof(i), &result, sizeof(result)));
+        ASSERT_EQ(i, result);
+    }
+}
+
+// Rewrites the index of the cache at |indexPath| through |edit|, with a matching CRC.
+static void rewriteIndex(const std::string& indexPath,
+                         const std::function<void(std::vector<uint8_t>&)>& edit) {
+    std::ifstream in(indexPath, std::ios::binary);
+    std::vector<uint8_t> index((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+    in.close();
+    ASSERT_GE(index.size(), sizeof(MultifileIndexHeader));
+
+    edit(index);
+    MultifileIndexHeader* header = reinterpret_cast<MultifileIndexHeader*>(index.data());
+    header->crc = crc32c(index.data() + offsetof(MultifileIndexHeader, cacheVersion),
+                         index.size() - offsetof(MultifileIndexHeader, cacheVersion));
+
+    std::ofstream out(indexPath, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(index.data()), index.size());
+}
+
+TEST_F(MultifileBlobCacheTest, IndexWithDuplicateEntriesCountsEachOnce) {
+    std::stringstream indexFile;
+    indexFile << &mTempFile->path[0] << ".multifile/" << kMultifileBlobCacheIndexFile;
+
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        mMBC->set(&i, sizeof(i), &i, sizeof(i));
+    }
+    size_t totalSize = mMBC->getTotalSize();
+
+    // Close the cache so the index is written out
+    mMBC->finish();
+    mMBC.reset();
+
+    // List the last entry a second time
+    rewriteIndex(indexFile.str(), [](std::vector<uint8_t>& index) {
+        index.insert(index.end(), index.end() - sizeof(MultifileIndexEntry), index.end());
+        reinterpret_cast<MultifileIndexHeader*>(index.data())->entryCount++;
+    });
+
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(mMBC->getTotalEntries(), kMaxTotalEntries / 2);
+    ASSERT_EQ(mMBC->getTotalSize(), totalSize);
+}
+
+TEST_F(MultifileBlobCacheTest, IndexWithOversizedEntryCountFallsBackToScan) {
+    std::stringstream indexFile;
+    indexFile << &mTempFile->path[0] << ".multifile/" << kMultifileBlobCacheIndexFile;
+
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        mMBC->set(&i, sizeof(i), &i, sizeof(i));
+    }
+
+    // Close the cache so the index is written out
+    mMBC->finish();
+    mMBC.reset();
+
+    // An entry count whose size wraps around in 32-bit processes
+    rewriteIndex(indexFile.str(), [](std::vector<uint8_t>& index) {
+        reinterpret_cast<MultifileIndexHeader*>(index.data())->entryCount =
+                static_cast<uint32_t>(SIZE_MAX / sizeof(MultifileIndexEntry) + 1);
+    });
+
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    ASSERT_EQ(mMBC->getTotalEntries(), kMaxTotalEntries / 2);
+    for (int i = 0; i < kMaxTotalEntries / 2; i++) {
+        int result = 0;
+        ASSERT_EQ(sizeof(i), mMBC->get(&i, sizeof(i), &result, sizeof(result)));
+        ASSERT_EQ(i, result);
+    }
+}
+
+TEST_F(MultifileBlobCacheTest, MultithreadedGetSetStaysWithinLimits) {
+    constexpr int kThreadCount = 8;
+    constexpr int kIterations = 2000;
+
+    // Each thread works on its own set of keys, with a key space larger than the cache so that
+    // trimming happens while other threads are reading
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreadCount; t++) {
+        threads.emplace_back([this, t]() {
+            for (int i = 0; i < kIterations; i++) {
+                int key = t * kMaxTotalEntries + (i % kMaxTotalEntries);
+                int result = -1;
+                if (mMBC->get(&key, sizeof(key), &result, sizeof(result)) == 0) {
+                    mMBC->set(&key, sizeof(key), &key, sizeof(key));
+                } else {
+                    ASSERT_EQ(key, result);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_LE(mMBC->getTotalEntries(), kMaxTotalEntries);
+    ASSERT_LE(mMBC->getTotalSize(), kMaxTotalSize);
+}
+
+TEST_F(MultifileBlobCacheTest, CompressedEntriesRoundTrip) {
+    mMBC->setCompressionEnabled(true);
+
+    // A highly compressible value
+    std::vector<uint8_t> value(kMaxValueSize);
+    for (size_t i = 0; i < value.size(); i++) {
+        value[i] = i % 16;
+    }
+
+    mMBC->set("abcd", 4, value.data(), value.size());
+    ASSERT_LT(mMBC->getTotalSize(), value.size());
+
+    std::vector<uint8_t> result(kMaxValueSize);
+    ASSERT_EQ(value.size(), mMBC->get("abcd", 4, result.data(), result.size()));
+    ASSERT_EQ(value, result);
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    mMBC.reset();
+
+    // Entries are read back regardless of whether compression is enabled
+    mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                                      &mTempFile->path[0]));
+    result.assign(kMaxValueSize, 0);
+    ASSERT_EQ(value.size(), mMBC->get("abcd", 4, result.data(), result.size()));
+    ASSERT_EQ(value, result);
+}
+
+TEST_F(MultifileBlobCacheTest, IncompressibleValuesStoredUncompressed) {
+    mMBC->setCompressionEnabled(true);
+
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mMBC->set("abcd", 4, "efgh", 4);
+    ASSERT_EQ(sizeof(MultifileHeader) + 8, mMBC->getTotalSize());
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('h', buf[3]);
+}
+
+// Build a value resembling a compiled shader: mostly repeated instruction sequences with a few
+// entry specific constants sprinkled throughout.
+static std::vector<uint8_t> generateShaderBinary(int index, size_t size) {
+    static const char* kSnippets[] = {
+            "OpLoad %float %v_texcoord ", "OpFMul %vec4 %color %tint ",
+            "OpImageSampleImplicitLod %vec4 %sampler %uv ", "OpStore %frag_color %result ",
+            "OpAccessChain %_ptr_Uniform_mat4 %ubo %int_0 ", "OpMatrixTimesVector %vec4 %mvp %pos ",
+    };
+    std::vector<uint8_t> binary;
+    binary.reserve(size);
+    int instruction = 0;
+    while (binary.size() < size) {
+        std::string text = kSnippets[(index + instruction) % 6];
+        if (instruction % 8 == 0) {
+            text += std::to_string(index * 7919 + instruction) + " ";
+        }
+        binary.insert(binary.end(), text.begin(), text.end());
+        instruction++;
+    }
+    binary.resize(size);
+    return binary;
+}
+
+TEST_F(MultifileBlobCacheTest, CompressionIncreasesCapacity) {
+    constexpr int kCorpusSize = 256;
+    constexpr size_t kShaderSize = kMaxValueSize / 2;
+
+    size_t capacities[2] = {};
+    for (bool compress : {false, true}) {
+        clearProperties();
+        mMBC.reset();
+        mTempFile.reset(new TemporaryFile());
+        mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                          kMaxTotalEntries, &mTempFile->path[0]));
+        mMBC->setCompressionEnabled(compress);
+
+        // Insert shaders until the cache first trims, which gives the effective capacity
+        size_t capacity = 0;
+        int inserted = 0;
+        for (; inserted < kCorpusSize; inserted++) {
+            std::vector<uint8_t> shader = generateShaderBinary(inserted, kShaderSize);
+            mMBC->set(&inserted, sizeof(inserted), shader.data(), shader.size());
+            if (mMBC->getTotalEntries() < capacity) {
+                break;
+            }
+            capacity = mMBC->getTotalEntries();
+        }
+
+        // Close the cache so everything writes out
+        mMBC->finish();
+        mMBC.reset();
+
+        // Every surviving entry reads back intact
+        mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                          kMaxTotalEntries, &mTempFile->path[0]));
+        std::vector<uint8_t> result(kShaderSize);
+        size_t hits = 0;
+        for (int i = 0; i <= inserted && i < kCorpusSize; i++) {
+            if (mMBC->get(&i, sizeof(i), result.data(), result.size()) == kShaderSize) {
+                ASSERT_EQ(generateShaderBinary(i, kShaderSize), result);
+                hits++;
+            }
+        }
+        ASSERT_GT(hits, size_t(0));
+        capacities[compress] = capacity;
+    }
+
+    // Compression should let noticeably more shaders fit within the same limits
+    ASSERT_GT(capacities[true], capacities[false]);
+}
+
 int MultifileBlobCacheTest::getFileDescriptorCount() {
     DIR* directory = opendir("/proc/self/fd");
 
@@ -322,7 +631,8 @@ std::vector<std::string> MultifileBlobCacheTest::getCacheEntries() {
                 if (entry->d_name == "."s || entry->d_name == ".."s) {
                     continue;
                 }
-                if (strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0) {
+                if (strcmp(entry->d_name, kMultifileBlobCacheStatusFile) == 0 ||
+                    strcmp(entry->d_name, kMultifileBlobCacheIndexFile) == 0) {
                     continue;
                 }
                 cacheEntries.push_back(multifileDirName + "/" + entry->d_name);
@@ -69,7 +69,10 @@ static EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize, void* v
 // egl_cache_t definition
 //
 egl_cache_t::egl_cache_t()
-      : mInitialized(false), mMultifileMode(false), mCacheByteLimit(kMaxMonolithicTotalSize) {}
+      : mInitialized(false),
+        mMultifileMode(false),
+        mCacheByteLimit(kMaxMonolithicTotalSize),
+        mCompressionEnabled(false) {}
 
 egl_cache_t::~egl_cache_t() {}
 
@@ -264,12 +267,23 @@ void egl_cache_t::updateMode() {
 
         ALOGV("Using multifile EGL blobcache limit of %zu bytes", mCacheByteLimit);
     }
+
+    // Check whether cache contents should be compressed, allowing a debug override
+    mCompressionEnabled = base::GetBoolProperty("ro.egl.blobcache.compress", false);
+    std::string compress = base::GetProperty("debug.egl.blobcache.compress", "");
+    if (compress == "true") {
+        mCompressionEnabled = true;
+    } else if (compress == "false") {
+        mCompressionEnabled = false;
+    }
+    ALOGV("EGL blobcache compression is %s", mCompressionEnabled ? "enabled" : "disabled");
 }
 
 BlobCache* egl_cache_t::getBlobCacheLocked() {
     if (mBlobCache == nullptr) {
         mBlobCache.reset(new FileBlobCache(kMaxMonolithicKeySize, kMaxMonolithicValueSize,
                                            mCacheByteLimit, mFilename));
+        mBlobCache->setCompressionEnabled(mCompressionEnabled);
     }
     return mBlobCache.get();
 }
@@ -279,6 +293,7 @@ MultifileBlobCache* egl_cache_t::getMultifileBlobCacheLocked() {
         mMultifileBlobCache.reset(new MultifileBlobCache(kMaxMultifileKeySize,
                                                          kMaxMultifileValueSize, mCacheByteLimit,
                                                          kMaxMultifileTotalEntries, mFilename));
+        mMultifileBlobCache->setCompressionEnabled(mCompressionEnabled);
     }
     return mMultifileBlobCache.get();
 }
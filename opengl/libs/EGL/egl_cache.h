@@ -142,6 +142,9 @@ private:
 
     // Cache limit
     size_t mCacheByteLimit;
+
+    // Whether cache contents should be compressed when written
+    bool mCompressionEnabled;
 };
 
 }; // namespace android
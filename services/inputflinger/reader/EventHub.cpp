@@ -51,6 +51,7 @@
 #include <utils/Log.h>
 #include <utils/Timers.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <optional>
 #include <regex>
@@ -1995,6 +1996,9 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                 int32_t readSize =
                         read(device->fd, readBuffer.data(),
                              sizeof(decltype(readBuffer)::value_type) * readBuffer.size());
+                // All the events returned by a single read were read at the same time.
+                const nsecs_t readTime = systemTime(SYSTEM_TIME_MONOTONIC);
+                mReadStats.deviceReads++;
                 if (readSize == 0 || (readSize < 0 && errno == ENODEV)) {
                     // Device was removed before INotify noticed.
                     ALOGW("could not get event, removed? (fd: %d size: %" PRId32
@@ -2012,12 +2016,17 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
                     const int32_t deviceId = device->id == mBuiltInKeyboardId ? 0 : device->id;
 
                     const size_t count = size_t(readSize) / sizeof(struct input_event);
+                    mReadStats.eventsRead += count;
+                    mReadStats.eventsSinceWakeup += count;
+                    if (count == readBuffer.size()) {
+                        mReadStats.fullReads++;
+                    }
                     for (size_t i = 0; i < count; i++) {
                         struct input_event& iev = readBuffer[i];
                         device->trackInputEvent(iev);
                         events.push_back({
                                 .when = processEventTimestamp(iev),
-                                .readTime = systemTime(SYSTEM_TIME_MONOTONIC),
+                                .readTime = readTime,
                                 .deviceId = deviceId,
                                 .type = iev.type,
                                 .code = iev.code,
@@ -2102,6 +2111,10 @@ std::vector<RawEvent> EventHub::getEvents(int timeoutMillis) {
         } else {
             // Some events occurred.
             mPendingEventCount = size_t(pollResult);
+            mReadStats.wakeups++;
+            mReadStats.maxEventsPerWakeup =
+                    std::max(mReadStats.maxEventsPerWakeup, mReadStats.eventsSinceWakeup);
+            mReadStats.eventsSinceWakeup = 0;
         }
     }
 
@@ -2927,6 +2940,20 @@ void EventHub::dump(std::string& dump) const {
         if (mUnattachedVideoDevices.empty()) {
             dump += INDENT2 "<none>\n";
         }
+
+        const ReadStats& stats = mReadStats;
+        const size_t maxEventsPerWakeup =
+                std::max(stats.maxEventsPerWakeup, stats.eventsSinceWakeup);
+        dump += INDENT "Read Stats:\n";
+        dump += StringPrintf(INDENT2 "Wakeups: %" PRIu64 "\n", stats.wakeups);
+        dump += StringPrintf(INDENT2 "DeviceReads: %" PRIu64 " (%" PRIu64 " filled the buffer)\n",
+                             stats.deviceReads, stats.fullReads);
+        dump += StringPrintf(INDENT2 "EventsRead: %" PRIu64 "\n", stats.eventsRead);
+        dump += StringPrintf(INDENT2 "EventsPerWakeup: avg=%.1f, max=%zu\n",
+                             stats.wakeups > 0 ? double(stats.eventsRead) / stats.wakeups : 0.0,
+                             maxEventsPerWakeup);
+        dump += StringPrintf(INDENT2 "ReadsPerWakeup: avg=%.1f\n",
+                             stats.wakeups > 0 ? double(stats.deviceReads) / stats.wakeups : 0.0);
     } // release lock
 }
 
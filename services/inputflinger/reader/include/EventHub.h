@@ -814,6 +814,24 @@ private:
     size_t mPendingEventCount;
     size_t mPendingEventIndex;
     bool mPendingINotify;
+
+    // Statistics about how input events are read, reported in dump(). The reads aren't batched:
+    // getEvents() still does one read() per ready device fd, since readv() only scatters a single
+    // fd and io_uring isn't available to system_server. These numbers show how many reads a
+    // wakeup takes, i.e. whether batching them would be worth pursuing.
+    struct ReadStats {
+        // Number of times epoll_wait() returned ready fds.
+        uint64_t wakeups = 0;
+        // Number of read() calls on device fds, and number of events they returned.
+        uint64_t deviceReads = 0;
+        uint64_t eventsRead = 0;
+        // Number of reads that filled the read buffer, so events were left in the device.
+        uint64_t fullReads = 0;
+        // Events read since the last wakeup, and the most read after a single wakeup.
+        size_t eventsSinceWakeup = 0;
+        size_t maxEventsPerWakeup = 0;
+    };
+    ReadStats mReadStats;
 };
 
 } // namespace android
@@ -218,6 +218,26 @@ TEST_F(EventHubTest, InputEvent_TimestampIsMonotonic) {
     }
 }
 
+/**
+ * Ensure that the events returned by a single read from the device share the same read time, which
+ * is after the time the events occurred, and that the reads are accounted for in the dump.
+ */
+TEST_F(EventHubTest, InputEvent_ReadTimeIsSharedWithinARead) {
+    ASSERT_NO_FATAL_FAILURE(mKeyboard->pressAndReleaseHomeKey());
+
+    std::vector<RawEvent> events = getEvents(4);
+    ASSERT_EQ(4U, events.size()) << "Expected to receive 2 keys and 2 syncs, total of 4 events";
+    for (const RawEvent& event : events) {
+        ASSERT_LE(event.when, event.readTime);
+    }
+    // The key down and its sync are written together, so they're read together.
+    ASSERT_EQ(events[0].readTime, events[1].readTime);
+
+    std::string dump;
+    mEventHub->dump(dump);
+    ASSERT_NE(std::string::npos, dump.find("Read Stats:")) << dump;
+}
+
 // --- BitArrayTest ---
 class BitArrayTest : public testing::Test {
 protected:
@@ -19,6 +19,7 @@
 #include <utils/Log.h>
 
 #include "Fusion.h"
+#include "FusionKernels.h"
 
 namespace android {
 
@@ -187,6 +188,8 @@ Fusion::Fusion() {
     x0 = 0;
     x1 = 0;
 
+    mUseGenericKernels = false;
+
     init();
 }
 
@@ -413,6 +416,14 @@ mat33_t Fusion::getRotationMatrix() const {
     return quatToMatrix(x0);
 }
 
+void Fusion::setUseGenericKernels(bool useGenericKernels) {
+    mUseGenericKernels = useGenericKernels;
+}
+
+mat33_t Fusion::mul(const mat33_t& lhs, const mat33_t& rhs) const {
+    return mUseGenericKernels ? lhs*rhs : fusion::mul(lhs, rhs);
+}
+
 mat34_t Fusion::getF(const vec4_t& q) {
     mat34_t F;
 
@@ -487,7 +498,11 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    if (mUseGenericKernels) {
+        P = Phi*P*transpose(Phi) + GQGt;
+    } else {
+        fusion::predictCovariance(P, Phi[0][0], Phi[1][0], GQGt);
+    }
 
     checkState();
 }
@@ -509,8 +524,8 @@ void Fusion::update(const vec3_t& z, const vec3_t& Bi, float sigma) {
     const mat33_t S(scaleCovariance(L, P[0][0]) + R);
     const mat33_t Si(invert(S));
     const mat33_t LtSi(transpose(L)*Si);
-    K[0] = P[0][0] * LtSi;
-    K[1] = transpose(P[1][0])*LtSi;
+    K[0] = mul(P[0][0], LtSi);
+    K[1] = mul(transpose(P[1][0]), LtSi);
 
     // update...
     // P = (I-K*H) * P
@@ -519,11 +534,11 @@ void Fusion::update(const vec3_t& z, const vec3_t& Bi, float sigma) {
     // | K1 |                 | K1*L  0 |   | P01  P11 |   | K1*L*P00  K1*L*P10 |
     // Note: the Joseph form is numerically more stable and given by:
     //     P = (I-KH) * P * (I-KH)' + K*R*R'
-    const mat33_t K0L(K[0] * L);
-    const mat33_t K1L(K[1] * L);
-    P[0][0] -= K0L*P[0][0];
-    P[1][1] -= K1L*P[1][0];
-    P[1][0] -= K0L*P[1][0];
+    const mat33_t K0L(mul(K[0], L));
+    const mat33_t K1L(mul(K[1], L));
+    P[0][0] -= mul(K0L, P[0][0]);
+    P[1][1] -= mul(K1L, P[1][0]);
+    P[1][0] -= mul(K0L, P[1][0]);
     P[0][1] = transpose(P[1][0]);
 
     const vec3_t e(z - Bb);
@@ -71,6 +71,10 @@ public:
     mat33_t getRotationMatrix() const;
     bool hasEstimate() const;
 
+    // Uses the generic mat.h templates instead of the kernels from FusionKernels.h, e.g. to check
+    // one against the other.
+    void setUseGenericKernels(bool useGenericKernels);
+
 private:
     struct Parameter {
         float gyroVar;
@@ -86,6 +90,7 @@ private:
     vec<vec3_t, 3> mData;
     size_t mCount[3];
     int mMode;
+    bool mUseGenericKernels;
 
     enum { ACC=0x1, MAG=0x2, GYRO=0x4 };
     bool checkInitComplete(int, const vec3_t& w, float d = 0);
@@ -93,6 +98,7 @@ private:
     void checkState();
     void predict(const vec3_t& w, float dT);
     void update(const vec3_t& z, const vec3_t& Bi, float sigma);
+    mat33_t mul(const mat33_t& lhs, const mat33_t& rhs) const;
     static mat34_t getF(const vec4_t& p);
     static vec3_t getOrthogonal(const vec3_t &v);
 };
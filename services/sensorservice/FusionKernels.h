@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FUSION_KERNELS_H
+#define ANDROID_FUSION_KERNELS_H
+
+#include "mat.h"
+#include "vec.h"
+
+// The 3x3 kernels below keep each matrix column in one 4-lane register. They're written with the
+// compiler's generic vector extension, which maps to NEON on ARM and SSE on x86.
+#if defined(__ARM_NEON) || defined(__SSE2__)
+#define FUSION_SIMD_KERNELS 1
+#else
+#define FUSION_SIMD_KERNELS 0
+#endif
+
+namespace android {
+namespace fusion {
+
+// -----------------------------------------------------------------------
+
+#if FUSION_SIMD_KERNELS
+
+typedef float float4 __attribute__((vector_size(16)));
+
+inline float4 load(const vec3_t& v) {
+    float4 r = {v.x, v.y, v.z, 0.0f};
+    return r;
+}
+
+inline void store(vec3_t& v, float4 r) {
+    v.x = r[0];
+    v.y = r[1];
+    v.z = r[2];
+}
+
+// Computes the columns of lhs*rhs (or lhs*transpose(rhs)), accumulating in the same order as the
+// generic helpers::doMul() so the results match up to FMA contraction.
+template <bool TRANSPOSE_RHS>
+inline void mulColumns(const float4 lhs[3], const mat33_t& rhs, float4 out[3]) {
+    for (size_t c = 0; c < 3; c++) {
+        float4 v = lhs[0] * (TRANSPOSE_RHS ? rhs[0][c] : rhs[c][0]);
+        v += lhs[1] * (TRANSPOSE_RHS ? rhs[1][c] : rhs[c][1]);
+        v += lhs[2] * (TRANSPOSE_RHS ? rhs[2][c] : rhs[c][2]);
+        out[c] = v;
+    }
+}
+
+inline void loadColumns(const mat33_t& m, float4 out[3]) {
+    out[0] = load(m[0]);
+    out[1] = load(m[1]);
+    out[2] = load(m[2]);
+}
+
+inline mat33_t storeColumns(const float4 in[3]) {
+    mat33_t m;
+    store(m[0], in[0]);
+    store(m[1], in[1]);
+    store(m[2], in[2]);
+    return m;
+}
+
+#endif // FUSION_SIMD_KERNELS
+
+// lhs * rhs
+inline mat33_t mul(const mat33_t& lhs, const mat33_t& rhs) {
+#if FUSION_SIMD_KERNELS
+    float4 l[3], r[3];
+    loadColumns(lhs, l);
+    mulColumns<false>(l, rhs, r);
+    return storeColumns(r);
+#else
+    return lhs * rhs;
+#endif
+}
+
+/*
+ * EKF covariance prediction, P = Phi*P*transpose(Phi) + GQGt, for a transition matrix of the form
+ *
+ *  Phi = | Phi00 Phi10 |
+ *        |   0     1   |
+ *
+ * Only the 8 3x3 products that don't involve the zero and identity blocks are computed, instead
+ * of the 16 of the generic block product.
+ */
+inline void predictCovariance(mat<mat33_t, 2, 2>& P, const mat33_t& Phi00, const mat33_t& Phi10,
+                              const mat<mat33_t, 2, 2>& GQGt) {
+#if FUSION_SIMD_KERNELS
+    float4 phi00[3], phi10[3], p01[3], p11[3], a[3], b[3];
+    loadColumns(Phi00, phi00);
+    loadColumns(Phi10, phi10);
+    loadColumns(P[0][1], p01);
+    loadColumns(P[1][1], p11);
+
+    // Top row of Phi*P: T0 = Phi00*P00 + Phi10*P01, T1 = Phi00*P10 + Phi10*P11.
+    float4 t0[3], t1[3];
+    mulColumns<false>(phi00, P[0][0], a);
+    mulColumns<false>(phi10, P[0][1], b);
+    for (size_t c = 0; c < 3; c++) t0[c] = a[c] + b[c];
+    mulColumns<false>(phi00, P[1][0], a);
+    mulColumns<false>(phi10, P[1][1], b);
+    for (size_t c = 0; c < 3; c++) t1[c] = a[c] + b[c];
+
+    // P00 = T0*Phi00' + T1*Phi10', P10 = T1, P01 = P01*Phi00' + P11*Phi10', P11 = P11.
+    float4 n00[3], n01[3];
+    mulColumns<true>(t0, Phi00, a);
+    mulColumns<true>(t1, Phi10, b);
+    for (size_t c = 0; c < 3; c++) n00[c] = a[c] + b[c];
+    mulColumns<true>(p01, Phi00, a);
+    mulColumns<true>(p11, Phi10, b);
+    for (size_t c = 0; c < 3; c++) n01[c] = a[c] + b[c];
+
+    P[0][0] = storeColumns(n00) + GQGt[0][0];
+    P[1][0] = storeColumns(t1) + GQGt[1][0];
+    P[0][1] = storeColumns(n01) + GQGt[0][1];
+    P[1][1] += GQGt[1][1];
+#else
+    const mat33_t T0(Phi00*P[0][0] + Phi10*P[0][1]);
+    const mat33_t T1(Phi00*P[1][0] + Phi10*P[1][1]);
+    const mat33_t Phi00t(transpose(Phi00));
+    const mat33_t Phi10t(transpose(Phi10));
+    P[0][0] = T0*Phi00t + T1*Phi10t + GQGt[0][0];
+    P[0][1] = P[0][1]*Phi00t + P[1][1]*Phi10t + GQGt[0][1];
+    P[1][0] = T1 + GQGt[1][0];
+    P[1][1] += GQGt[1][1];
+#endif
+}
+
+// -----------------------------------------------------------------------
+
+}; // namespace fusion
+}; // namespace android
+
+#endif // ANDROID_FUSION_KERNELS_H
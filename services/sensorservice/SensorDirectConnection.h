@@ -27,6 +27,7 @@
 #include <sensor/BitTube.h>
 #include <sensor/ISensorServer.h>
 #include <sensor/ISensorEventConnection.h>
+#include <sensor/SensorEventRing.h>
 
 #include "SensorService.h"
 
@@ -65,6 +66,7 @@ protected:
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
+    virtual sp<SensorEventRing> getSensorEventRing();
     virtual void destroy();
 private:
     bool hasSensorAccess() const;
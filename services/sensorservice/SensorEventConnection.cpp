@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
 #include <log/log.h>
 #include <sys/socket.h>
 #include <utils/threads.h>
@@ -101,6 +102,12 @@ void SensorService::SensorEventConnection::dump(String8& result) {
                                                            "active",
                             flushInfo.mPendingFlushEventsToSend);
     }
+    if (mEventRing != nullptr) {
+        result.appendFormat("\t shared event ring | events written %" PRIu64 " | doorbells %" PRIu64
+                            " | full %" PRIu64 "\n",
+                            mEventRing->getEventsWritten(), mEventRing->getDoorbellsRung(),
+                            mEventRing->getFullCount());
+    }
 #if DEBUG_CONNECTIONS
     result.appendFormat("\t events recvd: %d | sent %d | cache %d | dropped %d |"
             " total_acks_needed %d | total_acks_recvd %d\n",
@@ -241,7 +248,10 @@ void SensorService::SensorEventConnection::updateLooperRegistrationLocked(
     return; }
 
     int looper_flags = 0;
-    if (mCacheSize > 0) looper_flags |= ALOOPER_EVENT_OUTPUT;
+    // With the shared memory ring, the socket is always writable. The client writes a token to it
+    // instead once it has made room in the ring.
+    if (mCacheSize > 0) looper_flags |= mEventRing != nullptr ? ALOOPER_EVENT_INPUT
+                                                              : ALOOPER_EVENT_OUTPUT;
     if (mDataInjectionMode) looper_flags |= ALOOPER_EVENT_INPUT;
     for (auto& it : mSensorInfo) {
         const int handle = it.first;
@@ -403,8 +413,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
     }
 
     // NOTE: ASensorEvent and sensors_event_t are the same type.
-    ssize_t size = SensorEventQueue::write(mChannel,
-                                    reinterpret_cast<ASensorEvent const*>(scratch), count);
+    ssize_t size = writeEventsLocked(reinterpret_cast<ASensorEvent const*>(scratch), count);
     if (size < 0) {
         // Write error, copy events to local cache.
         if (index_wake_up_event >= 0) {
@@ -572,7 +581,7 @@ void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
                ++mWakeLockRefCount;
                flushCompleteEvent.flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
             }
-            ssize_t size = SensorEventQueue::write(mChannel, &flushCompleteEvent, 1);
+            ssize_t size = writeEventsLocked(&flushCompleteEvent, 1);
             if (size < 0) {
                 if (wakeUpSensor) --mWakeLockRefCount;
                 return;
@@ -608,9 +617,9 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
             }
         }
 
-        ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
-                          numEventsToWrite);
+        ssize_t size = writeEventsLocked(
+                reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
+                numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
@@ -680,6 +689,33 @@ sp<BitTube> SensorService::SensorEventConnection::getSensorChannel() const
     return mChannel;
 }
 
+sp<SensorEventRing> SensorService::SensorEventConnection::getSensorEventRing() {
+    Mutex::Autolock _l(mConnectionLock);
+    if (mEventRing != nullptr) {
+        return mEventRing;
+    }
+    // Switching once events may already be queued on the socket would reorder them.
+    if (mDataInjectionMode || !mSensorInfo.empty() || mCacheSize != 0) {
+        return nullptr;
+    }
+    mEventRing = SensorEventRing::create();
+    return mEventRing;
+}
+
+ssize_t SensorService::SensorEventConnection::writeEventsLocked(ASensorEvent const* events,
+                                                                size_t count) {
+    if (mEventRing == nullptr) {
+        return SensorEventQueue::write(mChannel, events, count);
+    }
+    bool wakeConsumer = false;
+    ssize_t size = mEventRing->write(events, count, &wakeConsumer);
+    if (wakeConsumer) {
+        ::send(mChannel->getSendFd(), &SensorEventRing::kWakeToken,
+               sizeof(SensorEventRing::kWakeToken), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+    return size;
+}
+
 status_t SensorService::SensorEventConnection::enableDisable(
         int handle, bool enabled, nsecs_t samplingPeriodNs, nsecs_t maxBatchReportLatencyNs,
         int reservedFlags)
@@ -845,6 +881,11 @@ int SensorService::SensorEventConnection::handleEvent(int fd, int events, void*
     if (events & ALOOPER_EVENT_INPUT) {
         unsigned char buf[sizeof(sensors_event_t)];
         ssize_t numBytesRead = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (numBytesRead == sizeof(SensorEventRing::kWakeToken)) {
+            // The client has made room in the shared memory ring, send the cached events.
+            mService->sendEventsFromCache(this);
+            return 1;
+        }
         {
             Mutex::Autolock _l(mConnectionLock);
             if (numBytesRead == sizeof(sensors_event_t)) {
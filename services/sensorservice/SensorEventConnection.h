@@ -37,6 +37,7 @@
 #include <sensor/BitTube.h>
 #include <sensor/ISensorServer.h>
 #include <sensor/ISensorEventConnection.h>
+#include <sensor/SensorEventRing.h>
 
 #include "SensorService.h"
 
@@ -83,8 +84,13 @@ private:
     virtual status_t setEventRate(int handle, nsecs_t samplingPeriodNs);
     virtual status_t flush();
     virtual int32_t configureChannel(int handle, int rateLevel);
+    virtual sp<SensorEventRing> getSensorEventRing();
     virtual void destroy();
 
+    // Writes events to the shared memory ring if the client opted in to it, or to the socket
+    // otherwise. Like a socket write, either all the events are written or none.
+    ssize_t writeEventsLocked(ASensorEvent const* events, size_t count);
+
     // Count the number of flush complete events which are about to be dropped in the buffer.
     // Increment mPendingFlushEventsToSend in mSensorInfo. These flush complete events will be sent
     // separately before the next batch of events.
@@ -148,6 +154,9 @@ private:
     void uncapRates();
     sp<SensorService> const mService;
     sp<BitTube> mChannel;
+    // Set once the client has switched to the shared memory ring, after which mChannel only
+    // carries doorbells and acks.
+    sp<SensorEventRing> mEventRing;
     uid_t mUid;
     mutable Mutex mConnectionLock;
     // Number of events from wake up sensors which are still pending and haven't been delivered to
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../Fusion.h"
+
+using namespace android;
+
+namespace {
+
+// Gyro rate, and how many gyro samples there are per accelerometer and magnetometer sample.
+constexpr float kGyroRateHz = 200.0f;
+constexpr size_t kGyroSamplesPerAccSample = 4;
+constexpr size_t kSampleCount = 20000;
+
+// Largest difference allowed between the attitude computed with the SIMD kernels and the one
+// computed with the generic templates, which only differ in rounding.
+constexpr float kAttitudeTolerance = 1e-3f;
+
+struct ImuSample {
+    vec3_t gyro;
+    // Only valid every kGyroSamplesPerAccSample samples.
+    vec3_t acc;
+    vec3_t mag;
+};
+
+// Returns noise in [-amplitude, amplitude], from a fixed seed so every run replays the same
+// stream.
+float noise(uint32_t& state, float amplitude) {
+    state = state * 1664525u + 1013904223u;
+    return amplitude * (float(state >> 8) / float(1u << 23) - 1.0f);
+}
+
+vec3_t makeVec3(float x, float y, float z) {
+    vec3_t v;
+    v.x = x;
+    v.y = y;
+    v.z = z;
+    return v;
+}
+
+/*
+ * Builds a stream like the one a phone being turned around in the hand would produce: a slowly
+ * varying angular velocity, and the gravity and Earth magnetic field vectors seen from the device
+ * frame, each with some sensor noise and a constant gyro bias.
+ */
+const std::vector<ImuSample>& getImuStream() {
+    static const std::vector<ImuSample> stream = [] {
+        std::vector<ImuSample> samples(kSampleCount);
+        const float dT = 1.0f / kGyroRateHz;
+        const vec3_t gravity(makeVec3(0.0f, 0.0f, 9.81f));
+        const vec3_t field(makeVec3(0.0f, 22.0f, -42.0f));
+        const vec3_t bias(makeVec3(0.002f, -0.003f, 0.001f));
+        uint32_t seed = 1;
+        // Rotates the device frame to the world frame.
+        mat33_t deviceToWorld(1.0f);
+        for (size_t i = 0; i < kSampleCount; i++) {
+            const float t = i * dT;
+            const vec3_t w(makeVec3(0.8f * sinf(0.7f * t), 0.5f * cosf(0.3f * t),
+                                    0.6f * sinf(0.2f * t + 1.0f)));
+            // Integrate the device attitude, going through a quaternion to keep it orthonormal.
+            quat_t dq;
+            dq.x = 0.5f * dT * w.x;
+            dq.y = 0.5f * dT * w.y;
+            dq.z = 0.5f * dT * w.z;
+            dq.w = 1.0f;
+            dq = normalize_quat(dq);
+            deviceToWorld = quatToMatrix(
+                    normalize_quat(matrixToQuat(deviceToWorld * quatToMatrix(dq))));
+            const mat33_t worldToDevice(transpose(deviceToWorld));
+
+            ImuSample& sample = samples[i];
+            sample.gyro = w + bias;
+            sample.acc = worldToDevice * gravity;
+            sample.mag = worldToDevice * field;
+            for (size_t k = 0; k < 3; k++) {
+                sample.gyro[k] += noise(seed, 0.01f);
+                sample.acc[k] += noise(seed, 0.05f);
+                sample.mag[k] += noise(seed, 0.5f);
+            }
+        }
+        return samples;
+    }();
+    return stream;
+}
+
+// Feeds the stream to |fusion| the way SensorFusion does, every fusion getting every sensor.
+void replay(Fusion& fusion, const std::vector<ImuSample>& stream) {
+    const float dT = 1.0f / kGyroRateHz;
+    for (size_t i = 0; i < stream.size(); i++) {
+        fusion.handleGyro(stream[i].gyro, dT);
+        if (i % kGyroSamplesPerAccSample == 0) {
+            fusion.handleMag(stream[i].mag);
+            fusion.handleAcc(stream[i].acc, dT * kGyroSamplesPerAccSample);
+        }
+    }
+}
+
+vec4_t replayAttitude(int mode, bool useGenericKernels) {
+    Fusion fusion;
+    fusion.init(mode);
+    fusion.setUseGenericKernels(useGenericKernels);
+    replay(fusion, getImuStream());
+    return fusion.getAttitude();
+}
+
+// Returns an empty string if the SIMD kernels produce the same attitude as the generic ones.
+std::string checkKernelsMatch(int mode) {
+    const vec4_t simd(replayAttitude(mode, false));
+    const vec4_t generic(replayAttitude(mode, true));
+    for (size_t i = 0; i < 4; i++) {
+        if (!(fabsf(simd[i] - generic[i]) <= kAttitudeTolerance)) {
+            char message[128];
+            snprintf(message, sizeof(message),
+                     "attitude mismatch: {%f, %f, %f, %f} vs {%f, %f, %f, %f}", simd.x, simd.y,
+                     simd.z, simd.w, generic.x, generic.y, generic.z, generic.w);
+            return message;
+        }
+    }
+    return "";
+}
+
+} // namespace
+
+// Args: fusion mode, and whether to use the generic templates instead of the SIMD kernels.
+static void BM_replayImuStream(benchmark::State& state) {
+    const int mode = state.range(0);
+    const bool useGenericKernels = state.range(1) != 0;
+    const std::vector<ImuSample>& stream = getImuStream();
+
+    std::string error = checkKernelsMatch(mode);
+    if (!error.empty()) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    for (auto _ : state) {
+        Fusion fusion;
+        fusion.init(mode);
+        fusion.setUseGenericKernels(useGenericKernels);
+        replay(fusion, stream);
+        benchmark::DoNotOptimize(fusion.getAttitude());
+    }
+
+    state.counters["time/sample"] =
+            benchmark::Counter(state.iterations() * stream.size(),
+                               benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(BM_replayImuStream)
+        ->ArgNames({"mode", "generic"})
+        ->ArgsProduct({{FUSION_9AXIS, FUSION_NOMAG, FUSION_NOGYRO}, {0, 1}});
+
+BENCHMARK_MAIN();
@@ -40,13 +40,13 @@ bool ClientCache::getBuffer(const client_cache_t& cacheId,
         ALOGE_AND_TRACE("ClientCache::getBuffer - invalid (nullptr) process token");
         return false;
     }
-    auto it = mBuffers.find(processToken);
+    auto it = mBuffers.find(processToken.unsafe_get());
     if (it == mBuffers.end()) {
         ALOGE_AND_TRACE("ClientCache::getBuffer - invalid process token");
         return false;
     }
 
-    auto& processBuffers = it->second.second;
+    auto& processBuffers = it->second.buffers;
 
     auto bufItr = processBuffers.find(id);
     if (bufItr == processBuffers.end()) {
@@ -77,7 +77,7 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
 
     // If this is a new process token, set a death recipient. If the client process dies, we will
     // get a callback through binderDied.
-    auto it = mBuffers.find(processToken);
+    auto it = mBuffers.find(processToken.unsafe_get());
     if (it == mBuffers.end()) {
         token = processToken.promote();
         if (!token) {
@@ -94,14 +94,12 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
             }
         }
         auto [itr, success] =
-                mBuffers.emplace(processToken,
-                                 std::make_pair(token,
-                                                std::unordered_map<uint64_t, ClientCacheBuffer>()));
+                mBuffers.emplace(token.get(), ProcessBuffers{.token = token, .buffers = {}});
         LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
         it = itr;
     }
 
-    auto& processBuffers = it->second.second;
+    auto& processBuffers = it->second.buffers;
 
     if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
         ALOGE_AND_TRACE("ClientCache::add - cache is full");
@@ -118,34 +116,63 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
                                                                  Usage::READABLE));
 }
 
+sp<GraphicBuffer> ClientCache::eraseLocked(const client_cache_t& cacheId,
+                                           std::vector<sp<ErasedRecipient>>& outPendingErase) {
+    auto& [processToken, id] = cacheId;
+    ClientCacheBuffer* buf = nullptr;
+    if (!getBuffer(cacheId, &buf)) {
+        ALOGE("failed to erase buffer, could not retrieve buffer");
+        return nullptr;
+    }
+
+    sp<GraphicBuffer> buffer = buf->buffer->getBuffer();
+
+    for (auto& recipient : buf->recipients) {
+        sp<ErasedRecipient> erasedRecipient = recipient.promote();
+        if (erasedRecipient) {
+            outPendingErase.push_back(erasedRecipient);
+        }
+    }
+
+    mBuffers[processToken.unsafe_get()].buffers.erase(id);
+    return buffer;
+}
+
 sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
     sp<GraphicBuffer> buffer;
-    auto& [processToken, id] = cacheId;
     std::vector<sp<ErasedRecipient>> pendingErase;
     {
         std::lock_guard lock(mMutex);
-        ClientCacheBuffer* buf = nullptr;
-        if (!getBuffer(cacheId, &buf)) {
-            ALOGE("failed to erase buffer, could not retrieve buffer");
-            return nullptr;
-        }
+        buffer = eraseLocked(cacheId, pendingErase);
+    }
 
-        buffer = buf->buffer->getBuffer();
+    for (auto& recipient : pendingErase) {
+        recipient->bufferErased(cacheId);
+    }
+    return buffer;
+}
 
-        for (auto& recipient : buf->recipients) {
-            sp<ErasedRecipient> erasedRecipient = recipient.promote();
-            if (erasedRecipient) {
-                pendingErase.push_back(erasedRecipient);
+void ClientCache::erase(const std::vector<client_cache_t>& cacheIds,
+                        std::vector<uint64_t>& outBufferIds) {
+    // Recipients are notified outside of the lock, along with the buffer they were registered for.
+    std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    {
+        std::lock_guard lock(mMutex);
+        std::vector<sp<ErasedRecipient>> recipients;
+        for (const auto& cacheId : cacheIds) {
+            if (sp<GraphicBuffer> buffer = eraseLocked(cacheId, recipients)) {
+                outBufferIds.push_back(buffer->getId());
             }
+            for (auto& recipient : recipients) {
+                pendingErase.emplace_back(std::move(recipient), cacheId);
+            }
+            recipients.clear();
         }
-
-        mBuffers[processToken].second.erase(id);
     }
 
-    for (auto& recipient : pendingErase) {
+    for (auto& [recipient, cacheId] : pendingErase) {
         recipient->bufferErased(cacheId);
     }
-    return buffer;
 }
 
 std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cache_t& cacheId) {
@@ -194,13 +221,13 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
             return;
         }
         std::lock_guard lock(mMutex);
-        auto itr = mBuffers.find(processToken);
+        auto itr = mBuffers.find(processToken.unsafe_get());
         if (itr == mBuffers.end()) {
             ALOGE("failed to remove process, could not find process");
             return;
         }
 
-        for (auto& [id, clientCacheBuffer] : itr->second.second) {
+        for (auto& [id, clientCacheBuffer] : itr->second.buffers) {
             client_cache_t cacheId = {processToken, id};
             for (auto& recipient : clientCacheBuffer.recipients) {
                 sp<ErasedRecipient> erasedRecipient = recipient.promote();
@@ -224,9 +251,9 @@ void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
 void ClientCache::dump(std::string& result) {
     std::lock_guard lock(mMutex);
     for (const auto& [_, cache] : mBuffers) {
-        base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
+        base::StringAppendF(&result, " Cache owner: %p\n", cache.token.get());
 
-        for (const auto& [id, entry] : cache.second) {
+        for (const auto& [id, entry] : cache.buffers) {
             const auto& buffer = entry.buffer->getBuffer();
             base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u\n", id, buffer->getWidth(),
                                 buffer->getHeight());
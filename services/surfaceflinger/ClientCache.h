@@ -24,10 +24,10 @@
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
-#include <map>
 #include <mutex>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 // 4096 is based on 64 buffers * 64 layers. Once this limit is reached, the least recently used
 // buffer is uncached before the new buffer is cached.
@@ -57,6 +57,10 @@ public:
 
     sp<GraphicBuffer> erase(const client_cache_t& cacheId);
 
+    // Erases all the buffers of |cacheIds| under a single lock, and appends the ids of the
+    // GraphicBuffers that were erased to |outBufferIds|.
+    void erase(const std::vector<client_cache_t>& cacheIds, std::vector<uint64_t>& outBufferIds);
+
     std::shared_ptr<renderengine::ExternalTexture> get(const client_cache_t& cacheId);
 
     // Always called immediately after setup. Will be set to non-null, and then should never be
@@ -84,10 +88,14 @@ private:
         std::shared_ptr<renderengine::ExternalTexture> buffer;
         std::set<wp<ErasedRecipient>> recipients;
     };
-    std::map<wp<IBinder> /*caching process*/,
-             std::pair<sp<IBinder> /*strong ref to caching process*/,
-                       std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
-            mBuffers GUARDED_BY(mMutex);
+    struct ProcessBuffers {
+        // Strong ref to the caching process, which also keeps the key below valid.
+        sp<IBinder> token;
+        std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer> buffers;
+    };
+    // Keyed by the binder of the caching process, so that lookups hash a pointer rather than walk
+    // a tree of weak references.
+    std::unordered_map<const IBinder*, ProcessBuffers> mBuffers GUARDED_BY(mMutex);
 
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
@@ -99,6 +107,10 @@ private:
 
     bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
             REQUIRES(mMutex);
+    // Removes a buffer from the cache, and appends the recipients to notify to |outPendingErase|.
+    sp<GraphicBuffer> eraseLocked(const client_cache_t& cacheId,
+                                  std::vector<sp<ErasedRecipient>>& outPendingErase)
+            REQUIRES(mMutex);
 };
 
 }; // namespace android
@@ -16,9 +16,8 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <stack>
-#include <unordered_map>
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
 #pragma clang diagnostic push
@@ -56,6 +55,10 @@ struct HwcSlotAndBuffer {
 // since it eliminates the overhead to transfer the buffer handle over IPC and
 // the overhead for the HAL to clone the handle.
 //
+// A layer only ever has a few dozen buffers, so the cache is a fixed table indexed by slot rather
+// than a map keyed by buffer id: lookups scan the ids of the occupied slots, and caching or
+// uncaching a buffer doesn't allocate.
+//
 class HwcBufferCache {
 private:
     static const constexpr size_t kMaxLayerBufferCount = BufferQueue::NUM_BUFFER_SLOTS;
@@ -93,21 +96,30 @@ public:
     uint32_t uncache(uint64_t graphicBufferId);
 
 private:
+    static_assert(kMaxLayerBufferCount <= 64, "occupied slots must fit in a 64 bit mask");
+
     uint32_t cache(const sp<GraphicBuffer>& buffer);
     uint32_t getLeastRecentlyUsedSlot();
+    // Returns the slot holding the buffer, or UINT32_MAX if it isn't cached.
+    uint32_t findSlot(uint64_t bufferId) const;
+    void freeSlot(uint32_t slot);
+
+    // Ids of the cached buffers, by slot. Only meaningful for the slots set in mOccupiedSlots.
+    // Kept apart from the buffers so that lookups only touch a couple of cache lines.
+    std::array<uint64_t, kMaxLayerBufferCount> mBufferIds{};
+    std::array<sp<GraphicBuffer>, kMaxLayerBufferCount> mBuffers;
+    // Cache entries are evicted according to least-recently-used when more than
+    // kMaxLayerBufferCount unique buffers have been sent to a layer.
+    std::array<uint64_t, kMaxLayerBufferCount> mLruCounters{};
+    uint64_t mOccupiedSlots = 0;
+
+    // Stack of the free slots. The slot freed last is reused first, which OutputLayer relies on
+    // to have the active buffer's memory freed as soon as possible.
+    std::array<uint32_t, kMaxLayerBufferCount> mFreeSlots;
+    size_t mNumFreeSlots = 0;
 
-    struct Cache {
-        sp<GraphicBuffer> buffer;
-        uint32_t slot;
-        // Cache entries are evicted according to least-recently-used when more than
-        // kMaxLayerBufferCount unique buffers have been sent to a layer.
-        uint64_t lruCounter;
-    };
-
-    std::unordered_map<uint64_t, Cache> mCacheByBufferId;
     sp<GraphicBuffer> mLastOverrideBuffer;
-    std::stack<uint32_t> mFreeSlots;
-    uint64_t mLeastRecentlyUsedCounter;
+    uint64_t mLeastRecentlyUsedCounter = 0;
 };
 
 } // namespace compositionengine::impl
@@ -23,16 +23,15 @@ namespace android::compositionengine::impl {
 
 HwcBufferCache::HwcBufferCache() {
     for (uint32_t i = kMaxLayerBufferCount; i-- > 0;) {
-        mFreeSlots.push(i);
+        mFreeSlots[mNumFreeSlots++] = i;
     }
 }
 
 HwcSlotAndBuffer HwcBufferCache::getHwcSlotAndBuffer(const sp<GraphicBuffer>& buffer) {
-    if (auto i = mCacheByBufferId.find(buffer->getId()); i != mCacheByBufferId.end()) {
-        Cache& cache = i->second;
+    if (const uint32_t slot = findSlot(buffer->getId()); slot != UINT32_MAX) {
         // mark this cache slot as more recently used so it won't get evicted anytime soon
-        cache.lruCounter = mLeastRecentlyUsedCounter++;
-        return {cache.slot, nullptr};
+        mLruCounters[slot] = mLeastRecentlyUsedCounter++;
+        return {slot, nullptr};
     }
     return {cache(buffer), buffer};
 }
@@ -46,10 +45,8 @@ HwcSlotAndBuffer HwcBufferCache::getOverrideHwcSlotAndBuffer(const sp<GraphicBuf
 }
 
 uint32_t HwcBufferCache::uncache(uint64_t bufferId) {
-    if (auto i = mCacheByBufferId.find(bufferId); i != mCacheByBufferId.end()) {
-        uint32_t slot = i->second.slot;
-        mCacheByBufferId.erase(i);
-        mFreeSlots.push(slot);
+    if (const uint32_t slot = findSlot(bufferId); slot != UINT32_MAX) {
+        freeSlot(slot);
         return slot;
     }
     if (mLastOverrideBuffer && bufferId == mLastOverrideBuffer->getId()) {
@@ -60,31 +57,42 @@ uint32_t HwcBufferCache::uncache(uint64_t bufferId) {
 }
 
 uint32_t HwcBufferCache::cache(const sp<GraphicBuffer>& buffer) {
-    Cache cache;
-    cache.slot = getLeastRecentlyUsedSlot();
-    cache.lruCounter = mLeastRecentlyUsedCounter++;
-    cache.buffer = buffer;
-    mCacheByBufferId.emplace(buffer->getId(), cache);
-    return cache.slot;
+    const uint32_t slot = getLeastRecentlyUsedSlot();
+    mBufferIds[slot] = buffer->getId();
+    mBuffers[slot] = buffer;
+    mLruCounters[slot] = mLeastRecentlyUsedCounter++;
+    mOccupiedSlots |= uint64_t{1} << slot;
+    return slot;
 }
 
 uint32_t HwcBufferCache::getLeastRecentlyUsedSlot() {
-    if (mFreeSlots.empty()) {
-        assert(!mCacheByBufferId.empty());
+    if (mNumFreeSlots == 0) {
         // evict the least recently used cache entry
-        auto cacheToErase = mCacheByBufferId.begin();
-        for (auto i = cacheToErase; i != mCacheByBufferId.end(); ++i) {
-            if (i->second.lruCounter < cacheToErase->second.lruCounter) {
-                cacheToErase = i;
+        uint32_t slotToEvict = 0;
+        for (uint32_t slot = 1; slot < kMaxLayerBufferCount; slot++) {
+            if (mLruCounters[slot] < mLruCounters[slotToEvict]) {
+                slotToEvict = slot;
             }
         }
-        uint32_t slot = cacheToErase->second.slot;
-        mCacheByBufferId.erase(cacheToErase);
-        mFreeSlots.push(slot);
+        freeSlot(slotToEvict);
     }
-    uint32_t slot = mFreeSlots.top();
-    mFreeSlots.pop();
-    return slot;
+    return mFreeSlots[--mNumFreeSlots];
+}
+
+uint32_t HwcBufferCache::findSlot(uint64_t bufferId) const {
+    for (uint64_t slots = mOccupiedSlots; slots != 0; slots &= slots - 1) {
+        const auto slot = static_cast<uint32_t>(__builtin_ctzll(slots));
+        if (mBufferIds[slot] == bufferId) {
+            return slot;
+        }
+    }
+    return UINT32_MAX;
+}
+
+void HwcBufferCache::freeSlot(uint32_t slot) {
+    mBuffers[slot] = nullptr;
+    mOccupiedSlots &= ~(uint64_t{1} << slot);
+    mFreeSlots[mNumFreeSlots++] = slot;
 }
 
 } // namespace android::compositionengine::impl
@@ -85,6 +85,62 @@ TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_evictsOldestCachedB
     EXPECT_EQ(cache.uncache(graphicBuffers[0]->getId()), UINT32_MAX);
 }
 
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenSlotsFull_keepsRecentlyUsedBuffers) {
+    HwcBufferCache cache;
+
+    sp<GraphicBuffer> graphicBuffers[HwcBufferCache::kOverrideBufferSlot + 1];
+    for (auto& buffer : graphicBuffers) {
+        buffer = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+    }
+    // fill up the cache, then use the oldest buffer again
+    HwcSlotAndBuffer firstSlotAndBuffer = cache.getHwcSlotAndBuffer(graphicBuffers[0]);
+    for (size_t i = 1; i < HwcBufferCache::kOverrideBufferSlot; ++i) {
+        cache.getHwcSlotAndBuffer(graphicBuffers[i]);
+    }
+    EXPECT_EQ(cache.getHwcSlotAndBuffer(graphicBuffers[0]).slot, firstSlotAndBuffer.slot);
+
+    // the second oldest buffer is evicted instead of the first one
+    HwcSlotAndBuffer lastSlotAndBuffer =
+            cache.getHwcSlotAndBuffer(graphicBuffers[HwcBufferCache::kOverrideBufferSlot]);
+    EXPECT_NE(lastSlotAndBuffer.slot, firstSlotAndBuffer.slot);
+    EXPECT_EQ(cache.uncache(graphicBuffers[1]->getId()), UINT32_MAX);
+    EXPECT_EQ(cache.uncache(graphicBuffers[0]->getId()), firstSlotAndBuffer.slot);
+}
+
+TEST_F(HwcBufferCacheTest, getHwcSlotAndBuffer_whenCyclingBuffers_returnsEachBufferOnce) {
+    HwcBufferCache cache;
+
+    constexpr int kNumBuffers = 3;
+    sp<GraphicBuffer> graphicBuffers[kNumBuffers];
+    for (auto& buffer : graphicBuffers) {
+        buffer = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+    }
+
+    int numBuffersReturned = 0;
+    for (int frame = 0; frame < 100; ++frame) {
+        HwcSlotAndBuffer slotAndBuffer = cache.getHwcSlotAndBuffer(graphicBuffers[frame % kNumBuffers]);
+        EXPECT_EQ(slotAndBuffer.slot, static_cast<uint32_t>(frame % kNumBuffers));
+        if (slotAndBuffer.buffer != nullptr) {
+            numBuffersReturned++;
+        }
+    }
+    EXPECT_EQ(numBuffersReturned, kNumBuffers);
+}
+
+TEST_F(HwcBufferCacheTest, uncache_reusesLastUncachedSlotFirst) {
+    HwcBufferCache cache;
+
+    HwcSlotAndBuffer slotAndBufferFor1 = cache.getHwcSlotAndBuffer(mBuffer1);
+    HwcSlotAndBuffer slotAndBufferFor2 = cache.getHwcSlotAndBuffer(mBuffer2);
+    EXPECT_EQ(cache.uncache(mBuffer2->getId()), slotAndBufferFor2.slot);
+    EXPECT_EQ(cache.uncache(mBuffer1->getId()), slotAndBufferFor1.slot);
+
+    sp<GraphicBuffer> buffer3 = sp<GraphicBuffer>::make(1u, 1u, HAL_PIXEL_FORMAT_RGBA_8888, 1u, 0u);
+    HwcSlotAndBuffer slotAndBufferFor3 = cache.getHwcSlotAndBuffer(buffer3);
+    EXPECT_EQ(slotAndBufferFor3.slot, slotAndBufferFor1.slot);
+    EXPECT_EQ(slotAndBufferFor3.buffer, buffer3);
+}
+
 TEST_F(HwcBufferCacheTest, uncache_whenCached_returnsSlotNumber) {
     HwcBufferCache cache;
     sp<GraphicBuffer> outBuffer;
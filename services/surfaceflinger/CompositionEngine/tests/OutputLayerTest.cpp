@@ -1418,6 +1418,28 @@ TEST_F(OutputLayerUncacheBufferTest, canUncacheAndReuseSlot) {
     Mock::VerifyAndClearExpectations(&mHwcLayer);
 }
 
+TEST_F(OutputLayerUncacheBufferTest, cyclingBuffersOnlySendsEachBufferOnce) {
+    const sp<GraphicBuffer> buffers[] = {kBuffer1, kBuffer2, kBuffer3};
+    constexpr int kNumFrames = 30;
+
+    // Once each buffer has been sent to its slot, the following frames only switch slots.
+    int numBuffersSent = 0;
+    int numSlotSwitches = 0;
+    EXPECT_CALL(mHwcLayer, setBuffer(_, _, kFence))
+            .Times(kNumFrames)
+            .WillRepeatedly([&](uint32_t, const sp<GraphicBuffer>& buffer, const sp<Fence>&) {
+                (buffer != nullptr ? numBuffersSent : numSlotSwitches)++;
+                return hal::Error::NONE;
+            });
+    for (int frame = 0; frame < kNumFrames; frame++) {
+        mLayerFEState.buffer = buffers[frame % 3];
+        mOutputLayer.writeStateToHWC(/*includeGeometry*/ false, /*skipLayer*/ false, 0,
+                                     /*zIsOverridden*/ false, /*isPeekingThrough*/ false);
+    }
+    EXPECT_EQ(numBuffersSent, 3);
+    EXPECT_EQ(numSlotSwitches, kNumFrames - 3);
+}
+
 /*
  * OutputLayer::writeCursorPositionToHWC()
  */
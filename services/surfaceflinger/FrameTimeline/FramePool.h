@@ -0,0 +1,123 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+
+namespace android::frametimeline::impl {
+
+/*
+ * Free list of same sized blocks. SurfaceFrames are created for every buffer of every layer, so
+ * they are allocated from here, together with their shared_ptr control block, instead of from the
+ * heap. Blocks are handed back when the last reference to the frame goes away, which can happen on
+ * any thread.
+ */
+class FramePool {
+public:
+    // Upper bound on the blocks kept around, so that a burst of frames doesn't pin its memory.
+    static constexpr size_t kMaxFreeBlocks = 512;
+
+    ~FramePool() {
+        for (void* block : mFreeBlocks) {
+            ::operator delete(block);
+        }
+    }
+
+    // Returns a block of |size| bytes. The size of the first request is the size of the blocks
+    // pooled; other sizes are allocated from the heap.
+    void* allocate(size_t size) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (mBlockSize == 0) {
+                mBlockSize = size;
+                mFreeBlocks.reserve(kMaxFreeBlocks);
+            }
+            if (size == mBlockSize) {
+                if (!mFreeBlocks.empty()) {
+                    void* block = mFreeBlocks.back();
+                    mFreeBlocks.pop_back();
+                    return block;
+                }
+                mNumHeapAllocations++;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    void deallocate(void* block, size_t size) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (size == mBlockSize && mFreeBlocks.size() < kMaxFreeBlocks) {
+                mFreeBlocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    // Number of pooled sized blocks that had to be allocated from the heap. Used by tests to check
+    // that steady state frames don't allocate.
+    size_t getNumHeapAllocations() const {
+        std::scoped_lock lock(mMutex);
+        return mNumHeapAllocations;
+    }
+
+private:
+    mutable std::mutex mMutex;
+    size_t mBlockSize GUARDED_BY(mMutex) = 0;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mMutex);
+    size_t mNumHeapAllocations GUARDED_BY(mMutex) = 0;
+};
+
+// Allocator for std::allocate_shared that takes its blocks from a FramePool. It holds a reference
+// to the pool, so that frames outliving their FrameTimeline can still hand their block back.
+template <typename T>
+class FramePoolAllocator {
+public:
+    using value_type = T;
+
+    explicit FramePoolAllocator(std::shared_ptr<FramePool> pool) : mPool(std::move(pool)) {}
+
+    template <typename U>
+    FramePoolAllocator(const FramePoolAllocator<U>& other) : mPool(other.mPool) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(mPool->allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { mPool->deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const FramePoolAllocator<U>& other) const {
+        return mPool == other.mPool;
+    }
+    template <typename U>
+    bool operator!=(const FramePoolAllocator<U>& other) const {
+        return mPool != other.mPool;
+    }
+
+private:
+    template <typename U>
+    friend class FramePoolAllocator;
+
+    std::shared_ptr<FramePool> mPool;
+};
+
+} // namespace android::frametimeline::impl
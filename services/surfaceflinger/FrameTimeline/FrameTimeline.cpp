@@ -822,19 +822,16 @@ namespace impl {
 int64_t TokenManager::generateTokenForPredictions(TimelineItem&& predictions) {
     ATRACE_CALL();
     std::scoped_lock lock(mMutex);
-    while (mPredictions.size() >= kMaxTokens) {
-        mPredictions.erase(mPredictions.begin());
-    }
     const int64_t assignedToken = mCurrentToken++;
-    mPredictions[assignedToken] = predictions;
+    mPredictions[static_cast<uint64_t>(assignedToken) % kMaxTokens] = {assignedToken, predictions};
     return assignedToken;
 }
 
 std::optional<TimelineItem> TokenManager::getPredictionsForToken(int64_t token) const {
     std::scoped_lock lock(mMutex);
-    auto predictionsIterator = mPredictions.find(token);
-    if (predictionsIterator != mPredictions.end()) {
-        return predictionsIterator->second;
+    const Prediction& prediction = mPredictions[static_cast<uint64_t>(token) % kMaxTokens];
+    if (token != FrameTimelineInfo::INVALID_VSYNC_ID && prediction.token == token) {
+        return prediction.predictions;
     }
     return {};
 }
@@ -867,27 +864,30 @@ std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
         const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid, int32_t layerId,
         std::string layerName, std::string debugName, bool isBuffer, GameMode gameMode) {
     ATRACE_CALL();
+    const FramePoolAllocator<SurfaceFrame> allocator(mSurfaceFramePool);
     if (frameTimelineInfo.vsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::None, TimelineItem(), mTimeStats,
-                                              mJankClassificationThresholds, &mTraceCookieCounter,
-                                              isBuffer, gameMode);
+        return std::allocate_shared<SurfaceFrame>(allocator, frameTimelineInfo, ownerPid, ownerUid,
+                                                  layerId, std::move(layerName),
+                                                  std::move(debugName), PredictionState::None,
+                                                  TimelineItem(), mTimeStats,
+                                                  mJankClassificationThresholds,
+                                                  &mTraceCookieCounter, isBuffer, gameMode);
     }
     std::optional<TimelineItem> predictions =
             mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId);
     if (predictions) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::Valid, std::move(*predictions),
-                                              mTimeStats, mJankClassificationThresholds,
-                                              &mTraceCookieCounter, isBuffer, gameMode);
-    }
-    return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                          std::move(layerName), std::move(debugName),
-                                          PredictionState::Expired, TimelineItem(), mTimeStats,
-                                          mJankClassificationThresholds, &mTraceCookieCounter,
-                                          isBuffer, gameMode);
+        return std::allocate_shared<SurfaceFrame>(allocator, frameTimelineInfo, ownerPid, ownerUid,
+                                                  layerId, std::move(layerName),
+                                                  std::move(debugName), PredictionState::Valid,
+                                                  std::move(*predictions), mTimeStats,
+                                                  mJankClassificationThresholds,
+                                                  &mTraceCookieCounter, isBuffer, gameMode);
+    }
+    return std::allocate_shared<SurfaceFrame>(allocator, frameTimelineInfo, ownerPid, ownerUid,
+                                              layerId, std::move(layerName), std::move(debugName),
+                                              PredictionState::Expired, TimelineItem(), mTimeStats,
+                                              mJankClassificationThresholds, &mTraceCookieCounter,
+                                              isBuffer, gameMode);
 }
 
 FrameTimeline::DisplayFrame::DisplayFrame(std::shared_ptr<TimeStats> timeStats,
@@ -931,13 +931,27 @@ void FrameTimeline::onCommitNotComposited() {
     ATRACE_CALL();
     std::scoped_lock lock(mMutex);
     mCurrentDisplayFrame->onCommitNotComposited();
-    mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
-                                                          &mTraceCookieCounter);
+    mCurrentDisplayFrame = makeDisplayFrame(std::move(mCurrentDisplayFrame));
 }
 
 void FrameTimeline::DisplayFrame::addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame) {
-    mSurfaceFrames.push_back(surfaceFrame);
+    mSurfaceFrames.push_back(std::move(surfaceFrame));
+}
+
+void FrameTimeline::DisplayFrame::recycle() {
+    mToken = FrameTimelineInfo::INVALID_VSYNC_ID;
+    mSurfaceFlingerPredictions = TimelineItem();
+    mSurfaceFlingerActuals = TimelineItem();
+    mSurfaceFrames.clear();
+    mPredictionState = PredictionState::None;
+    mJankType = JankType::None;
+    mJankSeverityType = JankSeverityType::None;
+    mGpuFence = FenceTime::NO_FENCE;
+    mFramePresentMetadata = FramePresentMetadata::UnknownPresent;
+    mFrameReadyMetadata = FrameReadyMetadata::UnknownFinish;
+    mFrameStartMetadata = FrameStartMetadata::UnknownStart;
+    mRefreshRate = Fps();
+    mRenderRate = Fps();
 }
 
 void FrameTimeline::DisplayFrame::onSfWakeUp(int64_t token, Fps refreshRate, Fps renderRate,
@@ -1411,14 +1425,25 @@ void FrameTimeline::flushPendingPresentFences() {
 }
 
 void FrameTimeline::finalizeCurrentDisplayFrame() {
+    std::shared_ptr<DisplayFrame> oldestDisplayFrame;
     while (mDisplayFrames.size() >= mMaxDisplayFrames) {
         // We maintain only a fixed number of frames' data. Pop older frames
+        oldestDisplayFrame = std::move(mDisplayFrames.front());
         mDisplayFrames.pop_front();
     }
-    mDisplayFrames.push_back(mCurrentDisplayFrame);
-    mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
-                                                          &mTraceCookieCounter);
+    mDisplayFrames.push_back(std::move(mCurrentDisplayFrame));
+    mCurrentDisplayFrame = makeDisplayFrame(std::move(oldestDisplayFrame));
+}
+
+std::shared_ptr<FrameTimeline::DisplayFrame> FrameTimeline::makeDisplayFrame(
+        std::shared_ptr<DisplayFrame> displayFrame) {
+    // The frame may still be waiting on its present fence, or be held by a test.
+    if (displayFrame && displayFrame.use_count() == 1) {
+        displayFrame->recycle();
+        return displayFrame;
+    }
+    return std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
+                                          &mTraceCookieCounter);
 }
 
 nsecs_t FrameTimeline::DisplayFrame::getBaseTime() const {
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -38,6 +39,7 @@
 #include <scheduler/Fps.h>
 
 #include "../TimeStats/TimeStats.h"
+#include "FramePool.h"
 
 namespace android::frametimeline {
 
@@ -356,12 +358,18 @@ private:
     // Friend class for testing
     friend class android::frametimeline::FrameTimelineTest;
 
-    void flushTokens(nsecs_t flushTime) REQUIRES(mMutex);
+    static constexpr size_t kMaxTokens = 500;
+
+    struct Prediction {
+        int64_t token = FrameTimelineInfo::INVALID_VSYNC_ID;
+        TimelineItem predictions;
+    };
 
-    std::map<int64_t, TimelineItem> mPredictions GUARDED_BY(mMutex);
+    // Tokens are handed out in order, so the predictions of the last kMaxTokens tokens are kept in
+    // a ring indexed by token. A slot holding a different token means the predictions expired.
+    std::array<Prediction, kMaxTokens> mPredictions GUARDED_BY(mMutex);
     int64_t mCurrentToken GUARDED_BY(mMutex);
     mutable std::mutex mMutex;
-    static constexpr size_t kMaxTokens = 500;
 };
 
 class FrameTimeline : public android::frametimeline::FrameTimeline {
@@ -400,6 +408,9 @@ public:
         void onCommitNotComposited();
         // Adds the provided SurfaceFrame to the current display frame.
         void addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame);
+        // Puts the DisplayFrame back in its initial state so that it can be reused, keeping the
+        // capacity of its SurfaceFrames.
+        void recycle();
 
         void setPredictions(PredictionState predictionState, TimelineItem predictions);
         void setActualStartTime(nsecs_t actualStartTime);
@@ -504,6 +515,9 @@ private:
     void flushPendingPresentFences() REQUIRES(mMutex);
     std::optional<size_t> getFirstSignalFenceIndex() const REQUIRES(mMutex);
     void finalizeCurrentDisplayFrame() REQUIRES(mMutex);
+    // Returns |displayFrame| recycled if nothing else references it, or a new DisplayFrame.
+    std::shared_ptr<DisplayFrame> makeDisplayFrame(std::shared_ptr<DisplayFrame> displayFrame)
+            REQUIRES(mMutex);
     void dumpAll(std::string& result);
     void dumpJank(std::string& result);
 
@@ -514,6 +528,7 @@ private:
     std::shared_ptr<DisplayFrame> mCurrentDisplayFrame GUARDED_BY(mMutex);
     TokenManager mTokenManager;
     TraceCookieCounter mTraceCookieCounter;
+    const std::shared_ptr<FramePool> mSurfaceFramePool = std::make_shared<FramePool>();
     mutable std::mutex mMutex;
     const bool mUseBootTimeClock;
     uint32_t mMaxDisplayFrames;
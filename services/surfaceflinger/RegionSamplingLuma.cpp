@@ -0,0 +1,191 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#pragma clang diagnostic ignored "-Wextra"
+
+#undef LOG_TAG
+#define LOG_TAG "RegionSamplingThread"
+
+#include "RegionSamplingLuma.h"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+#define REGION_SAMPLING_SIMD 1
+#else
+#define REGION_SAMPLING_SIMD 0
+#endif
+
+namespace android {
+
+namespace {
+
+#if REGION_SAMPLING_SIMD
+// Four lanes, which the compiler maps to NEON on ARM and SSE on x86.
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+#endif
+
+// Calculates luma with approximation of Rec. 709 primaries, as sampleArea() does.
+inline uint32_t luma(uint32_t pixel) {
+    const uint32_t r = pixel & 0xFF;
+    const uint32_t g = (pixel >> 8) & 0xFF;
+    const uint32_t b = (pixel >> 16) & 0xFF;
+    return (r * 7 + b * 2 + g * 23) >> 5;
+}
+
+void computeLuma(const uint32_t* pixels, size_t count, uint32_t* outLuma) {
+    size_t i = 0;
+#if REGION_SAMPLING_SIMD
+    for (; i + 4 <= count; i += 4) {
+        u32x4 pixel;
+        memcpy(&pixel, pixels + i, sizeof(pixel));
+        const u32x4 r = pixel & 0xFF;
+        const u32x4 g = (pixel >> 8) & 0xFF;
+        const u32x4 b = (pixel >> 16) & 0xFF;
+        const u32x4 luma = (r * 7 + b * 2 + g * 23) >> 5;
+        memcpy(outLuma + i, &luma, sizeof(luma));
+    }
+#endif
+    for (; i < count; i++) {
+        outLuma[i] = luma(pixels[i]);
+    }
+}
+
+// Sums with unsigned wraparound, like sampleArea(), so that the results are bit exact.
+uint32_t sumLuma(const uint32_t* luma, size_t count) {
+    uint32_t sum = 0;
+    size_t i = 0;
+#if REGION_SAMPLING_SIMD
+    u32x4 accumulated = {0, 0, 0, 0};
+    for (; i + 4 <= count; i += 4) {
+        u32x4 values;
+        memcpy(&values, luma + i, sizeof(values));
+        accumulated += values;
+    }
+    sum = accumulated[0] + accumulated[1] + accumulated[2] + accumulated[3];
+#endif
+    for (; i < count; i++) {
+        sum += luma[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
+                 uint32_t orientation, const Rect& sample_area) {
+    if (!sample_area.isValid() || (sample_area.getWidth() > width) ||
+        (sample_area.getHeight() > height)) {
+        ALOGE("invalid sampling region requested");
+        return 0.0f;
+    }
+
+    const uint32_t pixelCount =
+            (sample_area.bottom - sample_area.top) * (sample_area.right - sample_area.left);
+    uint32_t accumulatedLuma = 0;
+
+    // Calculates luma with approximation of Rec. 709 primaries
+    for (int32_t row = sample_area.top; row < sample_area.bottom; ++row) {
+        const uint32_t* rowBase = data + row * stride;
+        for (int32_t column = sample_area.left; column < sample_area.right; ++column) {
+            uint32_t pixel = rowBase[column];
+            const uint32_t r = pixel & 0xFF;
+            const uint32_t g = (pixel >> 8) & 0xFF;
+            const uint32_t b = (pixel >> 16) & 0xFF;
+            const uint32_t luma = (r * 7 + b * 2 + g * 23) >> 5;
+            accumulatedLuma += luma;
+        }
+    }
+
+    return accumulatedLuma / (255.0f * pixelCount);
+}
+
+std::vector<float> sampleAreas(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
+                               uint32_t orientation, const std::vector<Rect>& areas) {
+    std::vector<uint32_t> accumulatedLumas(areas.size(), 0);
+    std::vector<bool> valid(areas.size(), false);
+    // The non empty areas, and the bounds of their union. Unlike sampleArea(), areas must be
+    // within the buffer, since rows are read for all of them at once.
+    std::vector<size_t> sampled;
+    sampled.reserve(areas.size());
+    Rect bounds(INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN);
+    for (size_t i = 0; i < areas.size(); i++) {
+        const Rect& area = areas[i];
+        if (!area.isValid() || area.left < 0 || area.top < 0 || area.right > width ||
+            area.bottom > height) {
+            ALOGE("invalid sampling region requested");
+            continue;
+        }
+        valid[i] = true;
+        if (area.isEmpty()) {
+            continue;
+        }
+        sampled.push_back(i);
+        bounds.left = std::min(bounds.left, area.left);
+        bounds.top = std::min(bounds.top, area.top);
+        bounds.right = std::max(bounds.right, area.right);
+        bounds.bottom = std::max(bounds.bottom, area.bottom);
+    }
+
+    if (!sampled.empty()) {
+        std::vector<uint32_t> rowLuma(bounds.getWidth());
+        for (int32_t row = bounds.top; row < bounds.bottom; ++row) {
+            // Only the columns of the areas that cover this row need their luma.
+            int32_t left = INT32_MAX;
+            int32_t right = INT32_MIN;
+            for (size_t i : sampled) {
+                if (areas[i].top <= row && row < areas[i].bottom) {
+                    left = std::min(left, areas[i].left);
+                    right = std::max(right, areas[i].right);
+                }
+            }
+            if (left >= right) {
+                continue;
+            }
+
+            const uint32_t* rowBase = data + row * stride;
+            computeLuma(rowBase + left, right - left, rowLuma.data() + (left - bounds.left));
+            for (size_t i : sampled) {
+                if (areas[i].top <= row && row < areas[i].bottom) {
+                    accumulatedLumas[i] += sumLuma(rowLuma.data() + (areas[i].left - bounds.left),
+                                                   areas[i].getWidth());
+                }
+            }
+        }
+    }
+
+    std::vector<float> lumas(areas.size(), 0.0f);
+    for (size_t i = 0; i < areas.size(); i++) {
+        if (!valid[i]) {
+            continue;
+        }
+        const uint32_t pixelCount = areas[i].getWidth() * areas[i].getHeight();
+        lumas[i] = accumulatedLumas[i] / (255.0f * pixelCount);
+    }
+    return lumas;
+}
+
+} // namespace android
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion -Wextra"
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ui/Rect.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace android {
+
+// Returns the mean luma of |area| in an RGBA_8888 buffer, from 0 to 1.
+float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
+                 uint32_t orientation, const Rect& area);
+
+// Returns the same as sampleArea() for each of |areas|, but in a single pass over the buffer: the
+// luma of each pixel is computed once, even where areas overlap, and is then summed for each area
+// covering it. Both steps are vectorized where SIMD is available.
+std::vector<float> sampleAreas(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
+                               uint32_t orientation, const std::vector<Rect>& areas);
+
+} // namespace android
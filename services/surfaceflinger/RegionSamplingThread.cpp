@@ -197,34 +197,6 @@ void RegionSamplingThread::binderDied(const wp<IBinder>& who) {
     mDescriptors.erase(who);
 }
 
-float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
-                 uint32_t orientation, const Rect& sample_area) {
-    if (!sample_area.isValid() || (sample_area.getWidth() > width) ||
-        (sample_area.getHeight() > height)) {
-        ALOGE("invalid sampling region requested");
-        return 0.0f;
-    }
-
-    const uint32_t pixelCount =
-            (sample_area.bottom - sample_area.top) * (sample_area.right - sample_area.left);
-    uint32_t accumulatedLuma = 0;
-
-    // Calculates luma with approximation of Rec. 709 primaries
-    for (int32_t row = sample_area.top; row < sample_area.bottom; ++row) {
-        const uint32_t* rowBase = data + row * stride;
-        for (int32_t column = sample_area.left; column < sample_area.right; ++column) {
-            uint32_t pixel = rowBase[column];
-            const uint32_t r = pixel & 0xFF;
-            const uint32_t g = (pixel >> 8) & 0xFF;
-            const uint32_t b = (pixel >> 16) & 0xFF;
-            const uint32_t luma = (r * 7 + b * 2 + g * 23) >> 5;
-            accumulatedLuma += luma;
-        }
-    }
-
-    return accumulatedLuma / (255.0f * pixelCount);
-}
-
 std::vector<float> RegionSamplingThread::sampleBuffer(
         const sp<GraphicBuffer>& buffer, const Point& leftTop,
         const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
@@ -237,13 +209,12 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     const int32_t width = buffer->getWidth();
     const int32_t height = buffer->getHeight();
     const int32_t stride = buffer->getStride();
-    std::vector<float> lumas(descriptors.size());
-    std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
-                   [&](auto const& descriptor) {
-                       return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
-                   });
-    return lumas;
+    std::vector<Rect> areas;
+    areas.reserve(descriptors.size());
+    for (const auto& descriptor : descriptors) {
+        areas.push_back(descriptor.area - leftTop);
+    }
+    return sampleAreas(data.get(), width, height, stride, orientation, areas);
 }
 
 void RegionSamplingThread::captureSample() {
@@ -31,6 +31,7 @@
 #include <thread>
 #include <unordered_map>
 
+#include "RegionSamplingLuma.h"
 #include "Scheduler/OneShotTimer.h"
 #include "WpHash.h"
 
@@ -42,9 +43,6 @@ struct SamplingOffsetCallback;
 
 using gui::IRegionSamplingListener;
 
-float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t stride,
-                 uint32_t orientation, const Rect& area);
-
 class RegionSamplingThread : public IBinder::DeathRecipient {
 public:
     struct TimingTunables {
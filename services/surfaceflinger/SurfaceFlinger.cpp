@@ -5251,12 +5251,9 @@ status_t SurfaceFlinger::setTransactionState(
     const int64_t postTime = systemTime();
 
     std::vector<uint64_t> uncacheBufferIds;
-    uncacheBufferIds.reserve(uncacheBuffers.size());
-    for (const auto& uncacheBuffer : uncacheBuffers) {
-        sp<GraphicBuffer> buffer = ClientCache::getInstance().erase(uncacheBuffer);
-        if (buffer != nullptr) {
-            uncacheBufferIds.push_back(buffer->getId());
-        }
+    if (!uncacheBuffers.empty()) {
+        uncacheBufferIds.reserve(uncacheBuffers.size());
+        ClientCache::getInstance().erase(uncacheBuffers, uncacheBufferIds);
     }
 
     std::vector<ResolvedComposerState> resolvedStates;
@@ -7033,6 +7030,15 @@ void SurfaceFlinger::dumpAll(const DumpArgs& args, const std::string& compositio
     StringAppendF(&result, "  max send delay (ns): %" PRId64 " ns\n",
                   windowInfosDebug.maxSendDelayDuration);
     StringAppendF(&result, "  unsent messages: %zu\n", windowInfosDebug.pendingMessageCount);
+    StringAppendF(&result, "  updates sent: %" PRIu64 " full, %" PRIu64 " delta\n",
+                  windowInfosDebug.fullUpdateCount, windowInfosDebug.deltaUpdateCount);
+    StringAppendF(&result, "  last sampled full update: %zu bytes, serialized in %" PRId64 " ns\n",
+                  windowInfosDebug.fullUpdateParcelSize,
+                  windowInfosDebug.fullUpdateSerializationDuration);
+    StringAppendF(&result,
+                  "  last sampled delta update: %zu bytes, serialized in %" PRId64 " ns\n",
+                  windowInfosDebug.deltaUpdateParcelSize,
+                  windowInfosDebug.deltaUpdateSerializationDuration);
     result.append("\n");
 }
 
@@ -25,7 +25,11 @@
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <pthread.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cmath>
 #include <unordered_map>
@@ -91,8 +95,97 @@ SurfaceflingerStatsLayerInfo_SetFrameRateVote frameRateVoteToProto(
 }
 } // namespace
 
+namespace {
+
+std::atomic<uint64_t> sNextInstanceId = 1;
+
+// Number of events a thread records before waking up the aggregation thread. Small enough that
+// the recorded fences are released soon, and that the buffer rarely fills up.
+constexpr size_t kAggregationWakeupInterval = 64;
+// Number of events the aggregation thread applies each time it holds mMutex.
+constexpr size_t kAggregationBatchSize = 32;
+
+} // namespace
+
+// Single producer single consumer ring of events: the producer is the thread the buffer belongs
+// to, and the consumer is whoever holds mMutex. Each index is only written by one side; the
+// release stores make the slot contents visible to the side that acquires the index.
+struct TimeStats::LayerEventBuffer {
+    std::array<LayerEvent, LAYER_EVENT_BUFFER_CAPACITY> slots;
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+    // Only used by the producer.
+    size_t eventsSinceWakeup = 0;
+    // Set once the producer won't record any more events in the buffer, e.g. because its thread
+    // exited. The buffer is then reclaimed when it's empty.
+    std::atomic<bool> abandoned = false;
+
+    LayerEvent* beginPush() {
+        const size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead - tail.load(std::memory_order_acquire) == slots.size()) {
+            return nullptr;
+        }
+        return &slots[currentHead % slots.size()];
+    }
+
+    void endPush() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    LayerEvent* front() {
+        const size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[currentTail % slots.size()];
+    }
+
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+// Records an event in the buffer of the calling thread, and publishes it when it goes out of
+// scope. If the buffer is full, the events of all the threads are applied first.
+class TimeStats::LayerEventWriter {
+public:
+    LayerEventWriter(TimeStats& timeStats, LayerEventType type, int32_t layerId)
+          : mTimeStats(timeStats), mBuffer(timeStats.getLayerEventBuffer()) {
+        while (!(mEvent = mBuffer.beginPush())) {
+            ATRACE_NAME("TimeStats buffer full");
+            {
+                std::lock_guard<std::mutex> lock(mTimeStats.mMutex);
+                mTimeStats.applyLayerEventsLocked();
+            }
+            // Another thread may still be recording the event that the others wait for.
+            std::this_thread::yield();
+        }
+        // Only take a sequence number once the slot is secured, so the event can't hold up the
+        // events after it for long.
+        mEvent->sequence = mTimeStats.mNextLayerEventSequence.fetch_add(1);
+        mEvent->type = type;
+        mEvent->layerId = layerId;
+    }
+
+    ~LayerEventWriter() {
+        mBuffer.endPush();
+        if (++mBuffer.eventsSinceWakeup >= kAggregationWakeupInterval) {
+            mBuffer.eventsSinceWakeup = 0;
+            mTimeStats.wakeAggregationThread();
+        }
+    }
+
+    LayerEvent* operator->() { return mEvent; }
+
+private:
+    TimeStats& mTimeStats;
+    LayerEventBuffer& mBuffer;
+    LayerEvent* mEvent = nullptr;
+};
+
 bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    applyLayerEventsLocked();
 
     if (mTimeStats.statsStartLegacy == 0) {
         return false;
@@ -146,6 +239,7 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
 
 bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
     std::lock_guard<std::mutex> lock(mMutex);
+    applyLayerEventsLocked();
 
     std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
     uint32_t numLayers = 0;
@@ -245,7 +339,8 @@ bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
 TimeStats::TimeStats() : TimeStats(std::nullopt, std::nullopt) {}
 
 TimeStats::TimeStats(std::optional<size_t> maxPulledLayers,
-                     std::optional<size_t> maxPulledHistogramBuckets) {
+                     std::optional<size_t> maxPulledHistogramBuckets)
+      : mInstanceId(sNextInstanceId.fetch_add(1)) {
     if (maxPulledLayers) {
         mMaxPulledLayers = *maxPulledLayers;
     }
@@ -253,6 +348,162 @@ TimeStats::TimeStats(std::optional<size_t> maxPulledLayers,
     if (maxPulledHistogramBuckets) {
         mMaxPulledHistogramBuckets = *maxPulledHistogramBuckets;
     }
+
+    mAggregationThread = std::thread(&TimeStats::aggregationLoop, this);
+}
+
+TimeStats::~TimeStats() {
+    mStopAggregation = true;
+    wakeAggregationThread();
+    if (mAggregationThread.joinable()) {
+        mAggregationThread.join();
+    }
+}
+
+TimeStats::LayerEventBuffer& TimeStats::getLayerEventBuffer() {
+    // The buffer the thread last recorded into, abandoned when the thread exits or moves on to
+    // another TimeStats.
+    struct CachedBuffer {
+        uint64_t instanceId = 0;
+        std::shared_ptr<LayerEventBuffer> buffer;
+
+        ~CachedBuffer() { abandon(); }
+
+        void abandon() {
+            if (buffer) {
+                buffer->abandoned.store(true, std::memory_order_release);
+                buffer.reset();
+            }
+        }
+    };
+    thread_local CachedBuffer cachedBuffer;
+    if (cachedBuffer.instanceId == mInstanceId) {
+        return *cachedBuffer.buffer;
+    }
+    cachedBuffer.abandon();
+
+    std::lock_guard<std::mutex> lock(mLayerEventBuffersMutex);
+    auto& buffer = mLayerEventBuffers[gettid()];
+    if (!buffer) {
+        buffer = std::make_shared<LayerEventBuffer>();
+    }
+    buffer->abandoned.store(false, std::memory_order_relaxed);
+    cachedBuffer.instanceId = mInstanceId;
+    cachedBuffer.buffer = buffer;
+    return *buffer;
+}
+
+void TimeStats::wakeAggregationThread() {
+    mAggregationWakeups.fetch_add(1, std::memory_order_release);
+    mAggregationWakeups.notify_one();
+}
+
+void TimeStats::aggregationLoop() {
+    pthread_setname_np(pthread_self(), "TimeStats");
+    while (true) {
+        // Read before applying, so events recorded after the buffers are seen empty still wake us.
+        const uint32_t wakeups = mAggregationWakeups.load(std::memory_order_acquire);
+        bool moreEvents = true;
+        while (moreEvents) {
+            // Let go of the lock between batches, so the callers that need it don't wait long.
+            std::lock_guard<std::mutex> lock(mMutex);
+            moreEvents = applyLayerEventsLocked(kAggregationBatchSize);
+        }
+        if (mStopAggregation) {
+            break;
+        }
+        mAggregationWakeups.wait(wakeups, std::memory_order_acquire);
+    }
+}
+
+bool TimeStats::applyLayerEventsLocked(size_t maxEvents) {
+    ATRACE_CALL();
+    mLayerEventBuffersToApply.clear();
+    {
+        std::lock_guard<std::mutex> lock(mLayerEventBuffersMutex);
+        for (auto it = mLayerEventBuffers.begin(); it != mLayerEventBuffers.end();) {
+            LayerEventBuffer* buffer = it->second.get();
+            // Once abandoned, nothing else is pushed, so an empty buffer stays empty.
+            if (buffer->abandoned.load(std::memory_order_acquire) && !buffer->front()) {
+                it = mLayerEventBuffers.erase(it);
+                continue;
+            }
+            mLayerEventBuffersToApply.push_back(buffer);
+            ++it;
+        }
+    }
+
+    for (size_t applied = 0; applied < maxEvents; applied++) {
+        LayerEventBuffer* nextBuffer = nullptr;
+        LayerEvent* nextEvent = nullptr;
+        for (LayerEventBuffer* buffer : mLayerEventBuffersToApply) {
+            LayerEvent* event = buffer->front();
+            if (event && (!nextEvent || event->sequence < nextEvent->sequence)) {
+                nextBuffer = buffer;
+                nextEvent = event;
+            }
+        }
+        // Stop at a gap: the missing event is still being recorded by another thread, and the
+        // events after it may depend on it.
+        if (!nextEvent || nextEvent->sequence != mNextAppliedLayerEventSequence) {
+            return false;
+        }
+        applyLayerEventLocked(*nextEvent);
+        nextBuffer->pop();
+        mNextAppliedLayerEventSequence++;
+    }
+    return true;
+}
+
+void TimeStats::applyLayerEventLocked(LayerEvent& event) {
+    switch (event.type) {
+        case LayerEventType::PostTime:
+            setPostTimeLocked(event.layerId, event.frameNumber, event.layerName, event.uid,
+                              event.time, event.gameMode);
+            break;
+        case LayerEventType::LatchTime:
+            setLatchTimeLocked(event.layerId, event.frameNumber, event.time);
+            break;
+        case LayerEventType::LatchSkipped:
+            incrementLatchSkippedLocked(event.layerId, event.latchSkipReason);
+            break;
+        case LayerEventType::BadDesiredPresent:
+            incrementBadDesiredPresentLocked(event.layerId);
+            break;
+        case LayerEventType::DesiredTime:
+            setDesiredTimeLocked(event.layerId, event.frameNumber, event.time);
+            break;
+        case LayerEventType::AcquireTime:
+            setAcquireTimeLocked(event.layerId, event.frameNumber, event.time);
+            break;
+        case LayerEventType::AcquireFence:
+            setAcquireFenceLocked(event.layerId, event.frameNumber, event.fence);
+            break;
+        case LayerEventType::PresentTime:
+            setPresentTimeLocked(event.layerId, event.frameNumber, event.time,
+                                 event.displayRefreshRate, event.renderRate, event.frameRateVote,
+                                 event.gameMode);
+            break;
+        case LayerEventType::PresentFence:
+            setPresentFenceLocked(event.layerId, event.frameNumber, event.fence,
+                                  event.displayRefreshRate, event.renderRate, event.frameRateVote,
+                                  event.gameMode);
+            break;
+        case LayerEventType::JankyFrames:
+            incrementJankyFramesLocked({event.displayRefreshRate, event.renderRate, event.uid,
+                                        event.layerName, event.gameMode, event.jankReasons,
+                                        event.displayDeadlineDelta, event.displayPresentJitter,
+                                        event.appDeadlineDelta});
+            break;
+        case LayerEventType::Destroy:
+            mTimeStatsTracker.erase(event.layerId);
+            break;
+        case LayerEventType::RemoveTimeRecord:
+            removeTimeRecordLocked(event.layerId, event.frameNumber);
+            break;
+    }
+    // Don't keep the fence alive until the slot is reused.
+    event.fence = nullptr;
 }
 
 bool TimeStats::onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) {
@@ -308,10 +559,16 @@ std::string TimeStats::miniDump() {
 
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
+    applyLayerEventsLocked();
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
                                  mTimeStatsTracker.size());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
+    {
+        std::lock_guard<std::mutex> buffersLock(mLayerEventBuffersMutex);
+        android::base::StringAppendF(&result, "Number of layer event buffers is %zu\n",
+                                     mLayerEventBuffers.size());
+    }
     return result;
 }
 
@@ -569,10 +826,20 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::PostTime, layerId);
+    event->frameNumber = frameNumber;
+    event->layerName = layerName;
+    event->uid = uid;
+    event->time = postTime;
+    event->gameMode = gameMode;
+}
+
+void TimeStats::setPostTimeLocked(int32_t layerId, uint64_t frameNumber,
+                                  const std::string& layerName, uid_t uid, nsecs_t postTime,
+                                  GameMode gameMode) {
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
         return;
     }
@@ -613,9 +880,14 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::LatchTime, layerId);
+    event->frameNumber = frameNumber;
+    event->time = latchTime;
+}
+
+void TimeStats::setLatchTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t latchTime) {
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -631,10 +903,14 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::LatchSkipped, layerId);
+    event->latchSkipReason = reason;
+}
+
+void TimeStats::incrementLatchSkippedLocked(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
 
@@ -649,9 +925,12 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::BadDesiredPresent, layerId);
+}
+
+void TimeStats::incrementBadDesiredPresentLocked(int32_t layerId) {
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     layerRecord.badDesiredPresentFrames++;
@@ -661,9 +940,14 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::DesiredTime, layerId);
+    event->frameNumber = frameNumber;
+    event->time = desiredTime;
+}
+
+void TimeStats::setDesiredTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t desiredTime) {
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -679,9 +963,14 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::AcquireTime, layerId);
+    event->frameNumber = frameNumber;
+    event->time = acquireTime;
+}
+
+void TimeStats::setAcquireTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t acquireTime) {
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -698,10 +987,16 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::AcquireFence, layerId);
+    event->frameNumber = frameNumber;
+    event->fence = acquireFence;
+}
+
+void TimeStats::setAcquireFenceLocked(int32_t layerId, uint64_t frameNumber,
+                                      const std::shared_ptr<FenceTime>& acquireFence) {
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -719,9 +1014,20 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::PresentTime, layerId);
+    event->frameNumber = frameNumber;
+    event->time = presentTime;
+    event->displayRefreshRate = displayRefreshRate;
+    event->renderRate = renderRate;
+    event->frameRateVote = frameRateVote;
+    event->gameMode = gameMode;
+}
+
+void TimeStats::setPresentTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
+                                     Fps displayRefreshRate, std::optional<Fps> renderRate,
+                                     SetFrameRateVote frameRateVote, GameMode gameMode) {
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -745,10 +1051,22 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::PresentFence, layerId);
+    event->frameNumber = frameNumber;
+    event->fence = presentFence;
+    event->displayRefreshRate = displayRefreshRate;
+    event->renderRate = renderRate;
+    event->frameRateVote = frameRateVote;
+    event->gameMode = gameMode;
+}
+
+void TimeStats::setPresentFenceLocked(int32_t layerId, uint64_t frameNumber,
+                                      const std::shared_ptr<FenceTime>& presentFence,
+                                      Fps displayRefreshRate, std::optional<Fps> renderRate,
+                                      SetFrameRateVote frameRateVote, GameMode gameMode) {
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     if (layerRecord.waitData < 0 ||
@@ -806,8 +1124,19 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
-    std::lock_guard<std::mutex> lock(mMutex);
+    LayerEventWriter event(*this, LayerEventType::JankyFrames, 0);
+    event->layerName = info.layerName;
+    event->uid = info.uid;
+    event->gameMode = info.gameMode;
+    event->displayRefreshRate = info.refreshRate;
+    event->renderRate = info.renderRate;
+    event->jankReasons = info.reasons;
+    event->displayDeadlineDelta = info.displayDeadlineDelta;
+    event->displayPresentJitter = info.displayPresentJitter;
+    event->appDeadlineDelta = info.appDeadlineDelta;
+}
 
+void TimeStats::incrementJankyFramesLocked(const JankyFramesInfo& info) {
     // Only update layer stats if we're already tracking the layer in TimeStats.
     // Otherwise, continue tracking the statistic but use a default layer name instead.
     // As an implementation detail, we do this because this method is expected to be
@@ -863,17 +1192,20 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    LayerEventWriter event(*this, LayerEventType::Destroy, layerId);
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     if (!mEnabled.load()) return;
 
     ATRACE_CALL();
+    LayerEventWriter event(*this, LayerEventType::RemoveTimeRecord, layerId);
+    event->frameNumber = frameNumber;
+}
+
+void TimeStats::removeTimeRecordLocked(int32_t layerId, uint64_t frameNumber) {
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (!mTimeStatsTracker.count(layerId)) return;
     LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     size_t removeAt = 0;
@@ -1037,6 +1369,7 @@ void TimeStats::disable() {
     ATRACE_CALL();
 
     std::lock_guard<std::mutex> lock(mMutex);
+    applyLayerEventsLocked();
     flushPowerTimeLocked();
     mEnabled.store(false);
     mTimeStats.statsEndLegacy = static_cast<int64_t>(std::time(0));
@@ -1045,6 +1378,7 @@ void TimeStats::disable() {
 
 void TimeStats::clearAll() {
     std::lock_guard<std::mutex> lock(mMutex);
+    applyLayerEventsLocked();
     mTimeStats.stats.clear();
     clearGlobalLocked();
     clearLayersLocked();
@@ -1096,6 +1430,7 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
     ATRACE_CALL();
 
     std::lock_guard<std::mutex> lock(mMutex);
+    applyLayerEventsLocked();
     if (mTimeStats.statsStartLegacy == 0) {
         return;
     }
@@ -16,12 +16,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <thread>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <android/hardware/graphics/composer/2.4/IComposerClient.h>
 #include <gui/JankInfo.h>
@@ -236,11 +240,56 @@ class TimeStats : public android::TimeStats {
         std::deque<RenderEngineDuration> renderEngineDurations;
     };
 
+    enum class LayerEventType : uint8_t {
+        PostTime,
+        LatchTime,
+        LatchSkipped,
+        BadDesiredPresent,
+        DesiredTime,
+        AcquireTime,
+        AcquireFence,
+        PresentTime,
+        PresentFence,
+        JankyFrames,
+        Destroy,
+        RemoveTimeRecord,
+    };
+
+    // The arguments of a per layer call, recorded to be applied later. Events live in preallocated
+    // slots, so the strings and the fences don't need to be reallocated for each event.
+    struct LayerEvent {
+        uint64_t sequence = 0;
+        LayerEventType type = LayerEventType::PostTime;
+        int32_t layerId = 0;
+        uint64_t frameNumber = 0;
+        nsecs_t time = 0;
+        std::shared_ptr<FenceTime> fence;
+        // PostTime and JankyFrames
+        std::string layerName;
+        uid_t uid = 0;
+        GameMode gameMode = GameMode::Unsupported;
+        // LatchSkipped
+        LatchSkipReason latchSkipReason = LatchSkipReason::LateAcquire;
+        // PresentTime, PresentFence and JankyFrames
+        Fps displayRefreshRate;
+        std::optional<Fps> renderRate;
+        SetFrameRateVote frameRateVote;
+        // JankyFrames
+        int32_t jankReasons = 0;
+        nsecs_t displayDeadlineDelta = 0;
+        nsecs_t displayPresentJitter = 0;
+        nsecs_t appDeadlineDelta = 0;
+    };
+
+    struct LayerEventBuffer;
+    class LayerEventWriter;
+
 public:
     TimeStats();
     // For testing only for injecting custom dependencies.
     TimeStats(std::optional<size_t> maxPulledLayers,
               std::optional<size_t> maxPulledHistogramBuckets);
+    ~TimeStats() override;
 
     bool onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) override;
     void parseArgs(bool asProto, const Vector<String16>& args, std::string& result) override;
@@ -287,10 +336,41 @@ public:
     void pushCompositionStrategyState(const ClientCompositionRecord&) override;
 
     static const size_t MAX_NUM_TIME_RECORDS = 64;
+    // Number of events each thread can record before they are applied. The aggregation thread is
+    // woken up well before it's full; if it falls behind, the recording thread applies the events.
+    static const size_t LAYER_EVENT_BUFFER_CAPACITY = 256;
 
 private:
     bool populateGlobalAtom(std::vector<uint8_t>* pulledData);
     bool populateLayerAtom(std::vector<uint8_t>* pulledData);
+
+    LayerEventBuffer& getLayerEventBuffer();
+    void wakeAggregationThread();
+    void aggregationLoop();
+    // Applies up to |maxEvents| recorded events, in the order they were recorded. Returns whether
+    // there are more events ready to be applied.
+    bool applyLayerEventsLocked(size_t maxEvents = SIZE_MAX);
+    void applyLayerEventLocked(LayerEvent& event);
+
+    void setPostTimeLocked(int32_t layerId, uint64_t frameNumber, const std::string& layerName,
+                           uid_t uid, nsecs_t postTime, GameMode);
+    void setLatchTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t latchTime);
+    void incrementLatchSkippedLocked(int32_t layerId, LatchSkipReason reason);
+    void incrementBadDesiredPresentLocked(int32_t layerId);
+    void setDesiredTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t desiredTime);
+    void setAcquireTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t acquireTime);
+    void setAcquireFenceLocked(int32_t layerId, uint64_t frameNumber,
+                               const std::shared_ptr<FenceTime>& acquireFence);
+    void setPresentTimeLocked(int32_t layerId, uint64_t frameNumber, nsecs_t presentTime,
+                              Fps displayRefreshRate, std::optional<Fps> renderRate,
+                              SetFrameRateVote, GameMode);
+    void setPresentFenceLocked(int32_t layerId, uint64_t frameNumber,
+                               const std::shared_ptr<FenceTime>& presentFence,
+                               Fps displayRefreshRate, std::optional<Fps> renderRate,
+                               SetFrameRateVote, GameMode);
+    void incrementJankyFramesLocked(const JankyFramesInfo& info);
+    void removeTimeRecordLocked(int32_t layerId, uint64_t frameNumber);
+
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
     void flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
                                             std::optional<Fps> renderRate, SetFrameRateVote,
@@ -322,6 +402,26 @@ private:
     static const size_t MAX_NUM_PULLED_LAYERS = MAX_NUM_LAYER_STATS;
     size_t mMaxPulledLayers = MAX_NUM_PULLED_LAYERS;
     size_t mMaxPulledHistogramBuckets = 6;
+
+    // The per layer calls, made every frame by the main thread and the binder threads, only
+    // record an event in a buffer of the calling thread, without locking. The events are applied
+    // under mMutex by the aggregation thread, and before the stats are read.
+    const uint64_t mInstanceId;
+    std::mutex mLayerEventBuffersMutex;
+    // Buffers by thread id, guarded by mLayerEventBuffersMutex. They are allocated when a thread
+    // first records an event, and only removed by applyLayerEventsLocked() once abandoned and
+    // empty, so that the pointers can be used under mMutex without holding the lock.
+    std::unordered_map<pid_t, std::shared_ptr<LayerEventBuffer>> mLayerEventBuffers;
+    // Orders the events of all the threads.
+    std::atomic<uint64_t> mNextLayerEventSequence = 0;
+    // Sequence of the next event to apply, guarded by mMutex.
+    uint64_t mNextAppliedLayerEventSequence = 0;
+    // Reused by applyLayerEventsLocked().
+    std::vector<LayerEventBuffer*> mLayerEventBuffersToApply;
+
+    std::thread mAggregationThread;
+    std::atomic<uint32_t> mAggregationWakeups = 0;
+    std::atomic<bool> mStopAggregation = false;
 };
 
 } // namespace impl
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace android {
+
+// Single producer single consumer ring of preallocated slots. The slots are never destroyed, so
+// they keep whatever they own, like the capacity of a vector, from one use to the next.
+//
+// The producer fills the slot returned by beginPush() and publishes it with endPush(). The consumer
+// reads the slot returned by front() in place, and hands it back with pop(). Each index is only
+// written by one side; the release stores make the slot contents visible to the side that
+// acquires the index.
+template <typename T, size_t Capacity>
+class LocklessRing {
+public:
+    // Producer only. Returns the next free slot, or nullptr if the ring is full.
+    T* beginPush() {
+        const size_t head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) == Capacity) {
+            return nullptr;
+        }
+        return &mSlots[head % Capacity];
+    }
+
+    // Producer only. Publishes the slot returned by beginPush().
+    void endPush() {
+        mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer only. Returns the oldest published slot, or nullptr if the ring is empty.
+    T* front() {
+        const size_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &mSlots[tail % Capacity];
+    }
+
+    // Consumer only. Hands the slot returned by front() back to the producer.
+    void pop() {
+        mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    std::array<T, Capacity> mSlots;
+    // On separate cache lines, so that each side doesn't invalidate the other's index.
+    alignas(64) std::atomic<size_t> mHead = 0;
+    alignas(64) std::atomic<size_t> mTail = 0;
+};
+
+} // namespace android
@@ -37,25 +37,20 @@ TransactionTracing::TransactionTracing()
 
     mStartingTimestamp = systemTime();
 
-    {
-        std::scoped_lock lock(mMainThreadLock);
-        mThread = std::thread(&TransactionTracing::loop, this);
-    }
+    mThread = std::thread(&TransactionTracing::loop, this);
 
     TransactionDataSource::Initialize(*this);
 }
 
 TransactionTracing::~TransactionTracing() {
     TransactionDataSource::UnregisterTransactionTracing();
-    std::thread thread;
-    {
-        std::scoped_lock lock(mMainThreadLock);
-        mDone = true;
-        mTransactionsAvailableCv.notify_all();
-        thread = std::move(mThread);
+    mDone = true;
+    wakeTracingThread();
+    if (mThread.joinable()) {
+        mThread.join();
     }
-    if (thread.joinable()) {
-        thread.join();
+    while (perfetto::protos::TransactionState* transaction = mTransactionQueue.pop()) {
+        delete transaction;
     }
 }
 
@@ -163,10 +158,15 @@ void TransactionTracing::dump(std::string& result) const {
     std::scoped_lock lock(mTraceLock);
     base::StringAppendF(&result, "  queued transactions=%zu created layers=%zu states=%zu\n",
                         mQueuedTransactions.size(), mCreatedLayers.size(), mStartingStates.size());
+    base::StringAppendF(&result, "  handoff ring full=%" PRIu64 "\n",
+                        mHandoffRingFullCount.load(std::memory_order_relaxed));
     mBuffer.dump(result);
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
+    // Serialize on the binder thread: the proto only keeps the traced fields and layer ids, while a
+    // copy of the TransactionState would keep buffers, layer handles and listeners alive until the
+    // tracing thread gets to it.
     perfetto::protos::TransactionState* state =
             new perfetto::protos::TransactionState(mProtoParser.toProto(transaction));
     mTransactionQueue.push(state);
@@ -193,39 +193,36 @@ void TransactionTracing::addCommittedTransactions(int64_t vsyncId, nsecs_t commi
     for (auto& [handle, _] : newUpdate.destroyedHandles) {
         update.destroyedLayerHandles.push_back(handle);
     }
-    mPendingUpdates.emplace_back(update);
+    mPendingUpdates.emplace_back(std::move(update));
     tryPushToTracingThread();
     mLastUpdatedVsyncId = vsyncId;
 }
 
 void TransactionTracing::loop() {
     while (true) {
-        std::vector<CommittedUpdates> committedUpdates;
-        std::vector<uint32_t> destroyedLayers;
-        {
-            std::unique_lock<std::mutex> lock(mMainThreadLock);
-            base::ScopedLockAssertion assumeLocked(mMainThreadLock);
-            mTransactionsAvailableCv.wait(lock, [&]() REQUIRES(mMainThreadLock) {
-                return mDone || !mUpdates.empty();
-            });
-            if (mDone) {
-                mUpdates.clear();
-                mDestroyedLayers.clear();
-                break;
+        // Read before draining, so a batch pushed after the ring is seen empty still wakes us up.
+        const uint32_t wakeups = mWakeups.load(std::memory_order_acquire);
+        while (HandoffBatch* batch = mHandoffRing.front()) {
+            if (!batch->updates.empty() || !batch->destroyedLayers.empty()) {
+                addEntry(batch->updates, batch->destroyedLayers);
             }
-
-            destroyedLayers = std::move(mDestroyedLayers);
-            mDestroyedLayers.clear();
-            committedUpdates = std::move(mUpdates);
-            mUpdates.clear();
-        } // unlock mMainThreadLock
-
-        if (!committedUpdates.empty() || !destroyedLayers.empty()) {
-            addEntry(committedUpdates, destroyedLayers);
+            // Keep the capacity for the main thread to reuse.
+            batch->updates.clear();
+            batch->destroyedLayers.clear();
+            mHandoffRing.pop();
         }
+        if (mDone) {
+            break;
+        }
+        mWakeups.wait(wakeups, std::memory_order_acquire);
     }
 }
 
+void TransactionTracing::wakeTracingThread() {
+    mWakeups.fetch_add(1, std::memory_order_release);
+    mWakeups.notify_one();
+}
+
 void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committedUpdates,
                                   const std::vector<uint32_t>& destroyedLayers) {
     std::scoped_lock lock(mTraceLock);
@@ -233,8 +230,8 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
     perfetto::protos::TransactionTraceEntry entryProto;
 
     while (auto incomingTransaction = mTransactionQueue.pop()) {
-        auto transaction = *incomingTransaction;
-        mQueuedTransactions[incomingTransaction->transaction_id()] = transaction;
+        const uint64_t transactionId = incomingTransaction->transaction_id();
+        mQueuedTransactions[transactionId] = std::move(*incomingTransaction);
         delete incomingTransaction;
     }
     for (const CommittedUpdates& update : committedUpdates) {
@@ -322,16 +319,10 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
 }
 
 void TransactionTracing::flush() {
-    {
-        std::scoped_lock lock(mMainThreadLock);
-        // Collect any pending transactions and wait for transactions to be added to
-        mUpdates.insert(mUpdates.end(), std::make_move_iterator(mPendingUpdates.begin()),
-                        std::make_move_iterator(mPendingUpdates.end()));
-        mPendingUpdates.clear();
-        mDestroyedLayers.insert(mDestroyedLayers.end(), mPendingDestroyedLayers.begin(),
-                                mPendingDestroyedLayers.end());
-        mPendingDestroyedLayers.clear();
-        mTransactionsAvailableCv.notify_one();
+    // Push any pending transactions and wait for transactions to be added to the buffer. The ring
+    // only stays full until the tracing thread catches up.
+    while (!tryPushToTracingThread()) {
+        std::this_thread::yield();
     }
     std::unique_lock<std::mutex> lock(mTraceLock);
     base::ScopedLockAssertion assumeLocked(mTraceLock);
@@ -351,21 +342,23 @@ void TransactionTracing::onLayerRemoved(int32_t layerId) {
     tryPushToTracingThread();
 }
 
-void TransactionTracing::tryPushToTracingThread() {
-    // Try to acquire the lock from main thread.
-    if (mMainThreadLock.try_lock()) {
-        // We got the lock! Collect any pending transactions and continue.
-        mUpdates.insert(mUpdates.end(), std::make_move_iterator(mPendingUpdates.begin()),
-                        std::make_move_iterator(mPendingUpdates.end()));
-        mPendingUpdates.clear();
-        mDestroyedLayers.insert(mDestroyedLayers.end(), mPendingDestroyedLayers.begin(),
-                                mPendingDestroyedLayers.end());
-        mPendingDestroyedLayers.clear();
-        mTransactionsAvailableCv.notify_one();
-        mMainThreadLock.unlock();
-    } else {
-        ALOGV("Couldn't get lock");
+bool TransactionTracing::tryPushToTracingThread() {
+    if (mPendingUpdates.empty() && mPendingDestroyedLayers.empty()) {
+        return true;
+    }
+    HandoffBatch* batch = mHandoffRing.beginPush();
+    if (!batch) {
+        // The tracing thread is behind; keep the pending data for the next push.
+        mHandoffRingFullCount.fetch_add(1, std::memory_order_relaxed);
+        ALOGV("Handoff ring is full");
+        return false;
     }
+    // The slot was cleared by the tracing thread, so the pending containers get its capacity.
+    std::swap(batch->updates, mPendingUpdates);
+    std::swap(batch->destroyedLayers, mPendingDestroyedLayers);
+    mHandoffRing.endPush();
+    wakeTracingThread();
+    return true;
 }
 
 void TransactionTracing::updateStartingStateLocked(
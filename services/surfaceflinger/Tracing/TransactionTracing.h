@@ -22,6 +22,7 @@
 #include <utils/Singleton.h>
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <mutex>
 #include <optional>
 #include <set>
@@ -30,6 +31,7 @@
 #include "FrontEnd/DisplayInfo.h"
 #include "FrontEnd/LayerCreationArgs.h"
 #include "FrontEnd/Update.h"
+#include "LocklessRing.h"
 #include "LocklessStack.h"
 #include "TransactionProtoParser.h"
 #include "TransactionRingBuffer.h"
@@ -46,9 +48,10 @@ class TransactionTracingTest;
  *
  * Transactions come in via the binder thread. They are serialized to proto
  * and stored in a map using the transaction id as key. Main thread will
- * pass the list of transaction ids that are committed every vsync and notify
- * the tracing thread. The tracing thread will then wake up and add the
- * committed transactions to the ring buffer.
+ * pass the list of transaction ids that are committed every vsync through a
+ * lockless ring and notify the tracing thread. The tracing thread will then
+ * wake up and add the committed transactions to the ring buffer. Neither the
+ * binder threads nor the main thread take a lock.
  *
  * The traced data can then be collected via:
  * - Perfetto (preferred).
@@ -139,12 +142,12 @@ public:
                                   const frontend::DisplayInfos&, bool displayInfoChanged);
     status_t writeToFile(const std::string& filename = FILE_PATH);
     // Return buffer contents as trace file proto
-    perfetto::protos::TransactionTraceFile writeToProto() EXCLUDES(mMainThreadLock);
+    perfetto::protos::TransactionTraceFile writeToProto();
     void setBufferSize(size_t bufferSizeInBytes);
     void onLayerRemoved(int layerId);
     void dump(std::string&) const;
     // Wait until all the committed transactions for the specified vsync id are added to the buffer.
-    void flush() EXCLUDES(mMainThreadLock);
+    void flush();
 
     static constexpr auto CONTINUOUS_TRACING_BUFFER_SIZE = 512 * 1024;
     static constexpr auto LEGACY_ACTIVE_TRACING_BUFFER_SIZE = 100 * 1024 * 1024;
@@ -179,12 +182,8 @@ private:
     std::set<uint32_t /* layerId */> mRemovedLayerHandlesAtStart GUARDED_BY(mTraceLock);
     TransactionProtoParser mProtoParser;
 
-    // We do not want main thread to block so main thread will try to acquire mMainThreadLock,
-    // otherwise will push data to temporary container.
-    std::mutex mMainThreadLock;
-    std::thread mThread GUARDED_BY(mMainThreadLock);
-    bool mDone GUARDED_BY(mMainThreadLock) = false;
-    std::condition_variable mTransactionsAvailableCv;
+    std::thread mThread;
+    std::atomic<bool> mDone = false;
     std::condition_variable mTransactionsAddedToBufferCv;
     struct CommittedUpdates {
         std::vector<uint64_t> transactionIds;
@@ -195,10 +194,21 @@ private:
         int64_t vsyncId;
         int64_t timestamp;
     };
-    std::vector<CommittedUpdates> mUpdates GUARDED_BY(mMainThreadLock);
+    // What the main thread hands to the tracing thread at once. The vectors are swapped with the
+    // pending ones, so their capacity is reused instead of being allocated every frame.
+    struct HandoffBatch {
+        std::vector<CommittedUpdates> updates;
+        std::vector<uint32_t /* layerId */> destroyedLayers;
+    };
+    static constexpr size_t HANDOFF_RING_CAPACITY = 64;
+    // We do not want main thread to block, so if the tracing thread is behind and the ring is
+    // full, the main thread keeps the data in the pending containers until the next push.
+    LocklessRing<HandoffBatch, HANDOFF_RING_CAPACITY> mHandoffRing;
+    // Incremented for each batch pushed, and to stop the tracing thread, which waits on it.
+    std::atomic<uint32_t> mWakeups = 0;
+    std::atomic<uint64_t> mHandoffRingFullCount = 0;
     std::vector<CommittedUpdates> mPendingUpdates; // only accessed by main thread
 
-    std::vector<uint32_t /* layerId */> mDestroyedLayers GUARDED_BY(mMainThreadLock);
     std::vector<uint32_t /* layerId */> mPendingDestroyedLayers; // only accessed by main thread
     int64_t mLastUpdatedVsyncId = -1;
 
@@ -208,7 +218,9 @@ private:
     void addEntry(const std::vector<CommittedUpdates>& committedTransactions,
                   const std::vector<uint32_t>& removedLayers) EXCLUDES(mTraceLock);
     int32_t getLayerIdLocked(const sp<IBinder>& layerHandle) REQUIRES(mTraceLock);
-    void tryPushToTracingThread() EXCLUDES(mMainThreadLock);
+    // Returns false if the pending data couldn't be pushed because the ring is full.
+    bool tryPushToTracingThread();
+    void wakeTracingThread();
     std::optional<perfetto::protos::TransactionTraceEntry> createStartingStateProtoLocked()
             REQUIRES(mTraceLock);
     void updateStartingStateLocked(const perfetto::protos::TransactionTraceEntry& entry)
@@ -0,0 +1,388 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayersTraceDelta"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "LayersTraceDelta.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <string_view>
+#include <unordered_set>
+
+namespace android {
+
+namespace {
+
+using Fields = LayersTraceDeltaState::Fields;
+
+constexpr uint32_t kSnapshotLayersField = perfetto::protos::LayersSnapshotProto::kLayersFieldNumber;
+constexpr uint32_t kLayersLayerField = perfetto::protos::LayersProto::kLayersFieldNumber;
+
+enum WireType : uint32_t {
+    WIRE_TYPE_VARINT = 0,
+    WIRE_TYPE_FIXED64 = 1,
+    WIRE_TYPE_LENGTH_DELIMITED = 2,
+    WIRE_TYPE_FIXED32 = 5,
+};
+
+bool readVarint(std::string_view bytes, size_t& pos, uint64_t& outValue) {
+    outValue = 0;
+    for (uint32_t shift = 0; shift < 64 && pos < bytes.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(bytes[pos++]);
+        outValue |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeVarint(uint64_t value, std::string& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void writeLengthDelimited(uint32_t fieldNumber, std::string_view payload, std::string& out) {
+    writeVarint(fieldNumber << 3 | WIRE_TYPE_LENGTH_DELIMITED, out);
+    writeVarint(payload.size(), out);
+    out.append(payload);
+}
+
+// Calls |visitor| with the number, the bytes and the payload of each top level field of a
+// serialized message. The payload is only set for length delimited fields. Returns false if the
+// message is malformed, or if it has groups.
+template <typename Visitor>
+bool visitFields(std::string_view bytes, Visitor&& visitor) {
+    size_t pos = 0;
+    while (pos < bytes.size()) {
+        const size_t start = pos;
+        uint64_t tag;
+        if (!readVarint(bytes, pos, tag) || (tag >> 3) == 0 || (tag >> 3) > UINT32_MAX) {
+            return false;
+        }
+        std::string_view payload;
+        uint64_t value;
+        switch (tag & 7) {
+            case WIRE_TYPE_VARINT:
+                if (!readVarint(bytes, pos, value)) return false;
+                break;
+            case WIRE_TYPE_FIXED64:
+                pos += 8;
+                break;
+            case WIRE_TYPE_LENGTH_DELIMITED:
+                if (!readVarint(bytes, pos, value) || value > bytes.size() - pos) return false;
+                payload = bytes.substr(pos, static_cast<size_t>(value));
+                pos += static_cast<size_t>(value);
+                break;
+            case WIRE_TYPE_FIXED32:
+                pos += 4;
+                break;
+            default:
+                return false;
+        }
+        if (pos > bytes.size()) {
+            return false;
+        }
+        visitor(static_cast<uint32_t>(tag >> 3), bytes.substr(start, pos - start), payload);
+    }
+    return true;
+}
+
+bool parseFields(std::string_view bytes, Fields& outFields) {
+    return visitFields(bytes, [&](uint32_t number, std::string_view field, std::string_view) {
+        outFields[number].append(field);
+    });
+}
+
+std::string joinFields(const Fields& fields) {
+    size_t size = 0;
+    for (const auto& [number, field] : fields) {
+        size += field.size();
+    }
+    std::string bytes;
+    bytes.reserve(size);
+    for (const auto& [number, field] : fields) {
+        bytes.append(field);
+    }
+    return bytes;
+}
+
+// Splits a serialized LayersSnapshotProto into |outState|. Returns false if it can't be delta
+// encoded, in which case it is written as a keyframe.
+bool splitSnapshot(const perfetto::protos::LayersSnapshotProto& snapshot, std::string_view bytes,
+                   LayersTraceDeltaState& outState) {
+    std::vector<std::string_view> layers;
+    bool layersValid = true;
+    auto visitLayer = [&](uint32_t number, std::string_view, std::string_view layer) {
+        layersValid &= number == kLayersLayerField;
+        layers.push_back(layer);
+    };
+    auto visitSnapshotField = [&](uint32_t number, std::string_view field,
+                                  std::string_view payload) {
+        if (number != kSnapshotLayersField) {
+            outState.snapshot[number].append(field);
+            return;
+        }
+        layersValid &= visitFields(payload, visitLayer);
+        // Stands for the layers, which are kept apart.
+        auto& placeholder = outState.snapshot[number];
+        placeholder.clear();
+        writeLengthDelimited(number, {}, placeholder);
+    };
+    if (!visitFields(bytes, visitSnapshotField) || !layersValid ||
+        layers.size() != static_cast<size_t>(snapshot.layers().layers_size())) {
+        return false;
+    }
+
+    outState.layerOrder.reserve(layers.size());
+    outState.layers.reserve(layers.size());
+    for (size_t i = 0; i < layers.size(); i++) {
+        const int32_t id = snapshot.layers().layers(static_cast<int>(i)).id();
+        auto [it, inserted] = outState.layers.try_emplace(id);
+        // Layers are matched by id, so they have to be unique.
+        if (!inserted || !parseFields(layers[i], it->second)) {
+            return false;
+        }
+        outState.layerOrder.push_back(id);
+    }
+    return true;
+}
+
+std::string joinSnapshot(const LayersTraceDeltaState& state) {
+    auto snapshot = state.snapshot;
+    if (auto it = snapshot.find(kSnapshotLayersField); it != snapshot.end()) {
+        std::string layers;
+        for (int32_t id : state.layerOrder) {
+            writeLengthDelimited(kLayersLayerField, joinFields(state.layers.at(id)), layers);
+        }
+        it->second.clear();
+        writeLengthDelimited(kSnapshotLayersField, layers, it->second);
+    }
+    return joinFields(snapshot);
+}
+
+void diffFields(const Fields& from, const Fields& to, surfaceflinger::FieldsDeltaProto& outDelta) {
+    for (const auto& [number, field] : to) {
+        auto it = from.find(number);
+        if (it == from.end() || it->second != field) {
+            outDelta.mutable_changed_fields()->append(field);
+        }
+    }
+    for (const auto& [number, field] : from) {
+        if (to.find(number) == to.end()) {
+            outDelta.add_cleared_fields(number);
+        }
+    }
+}
+
+bool applyFields(const surfaceflinger::FieldsDeltaProto& delta, Fields& fields) {
+    for (uint32_t number : delta.cleared_fields()) {
+        fields.erase(number);
+    }
+    Fields changed;
+    if (!parseFields(delta.changed_fields(), changed)) {
+        return false;
+    }
+    for (auto& [number, field] : changed) {
+        fields[number] = std::move(field);
+    }
+    return true;
+}
+
+surfaceflinger::LayersSnapshotDeltaProto diffSnapshots(const LayersTraceDeltaState& from,
+                                                       const LayersTraceDeltaState& to) {
+    surfaceflinger::LayersSnapshotDeltaProto delta;
+    diffFields(from.snapshot, to.snapshot, *delta.mutable_snapshot());
+
+    // The order the layers are in if it's left out of the delta: the previous order without the
+    // removed layers, followed by the added layers.
+    std::vector<int32_t> order;
+    order.reserve(to.layerOrder.size());
+    for (int32_t id : from.layerOrder) {
+        if (to.layers.count(id) == 0) {
+            delta.add_removed_layer_ids(id);
+        } else {
+            order.push_back(id);
+        }
+    }
+
+    for (int32_t id : to.layerOrder) {
+        const auto& fields = to.layers.at(id);
+        auto it = from.layers.find(id);
+        if (it == from.layers.end()) {
+            order.push_back(id);
+            auto* layer = delta.add_changed_layers();
+            layer->set_id(id);
+            diffFields({}, fields, *layer->mutable_fields());
+            continue;
+        }
+        if (it->second == fields) {
+            continue;
+        }
+        auto* layer = delta.add_changed_layers();
+        layer->set_id(id);
+        diffFields(it->second, fields, *layer->mutable_fields());
+    }
+
+    if (order != to.layerOrder) {
+        delta.mutable_layer_order()->Add(to.layerOrder.begin(), to.layerOrder.end());
+    }
+    return delta;
+}
+
+bool applyDelta(const surfaceflinger::LayersSnapshotDeltaProto& delta,
+                LayersTraceDeltaState& state) {
+    if (!applyFields(delta.snapshot(), state.snapshot)) {
+        return false;
+    }
+
+    std::unordered_set<int32_t> removedIds(delta.removed_layer_ids().begin(),
+                                           delta.removed_layer_ids().end());
+    for (int32_t id : removedIds) {
+        state.layers.erase(id);
+    }
+    if (!removedIds.empty()) {
+        std::erase_if(state.layerOrder, [&](int32_t id) { return removedIds.count(id) != 0; });
+    }
+
+    for (const auto& layer : delta.changed_layers()) {
+        auto [it, inserted] = state.layers.try_emplace(layer.id());
+        if (inserted) {
+            state.layerOrder.push_back(layer.id());
+        }
+        if (!applyFields(layer.fields(), it->second)) {
+            return false;
+        }
+    }
+
+    if (delta.layer_order_size() > 0) {
+        if (static_cast<size_t>(delta.layer_order_size()) != state.layers.size()) {
+            return false;
+        }
+        for (int32_t id : delta.layer_order()) {
+            if (state.layers.count(id) == 0) {
+                return false;
+            }
+        }
+        state.layerOrder.assign(delta.layer_order().begin(), delta.layer_order().end());
+    }
+    return true;
+}
+
+} // namespace
+
+LayersTraceDeltaEncoder::LayersTraceDeltaEncoder(size_t keyframeInterval)
+      : mKeyframeInterval(keyframeInterval) {}
+
+surfaceflinger::LayersDeltaEntryProto LayersTraceDeltaEncoder::encode(
+        const perfetto::protos::LayersSnapshotProto& snapshot) {
+    ATRACE_CALL();
+    std::string bytes = snapshot.SerializeAsString();
+    LayersTraceDeltaState current;
+    const bool split = splitSnapshot(snapshot, bytes, current);
+
+    surfaceflinger::LayersDeltaEntryProto entry;
+    if (split && mPrevious && mEntriesSinceKeyframe + 1 < mKeyframeInterval) {
+        auto delta = diffSnapshots(*mPrevious, current);
+        // A snapshot where most layers changed isn't worth a delta.
+        if (delta.ByteSizeLong() < bytes.size()) {
+            *entry.mutable_delta() = std::move(delta);
+            mEntriesSinceKeyframe++;
+        }
+    }
+    if (!entry.has_delta()) {
+        entry.set_keyframe(std::move(bytes));
+        mEntriesSinceKeyframe = 0;
+    }
+
+    if (split) {
+        mPrevious = std::move(current);
+    } else {
+        mPrevious.reset();
+    }
+    return entry;
+}
+
+std::optional<perfetto::protos::LayersSnapshotProto> LayersTraceDeltaDecoder::decode(
+        const surfaceflinger::LayersDeltaEntryProto& entry) {
+    ATRACE_CALL();
+    perfetto::protos::LayersSnapshotProto snapshot;
+    if (entry.has_keyframe()) {
+        if (!snapshot.ParseFromString(entry.keyframe())) {
+            mPrevious.reset();
+            return std::nullopt;
+        }
+        LayersTraceDeltaState state;
+        if (splitSnapshot(snapshot, entry.keyframe(), state)) {
+            mPrevious = std::move(state);
+        } else {
+            mPrevious.reset();
+        }
+        return snapshot;
+    }
+
+    if (!entry.has_delta() || !mPrevious || !applyDelta(entry.delta(), *mPrevious) ||
+        !snapshot.ParseFromString(joinSnapshot(*mPrevious))) {
+        mPrevious.reset();
+        return std::nullopt;
+    }
+    return snapshot;
+}
+
+void encodeLayersDeltaTrace(const perfetto::protos::LayersTraceFileProto& trace,
+                            surfaceflinger::LayersDeltaTraceFileProto& outTrace,
+                            size_t keyframeInterval) {
+    outTrace.set_magic_number(
+            static_cast<uint64_t>(
+                    surfaceflinger::LayersDeltaTraceFileProto_MagicNumber_MAGIC_NUMBER_H)
+                    << 32 |
+            surfaceflinger::LayersDeltaTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
+    outTrace.set_real_to_elapsed_time_offset_nanos(trace.real_to_elapsed_time_offset_nanos());
+
+    LayersTraceDeltaEncoder encoder(keyframeInterval);
+    for (const auto& snapshot : trace.entry()) {
+        *outTrace.add_entry() = encoder.encode(snapshot);
+    }
+}
+
+bool expandLayersDeltaTrace(const surfaceflinger::LayersDeltaTraceFileProto& trace,
+                            perfetto::protos::LayersTraceFileProto& outTrace) {
+    outTrace.set_magic_number(
+            static_cast<uint64_t>(perfetto::protos::LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_H)
+                    << 32 |
+            perfetto::protos::LayersTraceFileProto_MagicNumber_MAGIC_NUMBER_L);
+    outTrace.set_real_to_elapsed_time_offset_nanos(trace.real_to_elapsed_time_offset_nanos());
+
+    LayersTraceDeltaDecoder decoder;
+    for (int i = 0; i < trace.entry_size(); i++) {
+        auto snapshot = decoder.decode(trace.entry(i));
+        if (!snapshot) {
+            ALOGE("Failed to decode entry %d", i);
+            return false;
+        }
+        *outTrace.add_entry() = std::move(*snapshot);
+    }
+    return true;
+}
+
+} // namespace android
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <layerproto/LayerProtoHeader.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+/*
+ * Delta encoding of layers traces.
+ *
+ * Most layers don't change from one snapshot to the next, so instead of writing every snapshot in
+ * full, a keyframe is written every few entries and the entries in between only hold the layers
+ * that were added, removed or changed since the previous entry.
+ *
+ * Snapshots are compared on their serialized form, one top level field at a time: a layer delta
+ * holds the fields of the LayerProto that changed, whole. This doesn't need reflection, which the
+ * lite runtime doesn't have, and reconstructs the snapshots exactly, including fields added to
+ * the protos later on.
+ *
+ * This is an offline conversion of a layers trace that was already written in full: it is not used
+ * on device. layertracegenerator --delta encodes the layers trace it generates, and
+ * layerstracedelta expands it back. LayerTracing always writes full snapshots, to perfetto or to
+ * a stream, since the perfetto schema of the layers snapshot packets lives in external/perfetto.
+ */
+struct LayersTraceDeltaState {
+    // Top level fields of a serialized message, by field number. Each value holds all the
+    // occurrences of the field, tags included.
+    using Fields = std::map<uint32_t, std::string>;
+
+    // Fields of the snapshot. The layers are replaced by an empty LayersProto.
+    Fields snapshot;
+    std::unordered_map<int32_t, Fields> layers;
+    std::vector<int32_t> layerOrder;
+};
+
+class LayersTraceDeltaEncoder {
+public:
+    static constexpr size_t kDefaultKeyframeInterval = 64;
+
+    explicit LayersTraceDeltaEncoder(size_t keyframeInterval = kDefaultKeyframeInterval);
+
+    // Encodes |snapshot| as a delta from the previous snapshot encoded, or as a keyframe.
+    surfaceflinger::LayersDeltaEntryProto encode(
+            const perfetto::protos::LayersSnapshotProto& snapshot);
+
+private:
+    const size_t mKeyframeInterval;
+    size_t mEntriesSinceKeyframe = 0;
+    std::optional<LayersTraceDeltaState> mPrevious;
+};
+
+class LayersTraceDeltaDecoder {
+public:
+    // Returns the snapshot |entry| was encoded from, or nullopt if it is malformed or if it is a
+    // delta that doesn't follow a keyframe.
+    std::optional<perfetto::protos::LayersSnapshotProto> decode(
+            const surfaceflinger::LayersDeltaEntryProto& entry);
+
+private:
+    std::optional<LayersTraceDeltaState> mPrevious;
+};
+
+// Encodes all the entries of a layers trace into |outTrace|.
+void encodeLayersDeltaTrace(
+        const perfetto::protos::LayersTraceFileProto& trace,
+        surfaceflinger::LayersDeltaTraceFileProto& outTrace,
+        size_t keyframeInterval = LayersTraceDeltaEncoder::kDefaultKeyframeInterval);
+
+// Expands all the entries of a delta encoded trace into |outTrace|.
+bool expandLayersDeltaTrace(const surfaceflinger::LayersDeltaTraceFileProto& trace,
+                            perfetto::protos::LayersTraceFileProto& outTrace);
+
+} // namespace android
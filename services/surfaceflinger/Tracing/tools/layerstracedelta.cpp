@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayersTraceDelta"
+
+#include <fstream>
+#include <iostream>
+
+#include "LayersTraceDelta.h"
+#include <log/log.h>
+
+using namespace android;
+
+// Expands a delta encoded layers trace, as written by layertracegenerator --delta, into a regular
+// layers trace.
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [delta-layers-trace-path] [output-layers-trace-path]\n";
+        return -1;
+    }
+
+    std::fstream input(argv[1], std::ios::in | std::ios::binary);
+    if (!input) {
+        std::cerr << "Error: Could not open " << argv[1] << "\n";
+        return -1;
+    }
+
+    surfaceflinger::LayersDeltaTraceFileProto deltaTrace;
+    if (!deltaTrace.ParseFromIstream(&input)) {
+        std::cerr << "Error: Failed to parse " << argv[1] << "\n";
+        return -1;
+    }
+
+    perfetto::protos::LayersTraceFileProto layersTrace;
+    if (!expandLayersDeltaTrace(deltaTrace, layersTrace)) {
+        std::cerr << "Error: Failed to expand " << argv[1] << "\n";
+        return -1;
+    }
+
+    std::ofstream output(argv[2], std::ios::binary | std::ios::out);
+    if (!layersTrace.SerializeToOstream(&output)) {
+        std::cerr << "Error: Failed to write " << argv[2] << "\n";
+        return -1;
+    }
+    ALOGD("Expanded %d entries to %s", layersTrace.entry_size(), argv[2]);
+    return 0;
+}
@@ -19,17 +19,20 @@
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 #include <Tracing/LayerTracing.h>
 #include "LayerTraceGenerator.h"
+#include "LayersTraceDelta.h"
 
 using namespace android;
 
 int main(int argc, char** argv) {
-    if (argc > 4) {
+    if (argc > 5) {
         std::cout << "Usage: " << argv[0]
-                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n";
+                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]"
+                     " [--delta]\n";
         return -1;
     }
 
@@ -49,13 +52,20 @@ int main(int argc, char** argv) {
     }
 
     const auto* outputLayersTracePath =
-            (argc == 3) ? argv[2] : "/data/misc/wmtrace/layers_trace.winscope";
+            (argc >= 3) ? argv[2] : "/data/misc/wmtrace/layers_trace.winscope";
     auto outStream = std::ofstream{outputLayersTracePath, std::ios::binary | std::ios::out};
 
-    auto layerTracing = LayerTracing{outStream};
+    bool generateLastEntryOnly = false;
+    bool deltaEncoded = false;
+    for (int i = 3; i < argc; i++) {
+        generateLastEntryOnly |= std::string_view(argv[i]) == "--last-entry-only";
+        deltaEncoded |= std::string_view(argv[i]) == "--delta";
+    }
 
-    const bool generateLastEntryOnly =
-            argc >= 4 && std::string_view(argv[3]) == "--last-entry-only";
+    // The delta encoding is applied to the whole layers trace once it's generated.
+    std::stringstream fullStream;
+    auto layerTracing = LayerTracing{deltaEncoded ? static_cast<std::ostream&>(fullStream)
+                                                  : outStream};
 
     auto traceFlags = LayerTracing::Flag::TRACE_INPUT | LayerTracing::Flag::TRACE_BUFFERS;
 
@@ -68,6 +78,20 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    if (deltaEncoded) {
+        perfetto::protos::LayersTraceFileProto layersTrace;
+        if (!layersTrace.ParseFromIstream(&fullStream)) {
+            std::cout << "Error: Failed to parse the generated layers trace\n";
+            return -1;
+        }
+        surfaceflinger::LayersDeltaTraceFileProto deltaTrace;
+        encodeLayersDeltaTrace(layersTrace, deltaTrace);
+        if (!deltaTrace.SerializeToOstream(&outStream)) {
+            std::cout << "Error: Failed to write " << outputLayersTracePath << "\n";
+            return -1;
+        }
+    }
+
     // Set output file permissions (-rw-r--r--)
     outStream.close();
     const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
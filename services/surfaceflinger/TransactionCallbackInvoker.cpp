@@ -35,17 +35,11 @@
 
 namespace android {
 
-// Returns 0 if they are equal
-//         <0 if the first id that doesn't match is lower in c2 or all ids match but c2 is shorter
-//         >0 if the first id that doesn't match is greater in c2 or all ids match but c2 is longer
-//
-// See CallbackIdsHash for a explanation of why this works
-static int compareCallbackIds(const std::vector<CallbackId>& c1,
-                              const std::vector<CallbackId>& c2) {
-    if (c1.empty()) {
-        return !c2.empty();
-    }
-    return c1.front().id - c2.front().id;
+// CallbackId vectors for the same listener either are identical or contain none of the same
+// members, so the first id identifies the transaction. CallbackIds are never 0, which is left for
+// transactions without callbacks. See CallbackIdsHash.
+static int64_t getTransactionKey(const std::vector<CallbackId>& callbackIds) {
+    return callbackIds.empty() ? 0 : callbackIds.front().id;
 }
 
 static bool containsOnCommitCallbacks(const std::vector<CallbackId>& callbacks) {
@@ -54,8 +48,7 @@ static bool containsOnCommitCallbacks(const std::vector<CallbackId>& callbacks)
 
 void TransactionCallbackInvoker::addEmptyTransaction(const ListenerCallbacks& listenerCallbacks) {
     auto& [listener, callbackIds] = listenerCallbacks;
-    auto& transactionStatsDeque = mCompletedTransactions[listener];
-    transactionStatsDeque.emplace_back(callbackIds);
+    mCompletedTransactions[listener].add(callbackIds);
 }
 
 status_t TransactionCallbackInvoker::addOnCommitCallbackHandles(
@@ -97,17 +90,14 @@ status_t TransactionCallbackInvoker::addCallbackHandles(
 status_t TransactionCallbackInvoker::findOrCreateTransactionStats(
         const sp<IBinder>& listener, const std::vector<CallbackId>& callbackIds,
         TransactionStats** outTransactionStats) {
-    auto& transactionStatsDeque = mCompletedTransactions[listener];
-
-    // Search back to front because the most recent transactions are at the back of the deque
-    auto itr = transactionStatsDeque.rbegin();
-    for (; itr != transactionStatsDeque.rend(); itr++) {
-        if (compareCallbackIds(itr->callbackIds, callbackIds) == 0) {
-            *outTransactionStats = &(*itr);
-            return NO_ERROR;
-        }
+    auto& listenerTransactions = mCompletedTransactions[listener];
+
+    const auto itr = listenerTransactions.indexByCallbackIds.find(getTransactionKey(callbackIds));
+    if (itr != listenerTransactions.indexByCallbackIds.end()) {
+        *outTransactionStats = &listenerTransactions.transactionStats[itr->second];
+        return NO_ERROR;
     }
-    *outTransactionStats = &transactionStatsDeque.emplace_back(callbackIds);
+    *outTransactionStats = &listenerTransactions.add(callbackIds);
     return NO_ERROR;
 }
 
@@ -166,7 +156,8 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
     auto completedTransactionsItr = mCompletedTransactions.begin();
     BackgroundExecutor::Callbacks callbacks;
     while (completedTransactionsItr != mCompletedTransactions.end()) {
-        auto& [listener, transactionStatsDeque] = *completedTransactionsItr;
+        auto& [listener, listenerTransactions] = *completedTransactionsItr;
+        auto& transactionStatsDeque = listenerTransactions.transactionStats;
         ListenerStats listenerStats;
         listenerStats.listener = listener;
 
@@ -191,6 +182,7 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
         }
         // If the listener has completed transactions
         if (!listenerStats.transactionStats.empty()) {
+            listenerTransactions.reindex();
             // If the listener is still alive
             if (listener->isBinderAlive()) {
                 // Send callback.  The listener stored in listenerStats
@@ -215,6 +207,19 @@ void TransactionCallbackInvoker::sendCallbacks(bool onCommitOnly) {
     BackgroundExecutor::getInstance().sendCallbacks(std::move(callbacks));
 }
 
+TransactionStats& TransactionCallbackInvoker::ListenerTransactions::add(
+        const std::vector<CallbackId>& callbackIds) {
+    indexByCallbackIds[getTransactionKey(callbackIds)] = transactionStats.size();
+    return transactionStats.emplace_back(callbackIds);
+}
+
+void TransactionCallbackInvoker::ListenerTransactions::reindex() {
+    indexByCallbackIds.clear();
+    for (size_t i = 0; i < transactionStats.size(); i++) {
+        indexByCallbackIds[getTransactionKey(transactionStats[i].callbackIds)] = i;
+    }
+}
+
 // -----------------------------------------------------------------------
 
 CallbackHandle::CallbackHandle(const sp<IBinder>& transactionListener,
@@ -86,8 +86,18 @@ private:
                                           const std::vector<CallbackId>& callbackIds,
                                           TransactionStats** outTransactionStats);
 
-    std::unordered_map<sp<IBinder>, std::deque<TransactionStats>, IListenerHash>
-        mCompletedTransactions;
+    struct ListenerTransactions {
+        std::deque<TransactionStats> transactionStats;
+        // Index in transactionStats of the most recent transaction for each set of callback ids,
+        // keyed by the first id. A process with many surfaces has many transactions completing in
+        // the same frame, which made looking them up one by one quadratic.
+        std::unordered_map<int64_t, size_t> indexByCallbackIds;
+
+        TransactionStats& add(const std::vector<CallbackId>& callbackIds);
+        void reindex();
+    };
+
+    std::unordered_map<sp<IBinder>, ListenerTransactions, IListenerHash> mCompletedTransactions;
 
     sp<Fence> mPresentFence;
 };
@@ -17,6 +17,7 @@
 #include <android/gui/BnWindowInfosPublisher.h>
 #include <android/gui/IWindowInfosPublisher.h>
 #include <android/gui/WindowInfosListenerInfo.h>
+#include <binder/Parcel.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/TraceUtils.h>
 #include <gui/WindowInfosUpdate.h>
@@ -47,6 +48,7 @@ void WindowInfosListenerInvoker::addWindowInfosListener(sp<IWindowInfosListener>
                 asBinder->linkToDeath(sp<DeathRecipient>::fromExisting(this));
                 mWindowInfosListeners.try_emplace(asBinder,
                                                   std::make_pair(listenerId, std::move(listener)));
+                mListenersNeedingFullUpdate.insert(listenerId);
             }});
 }
 
@@ -71,6 +73,7 @@ void WindowInfosListenerInvoker::eraseListenerAndAckMessages(const wp<IBinder>&
     auto it = mWindowInfosListeners.find(binder);
     int64_t listenerId = it->second.first;
     mWindowInfosListeners.erase(binder);
+    mListenersNeedingFullUpdate.erase(listenerId);
 
     std::vector<int64_t> vsyncIds;
     for (auto& [vsyncId, state] : mUnackedState) {
@@ -114,6 +117,7 @@ void WindowInfosListenerInvoker::windowInfosChanged(
     if (CC_UNLIKELY(mWindowInfosListeners.empty())) {
         mReportedListeners.merge(reportedListeners);
         mDelayInfo.reset();
+        mLastSentUpdate.reset();
         return;
     }
 
@@ -133,14 +137,56 @@ void WindowInfosListenerInvoker::windowInfosChanged(
     mDelayInfo.reset();
     updateMaxSendDelay();
 
+    // Listeners that hold the last update only get what changed since, unless a full update is due.
+    std::optional<gui::WindowInfosUpdate> delta;
+    if (mLastSentUpdate && ++mUpdatesSinceFullUpdate < kFullUpdateInterval) {
+        delta = gui::WindowInfosUpdate::makeDelta(*mLastSentUpdate, update);
+    }
+    if (!delta) {
+        mUpdatesSinceFullUpdate = 0;
+    }
+
+    if (++mUpdatesSinceMetricsSample >= kMetricsSamplingInterval) {
+        mUpdatesSinceMetricsSample = 0;
+        sampleParcelMetrics(update, delta);
+    }
+
     // Call the listeners
     for (auto& pair : mWindowInfosListeners) {
         auto& [listenerId, listener] = pair.second;
-        auto status = listener->onWindowInfosChanged(update);
+        const bool needsFullUpdate = mListenersNeedingFullUpdate.erase(listenerId) > 0;
+        const bool sendDelta = delta && !needsFullUpdate;
+        auto status = listener->onWindowInfosChanged(sendDelta ? *delta : update);
+        if (sendDelta) {
+            mDebugInfo.deltaUpdateCount++;
+        } else {
+            mDebugInfo.fullUpdateCount++;
+        }
         if (!status.isOk()) {
+            mListenersNeedingFullUpdate.insert(listenerId);
             ackWindowInfosReceived(update.vsyncId, listenerId);
         }
     }
+
+    mLastSentUpdate = std::move(update);
+}
+
+void WindowInfosListenerInvoker::sampleParcelMetrics(
+        const gui::WindowInfosUpdate& update, const std::optional<gui::WindowInfosUpdate>& delta) {
+    ATRACE_NAME("WindowInfosListenerInvoker::sampleParcelMetrics");
+    auto measure = [](const gui::WindowInfosUpdate& update, size_t& outSize,
+                      nsecs_t& outDuration) {
+        Parcel parcel;
+        const nsecs_t start = TimePoint::now().ns();
+        update.writeToParcel(&parcel);
+        outDuration = TimePoint::now().ns() - start;
+        outSize = parcel.dataSize();
+    };
+    measure(update, mDebugInfo.fullUpdateParcelSize, mDebugInfo.fullUpdateSerializationDuration);
+    if (delta) {
+        measure(*delta, mDebugInfo.deltaUpdateParcelSize,
+                mDebugInfo.deltaUpdateSerializationDuration);
+    }
 }
 
 WindowInfosListenerInvoker::DebugInfo WindowInfosListenerInvoker::getDebugInfo() {
@@ -176,9 +222,13 @@ binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncI
         }
 
         auto& state = it->second;
-        state.unackedListenerIds.unstable_erase(std::find(state.unackedListenerIds.begin(),
-                                                          state.unackedListenerIds.end(),
-                                                          listenerId));
+        // A listener acks the same vsync id twice when it was resynced with that update.
+        auto listenerIt = std::find(state.unackedListenerIds.begin(),
+                                    state.unackedListenerIds.end(), listenerId);
+        if (listenerIt == state.unackedListenerIds.end()) {
+            return;
+        }
+        state.unackedListenerIds.unstable_erase(listenerIt);
         if (!state.unackedListenerIds.empty()) {
             return;
         }
@@ -203,4 +253,30 @@ binder::Status WindowInfosListenerInvoker::ackWindowInfosReceived(int64_t vsyncI
     return binder::Status::ok();
 }
 
+binder::Status WindowInfosListenerInvoker::requestWindowInfosResync(int64_t listenerId) {
+    BackgroundExecutor::getInstance().sendCallbacks({[this, listenerId]() {
+        ATRACE_NAME("WindowInfosListenerInvoker::requestWindowInfosResync");
+        auto it = std::find_if(mWindowInfosListeners.begin(), mWindowInfosListeners.end(),
+                               [listenerId](const auto& pair) {
+                                   return pair.second.first == listenerId;
+                               });
+        if (it == mWindowInfosListeners.end()) {
+            return;
+        }
+        if (!mLastSentUpdate) {
+            mListenersNeedingFullUpdate.insert(listenerId);
+            return;
+        }
+
+        // Send the last update again in full, without waiting for the window infos to change.
+        // It isn't tracked in mUnackedState, as the delta it replaces already was.
+        auto& listener = it->second.second;
+        mDebugInfo.fullUpdateCount++;
+        if (!listener->onWindowInfosChanged(*mLastSentUpdate).isOk()) {
+            mListenersNeedingFullUpdate.insert(listenerId);
+        }
+    }});
+    return binder::Status::ok();
+}
+
 } // namespace android
@@ -22,6 +22,7 @@
 #include <android/gui/BnWindowInfosPublisher.h>
 #include <android/gui/IWindowInfosListener.h>
 #include <android/gui/IWindowInfosReportedListener.h>
+#include <gui/WindowInfosUpdate.h>
 #include <binder/IBinder.h>
 #include <ftl/small_map.h>
 #include <ftl/small_vector.h>
@@ -47,11 +48,20 @@ public:
                             bool forceImmediateCall);
 
     binder::Status ackWindowInfosReceived(int64_t, int64_t) override;
+    binder::Status requestWindowInfosResync(int64_t) override;
 
     struct DebugInfo {
         VsyncId maxSendDelayVsyncId;
         nsecs_t maxSendDelayDuration;
         size_t pendingMessageCount;
+        // Number of updates sent to listeners in full, and as deltas.
+        uint64_t fullUpdateCount = 0;
+        uint64_t deltaUpdateCount = 0;
+        // Parcel size and serialization time of the last sampled update, in full and as a delta.
+        size_t fullUpdateParcelSize = 0;
+        nsecs_t fullUpdateSerializationDuration = 0;
+        size_t deltaUpdateParcelSize = 0;
+        nsecs_t deltaUpdateSerializationDuration = 0;
     };
     DebugInfo getDebugInfo();
 
@@ -82,6 +92,21 @@ private:
     };
     std::optional<DelayInfo> mDelayInfo;
     void updateMaxSendDelay();
+
+    // Every this many updates, all the listeners get the update in full, so that they can't drift
+    // from the window infos for long.
+    static constexpr size_t kFullUpdateInterval = 120;
+    // One update out of this many is serialized once more to measure it for the DebugInfo.
+    static constexpr size_t kMetricsSamplingInterval = 16;
+
+    // The last update sent, which the deltas are made against.
+    std::optional<gui::WindowInfosUpdate> mLastSentUpdate;
+    size_t mUpdatesSinceFullUpdate = 0;
+    size_t mUpdatesSinceMetricsSample = 0;
+    // Listeners that don't hold mLastSentUpdate, so need the next update in full.
+    std::unordered_set<int64_t> mListenersNeedingFullUpdate;
+    void sampleParcelMetrics(const gui::WindowInfosUpdate& update,
+                             const std::optional<gui::WindowInfosUpdate>& delta);
 };
 
 } // namespace android
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../RegionSamplingLuma.h"
+
+using namespace android;
+
+namespace {
+
+// The sampled buffer covers the union of the areas, like the one captured for a navigation bar
+// and a status bar sampling overlapping regions.
+constexpr int32_t kWidth = 1080;
+constexpr int32_t kStride = 1088;
+constexpr int32_t kHeight = 240;
+constexpr uint32_t kOrientation = 0;
+
+const std::vector<uint32_t>& getBuffer() {
+    static const std::vector<uint32_t> buffer = [] {
+        std::vector<uint32_t> pixels(kStride * kHeight);
+        std::mt19937 random(1);
+        for (uint32_t& pixel : pixels) {
+            pixel = random();
+        }
+        return pixels;
+    }();
+    return buffer;
+}
+
+// Returns |count| overlapping areas, all starting at the top of the buffer.
+std::vector<Rect> getAreas(int64_t count) {
+    std::vector<Rect> areas;
+    for (int64_t i = 0; i < count; i++) {
+        const int32_t left = static_cast<int32_t>(i * 37 % (kWidth / 2));
+        areas.emplace_back(left, 0, left + kWidth / 2, kHeight - static_cast<int32_t>(i % 4));
+    }
+    return areas;
+}
+
+} // namespace
+
+// Arg: number of areas sampled.
+static void BM_sampleArea(benchmark::State& state) {
+    const std::vector<uint32_t>& buffer = getBuffer();
+    const std::vector<Rect> areas = getAreas(state.range(0));
+    for (auto _ : state) {
+        for (const Rect& area : areas) {
+            benchmark::DoNotOptimize(
+                    sampleArea(buffer.data(), kWidth, kHeight, kStride, kOrientation, area));
+        }
+    }
+}
+
+static void BM_sampleAreas(benchmark::State& state) {
+    const std::vector<uint32_t>& buffer = getBuffer();
+    const std::vector<Rect> areas = getAreas(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                sampleAreas(buffer.data(), kWidth, kHeight, kStride, kOrientation, areas));
+    }
+}
+
+BENCHMARK(BM_sampleArea)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+BENCHMARK(BM_sampleAreas)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+BENCHMARK_MAIN();
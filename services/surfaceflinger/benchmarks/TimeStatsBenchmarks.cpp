@@ -0,0 +1,91 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "TimeStats/TimeStats.h"
+
+using namespace android;
+
+namespace {
+
+constexpr nsecs_t kFramePeriod = 1'000'000'000 / 120;
+constexpr Fps kRefreshRate = 120_Hz;
+
+void enable(TimeStats& timeStats) {
+    Vector<String16> args;
+    args.push_back(String16("-enable"));
+    std::string result;
+    timeStats.parseArgs(false, args, result);
+}
+
+} // namespace
+
+// What SurfaceFlinger spends on TimeStats for a frame where every layer presents a buffer, at
+// 120 Hz, including applying the recorded events to the stats. That happens partly on the
+// aggregation thread, so the CPU time of the whole process is measured. Arg: the number of layers.
+static void BM_recordFrame(benchmark::State& state) {
+    const auto layerCount = static_cast<int32_t>(state.range(0));
+    impl::TimeStats timeStats;
+    enable(timeStats);
+
+    std::vector<std::string> layerNames;
+    for (int32_t layerId = 0; layerId < layerCount; layerId++) {
+        layerNames.push_back("com.example.app/com.example.app.Activity#" +
+                             std::to_string(layerId));
+    }
+
+    uint64_t frameNumber = 0;
+    nsecs_t frameTime = 0;
+    std::vector<std::shared_ptr<FenceTime>> acquireFences(static_cast<size_t>(layerCount));
+    std::shared_ptr<FenceTime> presentFence;
+    for (auto _ : state) {
+        // Fences come from the buffers and HWC, and aren't part of what TimeStats costs.
+        state.PauseTiming();
+        frameNumber++;
+        frameTime += kFramePeriod;
+        for (auto& fence : acquireFences) {
+            fence = std::make_shared<FenceTime>(frameTime + kFramePeriod / 4);
+        }
+        presentFence = std::make_shared<FenceTime>(frameTime + kFramePeriod);
+        state.ResumeTiming();
+
+        for (int32_t layerId = 0; layerId < layerCount; layerId++) {
+            const auto& layerName = layerNames[static_cast<size_t>(layerId)];
+            timeStats.setPostTime(layerId, frameNumber, layerName, 1000, frameTime,
+                                  GameMode::Unsupported);
+            timeStats.setDesiredTime(layerId, frameNumber, frameTime);
+            timeStats.setAcquireFence(layerId, frameNumber,
+                                      acquireFences[static_cast<size_t>(layerId)]);
+            timeStats.setLatchTime(layerId, frameNumber, frameTime + kFramePeriod / 2);
+            timeStats.setPresentFence(layerId, frameNumber, presentFence, kRefreshRate,
+                                      std::nullopt, {}, GameMode::Unsupported);
+        }
+        timeStats.setPresentFenceGlobal(presentFence);
+        timeStats.incrementTotalFrames();
+
+        // Apply whatever the aggregation thread hasn't yet, so each frame pays for its own events.
+        benchmark::DoNotOptimize(timeStats.miniDump());
+    }
+}
+
+BENCHMARK(BM_recordFrame)->ArgName("layers")->Arg(20)->Arg(200)->MeasureProcessCPUTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <deque>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+
+#include "TransactionCallbackInvoker.h"
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kNumListeners = 50;
+
+struct Listener {
+    sp<IBinder> binder = sp<BBinder>::make();
+    // One transaction per surface, each with its own callback.
+    std::deque<sp<CallbackHandle>> handles;
+    std::vector<sp<IBinder>> surfaces;
+};
+
+std::vector<Listener> makeListeners(size_t surfacesPerListener) {
+    std::vector<Listener> listeners(kNumListeners);
+    int64_t callbackId = 1;
+    for (auto& listener : listeners) {
+        for (size_t i = 0; i < surfacesPerListener; i++) {
+            listener.surfaces.push_back(sp<BBinder>::make());
+            const std::vector<CallbackId> callbackIds = {
+                    CallbackId(callbackId++, CallbackId::Type::ON_COMPLETE)};
+            auto handle = sp<CallbackHandle>::make(listener.binder, callbackIds,
+                                                   listener.surfaces.back());
+            handle->latchTime = 1;
+            listener.handles.push_back(std::move(handle));
+        }
+    }
+    return listeners;
+}
+
+} // namespace
+
+// What SurfaceFlinger's main thread spends each frame to collect and send the transaction
+// callbacks of 50 listeners. Arg: the number of surfaces with a completed transaction per
+// listener. The binder calls themselves are made on the background executor.
+static void BM_sendCallbacks(benchmark::State& state) {
+    const auto listeners = makeListeners(static_cast<size_t>(state.range(0)));
+    const std::vector<JankData> jankData;
+    TransactionCallbackInvoker invoker;
+    for (auto _ : state) {
+        for (const auto& listener : listeners) {
+            invoker.addCallbackHandles(listener.handles, jankData);
+        }
+        invoker.addPresentFence(Fence::NO_FENCE);
+        invoker.sendCallbacks(/*onCommitOnly*/ false);
+    }
+}
+
+BENCHMARK(BM_sendCallbacks)->ArgName("surfaces")->Arg(1)->Arg(8)->Arg(32);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "FrontEnd/Update.h"
+#include "Tracing/TransactionTracing.h"
+#include "TransactionState.h"
+
+using namespace android;
+
+namespace {
+
+constexpr size_t kLayersPerTransaction = 4;
+// How often the binder thread benchmark lets the tracing thread serialize what was queued.
+constexpr int64_t kTransactionsPerFrame = 16;
+
+TransactionState makeTransaction(uint64_t id) {
+    TransactionState transaction;
+    transaction.id = id;
+    transaction.originPid = 1;
+    transaction.originUid = 2;
+    for (size_t i = 0; i < kLayersPerTransaction; i++) {
+        ResolvedComposerState state;
+        state.layerId = static_cast<uint32_t>(i + 1);
+        state.state.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+                layer_state_t::eLayerChanged;
+        state.state.x = 10.0f * i;
+        state.state.y = 20.0f * i;
+        state.state.color.a = 0.5f;
+        state.state.z = static_cast<int32_t>(i);
+        transaction.states.push_back(std::move(state));
+    }
+    return transaction;
+}
+
+std::unique_ptr<TransactionTracing> makeTracing(bool enabled) {
+    return enabled ? std::make_unique<TransactionTracing>() : nullptr;
+}
+
+} // namespace
+
+// What SurfaceFlinger's main thread spends on tracing each frame. Args: whether tracing is on,
+// and the number of transactions committed per frame.
+static void BM_commitTransactions(benchmark::State& state) {
+    auto tracing = makeTracing(state.range(0) != 0);
+    const std::vector<TransactionState> transactions(static_cast<size_t>(state.range(1)),
+                                                     makeTransaction(1));
+    int64_t vsyncId = 0;
+    for (auto _ : state) {
+        // Built either way, since the main thread commits the update whether it's traced or not.
+        frontend::Update update;
+        update.transactions = transactions;
+        if (tracing) {
+            tracing->addCommittedTransactions(++vsyncId, systemTime(), update, {}, false);
+        }
+        benchmark::DoNotOptimize(update);
+    }
+    if (tracing) {
+        tracing->flush();
+    }
+}
+
+BENCHMARK(BM_commitTransactions)
+        ->ArgNames({"tracing", "transactions"})
+        ->ArgsProduct({{0, 1}, {1, 8, 32}});
+
+// What a binder thread spends on tracing for each transaction it queues. Arg: whether tracing is
+// on.
+static void BM_queueTransaction(benchmark::State& state) {
+    auto tracing = makeTracing(state.range(0) != 0);
+    const TransactionState transaction = makeTransaction(1);
+    int64_t queued = 0;
+    int64_t vsyncId = 0;
+    for (auto _ : state) {
+        if (tracing) {
+            tracing->addQueuedTransaction(transaction);
+        }
+        benchmark::DoNotOptimize(transaction);
+        if (tracing && ++queued % kTransactionsPerFrame == 0) {
+            // Commit nothing, only so the tracing thread drains the queued transactions.
+            state.PauseTiming();
+            frontend::Update update;
+            tracing->addCommittedTransactions(++vsyncId, systemTime(), update, {}, false);
+            state.ResumeTiming();
+        }
+    }
+    if (tracing) {
+        tracing->flush();
+    }
+}
+
+BENCHMARK(BM_queueTransaction)->ArgName("tracing")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -25,3 +25,5 @@
 #include <perfetto/config/android/surfaceflinger_layers_config.pbzero.h>
 #include <perfetto/trace/android/surfaceflinger_layers.pb.h>
 #include <perfetto/trace/android/surfaceflinger_layers.pbzero.h>
+
+#include <layers_delta.pb.h>
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <gui/SurfaceComposerClient.h>
+#include <ui/GraphicBuffer.h>
 
 #include <utils/String8.h>
 
@@ -51,6 +52,111 @@ TEST(SurfaceFlingerStress, create_and_destroy) {
     }
 }
 
+namespace {
+
+using android::hardware::graphics::common::V1_1::BufferUsage;
+constexpr uint64_t kUsageFlags = BufferUsage::CPU_READ_OFTEN | BufferUsage::CPU_WRITE_OFTEN |
+        BufferUsage::COMPOSER_OVERLAY | BufferUsage::GPU_TEXTURE;
+
+// Sends |count| new buffers to |surf|, so that they are all cached by SurfaceFlinger.
+void sendBuffers(const sp<SurfaceControl>& surf, size_t count,
+                 std::vector<sp<GraphicBuffer>>& outBuffers) {
+    for (size_t i = 0; i < count; i++) {
+        outBuffers.push_back(
+                sp<GraphicBuffer>::make(1u, 1u, PIXEL_FORMAT_RGBA_8888, 1u, kUsageFlags, "test"));
+        ASSERT_EQ(NO_ERROR,
+                  SurfaceComposerClient::Transaction().setBuffer(surf, outBuffers.back()).apply());
+    }
+}
+
+} // namespace
+
+TEST(SurfaceFlingerStress, cache_and_uncache_buffers) {
+    constexpr int kThreads = 10;
+    constexpr int kIterations = 50;
+    constexpr size_t kBuffersPerBatch = 16;
+    using BufferUncacheStats = SurfaceComposerClient::Transaction::BufferUncacheStats;
+    const BufferUncacheStats before = SurfaceComposerClient::Transaction::getBufferUncacheStats();
+
+    // Every buffer sent is cached by SurfaceFlinger, and uncached once it is destroyed, either on
+    // its own or batched with the buffers destroyed around the same time.
+    auto do_stress = [&]() {
+        sp<SurfaceComposerClient> client = sp<SurfaceComposerClient>::make();
+        ASSERT_EQ(NO_ERROR, client->initCheck());
+        auto surf = client->createSurface(String8("t"), 100, 100, PIXEL_FORMAT_RGBA_8888, 0);
+        ASSERT_TRUE(surf != nullptr);
+
+        for (int j = 0; j < kIterations; j++) {
+            std::vector<sp<GraphicBuffer>> buffers;
+            ASSERT_NO_FATAL_FAILURE(sendBuffers(surf, kBuffersPerBatch, buffers));
+            if (j % 2 == 0) {
+                SurfaceComposerClient::Transaction::BufferUncacheBatch batch;
+                buffers.clear();
+            } else {
+                buffers.clear();
+            }
+        }
+        // The layer still takes new buffers once all the others are gone.
+        auto buffer = sp<GraphicBuffer>::make(1u, 1u, PIXEL_FORMAT_RGBA_8888, 1u, kUsageFlags,
+                                              "test");
+        ASSERT_EQ(NO_ERROR,
+                  SurfaceComposerClient::Transaction().setBuffer(surf, buffer).apply(
+                          /*synchronous*/ true));
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; i++) {
+        threads.push_back(std::thread(do_stress));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Every buffer destroyed was uncached, with fewer transactions than buffers.
+    const BufferUncacheStats after = SurfaceComposerClient::Transaction::getBufferUncacheStats();
+    const uint64_t uncachedBuffers = after.uncachedBuffers - before.uncachedBuffers;
+    EXPECT_GE(uncachedBuffers, uint64_t{kThreads * kIterations * kBuffersPerBatch});
+    EXPECT_LT(after.uncacheTransactions - before.uncacheTransactions, uncachedBuffers);
+}
+
+TEST(SurfaceFlingerStress, uncache_batch_is_bounded) {
+    using Transaction = SurfaceComposerClient::Transaction;
+    sp<SurfaceComposerClient> client = sp<SurfaceComposerClient>::make();
+    ASSERT_EQ(NO_ERROR, client->initCheck());
+    auto surf = client->createSurface(String8("t"), 100, 100, PIXEL_FORMAT_RGBA_8888, 0);
+    ASSERT_TRUE(surf != nullptr);
+
+    // A small batch is sent in a single transaction once it goes away.
+    std::vector<sp<GraphicBuffer>> buffers;
+    ASSERT_NO_FATAL_FAILURE(sendBuffers(surf, 16, buffers));
+    Transaction::BufferUncacheStats before = Transaction::getBufferUncacheStats();
+    {
+        Transaction::BufferUncacheBatch batch;
+        buffers.clear();
+        const Transaction::BufferUncacheStats during = Transaction::getBufferUncacheStats();
+        EXPECT_EQ(before.uncachedBuffers, during.uncachedBuffers);
+        EXPECT_EQ(before.uncacheTransactions, during.uncacheTransactions);
+    }
+    Transaction::BufferUncacheStats after = Transaction::getBufferUncacheStats();
+    EXPECT_EQ(before.uncachedBuffers + 16, after.uncachedBuffers);
+    EXPECT_EQ(before.uncacheTransactions + 1, after.uncacheTransactions);
+
+    // A batch doesn't hold back more than MAX_PENDING_UNCACHES buffers, so that SurfaceFlinger
+    // doesn't keep them alive.
+    ASSERT_NO_FATAL_FAILURE(sendBuffers(surf, 2 * Transaction::MAX_PENDING_UNCACHES, buffers));
+    before = Transaction::getBufferUncacheStats();
+    {
+        Transaction::BufferUncacheBatch batch;
+        buffers.clear();
+        const Transaction::BufferUncacheStats during = Transaction::getBufferUncacheStats();
+        EXPECT_EQ(before.uncachedBuffers + 2 * Transaction::MAX_PENDING_UNCACHES,
+                  during.uncachedBuffers);
+        EXPECT_EQ(before.uncacheTransactions + 2, during.uncacheTransactions);
+    }
+    after = Transaction::getBufferUncacheStats();
+    EXPECT_EQ(before.uncacheTransactions + 2, after.uncacheTransactions);
+}
+
 perfetto::protos::LayersProto generateLayerProto() {
     perfetto::protos::LayersProto layersProto;
     std::array<perfetto::protos::LayerProto*, 10> layers = {};
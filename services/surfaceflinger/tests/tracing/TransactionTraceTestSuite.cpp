@@ -19,6 +19,7 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 
@@ -26,6 +27,7 @@
 #include <Tracing/LayerTracing.h>
 #include <Tracing/TransactionProtoParser.h>
 #include <Tracing/tools/LayerTraceGenerator.h>
+#include <Tracing/tools/LayersTraceDelta.h>
 #include <layerproto/LayerProtoHeader.h>
 #include <log/log.h>
 
@@ -240,6 +242,34 @@ TEST_P(TransactionTraceTestSuite, validateEndState) {
     }
 }
 
+TEST_P(TransactionTraceTestSuite, deltaEncodedTraceRoundTrips) {
+    auto traceFlags = LayerTracing::TRACE_INPUT | LayerTracing::TRACE_BUFFERS;
+    std::stringstream fullStream;
+    {
+        auto layerTracing = LayerTracing{fullStream};
+        ASSERT_TRUE(LayerTraceGenerator().generate(mTransactionTrace, traceFlags, layerTracing));
+    }
+
+    perfetto::protos::LayersTraceFileProto fullTrace;
+    ASSERT_TRUE(fullTrace.ParseFromIstream(&fullStream));
+    surfaceflinger::LayersDeltaTraceFileProto deltaTrace;
+    encodeLayersDeltaTrace(fullTrace, deltaTrace);
+    perfetto::protos::LayersTraceFileProto expandedTrace;
+    ASSERT_TRUE(expandLayersDeltaTrace(deltaTrace, expandedTrace));
+
+    ASSERT_GT(fullTrace.entry_size(), 0);
+    ASSERT_EQ(fullTrace.entry_size(), expandedTrace.entry_size());
+    int keyframes = 0;
+    for (int i = 0; i < fullTrace.entry_size(); i++) {
+        keyframes += deltaTrace.entry(i).has_keyframe() ? 1 : 0;
+        EXPECT_EQ(fullTrace.entry(i).SerializeAsString(),
+                  expandedTrace.entry(i).SerializeAsString())
+                << "Entry " << i << " doesn't match";
+    }
+    ALOGD("%d entries, %d keyframes, %zu bytes instead of %zu", fullTrace.entry_size(), keyframes,
+          deltaTrace.ByteSizeLong(), fullTrace.ByteSizeLong());
+}
+
 std::string PrintToStringParamName(const ::testing::TestParamInfo<std::filesystem::path>& info) {
     const auto& prefix = android::TransactionTraceTestSuite::sTransactionTracePrefix;
     const auto& postfix = android::TransactionTraceTestSuite::sTracePostfix;
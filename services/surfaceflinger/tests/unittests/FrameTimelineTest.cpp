@@ -25,7 +25,9 @@
 #include <gtest/gtest.h>
 #include <log/log.h>
 #include <perfetto/trace/trace.pb.h>
+#include <algorithm>
 #include <cinttypes>
+#include <unordered_set>
 
 using namespace std::chrono_literals;
 using testing::_;
@@ -139,7 +141,7 @@ public:
         for (size_t i = 0; i < maxTokens; i++) {
             mTokenManager->generateTokenForPredictions({});
         }
-        EXPECT_EQ(getPredictions().size(), maxTokens);
+        EXPECT_EQ(getNumberOfPredictions(), maxTokens);
     }
 
     SurfaceFrame& getSurfaceFrame(size_t displayFrameIdx, size_t surfaceFrameIdx) {
@@ -158,8 +160,22 @@ public:
                 a.presentTime == b.presentTime;
     }
 
-    const std::map<int64_t, TimelineItem>& getPredictions() const {
-        return mTokenManager->mPredictions;
+    size_t getNumberOfPredictions() const {
+        std::lock_guard<std::mutex> lock(mTokenManager->mMutex);
+        return static_cast<size_t>(
+                std::count_if(mTokenManager->mPredictions.begin(),
+                              mTokenManager->mPredictions.end(), [](const auto& prediction) {
+                                  return prediction.token != FrameTimelineInfo::INVALID_VSYNC_ID;
+                              }));
+    }
+
+    size_t getNumberOfSurfaceFrameHeapAllocations() const {
+        return mFrameTimeline->mSurfaceFramePool->getNumHeapAllocations();
+    }
+
+    const impl::FrameTimeline::DisplayFrame* getCurrentDisplayFrame() const {
+        std::lock_guard<std::mutex> lock(mFrameTimeline->mMutex);
+        return mFrameTimeline->mCurrentDisplayFrame.get();
     }
 
     uint32_t getNumberOfDisplayFrames() const {
@@ -193,7 +209,7 @@ public:
 
 TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     int64_t token1 = mTokenManager->generateTokenForPredictions({0, 0, 0});
-    EXPECT_EQ(getPredictions().size(), 1u);
+    EXPECT_EQ(getNumberOfPredictions(), 1u);
     flushTokens();
     int64_t token2 = mTokenManager->generateTokenForPredictions({10, 20, 30});
     std::optional<TimelineItem> predictions = mTokenManager->getPredictionsForToken(token1);
@@ -521,6 +537,77 @@ TEST_F(FrameTimelineTest, setMaxDisplayFramesSetsSizeProperly) {
     EXPECT_EQ(getNumberOfDisplayFrames(), *maxDisplayFrames);
 }
 
+TEST_F(FrameTimelineTest, steadyStateFramesReuseSurfaceFramesAndDisplayFrames) {
+    constexpr size_t kNumLayers = 20;
+    auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    presentFence->signalForTest(2);
+
+    const auto presentFrame = [&] {
+        int64_t surfaceFrameToken = mTokenManager->generateTokenForPredictions({10, 20, 30});
+        FrameTimelineInfo ftInfo;
+        ftInfo.vsyncId = surfaceFrameToken;
+        ftInfo.inputEventId = sInputEventId;
+        for (size_t i = 0; i < kNumLayers; i++) {
+            auto surfaceFrame =
+                    mFrameTimeline->createSurfaceFrameForToken(ftInfo, sPidOne, sUidOne,
+                                                               sLayerIdOne, sLayerNameOne,
+                                                               sLayerNameOne, /*isBuffer*/ true,
+                                                               sGameMode);
+            surfaceFrame->setPresentState(SurfaceFrame::PresentState::Presented);
+            mFrameTimeline->addSurfaceFrame(std::move(surfaceFrame));
+        }
+        int64_t sfToken = mTokenManager->generateTokenForPredictions({22, 26, 30});
+        mFrameTimeline->setSfWakeUp(sfToken, 22, RR_11, RR_11);
+        mFrameTimeline->setSfPresent(27, presentFence);
+    };
+
+    // Fill the window of display frames, after which the oldest frames are recycled.
+    for (size_t i = 0; i < *maxDisplayFrames + 1; i++) {
+        presentFrame();
+    }
+    const size_t heapAllocations = getNumberOfSurfaceFrameHeapAllocations();
+    EXPECT_LE(heapAllocations, (*maxDisplayFrames + 1) * kNumLayers);
+
+    std::unordered_set<const impl::FrameTimeline::DisplayFrame*> displayFrames;
+    for (size_t i = 0; i < *maxDisplayFrames; i++) {
+        displayFrames.insert(getDisplayFrame(i).get());
+    }
+    displayFrames.insert(getCurrentDisplayFrame());
+
+    for (size_t i = 0; i < *maxDisplayFrames * 2; i++) {
+        presentFrame();
+        EXPECT_EQ(displayFrames.count(getCurrentDisplayFrame()), 1u);
+    }
+    EXPECT_EQ(getNumberOfSurfaceFrameHeapAllocations(), heapAllocations);
+    EXPECT_EQ(getNumberOfDisplayFrames(), *maxDisplayFrames);
+}
+
+TEST_F(FrameTimelineTest, recycledDisplayFrameStartsClean) {
+    auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    presentFence->signalForTest(2);
+    mFrameTimeline->setMaxDisplayFrames(1);
+
+    const auto presentFrame = [&] {
+        addEmptySurfaceFrame();
+        int64_t sfToken = mTokenManager->generateTokenForPredictions({22, 26, 30});
+        mFrameTimeline->setSfWakeUp(sfToken, 22, RR_11, RR_11);
+        mFrameTimeline->setSfPresent(27, presentFence);
+    };
+
+    presentFrame();
+    const impl::FrameTimeline::DisplayFrame* firstDisplayFrame = getDisplayFrame(0).get();
+    presentFrame();
+
+    // The first display frame was pushed out of the window, and is the one being filled now.
+    const impl::FrameTimeline::DisplayFrame* displayFrame = getCurrentDisplayFrame();
+    ASSERT_EQ(displayFrame, firstDisplayFrame);
+    EXPECT_EQ(displayFrame->getSurfaceFrames().size(), 0u);
+    EXPECT_EQ(displayFrame->getJankType(), JankType::None);
+    EXPECT_EQ(displayFrame->getFramePresentMetadata(), FramePresentMetadata::UnknownPresent);
+    EXPECT_EQ(compareTimelineItems(displayFrame->getActuals(), TimelineItem()), true);
+    EXPECT_EQ(compareTimelineItems(displayFrame->getPredictions(), TimelineItem()), true);
+}
+
 TEST_F(FrameTimelineTest, presentFenceSignaled_invalidSignalTime) {
     Fps refreshRate = RR_11;
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <layerproto/LayerProtoHeader.h>
+#include "Tracing/tools/LayersTraceDelta.h"
+
+namespace android {
+
+class LayersTraceDeltaTest : public testing::Test {
+protected:
+    static perfetto::protos::LayerProto* addLayer(perfetto::protos::LayersSnapshotProto& snapshot,
+                                                  int32_t id, const std::string& name) {
+        auto* layer = snapshot.mutable_layers()->add_layers();
+        layer->set_id(id);
+        layer->set_name(name);
+        layer->set_z(id);
+        layer->add_children(id + 100);
+        return layer;
+    }
+
+    static perfetto::protos::LayersSnapshotProto makeSnapshot(int64_t timestamp) {
+        perfetto::protos::LayersSnapshotProto snapshot;
+        snapshot.set_elapsed_realtime_nanos(timestamp);
+        snapshot.set_where("visibleRegionsDirty");
+        addLayer(snapshot, 1, "root");
+        addLayer(snapshot, 2, "app");
+        addLayer(snapshot, 3, "wallpaper");
+        return snapshot;
+    }
+
+    // Encodes |snapshot|, and checks that it decodes back to it.
+    surfaceflinger::LayersDeltaEntryProto roundTrip(
+            const perfetto::protos::LayersSnapshotProto& snapshot) {
+        auto entry = mEncoder.encode(snapshot);
+        surfaceflinger::LayersDeltaEntryProto parsedEntry;
+        EXPECT_TRUE(parsedEntry.ParseFromString(entry.SerializeAsString()));
+        auto decoded = mDecoder.decode(parsedEntry);
+        EXPECT_TRUE(decoded.has_value());
+        if (decoded) {
+            EXPECT_EQ(snapshot.SerializeAsString(), decoded->SerializeAsString());
+        }
+        return entry;
+    }
+
+    LayersTraceDeltaEncoder mEncoder{/*keyframeInterval=*/4};
+    LayersTraceDeltaDecoder mDecoder;
+};
+
+TEST_F(LayersTraceDeltaTest, unchangedLayersAreLeftOut) {
+    auto snapshot = makeSnapshot(1);
+    EXPECT_TRUE(roundTrip(snapshot).has_keyframe());
+
+    snapshot.set_elapsed_realtime_nanos(2);
+    snapshot.mutable_layers()->mutable_layers(1)->set_z(42);
+    auto entry = roundTrip(snapshot);
+    ASSERT_TRUE(entry.has_delta());
+    ASSERT_EQ(1, entry.delta().changed_layers_size());
+    EXPECT_EQ(2, entry.delta().changed_layers(0).id());
+    EXPECT_EQ(0, entry.delta().removed_layer_ids_size());
+    EXPECT_EQ(0, entry.delta().layer_order_size());
+
+    // Only the changed field is carried.
+    perfetto::protos::LayerProto changedFields;
+    ASSERT_TRUE(changedFields.ParseFromString(
+            entry.delta().changed_layers(0).fields().changed_fields()));
+    EXPECT_FALSE(changedFields.has_name());
+    EXPECT_EQ(42, changedFields.z());
+}
+
+TEST_F(LayersTraceDeltaTest, addsRemovesAndReordersLayers) {
+    auto snapshot = makeSnapshot(1);
+    roundTrip(snapshot);
+
+    snapshot.mutable_layers()->mutable_layers()->DeleteSubrange(0, 1);
+    addLayer(snapshot, 4, "dialog");
+    auto entry = roundTrip(snapshot);
+    ASSERT_TRUE(entry.has_delta());
+    ASSERT_EQ(1, entry.delta().removed_layer_ids_size());
+    EXPECT_EQ(1, entry.delta().removed_layer_ids(0));
+    ASSERT_EQ(1, entry.delta().changed_layers_size());
+    EXPECT_EQ(4, entry.delta().changed_layers(0).id());
+    EXPECT_EQ(0, entry.delta().layer_order_size());
+
+    snapshot.mutable_layers()->mutable_layers()->SwapElements(0, 2);
+    entry = roundTrip(snapshot);
+    ASSERT_TRUE(entry.has_delta());
+    EXPECT_EQ(0, entry.delta().changed_layers_size());
+    EXPECT_EQ(3, entry.delta().layer_order_size());
+}
+
+TEST_F(LayersTraceDeltaTest, clearsFields) {
+    auto snapshot = makeSnapshot(1);
+    snapshot.mutable_layers()->mutable_layers(2)->add_children(7);
+    roundTrip(snapshot);
+
+    snapshot.clear_where();
+    snapshot.mutable_layers()->mutable_layers(2)->clear_children();
+    auto entry = roundTrip(snapshot);
+    ASSERT_TRUE(entry.has_delta());
+    EXPECT_EQ(1, entry.delta().snapshot().cleared_fields_size());
+    ASSERT_EQ(1, entry.delta().changed_layers_size());
+    EXPECT_EQ(1, entry.delta().changed_layers(0).fields().cleared_fields_size());
+
+    snapshot.clear_layers();
+    roundTrip(snapshot);
+    snapshot.mutable_layers();
+    roundTrip(snapshot);
+}
+
+TEST_F(LayersTraceDeltaTest, writesKeyframesPeriodically) {
+    auto snapshot = makeSnapshot(0);
+    for (int i = 0; i < 10; i++) {
+        snapshot.set_elapsed_realtime_nanos(i);
+        EXPECT_EQ(i % 4 == 0, roundTrip(snapshot).has_keyframe()) << "Entry " << i;
+    }
+}
+
+TEST_F(LayersTraceDeltaTest, duplicateIdsAreWrittenAsKeyframes) {
+    auto snapshot = makeSnapshot(1);
+    roundTrip(snapshot);
+
+    snapshot.set_elapsed_realtime_nanos(2);
+    addLayer(snapshot, 2, "mirror");
+    EXPECT_TRUE(roundTrip(snapshot).has_keyframe());
+    snapshot.set_elapsed_realtime_nanos(3);
+    EXPECT_TRUE(roundTrip(snapshot).has_keyframe());
+}
+
+TEST_F(LayersTraceDeltaTest, deltaWithoutKeyframeFailsToDecode) {
+    auto snapshot = makeSnapshot(1);
+    mEncoder.encode(snapshot);
+    snapshot.set_elapsed_realtime_nanos(2);
+    auto entry = mEncoder.encode(snapshot);
+    ASSERT_TRUE(entry.has_delta());
+    EXPECT_FALSE(mDecoder.decode(entry).has_value());
+}
+
+TEST_F(LayersTraceDeltaTest, encodesAndExpandsTrace) {
+    perfetto::protos::LayersTraceFileProto trace;
+    trace.set_real_to_elapsed_time_offset_nanos(1234);
+    for (int i = 0; i < 6; i++) {
+        auto* snapshot = trace.add_entry();
+        *snapshot = makeSnapshot(i);
+        snapshot->mutable_layers()->mutable_layers(i % 3)->set_name("renamed" + std::to_string(i));
+    }
+
+    surfaceflinger::LayersDeltaTraceFileProto deltaTrace;
+    encodeLayersDeltaTrace(trace, deltaTrace, /*keyframeInterval=*/4);
+    ASSERT_EQ(6, deltaTrace.entry_size());
+    EXPECT_TRUE(deltaTrace.entry(0).has_keyframe());
+    EXPECT_FALSE(deltaTrace.entry(1).has_keyframe());
+
+    perfetto::protos::LayersTraceFileProto expandedTrace;
+    ASSERT_TRUE(expandLayersDeltaTrace(deltaTrace, expandedTrace));
+    EXPECT_EQ(1234u, expandedTrace.real_to_elapsed_time_offset_nanos());
+    ASSERT_EQ(6, expandedTrace.entry_size());
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(trace.entry(i).SerializeAsString(), expandedTrace.entry(i).SerializeAsString());
+    }
+}
+
+} // namespace android
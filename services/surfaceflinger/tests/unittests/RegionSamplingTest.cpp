@@ -27,6 +27,8 @@
 #include <gtest/gtest.h>
 #include <array>
 #include <limits>
+#include <random>
+#include <vector>
 
 #include "RegionSamplingThread.h"
 
@@ -106,6 +108,48 @@ TEST_F(RegionSamplingTest, bounds_checking) {
                 testing::Eq(0.0));
 }
 
+TEST_F(RegionSamplingTest, sample_areas_matches_sample_area) {
+    std::mt19937 random(42);
+    std::generate(buffer.begin(), buffer.end(), [&random]() { return uint32_t(random()); });
+
+    // Overlapping areas, with widths that aren't multiples of the vector width.
+    std::vector<Rect> areas;
+    for (int i = 0; i < 32; i++) {
+        const int32_t left = random() % kWidth;
+        const int32_t top = random() % kHeight;
+        const int32_t right = left + 1 + random() % (kWidth - left);
+        const int32_t bottom = top + 1 + random() % (kHeight - top);
+        areas.emplace_back(left, top, right, bottom);
+    }
+    areas.push_back(whole_area);
+
+    const std::vector<float> lumas =
+            sampleAreas(buffer.data(), kWidth, kHeight, kStride, kOrientation, areas);
+    ASSERT_EQ(areas.size(), lumas.size());
+    for (size_t i = 0; i < areas.size(); i++) {
+        // Bit exact, so switching to sampleAreas() can't change any sampling decision.
+        EXPECT_EQ(sampleArea(buffer.data(), kWidth, kHeight, kStride, kOrientation, areas[i]),
+                  lumas[i])
+                << "area " << i;
+    }
+}
+
+TEST_F(RegionSamplingTest, sample_areas_bounds_checking) {
+    std::fill(buffer.begin(), buffer.end(), kWhite);
+
+    const std::vector<Rect> areas = {Rect{0, 0, 4, kHeight + 1}, Rect{0, 0, -4, kHeight},
+                                     Rect{-1, 0, 4, 4}, Rect{kWidth - 4, 0, kWidth + 1, 4},
+                                     whole_area};
+    const std::vector<float> lumas =
+            sampleAreas(buffer.data(), kWidth, kHeight, kStride, kOrientation, areas);
+    ASSERT_EQ(areas.size(), lumas.size());
+    EXPECT_THAT(lumas[0], testing::Eq(0.0));
+    EXPECT_THAT(lumas[1], testing::Eq(0.0));
+    EXPECT_THAT(lumas[2], testing::Eq(0.0));
+    EXPECT_THAT(lumas[3], testing::Eq(0.0));
+    EXPECT_THAT(lumas[4], testing::FloatEq(1.0f));
+}
+
 } // namespace android
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -32,6 +32,7 @@
 
 #include <chrono>
 #include <random>
+#include <thread>
 #include <unordered_set>
 
 #include "libsurfaceflinger_unittest_main.h"
@@ -1539,6 +1540,41 @@ TEST_F(TimeStatsTest, layerStatsCallback_limitsLayers) {
     EXPECT_EQ(atomList.atom(0).layer_name(), genLayerName(LAYER_ID_1));
 }
 
+TEST_F(TimeStatsTest, canInsertLayerTimeStatsFromSeveralThreads) {
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    std::thread([&] { insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, 1, 1000000); }).join();
+    std::thread([&] { insertTimeRecord(NORMAL_SEQUENCE_2, LAYER_ID_0, 2, 2000000); }).join();
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    EXPECT_EQ(1, globalProto.stats(0).total_frames());
+
+    // The buffers of the threads that exited are reclaimed once their events are applied.
+    EXPECT_THAT(mTimeStats->miniDump(), HasSubstr("Number of layer event buffers is 0\n"));
+}
+
+TEST_F(TimeStatsTest, canInsertMoreLayerEventsThanBuffered) {
+    // Enough frames to fill the event buffer of the calling thread before the aggregation thread
+    // gets to it, so that some of the events are applied by the caller.
+    constexpr uint64_t kFrames = 1000;
+
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    for (uint64_t frameNumber = 1; frameNumber <= kFrames; frameNumber++) {
+        insertTimeRecord(NORMAL_SEQUENCE, LAYER_ID_0, frameNumber,
+                         static_cast<nsecs_t>(frameNumber) * 1000000);
+    }
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(1, globalProto.stats_size());
+    EXPECT_EQ(kFrames - 1, globalProto.stats(0).total_frames());
+}
+
 TEST_F(TimeStatsTest, canSurviveMonkey) {
     if (g_noSlowTests) {
         GTEST_SKIP();
@@ -34,6 +34,7 @@ namespace android {
 class TransactionTracingTest : public testing::Test {
 protected:
     static constexpr size_t SMALL_BUFFER_SIZE = 1024;
+    static constexpr size_t HANDOFF_RING_CAPACITY = TransactionTracing::HANDOFF_RING_CAPACITY;
     TransactionTracing mTracing;
 
     void flush() { mTracing.flush(); }
@@ -123,6 +124,30 @@ TEST_F(TransactionTracingTest, addTransactions) {
     verifyEntry(proto.entry(1), secondUpdate.transactions, secondTransactionSetVsyncId);
 }
 
+TEST_F(TransactionTracingTest, handsOffMoreUpdatesThanRingCapacity) {
+    // More than the ring holds, so the main thread keeps some pending if the tracing thread falls
+    // behind.
+    const int64_t vsyncCount = static_cast<int64_t>(HANDOFF_RING_CAPACITY) * 3;
+    for (int64_t vsyncId = 1; vsyncId <= vsyncCount; vsyncId++) {
+        TransactionState transaction;
+        transaction.id = static_cast<uint64_t>(vsyncId);
+        mTracing.addQueuedTransaction(transaction);
+        frontend::Update update;
+        update.transactions.emplace_back(transaction);
+        mTracing.addCommittedTransactions(vsyncId, 0, update, {}, false);
+    }
+    flush();
+
+    perfetto::protos::TransactionTraceFile proto = writeToProto();
+    ASSERT_EQ(proto.entry().size(), vsyncCount);
+    for (int32_t i = 0; i < proto.entry().size(); i++) {
+        const auto& entry = proto.entry(i);
+        EXPECT_EQ(entry.vsync_id(), i + 1);
+        ASSERT_EQ(entry.transactions().size(), 1);
+        EXPECT_EQ(entry.transactions(0).transaction_id(), static_cast<uint64_t>(i + 1));
+    }
+}
+
 class TransactionTracingLayerHandlingTest : public TransactionTracingTest {
 protected:
     void SetUp() override {
@@ -283,4 +283,73 @@ TEST_F(WindowInfosListenerInvokerTest, removeListenerAcks) {
     EXPECT_EQ(callCount, 2);
 }
 
+namespace {
+
+gui::WindowInfosUpdate makeUpdate(int64_t vsyncId, int32_t movedWindowId) {
+    gui::WindowInfosUpdate update{{}, {}, vsyncId, 0};
+    for (int32_t id = 1; id <= 4; id++) {
+        gui::WindowInfo info;
+        info.id = id;
+        info.name = "Window " + std::to_string(id);
+        info.frame = id == movedWindowId ? Rect(10, 10, 20, 20) : Rect(0, 0, 10, 10);
+        update.windowInfos.push_back(std::move(info));
+    }
+    return update;
+}
+
+} // namespace
+
+// Test that listeners that hold the last update are only sent the windows that changed, and that a
+// listener can ask for the whole window infos again.
+TEST_F(WindowInfosListenerInvokerTest, sendsDeltasAndResyncs) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<gui::WindowInfosUpdate> updates;
+
+    gui::WindowInfosListenerInfo listenerInfo;
+    mInvoker->addWindowInfosListener(sp<Listener>::make([&](const gui::WindowInfosUpdate& update) {
+                                         std::scoped_lock lock{mutex};
+                                         updates.push_back(update);
+                                         cv.notify_one();
+                                         listenerInfo.windowInfosPublisher
+                                                 ->ackWindowInfosReceived(update.vsyncId,
+                                                                          listenerInfo.listenerId);
+                                     }),
+                                     &listenerInfo);
+
+    BackgroundExecutor::getInstance().sendCallbacks(
+            {[&]() { mInvoker->windowInfosChanged(makeUpdate(1, 0), {}, false); }});
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 1; });
+    }
+    BackgroundExecutor::getInstance().sendCallbacks(
+            {[&]() { mInvoker->windowInfosChanged(makeUpdate(2, 3), {}, false); }});
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 2; });
+    }
+    listenerInfo.windowInfosPublisher->requestWindowInfosResync(listenerInfo.listenerId);
+    {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return updates.size() == 3; });
+    }
+
+    EXPECT_FALSE(updates[0].isDelta);
+    EXPECT_EQ(4u, updates[0].windowInfos.size());
+
+    EXPECT_TRUE(updates[1].isDelta);
+    EXPECT_EQ(1, updates[1].baseVsyncId);
+    ASSERT_EQ(1u, updates[1].windowInfos.size());
+    EXPECT_EQ(3, updates[1].windowInfos[0].id);
+
+    EXPECT_FALSE(updates[2].isDelta);
+    EXPECT_EQ(2, updates[2].vsyncId);
+    EXPECT_EQ(4u, updates[2].windowInfos.size());
+
+    auto debugInfo = mInvoker->getDebugInfo();
+    EXPECT_EQ(2u, debugInfo.fullUpdateCount);
+    EXPECT_EQ(1u, debugInfo.deltaUpdateCount);
+}
+
 } // namespace android
@@ -50,6 +50,18 @@ namespace api {
             data.dispatch.proc = disabled##proc; \
     } while (0)
 
+// Optional device commands are resolved on their first call rather than when
+// the device is created.  Most of them are never called through the loader.
+#define INIT_PROC_LAZY(proc) data.dispatch.proc = lazy##proc
+
+#define INIT_PROC_EXT_LAZY(ext, proc)            \
+    do {                                         \
+        if (extensions[driver::ProcHook::ext])   \
+            INIT_PROC_LAZY(proc);                \
+        else                                     \
+            data.dispatch.proc = disabled##proc; \
+    } while (0)
+
 namespace {
 
 // clang-format off
@@ -137,6 +149,357 @@ VKAPI_ATTR VkResult disabledGetMemoryAndroidHardwareBufferANDROID(VkDevice devic
     return VK_SUCCESS;
 }
 
+// Resolves an optional device command on its first call and replaces the lazy
+// stub in the dispatch table with it.
+template <typename PFN>
+PFN ResolveDeviceProc(DeviceData& data, PFN* proc, const char* name) {
+    PFN resolved = reinterpret_cast<PFN>(data.get_device_proc_addr(data.device, name));
+    ALOGE_IF(!resolved, "missing dev proc: %s", name);
+    // Threads racing to resolve the same command all store the same value.
+    __atomic_store_n(proc, resolved, __ATOMIC_RELAXED);
+    return resolved;
+}
+
+VKAPI_ATTR void lazyResetQueryPool(VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.ResetQueryPool, "vkResetQueryPool")(device, queryPool, firstQuery, queryCount);
+}
+
+VKAPI_ATTR void lazyTrimCommandPool(VkDevice device, VkCommandPool commandPool, VkCommandPoolTrimFlags flags) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.TrimCommandPool, "vkTrimCommandPool")(device, commandPool, flags);
+}
+
+VKAPI_ATTR void lazyGetDeviceGroupPeerMemoryFeatures(VkDevice device, uint32_t heapIndex, uint32_t localDeviceIndex, uint32_t remoteDeviceIndex, VkPeerMemoryFeatureFlags* pPeerMemoryFeatures) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetDeviceGroupPeerMemoryFeatures, "vkGetDeviceGroupPeerMemoryFeatures")(device, heapIndex, localDeviceIndex, remoteDeviceIndex, pPeerMemoryFeatures);
+}
+
+VKAPI_ATTR VkResult lazyBindBufferMemory2(VkDevice device, uint32_t bindInfoCount, const VkBindBufferMemoryInfo* pBindInfos) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.BindBufferMemory2, "vkBindBufferMemory2")(device, bindInfoCount, pBindInfos);
+}
+
+VKAPI_ATTR VkResult lazyBindImageMemory2(VkDevice device, uint32_t bindInfoCount, const VkBindImageMemoryInfo* pBindInfos) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.BindImageMemory2, "vkBindImageMemory2")(device, bindInfoCount, pBindInfos);
+}
+
+VKAPI_ATTR void lazyCmdSetDeviceMask(VkCommandBuffer commandBuffer, uint32_t deviceMask) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetDeviceMask, "vkCmdSetDeviceMask")(commandBuffer, deviceMask);
+}
+
+VKAPI_ATTR VkResult lazyGetDeviceGroupPresentCapabilitiesKHR(VkDevice device, VkDeviceGroupPresentCapabilitiesKHR* pDeviceGroupPresentCapabilities) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.GetDeviceGroupPresentCapabilitiesKHR, "vkGetDeviceGroupPresentCapabilitiesKHR")(device, pDeviceGroupPresentCapabilities);
+}
+
+VKAPI_ATTR VkResult lazyGetDeviceGroupSurfacePresentModesKHR(VkDevice device, VkSurfaceKHR surface, VkDeviceGroupPresentModeFlagsKHR* pModes) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.GetDeviceGroupSurfacePresentModesKHR, "vkGetDeviceGroupSurfacePresentModesKHR")(device, surface, pModes);
+}
+
+VKAPI_ATTR VkResult lazyAcquireNextImage2KHR(VkDevice device, const VkAcquireNextImageInfoKHR* pAcquireInfo, uint32_t* pImageIndex) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.AcquireNextImage2KHR, "vkAcquireNextImage2KHR")(device, pAcquireInfo, pImageIndex);
+}
+
+VKAPI_ATTR void lazyCmdDispatchBase(VkCommandBuffer commandBuffer, uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdDispatchBase, "vkCmdDispatchBase")(commandBuffer, baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY, groupCountZ);
+}
+
+VKAPI_ATTR VkResult lazyCreateDescriptorUpdateTemplate(VkDevice device, const VkDescriptorUpdateTemplateCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDescriptorUpdateTemplate* pDescriptorUpdateTemplate) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.CreateDescriptorUpdateTemplate, "vkCreateDescriptorUpdateTemplate")(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate);
+}
+
+VKAPI_ATTR void lazyDestroyDescriptorUpdateTemplate(VkDevice device, VkDescriptorUpdateTemplate descriptorUpdateTemplate, const VkAllocationCallbacks* pAllocator) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.DestroyDescriptorUpdateTemplate, "vkDestroyDescriptorUpdateTemplate")(device, descriptorUpdateTemplate, pAllocator);
+}
+
+VKAPI_ATTR void lazyUpdateDescriptorSetWithTemplate(VkDevice device, VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplate descriptorUpdateTemplate, const void* pData) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.UpdateDescriptorSetWithTemplate, "vkUpdateDescriptorSetWithTemplate")(device, descriptorSet, descriptorUpdateTemplate, pData);
+}
+
+VKAPI_ATTR void lazyGetBufferMemoryRequirements2(VkDevice device, const VkBufferMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetBufferMemoryRequirements2, "vkGetBufferMemoryRequirements2")(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetImageMemoryRequirements2(VkDevice device, const VkImageMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetImageMemoryRequirements2, "vkGetImageMemoryRequirements2")(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetImageSparseMemoryRequirements2(VkDevice device, const VkImageSparseMemoryRequirementsInfo2* pInfo, uint32_t* pSparseMemoryRequirementCount, VkSparseImageMemoryRequirements2* pSparseMemoryRequirements) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetImageSparseMemoryRequirements2, "vkGetImageSparseMemoryRequirements2")(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetDeviceBufferMemoryRequirements(VkDevice device, const VkDeviceBufferMemoryRequirements* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetDeviceBufferMemoryRequirements, "vkGetDeviceBufferMemoryRequirements")(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetDeviceImageMemoryRequirements(VkDevice device, const VkDeviceImageMemoryRequirements* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetDeviceImageMemoryRequirements, "vkGetDeviceImageMemoryRequirements")(device, pInfo, pMemoryRequirements);
+}
+
+VKAPI_ATTR void lazyGetDeviceImageSparseMemoryRequirements(VkDevice device, const VkDeviceImageMemoryRequirements* pInfo, uint32_t* pSparseMemoryRequirementCount, VkSparseImageMemoryRequirements2* pSparseMemoryRequirements) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetDeviceImageSparseMemoryRequirements, "vkGetDeviceImageSparseMemoryRequirements")(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
+}
+
+VKAPI_ATTR VkResult lazyCreateSamplerYcbcrConversion(VkDevice device, const VkSamplerYcbcrConversionCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSamplerYcbcrConversion* pYcbcrConversion) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.CreateSamplerYcbcrConversion, "vkCreateSamplerYcbcrConversion")(device, pCreateInfo, pAllocator, pYcbcrConversion);
+}
+
+VKAPI_ATTR void lazyDestroySamplerYcbcrConversion(VkDevice device, VkSamplerYcbcrConversion ycbcrConversion, const VkAllocationCallbacks* pAllocator) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.DestroySamplerYcbcrConversion, "vkDestroySamplerYcbcrConversion")(device, ycbcrConversion, pAllocator);
+}
+
+VKAPI_ATTR void lazyGetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetDeviceQueue2, "vkGetDeviceQueue2")(device, pQueueInfo, pQueue);
+}
+
+VKAPI_ATTR void lazyGetDescriptorSetLayoutSupport(VkDevice device, const VkDescriptorSetLayoutCreateInfo* pCreateInfo, VkDescriptorSetLayoutSupport* pSupport) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetDescriptorSetLayoutSupport, "vkGetDescriptorSetLayoutSupport")(device, pCreateInfo, pSupport);
+}
+
+VKAPI_ATTR VkResult lazyCreateRenderPass2(VkDevice device, const VkRenderPassCreateInfo2* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkRenderPass* pRenderPass) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.CreateRenderPass2, "vkCreateRenderPass2")(device, pCreateInfo, pAllocator, pRenderPass);
+}
+
+VKAPI_ATTR void lazyCmdBeginRenderPass2(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, const VkSubpassBeginInfo* pSubpassBeginInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdBeginRenderPass2, "vkCmdBeginRenderPass2")(commandBuffer, pRenderPassBegin, pSubpassBeginInfo);
+}
+
+VKAPI_ATTR void lazyCmdNextSubpass2(VkCommandBuffer commandBuffer, const VkSubpassBeginInfo* pSubpassBeginInfo, const VkSubpassEndInfo* pSubpassEndInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdNextSubpass2, "vkCmdNextSubpass2")(commandBuffer, pSubpassBeginInfo, pSubpassEndInfo);
+}
+
+VKAPI_ATTR void lazyCmdEndRenderPass2(VkCommandBuffer commandBuffer, const VkSubpassEndInfo* pSubpassEndInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdEndRenderPass2, "vkCmdEndRenderPass2")(commandBuffer, pSubpassEndInfo);
+}
+
+VKAPI_ATTR VkResult lazyGetSemaphoreCounterValue(VkDevice device, VkSemaphore semaphore, uint64_t* pValue) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.GetSemaphoreCounterValue, "vkGetSemaphoreCounterValue")(device, semaphore, pValue);
+}
+
+VKAPI_ATTR VkResult lazyWaitSemaphores(VkDevice device, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t timeout) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.WaitSemaphores, "vkWaitSemaphores")(device, pWaitInfo, timeout);
+}
+
+VKAPI_ATTR VkResult lazySignalSemaphore(VkDevice device, const VkSemaphoreSignalInfo* pSignalInfo) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.SignalSemaphore, "vkSignalSemaphore")(device, pSignalInfo);
+}
+
+VKAPI_ATTR void lazyCmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdDrawIndirectCount, "vkCmdDrawIndirectCount")(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
+VKAPI_ATTR void lazyCmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdDrawIndexedIndirectCount, "vkCmdDrawIndexedIndirectCount")(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
+VKAPI_ATTR uint64_t lazyGetBufferOpaqueCaptureAddress(VkDevice device, const VkBufferDeviceAddressInfo* pInfo) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.GetBufferOpaqueCaptureAddress, "vkGetBufferOpaqueCaptureAddress")(device, pInfo);
+}
+
+VKAPI_ATTR VkDeviceAddress lazyGetBufferDeviceAddress(VkDevice device, const VkBufferDeviceAddressInfo* pInfo) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.GetBufferDeviceAddress, "vkGetBufferDeviceAddress")(device, pInfo);
+}
+
+VKAPI_ATTR uint64_t lazyGetDeviceMemoryOpaqueCaptureAddress(VkDevice device, const VkDeviceMemoryOpaqueCaptureAddressInfo* pInfo) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.GetDeviceMemoryOpaqueCaptureAddress, "vkGetDeviceMemoryOpaqueCaptureAddress")(device, pInfo);
+}
+
+VKAPI_ATTR void lazyCmdSetCullMode(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetCullMode, "vkCmdSetCullMode")(commandBuffer, cullMode);
+}
+
+VKAPI_ATTR void lazyCmdSetFrontFace(VkCommandBuffer commandBuffer, VkFrontFace frontFace) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetFrontFace, "vkCmdSetFrontFace")(commandBuffer, frontFace);
+}
+
+VKAPI_ATTR void lazyCmdSetPrimitiveTopology(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetPrimitiveTopology, "vkCmdSetPrimitiveTopology")(commandBuffer, primitiveTopology);
+}
+
+VKAPI_ATTR void lazyCmdSetViewportWithCount(VkCommandBuffer commandBuffer, uint32_t viewportCount, const VkViewport* pViewports) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetViewportWithCount, "vkCmdSetViewportWithCount")(commandBuffer, viewportCount, pViewports);
+}
+
+VKAPI_ATTR void lazyCmdSetScissorWithCount(VkCommandBuffer commandBuffer, uint32_t scissorCount, const VkRect2D* pScissors) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetScissorWithCount, "vkCmdSetScissorWithCount")(commandBuffer, scissorCount, pScissors);
+}
+
+VKAPI_ATTR void lazyCmdBindVertexBuffers2(VkCommandBuffer commandBuffer, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets, const VkDeviceSize* pSizes, const VkDeviceSize* pStrides) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdBindVertexBuffers2, "vkCmdBindVertexBuffers2")(commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets, pSizes, pStrides);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthTestEnable(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetDepthTestEnable, "vkCmdSetDepthTestEnable")(commandBuffer, depthTestEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthWriteEnable(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetDepthWriteEnable, "vkCmdSetDepthWriteEnable")(commandBuffer, depthWriteEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthCompareOp(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetDepthCompareOp, "vkCmdSetDepthCompareOp")(commandBuffer, depthCompareOp);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthBoundsTestEnable(VkCommandBuffer commandBuffer, VkBool32 depthBoundsTestEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetDepthBoundsTestEnable, "vkCmdSetDepthBoundsTestEnable")(commandBuffer, depthBoundsTestEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetStencilTestEnable(VkCommandBuffer commandBuffer, VkBool32 stencilTestEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetStencilTestEnable, "vkCmdSetStencilTestEnable")(commandBuffer, stencilTestEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetStencilOp(VkCommandBuffer commandBuffer, VkStencilFaceFlags faceMask, VkStencilOp failOp, VkStencilOp passOp, VkStencilOp depthFailOp, VkCompareOp compareOp) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetStencilOp, "vkCmdSetStencilOp")(commandBuffer, faceMask, failOp, passOp, depthFailOp, compareOp);
+}
+
+VKAPI_ATTR void lazyCmdSetRasterizerDiscardEnable(VkCommandBuffer commandBuffer, VkBool32 rasterizerDiscardEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetRasterizerDiscardEnable, "vkCmdSetRasterizerDiscardEnable")(commandBuffer, rasterizerDiscardEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetDepthBiasEnable(VkCommandBuffer commandBuffer, VkBool32 depthBiasEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetDepthBiasEnable, "vkCmdSetDepthBiasEnable")(commandBuffer, depthBiasEnable);
+}
+
+VKAPI_ATTR void lazyCmdSetPrimitiveRestartEnable(VkCommandBuffer commandBuffer, VkBool32 primitiveRestartEnable) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetPrimitiveRestartEnable, "vkCmdSetPrimitiveRestartEnable")(commandBuffer, primitiveRestartEnable);
+}
+
+VKAPI_ATTR VkResult lazyCreatePrivateDataSlot(VkDevice device, const VkPrivateDataSlotCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkPrivateDataSlot* pPrivateDataSlot) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.CreatePrivateDataSlot, "vkCreatePrivateDataSlot")(device, pCreateInfo, pAllocator, pPrivateDataSlot);
+}
+
+VKAPI_ATTR void lazyDestroyPrivateDataSlot(VkDevice device, VkPrivateDataSlot privateDataSlot, const VkAllocationCallbacks* pAllocator) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.DestroyPrivateDataSlot, "vkDestroyPrivateDataSlot")(device, privateDataSlot, pAllocator);
+}
+
+VKAPI_ATTR VkResult lazySetPrivateData(VkDevice device, VkObjectType objectType, uint64_t objectHandle, VkPrivateDataSlot privateDataSlot, uint64_t data) {
+    auto& data = GetData(device);
+    return ResolveDeviceProc(data, &data.dispatch.SetPrivateData, "vkSetPrivateData")(device, objectType, objectHandle, privateDataSlot, data);
+}
+
+VKAPI_ATTR void lazyGetPrivateData(VkDevice device, VkObjectType objectType, uint64_t objectHandle, VkPrivateDataSlot privateDataSlot, uint64_t* pData) {
+    auto& data = GetData(device);
+    ResolveDeviceProc(data, &data.dispatch.GetPrivateData, "vkGetPrivateData")(device, objectType, objectHandle, privateDataSlot, pData);
+}
+
+VKAPI_ATTR void lazyCmdCopyBuffer2(VkCommandBuffer commandBuffer, const VkCopyBufferInfo2* pCopyBufferInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdCopyBuffer2, "vkCmdCopyBuffer2")(commandBuffer, pCopyBufferInfo);
+}
+
+VKAPI_ATTR void lazyCmdCopyImage2(VkCommandBuffer commandBuffer, const VkCopyImageInfo2* pCopyImageInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdCopyImage2, "vkCmdCopyImage2")(commandBuffer, pCopyImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdBlitImage2(VkCommandBuffer commandBuffer, const VkBlitImageInfo2* pBlitImageInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdBlitImage2, "vkCmdBlitImage2")(commandBuffer, pBlitImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdCopyBufferToImage2(VkCommandBuffer commandBuffer, const VkCopyBufferToImageInfo2* pCopyBufferToImageInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdCopyBufferToImage2, "vkCmdCopyBufferToImage2")(commandBuffer, pCopyBufferToImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdCopyImageToBuffer2(VkCommandBuffer commandBuffer, const VkCopyImageToBufferInfo2* pCopyImageToBufferInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdCopyImageToBuffer2, "vkCmdCopyImageToBuffer2")(commandBuffer, pCopyImageToBufferInfo);
+}
+
+VKAPI_ATTR void lazyCmdResolveImage2(VkCommandBuffer commandBuffer, const VkResolveImageInfo2* pResolveImageInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdResolveImage2, "vkCmdResolveImage2")(commandBuffer, pResolveImageInfo);
+}
+
+VKAPI_ATTR void lazyCmdSetEvent2(VkCommandBuffer commandBuffer, VkEvent event, const VkDependencyInfo* pDependencyInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdSetEvent2, "vkCmdSetEvent2")(commandBuffer, event, pDependencyInfo);
+}
+
+VKAPI_ATTR void lazyCmdResetEvent2(VkCommandBuffer commandBuffer, VkEvent event, VkPipelineStageFlags2 stageMask) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdResetEvent2, "vkCmdResetEvent2")(commandBuffer, event, stageMask);
+}
+
+VKAPI_ATTR void lazyCmdWaitEvents2(VkCommandBuffer commandBuffer, uint32_t eventCount, const VkEvent* pEvents, const VkDependencyInfo* pDependencyInfos) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdWaitEvents2, "vkCmdWaitEvents2")(commandBuffer, eventCount, pEvents, pDependencyInfos);
+}
+
+VKAPI_ATTR void lazyCmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo* pDependencyInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdPipelineBarrier2, "vkCmdPipelineBarrier2")(commandBuffer, pDependencyInfo);
+}
+
+VKAPI_ATTR VkResult lazyQueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2* pSubmits, VkFence fence) {
+    auto& data = GetData(queue);
+    return ResolveDeviceProc(data, &data.dispatch.QueueSubmit2, "vkQueueSubmit2")(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR void lazyCmdWriteTimestamp2(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, VkQueryPool queryPool, uint32_t query) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdWriteTimestamp2, "vkCmdWriteTimestamp2")(commandBuffer, stage, queryPool, query);
+}
+
+VKAPI_ATTR void lazyCmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo* pRenderingInfo) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdBeginRendering, "vkCmdBeginRendering")(commandBuffer, pRenderingInfo);
+}
+
+VKAPI_ATTR void lazyCmdEndRendering(VkCommandBuffer commandBuffer) {
+    auto& data = GetData(commandBuffer);
+    ResolveDeviceProc(data, &data.dispatch.CmdEndRendering, "vkCmdEndRendering")(commandBuffer);
+}
+
 // clang-format on
 
 }  // namespace
@@ -192,6 +555,9 @@ bool InitDispatchTable(
     auto& data = GetData(dev);
     bool success = true;
 
+    data.device = dev;
+    data.get_device_proc_addr = get_proc;
+
     // clang-format off
     INIT_PROC(true, dev, GetDeviceProcAddr);
     INIT_PROC(true, dev, DestroyDevice);
@@ -227,7 +593,7 @@ bool InitDispatchTable(
     INIT_PROC(true, dev, CreateQueryPool);
     INIT_PROC(true, dev, DestroyQueryPool);
     INIT_PROC(true, dev, GetQueryPoolResults);
-    INIT_PROC(false, dev, ResetQueryPool);
+    INIT_PROC_LAZY(ResetQueryPool);
     INIT_PROC(true, dev, CreateBuffer);
     INIT_PROC(true, dev, DestroyBuffer);
     INIT_PROC(true, dev, CreateBufferView);
@@ -320,75 +686,75 @@ bool InitDispatchTable(
     INIT_PROC_EXT(KHR_swapchain, true, dev, GetSwapchainImagesKHR);
     INIT_PROC_EXT(KHR_swapchain, true, dev, AcquireNextImageKHR);
     INIT_PROC_EXT(KHR_swapchain, true, dev, QueuePresentKHR);
-    INIT_PROC(false, dev, TrimCommandPool);
-    INIT_PROC(false, dev, GetDeviceGroupPeerMemoryFeatures);
-    INIT_PROC(false, dev, BindBufferMemory2);
-    INIT_PROC(false, dev, BindImageMemory2);
-    INIT_PROC(false, dev, CmdSetDeviceMask);
-    INIT_PROC_EXT(KHR_swapchain, false, dev, GetDeviceGroupPresentCapabilitiesKHR);
-    INIT_PROC_EXT(KHR_swapchain, false, dev, GetDeviceGroupSurfacePresentModesKHR);
-    INIT_PROC_EXT(KHR_swapchain, false, dev, AcquireNextImage2KHR);
-    INIT_PROC(false, dev, CmdDispatchBase);
-    INIT_PROC(false, dev, CreateDescriptorUpdateTemplate);
-    INIT_PROC(false, dev, DestroyDescriptorUpdateTemplate);
-    INIT_PROC(false, dev, UpdateDescriptorSetWithTemplate);
-    INIT_PROC(false, dev, GetBufferMemoryRequirements2);
-    INIT_PROC(false, dev, GetImageMemoryRequirements2);
-    INIT_PROC(false, dev, GetImageSparseMemoryRequirements2);
-    INIT_PROC(false, dev, GetDeviceBufferMemoryRequirements);
-    INIT_PROC(false, dev, GetDeviceImageMemoryRequirements);
-    INIT_PROC(false, dev, GetDeviceImageSparseMemoryRequirements);
-    INIT_PROC(false, dev, CreateSamplerYcbcrConversion);
-    INIT_PROC(false, dev, DestroySamplerYcbcrConversion);
-    INIT_PROC(false, dev, GetDeviceQueue2);
-    INIT_PROC(false, dev, GetDescriptorSetLayoutSupport);
-    INIT_PROC(false, dev, CreateRenderPass2);
-    INIT_PROC(false, dev, CmdBeginRenderPass2);
-    INIT_PROC(false, dev, CmdNextSubpass2);
-    INIT_PROC(false, dev, CmdEndRenderPass2);
-    INIT_PROC(false, dev, GetSemaphoreCounterValue);
-    INIT_PROC(false, dev, WaitSemaphores);
-    INIT_PROC(false, dev, SignalSemaphore);
+    INIT_PROC_LAZY(TrimCommandPool);
+    INIT_PROC_LAZY(GetDeviceGroupPeerMemoryFeatures);
+    INIT_PROC_LAZY(BindBufferMemory2);
+    INIT_PROC_LAZY(BindImageMemory2);
+    INIT_PROC_LAZY(CmdSetDeviceMask);
+    INIT_PROC_EXT_LAZY(KHR_swapchain, GetDeviceGroupPresentCapabilitiesKHR);
+    INIT_PROC_EXT_LAZY(KHR_swapchain, GetDeviceGroupSurfacePresentModesKHR);
+    INIT_PROC_EXT_LAZY(KHR_swapchain, AcquireNextImage2KHR);
+    INIT_PROC_LAZY(CmdDispatchBase);
+    INIT_PROC_LAZY(CreateDescriptorUpdateTemplate);
+    INIT_PROC_LAZY(DestroyDescriptorUpdateTemplate);
+    INIT_PROC_LAZY(UpdateDescriptorSetWithTemplate);
+    INIT_PROC_LAZY(GetBufferMemoryRequirements2);
+    INIT_PROC_LAZY(GetImageMemoryRequirements2);
+    INIT_PROC_LAZY(GetImageSparseMemoryRequirements2);
+    INIT_PROC_LAZY(GetDeviceBufferMemoryRequirements);
+    INIT_PROC_LAZY(GetDeviceImageMemoryRequirements);
+    INIT_PROC_LAZY(GetDeviceImageSparseMemoryRequirements);
+    INIT_PROC_LAZY(CreateSamplerYcbcrConversion);
+    INIT_PROC_LAZY(DestroySamplerYcbcrConversion);
+    INIT_PROC_LAZY(GetDeviceQueue2);
+    INIT_PROC_LAZY(GetDescriptorSetLayoutSupport);
+    INIT_PROC_LAZY(CreateRenderPass2);
+    INIT_PROC_LAZY(CmdBeginRenderPass2);
+    INIT_PROC_LAZY(CmdNextSubpass2);
+    INIT_PROC_LAZY(CmdEndRenderPass2);
+    INIT_PROC_LAZY(GetSemaphoreCounterValue);
+    INIT_PROC_LAZY(WaitSemaphores);
+    INIT_PROC_LAZY(SignalSemaphore);
     INIT_PROC_EXT(ANDROID_external_memory_android_hardware_buffer, true, dev, GetAndroidHardwareBufferPropertiesANDROID);
     INIT_PROC_EXT(ANDROID_external_memory_android_hardware_buffer, true, dev, GetMemoryAndroidHardwareBufferANDROID);
-    INIT_PROC(false, dev, CmdDrawIndirectCount);
-    INIT_PROC(false, dev, CmdDrawIndexedIndirectCount);
-    INIT_PROC(false, dev, GetBufferOpaqueCaptureAddress);
-    INIT_PROC(false, dev, GetBufferDeviceAddress);
-    INIT_PROC(false, dev, GetDeviceMemoryOpaqueCaptureAddress);
-    INIT_PROC(false, dev, CmdSetCullMode);
-    INIT_PROC(false, dev, CmdSetFrontFace);
-    INIT_PROC(false, dev, CmdSetPrimitiveTopology);
-    INIT_PROC(false, dev, CmdSetViewportWithCount);
-    INIT_PROC(false, dev, CmdSetScissorWithCount);
-    INIT_PROC(false, dev, CmdBindVertexBuffers2);
-    INIT_PROC(false, dev, CmdSetDepthTestEnable);
-    INIT_PROC(false, dev, CmdSetDepthWriteEnable);
-    INIT_PROC(false, dev, CmdSetDepthCompareOp);
-    INIT_PROC(false, dev, CmdSetDepthBoundsTestEnable);
-    INIT_PROC(false, dev, CmdSetStencilTestEnable);
-    INIT_PROC(false, dev, CmdSetStencilOp);
-    INIT_PROC(false, dev, CmdSetRasterizerDiscardEnable);
-    INIT_PROC(false, dev, CmdSetDepthBiasEnable);
-    INIT_PROC(false, dev, CmdSetPrimitiveRestartEnable);
-    INIT_PROC(false, dev, CreatePrivateDataSlot);
-    INIT_PROC(false, dev, DestroyPrivateDataSlot);
-    INIT_PROC(false, dev, SetPrivateData);
-    INIT_PROC(false, dev, GetPrivateData);
-    INIT_PROC(false, dev, CmdCopyBuffer2);
-    INIT_PROC(false, dev, CmdCopyImage2);
-    INIT_PROC(false, dev, CmdBlitImage2);
-    INIT_PROC(false, dev, CmdCopyBufferToImage2);
-    INIT_PROC(false, dev, CmdCopyImageToBuffer2);
-    INIT_PROC(false, dev, CmdResolveImage2);
-    INIT_PROC(false, dev, CmdSetEvent2);
-    INIT_PROC(false, dev, CmdResetEvent2);
-    INIT_PROC(false, dev, CmdWaitEvents2);
-    INIT_PROC(false, dev, CmdPipelineBarrier2);
-    INIT_PROC(false, dev, QueueSubmit2);
-    INIT_PROC(false, dev, CmdWriteTimestamp2);
-    INIT_PROC(false, dev, CmdBeginRendering);
-    INIT_PROC(false, dev, CmdEndRendering);
+    INIT_PROC_LAZY(CmdDrawIndirectCount);
+    INIT_PROC_LAZY(CmdDrawIndexedIndirectCount);
+    INIT_PROC_LAZY(GetBufferOpaqueCaptureAddress);
+    INIT_PROC_LAZY(GetBufferDeviceAddress);
+    INIT_PROC_LAZY(GetDeviceMemoryOpaqueCaptureAddress);
+    INIT_PROC_LAZY(CmdSetCullMode);
+    INIT_PROC_LAZY(CmdSetFrontFace);
+    INIT_PROC_LAZY(CmdSetPrimitiveTopology);
+    INIT_PROC_LAZY(CmdSetViewportWithCount);
+    INIT_PROC_LAZY(CmdSetScissorWithCount);
+    INIT_PROC_LAZY(CmdBindVertexBuffers2);
+    INIT_PROC_LAZY(CmdSetDepthTestEnable);
+    INIT_PROC_LAZY(CmdSetDepthWriteEnable);
+    INIT_PROC_LAZY(CmdSetDepthCompareOp);
+    INIT_PROC_LAZY(CmdSetDepthBoundsTestEnable);
+    INIT_PROC_LAZY(CmdSetStencilTestEnable);
+    INIT_PROC_LAZY(CmdSetStencilOp);
+    INIT_PROC_LAZY(CmdSetRasterizerDiscardEnable);
+    INIT_PROC_LAZY(CmdSetDepthBiasEnable);
+    INIT_PROC_LAZY(CmdSetPrimitiveRestartEnable);
+    INIT_PROC_LAZY(CreatePrivateDataSlot);
+    INIT_PROC_LAZY(DestroyPrivateDataSlot);
+    INIT_PROC_LAZY(SetPrivateData);
+    INIT_PROC_LAZY(GetPrivateData);
+    INIT_PROC_LAZY(CmdCopyBuffer2);
+    INIT_PROC_LAZY(CmdCopyImage2);
+    INIT_PROC_LAZY(CmdBlitImage2);
+    INIT_PROC_LAZY(CmdCopyBufferToImage2);
+    INIT_PROC_LAZY(CmdCopyImageToBuffer2);
+    INIT_PROC_LAZY(CmdResolveImage2);
+    INIT_PROC_LAZY(CmdSetEvent2);
+    INIT_PROC_LAZY(CmdResetEvent2);
+    INIT_PROC_LAZY(CmdWaitEvents2);
+    INIT_PROC_LAZY(CmdPipelineBarrier2);
+    INIT_PROC_LAZY(QueueSubmit2);
+    INIT_PROC_LAZY(CmdWriteTimestamp2);
+    INIT_PROC_LAZY(CmdBeginRendering);
+    INIT_PROC_LAZY(CmdEndRendering);
     // clang-format on
 
     return success;
@@ -1124,7 +1490,7 @@ VKAPI_ATTR VkResult GetQueryPoolResults(VkDevice device, VkQueryPool queryPool,
 }
 
 VKAPI_ATTR void ResetQueryPool(VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
-    GetData(device).dispatch.ResetQueryPool(device, queryPool, firstQuery, queryCount);
+    __atomic_load_n(&GetData(device).dispatch.ResetQueryPool, __ATOMIC_RELAXED)(device, queryPool, firstQuery, queryCount);
 }
 
 VKAPI_ATTR VkResult CreateBuffer(VkDevice device, const VkBufferCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkBuffer* pBuffer) {
@@ -1548,7 +1914,7 @@ VKAPI_ATTR void GetPhysicalDeviceSparseImageFormatProperties2(VkPhysicalDevice p
 }
 
 VKAPI_ATTR void TrimCommandPool(VkDevice device, VkCommandPool commandPool, VkCommandPoolTrimFlags flags) {
-    GetData(device).dispatch.TrimCommandPool(device, commandPool, flags);
+    __atomic_load_n(&GetData(device).dispatch.TrimCommandPool, __ATOMIC_RELAXED)(device, commandPool, flags);
 }
 
 VKAPI_ATTR void GetPhysicalDeviceExternalBufferProperties(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceExternalBufferInfo* pExternalBufferInfo, VkExternalBufferProperties* pExternalBufferProperties) {
@@ -1568,35 +1934,35 @@ VKAPI_ATTR VkResult EnumeratePhysicalDeviceGroups(VkInstance instance, uint32_t*
 }
 
 VKAPI_ATTR void GetDeviceGroupPeerMemoryFeatures(VkDevice device, uint32_t heapIndex, uint32_t localDeviceIndex, uint32_t remoteDeviceIndex, VkPeerMemoryFeatureFlags* pPeerMemoryFeatures) {
-    GetData(device).dispatch.GetDeviceGroupPeerMemoryFeatures(device, heapIndex, localDeviceIndex, remoteDeviceIndex, pPeerMemoryFeatures);
+    __atomic_load_n(&GetData(device).dispatch.GetDeviceGroupPeerMemoryFeatures, __ATOMIC_RELAXED)(device, heapIndex, localDeviceIndex, remoteDeviceIndex, pPeerMemoryFeatures);
 }
 
 VKAPI_ATTR VkResult BindBufferMemory2(VkDevice device, uint32_t bindInfoCount, const VkBindBufferMemoryInfo* pBindInfos) {
-    return GetData(device).dispatch.BindBufferMemory2(device, bindInfoCount, pBindInfos);
+    return __atomic_load_n(&GetData(device).dispatch.BindBufferMemory2, __ATOMIC_RELAXED)(device, bindInfoCount, pBindInfos);
 }
 
 VKAPI_ATTR VkResult BindImageMemory2(VkDevice device, uint32_t bindInfoCount, const VkBindImageMemoryInfo* pBindInfos) {
-    return GetData(device).dispatch.BindImageMemory2(device, bindInfoCount, pBindInfos);
+    return __atomic_load_n(&GetData(device).dispatch.BindImageMemory2, __ATOMIC_RELAXED)(device, bindInfoCount, pBindInfos);
 }
 
 VKAPI_ATTR void CmdSetDeviceMask(VkCommandBuffer commandBuffer, uint32_t deviceMask) {
-    GetData(commandBuffer).dispatch.CmdSetDeviceMask(commandBuffer, deviceMask);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetDeviceMask, __ATOMIC_RELAXED)(commandBuffer, deviceMask);
 }
 
 VKAPI_ATTR VkResult GetDeviceGroupPresentCapabilitiesKHR(VkDevice device, VkDeviceGroupPresentCapabilitiesKHR* pDeviceGroupPresentCapabilities) {
-    return GetData(device).dispatch.GetDeviceGroupPresentCapabilitiesKHR(device, pDeviceGroupPresentCapabilities);
+    return __atomic_load_n(&GetData(device).dispatch.GetDeviceGroupPresentCapabilitiesKHR, __ATOMIC_RELAXED)(device, pDeviceGroupPresentCapabilities);
 }
 
 VKAPI_ATTR VkResult GetDeviceGroupSurfacePresentModesKHR(VkDevice device, VkSurfaceKHR surface, VkDeviceGroupPresentModeFlagsKHR* pModes) {
-    return GetData(device).dispatch.GetDeviceGroupSurfacePresentModesKHR(device, surface, pModes);
+    return __atomic_load_n(&GetData(device).dispatch.GetDeviceGroupSurfacePresentModesKHR, __ATOMIC_RELAXED)(device, surface, pModes);
 }
 
 VKAPI_ATTR VkResult AcquireNextImage2KHR(VkDevice device, const VkAcquireNextImageInfoKHR* pAcquireInfo, uint32_t* pImageIndex) {
-    return GetData(device).dispatch.AcquireNextImage2KHR(device, pAcquireInfo, pImageIndex);
+    return __atomic_load_n(&GetData(device).dispatch.AcquireNextImage2KHR, __ATOMIC_RELAXED)(device, pAcquireInfo, pImageIndex);
 }
 
 VKAPI_ATTR void CmdDispatchBase(VkCommandBuffer commandBuffer, uint32_t baseGroupX, uint32_t baseGroupY, uint32_t baseGroupZ, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
-    GetData(commandBuffer).dispatch.CmdDispatchBase(commandBuffer, baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY, groupCountZ);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdDispatchBase, __ATOMIC_RELAXED)(commandBuffer, baseGroupX, baseGroupY, baseGroupZ, groupCountX, groupCountY, groupCountZ);
 }
 
 VKAPI_ATTR VkResult GetPhysicalDevicePresentRectanglesKHR(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, uint32_t* pRectCount, VkRect2D* pRects) {
@@ -1604,83 +1970,83 @@ VKAPI_ATTR VkResult GetPhysicalDevicePresentRectanglesKHR(VkPhysicalDevice physi
 }
 
 VKAPI_ATTR VkResult CreateDescriptorUpdateTemplate(VkDevice device, const VkDescriptorUpdateTemplateCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDescriptorUpdateTemplate* pDescriptorUpdateTemplate) {
-    return GetData(device).dispatch.CreateDescriptorUpdateTemplate(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate);
+    return __atomic_load_n(&GetData(device).dispatch.CreateDescriptorUpdateTemplate, __ATOMIC_RELAXED)(device, pCreateInfo, pAllocator, pDescriptorUpdateTemplate);
 }
 
 VKAPI_ATTR void DestroyDescriptorUpdateTemplate(VkDevice device, VkDescriptorUpdateTemplate descriptorUpdateTemplate, const VkAllocationCallbacks* pAllocator) {
-    GetData(device).dispatch.DestroyDescriptorUpdateTemplate(device, descriptorUpdateTemplate, pAllocator);
+    __atomic_load_n(&GetData(device).dispatch.DestroyDescriptorUpdateTemplate, __ATOMIC_RELAXED)(device, descriptorUpdateTemplate, pAllocator);
 }
 
 VKAPI_ATTR void UpdateDescriptorSetWithTemplate(VkDevice device, VkDescriptorSet descriptorSet, VkDescriptorUpdateTemplate descriptorUpdateTemplate, const void* pData) {
-    GetData(device).dispatch.UpdateDescriptorSetWithTemplate(device, descriptorSet, descriptorUpdateTemplate, pData);
+    __atomic_load_n(&GetData(device).dispatch.UpdateDescriptorSetWithTemplate, __ATOMIC_RELAXED)(device, descriptorSet, descriptorUpdateTemplate, pData);
 }
 
 VKAPI_ATTR void GetBufferMemoryRequirements2(VkDevice device, const VkBufferMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
-    GetData(device).dispatch.GetBufferMemoryRequirements2(device, pInfo, pMemoryRequirements);
+    __atomic_load_n(&GetData(device).dispatch.GetBufferMemoryRequirements2, __ATOMIC_RELAXED)(device, pInfo, pMemoryRequirements);
 }
 
 VKAPI_ATTR void GetImageMemoryRequirements2(VkDevice device, const VkImageMemoryRequirementsInfo2* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
-    GetData(device).dispatch.GetImageMemoryRequirements2(device, pInfo, pMemoryRequirements);
+    __atomic_load_n(&GetData(device).dispatch.GetImageMemoryRequirements2, __ATOMIC_RELAXED)(device, pInfo, pMemoryRequirements);
 }
 
 VKAPI_ATTR void GetImageSparseMemoryRequirements2(VkDevice device, const VkImageSparseMemoryRequirementsInfo2* pInfo, uint32_t* pSparseMemoryRequirementCount, VkSparseImageMemoryRequirements2* pSparseMemoryRequirements) {
-    GetData(device).dispatch.GetImageSparseMemoryRequirements2(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
+    __atomic_load_n(&GetData(device).dispatch.GetImageSparseMemoryRequirements2, __ATOMIC_RELAXED)(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
 }
 
 VKAPI_ATTR void GetDeviceBufferMemoryRequirements(VkDevice device, const VkDeviceBufferMemoryRequirements* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
-    GetData(device).dispatch.GetDeviceBufferMemoryRequirements(device, pInfo, pMemoryRequirements);
+    __atomic_load_n(&GetData(device).dispatch.GetDeviceBufferMemoryRequirements, __ATOMIC_RELAXED)(device, pInfo, pMemoryRequirements);
 }
 
 VKAPI_ATTR void GetDeviceImageMemoryRequirements(VkDevice device, const VkDeviceImageMemoryRequirements* pInfo, VkMemoryRequirements2* pMemoryRequirements) {
-    GetData(device).dispatch.GetDeviceImageMemoryRequirements(device, pInfo, pMemoryRequirements);
+    __atomic_load_n(&GetData(device).dispatch.GetDeviceImageMemoryRequirements, __ATOMIC_RELAXED)(device, pInfo, pMemoryRequirements);
 }
 
 VKAPI_ATTR void GetDeviceImageSparseMemoryRequirements(VkDevice device, const VkDeviceImageMemoryRequirements* pInfo, uint32_t* pSparseMemoryRequirementCount, VkSparseImageMemoryRequirements2* pSparseMemoryRequirements) {
-    GetData(device).dispatch.GetDeviceImageSparseMemoryRequirements(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
+    __atomic_load_n(&GetData(device).dispatch.GetDeviceImageSparseMemoryRequirements, __ATOMIC_RELAXED)(device, pInfo, pSparseMemoryRequirementCount, pSparseMemoryRequirements);
 }
 
 VKAPI_ATTR VkResult CreateSamplerYcbcrConversion(VkDevice device, const VkSamplerYcbcrConversionCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSamplerYcbcrConversion* pYcbcrConversion) {
-    return GetData(device).dispatch.CreateSamplerYcbcrConversion(device, pCreateInfo, pAllocator, pYcbcrConversion);
+    return __atomic_load_n(&GetData(device).dispatch.CreateSamplerYcbcrConversion, __ATOMIC_RELAXED)(device, pCreateInfo, pAllocator, pYcbcrConversion);
 }
 
 VKAPI_ATTR void DestroySamplerYcbcrConversion(VkDevice device, VkSamplerYcbcrConversion ycbcrConversion, const VkAllocationCallbacks* pAllocator) {
-    GetData(device).dispatch.DestroySamplerYcbcrConversion(device, ycbcrConversion, pAllocator);
+    __atomic_load_n(&GetData(device).dispatch.DestroySamplerYcbcrConversion, __ATOMIC_RELAXED)(device, ycbcrConversion, pAllocator);
 }
 
 VKAPI_ATTR void GetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue) {
-    GetData(device).dispatch.GetDeviceQueue2(device, pQueueInfo, pQueue);
+    __atomic_load_n(&GetData(device).dispatch.GetDeviceQueue2, __ATOMIC_RELAXED)(device, pQueueInfo, pQueue);
 }
 
 VKAPI_ATTR void GetDescriptorSetLayoutSupport(VkDevice device, const VkDescriptorSetLayoutCreateInfo* pCreateInfo, VkDescriptorSetLayoutSupport* pSupport) {
-    GetData(device).dispatch.GetDescriptorSetLayoutSupport(device, pCreateInfo, pSupport);
+    __atomic_load_n(&GetData(device).dispatch.GetDescriptorSetLayoutSupport, __ATOMIC_RELAXED)(device, pCreateInfo, pSupport);
 }
 
 VKAPI_ATTR VkResult CreateRenderPass2(VkDevice device, const VkRenderPassCreateInfo2* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkRenderPass* pRenderPass) {
-    return GetData(device).dispatch.CreateRenderPass2(device, pCreateInfo, pAllocator, pRenderPass);
+    return __atomic_load_n(&GetData(device).dispatch.CreateRenderPass2, __ATOMIC_RELAXED)(device, pCreateInfo, pAllocator, pRenderPass);
 }
 
 VKAPI_ATTR void CmdBeginRenderPass2(VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, const VkSubpassBeginInfo* pSubpassBeginInfo) {
-    GetData(commandBuffer).dispatch.CmdBeginRenderPass2(commandBuffer, pRenderPassBegin, pSubpassBeginInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdBeginRenderPass2, __ATOMIC_RELAXED)(commandBuffer, pRenderPassBegin, pSubpassBeginInfo);
 }
 
 VKAPI_ATTR void CmdNextSubpass2(VkCommandBuffer commandBuffer, const VkSubpassBeginInfo* pSubpassBeginInfo, const VkSubpassEndInfo* pSubpassEndInfo) {
-    GetData(commandBuffer).dispatch.CmdNextSubpass2(commandBuffer, pSubpassBeginInfo, pSubpassEndInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdNextSubpass2, __ATOMIC_RELAXED)(commandBuffer, pSubpassBeginInfo, pSubpassEndInfo);
 }
 
 VKAPI_ATTR void CmdEndRenderPass2(VkCommandBuffer commandBuffer, const VkSubpassEndInfo* pSubpassEndInfo) {
-    GetData(commandBuffer).dispatch.CmdEndRenderPass2(commandBuffer, pSubpassEndInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdEndRenderPass2, __ATOMIC_RELAXED)(commandBuffer, pSubpassEndInfo);
 }
 
 VKAPI_ATTR VkResult GetSemaphoreCounterValue(VkDevice device, VkSemaphore semaphore, uint64_t* pValue) {
-    return GetData(device).dispatch.GetSemaphoreCounterValue(device, semaphore, pValue);
+    return __atomic_load_n(&GetData(device).dispatch.GetSemaphoreCounterValue, __ATOMIC_RELAXED)(device, semaphore, pValue);
 }
 
 VKAPI_ATTR VkResult WaitSemaphores(VkDevice device, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t timeout) {
-    return GetData(device).dispatch.WaitSemaphores(device, pWaitInfo, timeout);
+    return __atomic_load_n(&GetData(device).dispatch.WaitSemaphores, __ATOMIC_RELAXED)(device, pWaitInfo, timeout);
 }
 
 VKAPI_ATTR VkResult SignalSemaphore(VkDevice device, const VkSemaphoreSignalInfo* pSignalInfo) {
-    return GetData(device).dispatch.SignalSemaphore(device, pSignalInfo);
+    return __atomic_load_n(&GetData(device).dispatch.SignalSemaphore, __ATOMIC_RELAXED)(device, pSignalInfo);
 }
 
 VKAPI_ATTR VkResult GetAndroidHardwareBufferPropertiesANDROID(VkDevice device, const struct AHardwareBuffer* buffer, VkAndroidHardwareBufferPropertiesANDROID* pProperties) {
@@ -1692,23 +2058,23 @@ VKAPI_ATTR VkResult GetMemoryAndroidHardwareBufferANDROID(VkDevice device, const
 }
 
 VKAPI_ATTR void CmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
-    GetData(commandBuffer).dispatch.CmdDrawIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdDrawIndirectCount, __ATOMIC_RELAXED)(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
 }
 
 VKAPI_ATTR void CmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
-    GetData(commandBuffer).dispatch.CmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdDrawIndexedIndirectCount, __ATOMIC_RELAXED)(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
 }
 
 VKAPI_ATTR uint64_t GetBufferOpaqueCaptureAddress(VkDevice device, const VkBufferDeviceAddressInfo* pInfo) {
-    return GetData(device).dispatch.GetBufferOpaqueCaptureAddress(device, pInfo);
+    return __atomic_load_n(&GetData(device).dispatch.GetBufferOpaqueCaptureAddress, __ATOMIC_RELAXED)(device, pInfo);
 }
 
 VKAPI_ATTR VkDeviceAddress GetBufferDeviceAddress(VkDevice device, const VkBufferDeviceAddressInfo* pInfo) {
-    return GetData(device).dispatch.GetBufferDeviceAddress(device, pInfo);
+    return __atomic_load_n(&GetData(device).dispatch.GetBufferDeviceAddress, __ATOMIC_RELAXED)(device, pInfo);
 }
 
 VKAPI_ATTR uint64_t GetDeviceMemoryOpaqueCaptureAddress(VkDevice device, const VkDeviceMemoryOpaqueCaptureAddressInfo* pInfo) {
-    return GetData(device).dispatch.GetDeviceMemoryOpaqueCaptureAddress(device, pInfo);
+    return __atomic_load_n(&GetData(device).dispatch.GetDeviceMemoryOpaqueCaptureAddress, __ATOMIC_RELAXED)(device, pInfo);
 }
 
 VKAPI_ATTR VkResult GetPhysicalDeviceToolProperties(VkPhysicalDevice physicalDevice, uint32_t* pToolCount, VkPhysicalDeviceToolProperties* pToolProperties) {
@@ -1716,135 +2082,135 @@ VKAPI_ATTR VkResult GetPhysicalDeviceToolProperties(VkPhysicalDevice physicalDev
 }
 
 VKAPI_ATTR void CmdSetCullMode(VkCommandBuffer commandBuffer, VkCullModeFlags cullMode) {
-    GetData(commandBuffer).dispatch.CmdSetCullMode(commandBuffer, cullMode);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetCullMode, __ATOMIC_RELAXED)(commandBuffer, cullMode);
 }
 
 VKAPI_ATTR void CmdSetFrontFace(VkCommandBuffer commandBuffer, VkFrontFace frontFace) {
-    GetData(commandBuffer).dispatch.CmdSetFrontFace(commandBuffer, frontFace);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetFrontFace, __ATOMIC_RELAXED)(commandBuffer, frontFace);
 }
 
 VKAPI_ATTR void CmdSetPrimitiveTopology(VkCommandBuffer commandBuffer, VkPrimitiveTopology primitiveTopology) {
-    GetData(commandBuffer).dispatch.CmdSetPrimitiveTopology(commandBuffer, primitiveTopology);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetPrimitiveTopology, __ATOMIC_RELAXED)(commandBuffer, primitiveTopology);
 }
 
 VKAPI_ATTR void CmdSetViewportWithCount(VkCommandBuffer commandBuffer, uint32_t viewportCount, const VkViewport* pViewports) {
-    GetData(commandBuffer).dispatch.CmdSetViewportWithCount(commandBuffer, viewportCount, pViewports);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetViewportWithCount, __ATOMIC_RELAXED)(commandBuffer, viewportCount, pViewports);
 }
 
 VKAPI_ATTR void CmdSetScissorWithCount(VkCommandBuffer commandBuffer, uint32_t scissorCount, const VkRect2D* pScissors) {
-    GetData(commandBuffer).dispatch.CmdSetScissorWithCount(commandBuffer, scissorCount, pScissors);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetScissorWithCount, __ATOMIC_RELAXED)(commandBuffer, scissorCount, pScissors);
 }
 
 VKAPI_ATTR void CmdBindVertexBuffers2(VkCommandBuffer commandBuffer, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets, const VkDeviceSize* pSizes, const VkDeviceSize* pStrides) {
-    GetData(commandBuffer).dispatch.CmdBindVertexBuffers2(commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets, pSizes, pStrides);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdBindVertexBuffers2, __ATOMIC_RELAXED)(commandBuffer, firstBinding, bindingCount, pBuffers, pOffsets, pSizes, pStrides);
 }
 
 VKAPI_ATTR void CmdSetDepthTestEnable(VkCommandBuffer commandBuffer, VkBool32 depthTestEnable) {
-    GetData(commandBuffer).dispatch.CmdSetDepthTestEnable(commandBuffer, depthTestEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetDepthTestEnable, __ATOMIC_RELAXED)(commandBuffer, depthTestEnable);
 }
 
 VKAPI_ATTR void CmdSetDepthWriteEnable(VkCommandBuffer commandBuffer, VkBool32 depthWriteEnable) {
-    GetData(commandBuffer).dispatch.CmdSetDepthWriteEnable(commandBuffer, depthWriteEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetDepthWriteEnable, __ATOMIC_RELAXED)(commandBuffer, depthWriteEnable);
 }
 
 VKAPI_ATTR void CmdSetDepthCompareOp(VkCommandBuffer commandBuffer, VkCompareOp depthCompareOp) {
-    GetData(commandBuffer).dispatch.CmdSetDepthCompareOp(commandBuffer, depthCompareOp);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetDepthCompareOp, __ATOMIC_RELAXED)(commandBuffer, depthCompareOp);
 }
 
 VKAPI_ATTR void CmdSetDepthBoundsTestEnable(VkCommandBuffer commandBuffer, VkBool32 depthBoundsTestEnable) {
-    GetData(commandBuffer).dispatch.CmdSetDepthBoundsTestEnable(commandBuffer, depthBoundsTestEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetDepthBoundsTestEnable, __ATOMIC_RELAXED)(commandBuffer, depthBoundsTestEnable);
 }
 
 VKAPI_ATTR void CmdSetStencilTestEnable(VkCommandBuffer commandBuffer, VkBool32 stencilTestEnable) {
-    GetData(commandBuffer).dispatch.CmdSetStencilTestEnable(commandBuffer, stencilTestEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetStencilTestEnable, __ATOMIC_RELAXED)(commandBuffer, stencilTestEnable);
 }
 
 VKAPI_ATTR void CmdSetStencilOp(VkCommandBuffer commandBuffer, VkStencilFaceFlags faceMask, VkStencilOp failOp, VkStencilOp passOp, VkStencilOp depthFailOp, VkCompareOp compareOp) {
-    GetData(commandBuffer).dispatch.CmdSetStencilOp(commandBuffer, faceMask, failOp, passOp, depthFailOp, compareOp);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetStencilOp, __ATOMIC_RELAXED)(commandBuffer, faceMask, failOp, passOp, depthFailOp, compareOp);
 }
 
 VKAPI_ATTR void CmdSetRasterizerDiscardEnable(VkCommandBuffer commandBuffer, VkBool32 rasterizerDiscardEnable) {
-    GetData(commandBuffer).dispatch.CmdSetRasterizerDiscardEnable(commandBuffer, rasterizerDiscardEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetRasterizerDiscardEnable, __ATOMIC_RELAXED)(commandBuffer, rasterizerDiscardEnable);
 }
 
 VKAPI_ATTR void CmdSetDepthBiasEnable(VkCommandBuffer commandBuffer, VkBool32 depthBiasEnable) {
-    GetData(commandBuffer).dispatch.CmdSetDepthBiasEnable(commandBuffer, depthBiasEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetDepthBiasEnable, __ATOMIC_RELAXED)(commandBuffer, depthBiasEnable);
 }
 
 VKAPI_ATTR void CmdSetPrimitiveRestartEnable(VkCommandBuffer commandBuffer, VkBool32 primitiveRestartEnable) {
-    GetData(commandBuffer).dispatch.CmdSetPrimitiveRestartEnable(commandBuffer, primitiveRestartEnable);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetPrimitiveRestartEnable, __ATOMIC_RELAXED)(commandBuffer, primitiveRestartEnable);
 }
 
 VKAPI_ATTR VkResult CreatePrivateDataSlot(VkDevice device, const VkPrivateDataSlotCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkPrivateDataSlot* pPrivateDataSlot) {
-    return GetData(device).dispatch.CreatePrivateDataSlot(device, pCreateInfo, pAllocator, pPrivateDataSlot);
+    return __atomic_load_n(&GetData(device).dispatch.CreatePrivateDataSlot, __ATOMIC_RELAXED)(device, pCreateInfo, pAllocator, pPrivateDataSlot);
 }
 
 VKAPI_ATTR void DestroyPrivateDataSlot(VkDevice device, VkPrivateDataSlot privateDataSlot, const VkAllocationCallbacks* pAllocator) {
-    GetData(device).dispatch.DestroyPrivateDataSlot(device, privateDataSlot, pAllocator);
+    __atomic_load_n(&GetData(device).dispatch.DestroyPrivateDataSlot, __ATOMIC_RELAXED)(device, privateDataSlot, pAllocator);
 }
 
 VKAPI_ATTR VkResult SetPrivateData(VkDevice device, VkObjectType objectType, uint64_t objectHandle, VkPrivateDataSlot privateDataSlot, uint64_t data) {
-    return GetData(device).dispatch.SetPrivateData(device, objectType, objectHandle, privateDataSlot, data);
+    return __atomic_load_n(&GetData(device).dispatch.SetPrivateData, __ATOMIC_RELAXED)(device, objectType, objectHandle, privateDataSlot, data);
 }
 
 VKAPI_ATTR void GetPrivateData(VkDevice device, VkObjectType objectType, uint64_t objectHandle, VkPrivateDataSlot privateDataSlot, uint64_t* pData) {
-    GetData(device).dispatch.GetPrivateData(device, objectType, objectHandle, privateDataSlot, pData);
+    __atomic_load_n(&GetData(device).dispatch.GetPrivateData, __ATOMIC_RELAXED)(device, objectType, objectHandle, privateDataSlot, pData);
 }
 
 VKAPI_ATTR void CmdCopyBuffer2(VkCommandBuffer commandBuffer, const VkCopyBufferInfo2* pCopyBufferInfo) {
-    GetData(commandBuffer).dispatch.CmdCopyBuffer2(commandBuffer, pCopyBufferInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdCopyBuffer2, __ATOMIC_RELAXED)(commandBuffer, pCopyBufferInfo);
 }
 
 VKAPI_ATTR void CmdCopyImage2(VkCommandBuffer commandBuffer, const VkCopyImageInfo2* pCopyImageInfo) {
-    GetData(commandBuffer).dispatch.CmdCopyImage2(commandBuffer, pCopyImageInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdCopyImage2, __ATOMIC_RELAXED)(commandBuffer, pCopyImageInfo);
 }
 
 VKAPI_ATTR void CmdBlitImage2(VkCommandBuffer commandBuffer, const VkBlitImageInfo2* pBlitImageInfo) {
-    GetData(commandBuffer).dispatch.CmdBlitImage2(commandBuffer, pBlitImageInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdBlitImage2, __ATOMIC_RELAXED)(commandBuffer, pBlitImageInfo);
 }
 
 VKAPI_ATTR void CmdCopyBufferToImage2(VkCommandBuffer commandBuffer, const VkCopyBufferToImageInfo2* pCopyBufferToImageInfo) {
-    GetData(commandBuffer).dispatch.CmdCopyBufferToImage2(commandBuffer, pCopyBufferToImageInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdCopyBufferToImage2, __ATOMIC_RELAXED)(commandBuffer, pCopyBufferToImageInfo);
 }
 
 VKAPI_ATTR void CmdCopyImageToBuffer2(VkCommandBuffer commandBuffer, const VkCopyImageToBufferInfo2* pCopyImageToBufferInfo) {
-    GetData(commandBuffer).dispatch.CmdCopyImageToBuffer2(commandBuffer, pCopyImageToBufferInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdCopyImageToBuffer2, __ATOMIC_RELAXED)(commandBuffer, pCopyImageToBufferInfo);
 }
 
 VKAPI_ATTR void CmdResolveImage2(VkCommandBuffer commandBuffer, const VkResolveImageInfo2* pResolveImageInfo) {
-    GetData(commandBuffer).dispatch.CmdResolveImage2(commandBuffer, pResolveImageInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdResolveImage2, __ATOMIC_RELAXED)(commandBuffer, pResolveImageInfo);
 }
 
 VKAPI_ATTR void CmdSetEvent2(VkCommandBuffer commandBuffer, VkEvent event, const VkDependencyInfo* pDependencyInfo) {
-    GetData(commandBuffer).dispatch.CmdSetEvent2(commandBuffer, event, pDependencyInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdSetEvent2, __ATOMIC_RELAXED)(commandBuffer, event, pDependencyInfo);
 }
 
 VKAPI_ATTR void CmdResetEvent2(VkCommandBuffer commandBuffer, VkEvent event, VkPipelineStageFlags2 stageMask) {
-    GetData(commandBuffer).dispatch.CmdResetEvent2(commandBuffer, event, stageMask);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdResetEvent2, __ATOMIC_RELAXED)(commandBuffer, event, stageMask);
 }
 
 VKAPI_ATTR void CmdWaitEvents2(VkCommandBuffer commandBuffer, uint32_t eventCount, const VkEvent* pEvents, const VkDependencyInfo* pDependencyInfos) {
-    GetData(commandBuffer).dispatch.CmdWaitEvents2(commandBuffer, eventCount, pEvents, pDependencyInfos);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdWaitEvents2, __ATOMIC_RELAXED)(commandBuffer, eventCount, pEvents, pDependencyInfos);
 }
 
 VKAPI_ATTR void CmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo* pDependencyInfo) {
-    GetData(commandBuffer).dispatch.CmdPipelineBarrier2(commandBuffer, pDependencyInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdPipelineBarrier2, __ATOMIC_RELAXED)(commandBuffer, pDependencyInfo);
 }
 
 VKAPI_ATTR VkResult QueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2* pSubmits, VkFence fence) {
-    return GetData(queue).dispatch.QueueSubmit2(queue, submitCount, pSubmits, fence);
+    return __atomic_load_n(&GetData(queue).dispatch.QueueSubmit2, __ATOMIC_RELAXED)(queue, submitCount, pSubmits, fence);
 }
 
 VKAPI_ATTR void CmdWriteTimestamp2(VkCommandBuffer commandBuffer, VkPipelineStageFlags2 stage, VkQueryPool queryPool, uint32_t query) {
-    GetData(commandBuffer).dispatch.CmdWriteTimestamp2(commandBuffer, stage, queryPool, query);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdWriteTimestamp2, __ATOMIC_RELAXED)(commandBuffer, stage, queryPool, query);
 }
 
 VKAPI_ATTR void CmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo* pRenderingInfo) {
-    GetData(commandBuffer).dispatch.CmdBeginRendering(commandBuffer, pRenderingInfo);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdBeginRendering, __ATOMIC_RELAXED)(commandBuffer, pRenderingInfo);
 }
 
 VKAPI_ATTR void CmdEndRendering(VkCommandBuffer commandBuffer) {
-    GetData(commandBuffer).dispatch.CmdEndRendering(commandBuffer);
+    __atomic_load_n(&GetData(commandBuffer).dispatch.CmdEndRendering, __ATOMIC_RELAXED)(commandBuffer);
 }
 
 
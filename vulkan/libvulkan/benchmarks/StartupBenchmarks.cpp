@@ -0,0 +1,255 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <benchmark/benchmark.h>
+#include <graphicsenv/GraphicsEnv.h>
+#include <vulkan/vulkan.h>
+
+namespace {
+
+// Installed next to the benchmark, see the "data" property in Android.bp.
+constexpr char kNullDriverLibrary[] = "libvulkan_benchmarks_nulldrv.so";
+constexpr char kNullDriverName[] = "Android Vulkan Null Driver";
+
+// Same properties libvulkan uses to pick the name of the driver library.
+constexpr const char* kDriverNameProperties[] = {"ro.hardware.vulkan", "ro.board.platform"};
+
+using Clock = std::chrono::steady_clock;
+
+// First vkCreateInstance and vkCreateDevice of the process, timed in main() before any benchmark
+// touches the loader.
+struct ColdStartup {
+    double instanceSeconds = 0;
+    double deviceSeconds = 0;
+} gColdStartup;
+
+VkInstance createInstance() {
+    const VkApplicationInfo appInfo = {
+            .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+            .apiVersion = VK_API_VERSION_1_1,
+    };
+    const VkInstanceCreateInfo createInfo = {
+            .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+            .pApplicationInfo = &appInfo,
+    };
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    return instance;
+}
+
+VkPhysicalDevice getFirstPhysicalDevice(VkInstance instance) {
+    uint32_t count = 0;
+    vkEnumeratePhysicalDevices(instance, &count, nullptr);
+    if (count == 0) {
+        return VK_NULL_HANDLE;
+    }
+    std::vector<VkPhysicalDevice> devices(count);
+    vkEnumeratePhysicalDevices(instance, &count, devices.data());
+    return devices[0];
+}
+
+VkDevice createDevice(VkPhysicalDevice physicalDevice) {
+    const float priority = 1.0f;
+    const VkDeviceQueueCreateInfo queueInfo = {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .queueFamilyIndex = 0,
+            .queueCount = 1,
+            .pQueuePriorities = &priority,
+    };
+    const VkDeviceCreateInfo createInfo = {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+            .queueCreateInfoCount = 1,
+            .pQueueCreateInfos = &queueInfo,
+    };
+    VkDevice device = VK_NULL_HANDLE;
+    if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    return device;
+}
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Points libvulkan at the null driver shipped with the benchmark instead of the device's driver.
+// The loader looks the updatable driver up by the same vulkan.<property>.so name as the built-in
+// one, so the driver is linked under those names into a directory used as the driver path.
+// Returns the directory, or an empty string on failure.
+std::string stageNullDriver() {
+    const std::string driver = android::base::GetExecutableDirectory() + "/" + kNullDriverLibrary;
+    if (access(driver.c_str(), R_OK) != 0) {
+        fprintf(stderr, "cannot find %s: %s\n", driver.c_str(), strerror(errno));
+        return "";
+    }
+
+    char dir[] = "/data/local/tmp/libvulkan_benchmarks.XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        fprintf(stderr, "mkdtemp failed: %s\n", strerror(errno));
+        return "";
+    }
+    for (const char* property : kDriverNameProperties) {
+        const std::string name = android::base::GetProperty(property, "");
+        if (name.empty()) {
+            continue;
+        }
+        const std::string link = std::string(dir) + "/vulkan." + name + ".so";
+        if (symlink(driver.c_str(), link.c_str()) != 0 && errno != EEXIST) {
+            fprintf(stderr, "symlink %s failed: %s\n", link.c_str(), strerror(errno));
+        }
+    }
+    android::GraphicsEnv::getInstance().setDriverPathAndSphalLibraries(dir, "");
+    return dir;
+}
+
+void removeStagedNullDriver(const std::string& dir) {
+    for (const char* property : kDriverNameProperties) {
+        const std::string name = android::base::GetProperty(property, "");
+        if (!name.empty()) {
+            unlink((dir + "/vulkan." + name + ".so").c_str());
+        }
+    }
+    rmdir(dir.c_str());
+}
+
+// Times the first instance and device of the process, which include loader initialization,
+// layer discovery and driver loading. Fails unless the loader picked up the null driver.
+bool measureColdStartup() {
+    Clock::time_point start = Clock::now();
+    VkInstance instance = createInstance();
+    gColdStartup.instanceSeconds = secondsSince(start);
+    if (instance == VK_NULL_HANDLE) {
+        fprintf(stderr, "vkCreateInstance failed\n");
+        return false;
+    }
+
+    bool loaded = false;
+    VkPhysicalDevice physicalDevice = getFirstPhysicalDevice(instance);
+    if (physicalDevice != VK_NULL_HANDLE) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        loaded = strcmp(properties.deviceName, kNullDriverName) == 0;
+        if (!loaded) {
+            fprintf(stderr, "loaded driver '%s' instead of the null driver\n",
+                    properties.deviceName);
+        }
+    }
+    if (loaded) {
+        start = Clock::now();
+        VkDevice device = createDevice(physicalDevice);
+        gColdStartup.deviceSeconds = secondsSince(start);
+        if (device == VK_NULL_HANDLE) {
+            fprintf(stderr, "vkCreateDevice failed\n");
+            loaded = false;
+        }
+        vkDestroyDevice(device, nullptr);
+    }
+    vkDestroyInstance(instance, nullptr);
+    return loaded;
+}
+
+} // namespace
+
+// First vkCreateInstance of the process, measured once in main().
+static void BM_createInstanceCold(benchmark::State& state) {
+    for (auto _ : state) {
+        state.SetIterationTime(gColdStartup.instanceSeconds);
+    }
+}
+BENCHMARK(BM_createInstanceCold)->UseManualTime()->Iterations(1);
+
+// First vkCreateDevice of the process, measured once in main().
+static void BM_createDeviceCold(benchmark::State& state) {
+    for (auto _ : state) {
+        state.SetIterationTime(gColdStartup.deviceSeconds);
+    }
+}
+BENCHMARK(BM_createDeviceCold)->UseManualTime()->Iterations(1);
+
+// Cost of bringing up an instance once the loader has been initialized.
+static void BM_createInstance(benchmark::State& state) {
+    for (auto _ : state) {
+        VkInstance instance = createInstance();
+        if (instance == VK_NULL_HANDLE) {
+            state.SkipWithError("vkCreateInstance failed");
+            break;
+        }
+        vkDestroyInstance(instance, nullptr);
+    }
+}
+BENCHMARK(BM_createInstance);
+
+// Cost of vkCreateDevice, which builds the device dispatch table of the loader.
+static void BM_createDevice(benchmark::State& state) {
+    VkInstance instance = createInstance();
+    if (instance == VK_NULL_HANDLE) {
+        state.SkipWithError("vkCreateInstance failed");
+        return;
+    }
+    VkPhysicalDevice physicalDevice = getFirstPhysicalDevice(instance);
+    if (physicalDevice == VK_NULL_HANDLE) {
+        vkDestroyInstance(instance, nullptr);
+        state.SkipWithError("no physical device");
+        return;
+    }
+
+    for (auto _ : state) {
+        VkDevice device = createDevice(physicalDevice);
+        if (device == VK_NULL_HANDLE) {
+            state.SkipWithError("vkCreateDevice failed");
+            break;
+        }
+        vkDestroyDevice(device, nullptr);
+    }
+    vkDestroyInstance(instance, nullptr);
+}
+BENCHMARK(BM_createDevice);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    // Must happen before the first Vulkan call, which is when libvulkan loads its driver.
+    const std::string driverDir = stageNullDriver();
+    if (driverDir.empty()) {
+        return 1;
+    }
+    const bool loaded = measureColdStartup();
+    removeStagedNullDriver(driverDir);
+    if (!loaded) {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/Surface.h>
+#include <vulkan/vulkan.h>
+
+using namespace android;
+
+namespace {
+
+constexpr VkExtent2D kExtent = {256, 256};
+constexpr VkExtent2D kOtherExtent = {320, 240};
+constexpr uint32_t kMinImageCount = 3;
+
+class StubConsumerListener : public BnConsumerListener {
+public:
+    void onFrameAvailable(const BufferItem& /*item*/) override {}
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+};
+
+// A Vulkan device presenting to a BufferQueue. The benchmark plays the consumer, which takes
+// every frame as soon as it's queued and hands the buffer back right away.
+class Presenter {
+public:
+    Presenter() {
+        BufferQueue::createBufferQueue(&mProducer, &mConsumer);
+        mConsumer->consumerConnect(sp<StubConsumerListener>::make(), false);
+        mWindow = sp<Surface>::make(mProducer);
+
+        const char* instanceExtensions[] = {VK_KHR_SURFACE_EXTENSION_NAME,
+                                            VK_KHR_ANDROID_SURFACE_EXTENSION_NAME};
+        const VkApplicationInfo appInfo = {
+                .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+                .apiVersion = VK_API_VERSION_1_1,
+        };
+        const VkInstanceCreateInfo instanceInfo = {
+                .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+                .pApplicationInfo = &appInfo,
+                .enabledExtensionCount = 2,
+                .ppEnabledExtensionNames = instanceExtensions,
+        };
+        if (vkCreateInstance(&instanceInfo, nullptr, &mInstance) != VK_SUCCESS) {
+            mInstance = VK_NULL_HANDLE;
+            return;
+        }
+
+        uint32_t count = 1;
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        vkEnumeratePhysicalDevices(mInstance, &count, &physicalDevice);
+        if (physicalDevice == VK_NULL_HANDLE) {
+            return;
+        }
+
+        const char* deviceExtensions[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        const float priority = 1.0f;
+        const VkDeviceQueueCreateInfo queueInfo = {
+                .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                .queueFamilyIndex = 0,
+                .queueCount = 1,
+                .pQueuePriorities = &priority,
+        };
+        const VkDeviceCreateInfo deviceInfo = {
+                .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+                .queueCreateInfoCount = 1,
+                .pQueueCreateInfos = &queueInfo,
+                .enabledExtensionCount = 1,
+                .ppEnabledExtensionNames = deviceExtensions,
+        };
+        if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &mDevice) != VK_SUCCESS) {
+            mDevice = VK_NULL_HANDLE;
+            return;
+        }
+        vkGetDeviceQueue(mDevice, 0, 0, &mQueue);
+
+        const VkAndroidSurfaceCreateInfoKHR surfaceInfo = {
+                .sType = VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR,
+                .window = mWindow.get(),
+        };
+        if (vkCreateAndroidSurfaceKHR(mInstance, &surfaceInfo, nullptr, &mSurface) !=
+            VK_SUCCESS) {
+            mSurface = VK_NULL_HANDLE;
+            return;
+        }
+
+        const VkSemaphoreCreateInfo semaphoreInfo = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        };
+        vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mSemaphore);
+    }
+
+    ~Presenter() {
+        if (mDevice != VK_NULL_HANDLE) {
+            vkDeviceWaitIdle(mDevice);
+            vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+            vkDestroySemaphore(mDevice, mSemaphore, nullptr);
+            vkDestroyDevice(mDevice, nullptr);
+        }
+        if (mInstance != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+            vkDestroyInstance(mInstance, nullptr);
+        }
+    }
+
+    bool isValid() const { return mSurface != VK_NULL_HANDLE && mSemaphore != VK_NULL_HANDLE; }
+
+    // Replaces the current swapchain, if any, with one of the given size and present mode.
+    bool recreateSwapchain(VkExtent2D extent,
+                           VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR) {
+        const VkSwapchainCreateInfoKHR swapchainInfo = {
+                .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+                .surface = mSurface,
+                .minImageCount = kMinImageCount,
+                .imageFormat = VK_FORMAT_R8G8B8A8_UNORM,
+                .imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
+                .imageExtent = extent,
+                .imageArrayLayers = 1,
+                .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
+                .compositeAlpha = VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+                .presentMode = presentMode,
+                .clipped = VK_TRUE,
+                .oldSwapchain = mSwapchain,
+        };
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        const VkResult result = vkCreateSwapchainKHR(mDevice, &swapchainInfo, nullptr, &swapchain);
+        vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+        mSwapchain = swapchain;
+        return result == VK_SUCCESS;
+    }
+
+    bool presentFrame(const VkPresentRegionsKHR* regions) {
+        uint32_t index;
+        if (vkAcquireNextImageKHR(mDevice, mSwapchain, UINT64_MAX, mSemaphore, VK_NULL_HANDLE,
+                                  &index) != VK_SUCCESS) {
+            return false;
+        }
+        const VkPresentInfoKHR presentInfo = {
+                .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+                .pNext = regions,
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores = &mSemaphore,
+                .swapchainCount = 1,
+                .pSwapchains = &mSwapchain,
+                .pImageIndices = &index,
+        };
+        if (vkQueuePresentKHR(mQueue, &presentInfo) != VK_SUCCESS) {
+            return false;
+        }
+
+        BufferItem item;
+        if (mConsumer->acquireBuffer(&item, 0) != NO_ERROR) {
+            return false;
+        }
+        return mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, EGL_NO_DISPLAY,
+                                        EGL_NO_SYNC_KHR, Fence::NO_FENCE) == NO_ERROR;
+    }
+
+private:
+    sp<IGraphicBufferProducer> mProducer;
+    sp<IGraphicBufferConsumer> mConsumer;
+    sp<Surface> mWindow;
+
+    VkInstance mInstance = VK_NULL_HANDLE;
+    VkDevice mDevice = VK_NULL_HANDLE;
+    VkQueue mQueue = VK_NULL_HANDLE;
+    VkSurfaceKHR mSurface = VK_NULL_HANDLE;
+    VkSemaphore mSemaphore = VK_NULL_HANDLE;
+    VkSwapchainKHR mSwapchain = VK_NULL_HANDLE;
+};
+
+} // namespace
+
+// One frame of a steady state app: acquire, present with damage, and the consumer latching the
+// frame. Arg: the number of damage rectangles per present.
+static void BM_presentFrame(benchmark::State& state) {
+    Presenter presenter;
+    if (!presenter.isValid() || !presenter.recreateSwapchain(kExtent)) {
+        state.SkipWithError("failed to set up a swapchain");
+        return;
+    }
+
+    const std::vector<VkRectLayerKHR> rects(static_cast<size_t>(state.range(0)),
+                                            VkRectLayerKHR{{0, 0}, {16, 16}, 0});
+    const VkPresentRegionKHR region = {
+            .rectangleCount = static_cast<uint32_t>(rects.size()),
+            .pRectangles = rects.data(),
+    };
+    const VkPresentRegionsKHR regions = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR,
+            .swapchainCount = 1,
+            .pRegions = &region,
+    };
+
+    for (auto _ : state) {
+        if (!presenter.presentFrame(rects.empty() ? nullptr : &regions)) {
+            state.SkipWithError("failed to present");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_presentFrame)->ArgName("rects")->Arg(0)->Arg(4)->Arg(64);
+
+enum class Recreation : int64_t {
+    // Same size and present mode, so that the new swapchain takes over the buffers of the old one.
+    kSame,
+    // Alternate between two sizes, so that every recreation needs new buffers.
+    kResize,
+    // Alternate between FIFO and MAILBOX, which changes the swap interval of the window.
+    kPresentMode,
+};
+
+// Recreating a swapchain, e.g. for a rotation, followed by a frame from each of its images. A
+// buffer the window dropped while the new swapchain still uses it makes presenting fail.
+// Arg: a Recreation.
+static void BM_recreateSwapchain(benchmark::State& state) {
+    Presenter presenter;
+    if (!presenter.isValid() || !presenter.recreateSwapchain(kExtent)) {
+        state.SkipWithError("failed to set up a swapchain");
+        return;
+    }
+
+    const auto recreation = static_cast<Recreation>(state.range(0));
+    bool alternate = false;
+    for (auto _ : state) {
+        alternate = recreation != Recreation::kSame && !alternate;
+        const VkExtent2D extent =
+                alternate && recreation == Recreation::kResize ? kOtherExtent : kExtent;
+        const VkPresentModeKHR presentMode = alternate && recreation == Recreation::kPresentMode
+                ? VK_PRESENT_MODE_MAILBOX_KHR
+                : VK_PRESENT_MODE_FIFO_KHR;
+        if (!presenter.recreateSwapchain(extent, presentMode)) {
+            state.SkipWithError("failed to recreate the swapchain");
+            break;
+        }
+        for (uint32_t i = 0; i < kMinImageCount; i++) {
+            if (!presenter.presentFrame(nullptr)) {
+                state.SkipWithError("failed to present after recreating the swapchain");
+                return;
+            }
+        }
+    }
+}
+BENCHMARK(BM_recreateSwapchain)
+        ->ArgName("recreation")
+        ->Arg(static_cast<int64_t>(Recreation::kSame))
+        ->Arg(static_cast<int64_t>(Recreation::kResize))
+        ->Arg(static_cast<int64_t>(Recreation::kPresentMode));
@@ -53,6 +53,10 @@ struct InstanceData {
 
 struct DeviceData {
     DeviceDispatchTable dispatch;
+
+    // used to resolve the optional commands of the dispatch table on first use
+    VkDevice device;
+    PFN_vkGetDeviceProcAddr get_device_proc_addr;
 };
 
 }  // namespace api
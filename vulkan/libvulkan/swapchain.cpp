@@ -284,11 +284,17 @@ struct Swapchain {
         : surface(surface_),
           num_images(num_images_),
           mailbox_mode(present_mode == VK_PRESENT_MODE_MAILBOX_KHR),
+          present_mode(present_mode),
           pre_transform(pre_transform_),
           frame_timestamps_enabled(false),
           refresh_duration(refresh_duration_),
           acquire_next_image_timeout(-1),
-          shared(IsSharedPresentMode(present_mode)) {
+          shared(IsSharedPresentMode(present_mode)),
+          format(VK_FORMAT_UNDEFINED),
+          extent{0, 0},
+          native_usage(0),
+          buffer_count(0),
+          reusable_buffers(false) {
     }
 
     VkResult get_refresh_duration(uint64_t& outRefreshDuration)
@@ -309,12 +315,25 @@ struct Swapchain {
     Surface& surface;
     uint32_t num_images;
     bool mailbox_mode;
+    VkPresentModeKHR present_mode;
     int pre_transform;
     bool frame_timestamps_enabled;
     int64_t refresh_duration;
     nsecs_t acquire_next_image_timeout;
     bool shared;
 
+    // What the buffers of the swapchain were allocated for, so that a
+    // swapchain replacing this one can tell whether it can take them over.
+    VkFormat format;
+    VkExtent2D extent;
+    uint64_t native_usage;
+    // The buffer count set on the native window. Changing it, like changing
+    // the present mode and with it the swap interval, can free a buffer.
+    uint32_t buffer_count;
+    // Set if the images were bound to buffers dequeued up front, i.e. the
+    // swapchain is neither shared nor uses deferred memory allocation.
+    bool reusable_buffers;
+
     struct Image {
         Image()
             : image(VK_NULL_HANDLE),
@@ -339,6 +358,9 @@ struct Swapchain {
     } images[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
 
     std::vector<TimingInfo> timing;
+    // Scratch storage for the damage rectangles of vkQueuePresentKHR, so that
+    // presenting doesn't allocate once it has seen the largest damage.
+    std::vector<android_native_rect_t> damage_rects;
 };
 
 VkSwapchainKHR HandleFromSwapchain(Swapchain* swapchain) {
@@ -1634,6 +1656,106 @@ static VkResult getProducerUsage(const VkDevice& device,
     return VK_SUCCESS;
 }
 
+// Queries the number of images a swapchain created with |create_info| gets,
+// and the buffer count to set on |window| for them, given how the window is
+// currently configured.
+static VkResult GetSwapchainImageCount(VkDevice device,
+                                       const VkSwapchainCreateInfoKHR* create_info,
+                                       ANativeWindow* window,
+                                       uint32_t* num_images,
+                                       uint32_t* buffer_count) {
+    int query_value;
+    // TODO: Now that we are calling into GPDSC2 directly, this query may be redundant
+    //       the call to std::max(min_buffer_count, num_images) may be redundant as well
+    int err = window->query(window, NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS,
+                            &query_value);
+    if (err != android::OK || query_value < 0) {
+        ALOGE("window->query failed: %s (%d) value=%d", strerror(-err), err,
+              query_value);
+        return VK_ERROR_SURFACE_LOST_KHR;
+    }
+    const uint32_t min_undequeued_buffers = static_cast<uint32_t>(query_value);
+
+    // Lower layer insists that we have at least min_undequeued_buffers + 1
+    // buffers.  This is wasteful and we'd like to relax it in the shared case,
+    // but not all the pieces are in place for that to work yet.  Note we only
+    // lie to the lower layer--we don't want to give the app back a swapchain
+    // with extra images (which they can't actually use!).
+    const uint32_t min_buffer_count = min_undequeued_buffers + 1;
+
+    // Call into GPDSC2 to get the minimum and maximum allowable buffer count for the surface of
+    // interest. This step is only necessary if the app requests a number of images
+    // (create_info->minImageCount) that is less or more than the surface capabilities.
+    // An app should be calling GPDSC2 and using those values to set create_info, but in the
+    // event that the app has hard-coded image counts an error can occur
+    VkSurfacePresentModeEXT present_mode = {
+        VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_EXT,
+        nullptr,
+        create_info->presentMode
+    };
+    VkPhysicalDeviceSurfaceInfo2KHR surface_info2 = {
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SURFACE_INFO_2_KHR,
+        &present_mode,
+        create_info->surface
+    };
+    VkSurfaceCapabilities2KHR surface_capabilities2 = {
+        VK_STRUCTURE_TYPE_SURFACE_CAPABILITIES_2_KHR,
+        nullptr,
+        {},
+    };
+    GetPhysicalDeviceSurfaceCapabilities2KHR(GetData(device).driver_physical_device,
+            &surface_info2, &surface_capabilities2);
+
+    *num_images = std::clamp(create_info->minImageCount,
+            surface_capabilities2.surfaceCapabilities.minImageCount,
+            surface_capabilities2.surfaceCapabilities.maxImageCount);
+    *buffer_count = std::max(min_buffer_count, *num_images);
+    return VK_SUCCESS;
+}
+
+// Whether the swapchain created with |create_info| can take over the buffers
+// of |old_swapchain| instead of having the native window allocate new ones.
+// This is the case when an app recreates its swapchain, e.g. for a rotation,
+// and the window can be left configured as it is, so that it keeps all of the
+// old buffers. This is decided before the window is touched: a different
+// present mode or buffer count makes the BufferQueue free a buffer.
+static bool CanReuseSwapchainBuffers(VkDevice device,
+                                     const Swapchain& old_swapchain,
+                                     const VkSwapchainCreateInfoKHR* create_info,
+                                     uint64_t native_usage) {
+    if (!old_swapchain.reusable_buffers ||
+        IsSharedPresentMode(create_info->presentMode) ||
+        (create_info->flags &
+         VK_SWAPCHAIN_CREATE_DEFERRED_MEMORY_ALLOCATION_BIT_EXT)) {
+        return false;
+    }
+    if (old_swapchain.present_mode != create_info->presentMode ||
+        old_swapchain.format != create_info->imageFormat ||
+        old_swapchain.extent.width != create_info->imageExtent.width ||
+        old_swapchain.extent.height != create_info->imageExtent.height ||
+        old_swapchain.native_usage != native_usage) {
+        return false;
+    }
+    // A buffer the app still has acquired would only be returned to the old
+    // swapchain, which no longer gives it back to the window.
+    for (uint32_t i = 0; i < old_swapchain.num_images; i++) {
+        const Swapchain::Image& img = old_swapchain.images[i];
+        if (img.dequeued || !img.buffer)
+            return false;
+    }
+    // The window is still configured for the old present mode, so it reports
+    // the same counts the new swapchain would see after configuring it.
+    uint32_t num_images;
+    uint32_t buffer_count;
+    if (GetSwapchainImageCount(device, create_info,
+                               old_swapchain.surface.window.get(), &num_images,
+                               &buffer_count) != VK_SUCCESS) {
+        return false;
+    }
+    return num_images == old_swapchain.num_images &&
+           buffer_count == old_swapchain.buffer_count;
+}
+
 VKAPI_ATTR
 VkResult CreateSwapchainKHR(VkDevice device,
                             const VkSwapchainCreateInfoKHR* create_info,
@@ -1694,8 +1816,68 @@ VkResult CreateSwapchainKHR(VkDevice device,
               reinterpret_cast<uint64_t>(create_info->oldSwapchain));
         return VK_ERROR_NATIVE_WINDOW_IN_USE_KHR;
     }
-    if (create_info->oldSwapchain != VK_NULL_HANDLE)
-        OrphanSwapchain(device, SwapchainFromHandle(create_info->oldSwapchain));
+
+    VkSwapchainImageUsageFlagsANDROID swapchain_image_usage = 0;
+    if (IsSharedPresentMode(create_info->presentMode))
+        swapchain_image_usage |= VK_SWAPCHAIN_IMAGE_USAGE_SHARED_BIT_ANDROID;
+
+    // Look through the create_info pNext chain passed to createSwapchainKHR
+    // for an image compression control struct.
+    // if one is found AND the appropriate extensions are enabled, create a
+    // VkImageCompressionControlEXT structure to pass on to VkImageCreateInfo
+    // TODO check for imageCompressionControlSwapchain feature is enabled
+    void* usage_info_pNext = nullptr;
+    VkImageCompressionControlEXT image_compression = {};
+    const VkSwapchainCreateInfoKHR* create_infos = create_info;
+    while (create_infos->pNext) {
+        create_infos = reinterpret_cast<const VkSwapchainCreateInfoKHR*>(create_infos->pNext);
+        switch (create_infos->sType) {
+            case VK_STRUCTURE_TYPE_IMAGE_COMPRESSION_CONTROL_EXT: {
+                const VkImageCompressionControlEXT* compression_infos =
+                    reinterpret_cast<const VkImageCompressionControlEXT*>(create_infos);
+                image_compression = *compression_infos;
+                image_compression.pNext = nullptr;
+                usage_info_pNext = &image_compression;
+            } break;
+
+            default:
+                // Ignore all other info structs
+                break;
+        }
+    }
+
+    // Get the appropriate native_usage for the images
+    // Get the consumer usage
+    uint64_t native_usage = surface.consumer_usage;
+    // Determine if the swapchain is protected
+    bool create_protected_swapchain = false;
+    if (create_info->flags & VK_SWAPCHAIN_CREATE_PROTECTED_BIT_KHR) {
+        create_protected_swapchain = true;
+        native_usage |= BufferUsage::PROTECTED;
+    }
+    // Get the producer usage
+    uint64_t producer_usage;
+    result = getProducerUsage(device, create_info, swapchain_image_usage, create_protected_swapchain, &producer_usage);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    native_usage |= producer_usage;
+
+    // Take references to the buffers of the old swapchain before orphaning it
+    // releases them.
+    Swapchain* old_swapchain = SwapchainFromHandle(create_info->oldSwapchain);
+    const bool reuse_buffers =
+        old_swapchain && !usage_info_pNext &&
+        CanReuseSwapchainBuffers(device, *old_swapchain, create_info,
+                                 native_usage);
+    android::sp<ANativeWindowBuffer>
+        reused_buffers[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
+    if (reuse_buffers) {
+        for (uint32_t i = 0; i < old_swapchain->num_images; i++)
+            reused_buffers[i] = old_swapchain->images[i].buffer;
+    }
+    if (old_swapchain)
+        OrphanSwapchain(device, old_swapchain);
 
     // -- Reset the native window --
     // The native window might have been used previously, and had its properties
@@ -1709,11 +1891,11 @@ VkResult CreateSwapchainKHR(VkDevice device,
     // orphans the previous buffers, getting us back to the state where we can
     // dequeue all buffers.
     //
-    // This is not necessary if the surface was never used previously.
-    //
-    // TODO(http://b/134186185) recycle swapchain images more efficiently
+    // This is not necessary if the surface was never used previously, or if
+    // the new swapchain takes over the buffers of the old one and so doesn't
+    // dequeue any.
     ANativeWindow* window = surface.window.get();
-    if (surface.used_by_swapchain) {
+    if (surface.used_by_swapchain && !reuse_buffers) {
         err = native_window_api_disconnect(window, NATIVE_WINDOW_API_EGL);
         ALOGW_IF(err != android::OK,
                  "native_window_api_disconnect failed: %s (%d)", strerror(-err),
@@ -1813,9 +1995,7 @@ VkResult CreateSwapchainKHR(VkDevice device,
         return VK_ERROR_SURFACE_LOST_KHR;
     }
 
-    VkSwapchainImageUsageFlagsANDROID swapchain_image_usage = 0;
     if (IsSharedPresentMode(create_info->presentMode)) {
-        swapchain_image_usage |= VK_SWAPCHAIN_IMAGE_USAGE_SHARED_BIT_ANDROID;
         err = native_window_set_shared_buffer_mode(window, true);
         if (err != android::OK) {
             ALOGE("native_window_set_shared_buffer_mode failed: %s (%d)", strerror(-err), err);
@@ -1831,54 +2011,13 @@ VkResult CreateSwapchainKHR(VkDevice device,
         }
     }
 
-    int query_value;
-    // TODO: Now that we are calling into GPDSC2 directly, this query may be redundant
-    //       the call to std::max(min_buffer_count, num_images) may be redundant as well
-    err = window->query(window, NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS,
-                        &query_value);
-    if (err != android::OK || query_value < 0) {
-        ALOGE("window->query failed: %s (%d) value=%d", strerror(-err), err,
-              query_value);
-        return VK_ERROR_SURFACE_LOST_KHR;
-    }
-    const uint32_t min_undequeued_buffers = static_cast<uint32_t>(query_value);
-
-    // Lower layer insists that we have at least min_undequeued_buffers + 1
-    // buffers.  This is wasteful and we'd like to relax it in the shared case,
-    // but not all the pieces are in place for that to work yet.  Note we only
-    // lie to the lower layer--we don't want to give the app back a swapchain
-    // with extra images (which they can't actually use!).
-    const uint32_t min_buffer_count = min_undequeued_buffers + 1;
-
-    // Call into GPDSC2 to get the minimum and maximum allowable buffer count for the surface of
-    // interest. This step is only necessary if the app requests a number of images
-    // (create_info->minImageCount) that is less or more than the surface capabilities.
-    // An app should be calling GPDSC2 and using those values to set create_info, but in the
-    // event that the app has hard-coded image counts an error can occur
-    VkSurfacePresentModeEXT present_mode = {
-        VK_STRUCTURE_TYPE_SURFACE_PRESENT_MODE_EXT,
-        nullptr,
-        create_info->presentMode
-    };
-    VkPhysicalDeviceSurfaceInfo2KHR surface_info2 = {
-        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SURFACE_INFO_2_KHR,
-        &present_mode,
-        create_info->surface
-    };
-    VkSurfaceCapabilities2KHR surface_capabilities2 = {
-        VK_STRUCTURE_TYPE_SURFACE_CAPABILITIES_2_KHR,
-        nullptr,
-        {},
-    };
-    result = GetPhysicalDeviceSurfaceCapabilities2KHR(GetData(device).driver_physical_device,
-            &surface_info2, &surface_capabilities2);
-
-    uint32_t num_images = create_info->minImageCount;
-    num_images = std::clamp(num_images,
-            surface_capabilities2.surfaceCapabilities.minImageCount,
-            surface_capabilities2.surfaceCapabilities.maxImageCount);
+    uint32_t num_images;
+    uint32_t buffer_count;
+    result = GetSwapchainImageCount(device, create_info, window, &num_images,
+                                    &buffer_count);
+    if (result != VK_SUCCESS)
+        return result;
 
-    const uint32_t buffer_count = std::max(min_buffer_count, num_images);
     err = native_window_set_buffer_count(window, buffer_count);
     if (err != android::OK) {
         ALOGE("native_window_set_buffer_count(%d) failed: %s (%d)", buffer_count,
@@ -1892,48 +2031,6 @@ VkResult CreateSwapchainKHR(VkDevice device,
         num_images = 1;
     }
 
-    // Look through the create_info pNext chain passed to createSwapchainKHR
-    // for an image compression control struct.
-    // if one is found AND the appropriate extensions are enabled, create a
-    // VkImageCompressionControlEXT structure to pass on to VkImageCreateInfo
-    // TODO check for imageCompressionControlSwapchain feature is enabled
-    void* usage_info_pNext = nullptr;
-    VkImageCompressionControlEXT image_compression = {};
-    const VkSwapchainCreateInfoKHR* create_infos = create_info;
-    while (create_infos->pNext) {
-        create_infos = reinterpret_cast<const VkSwapchainCreateInfoKHR*>(create_infos->pNext);
-        switch (create_infos->sType) {
-            case VK_STRUCTURE_TYPE_IMAGE_COMPRESSION_CONTROL_EXT: {
-                const VkImageCompressionControlEXT* compression_infos =
-                    reinterpret_cast<const VkImageCompressionControlEXT*>(create_infos);
-                image_compression = *compression_infos;
-                image_compression.pNext = nullptr;
-                usage_info_pNext = &image_compression;
-            } break;
-
-            default:
-                // Ignore all other info structs
-                break;
-        }
-    }
-
-    // Get the appropriate native_usage for the images
-    // Get the consumer usage
-    uint64_t native_usage = surface.consumer_usage;
-    // Determine if the swapchain is protected
-    bool create_protected_swapchain = false;
-    if (create_info->flags & VK_SWAPCHAIN_CREATE_PROTECTED_BIT_KHR) {
-        create_protected_swapchain = true;
-        native_usage |= BufferUsage::PROTECTED;
-    }
-    // Get the producer usage
-    uint64_t producer_usage;
-    result = getProducerUsage(device, create_info, swapchain_image_usage, create_protected_swapchain, &producer_usage);
-    if (result != VK_SUCCESS) {
-        return result;
-    }
-    native_usage |= producer_usage;
-
     err = native_window_set_usage(window, native_usage);
     if (err != android::OK) {
         ALOGE("native_window_set_usage failed: %s (%d)", strerror(-err), err);
@@ -2008,8 +2105,10 @@ VkResult CreateSwapchainKHR(VkDevice device,
 
     // Note: don't do deferred allocation for shared present modes. There's only one buffer
     // involved so very little benefit.
-    if ((create_info->flags & VK_SWAPCHAIN_CREATE_DEFERRED_MEMORY_ALLOCATION_BIT_EXT) &&
-            !IsSharedPresentMode(create_info->presentMode)) {
+    const bool deferred_allocation =
+        (create_info->flags & VK_SWAPCHAIN_CREATE_DEFERRED_MEMORY_ALLOCATION_BIT_EXT) &&
+        !IsSharedPresentMode(create_info->presentMode);
+    if (deferred_allocation) {
         // Don't want to touch the underlying gralloc buffers yet;
         // instead just create unbound VkImages which will later be bound to memory inside
         // AcquireNextImage.
@@ -2034,26 +2133,32 @@ VkResult CreateSwapchainKHR(VkDevice device,
     } else {
         // -- Dequeue all buffers and create a VkImage for each --
         // Any failures during or after this must cancel the dequeued buffers.
+        // Buffers taken over from the old swapchain aren't dequeued: they are
+        // left with the window or its consumer, just as they were.
 
         for (uint32_t i = 0; i < num_images; i++) {
             Swapchain::Image& img = swapchain->images[i];
 
-            ANativeWindowBuffer* buffer;
-            err = window->dequeueBuffer(window, &buffer, &img.dequeue_fence);
-            if (err != android::OK) {
-                ALOGE("dequeueBuffer[%u] failed: %s (%d)", i, strerror(-err), err);
-                switch (-err) {
-                    case ENOMEM:
-                        result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
-                        break;
-                    default:
-                        result = VK_ERROR_SURFACE_LOST_KHR;
-                        break;
+            if (reuse_buffers) {
+                img.buffer = std::move(reused_buffers[i]);
+            } else {
+                ANativeWindowBuffer* buffer;
+                err = window->dequeueBuffer(window, &buffer, &img.dequeue_fence);
+                if (err != android::OK) {
+                    ALOGE("dequeueBuffer[%u] failed: %s (%d)", i, strerror(-err), err);
+                    switch (-err) {
+                        case ENOMEM:
+                            result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+                            break;
+                        default:
+                            result = VK_ERROR_SURFACE_LOST_KHR;
+                            break;
+                    }
+                    break;
                 }
-                break;
+                img.buffer = buffer;
+                img.dequeued = true;
             }
-            img.buffer = buffer;
-            img.dequeued = true;
 
             image_native_buffer.handle = img.buffer->handle;
             image_native_buffer.stride = img.buffer->stride;
@@ -2099,6 +2204,19 @@ VkResult CreateSwapchainKHR(VkDevice device,
         return result;
     }
 
+    swapchain->format = create_info->imageFormat;
+    swapchain->extent = create_info->imageExtent;
+    swapchain->native_usage = native_usage;
+    swapchain->buffer_count = buffer_count;
+    swapchain->reusable_buffers =
+        !swapchain->shared && !deferred_allocation && !usage_info_pNext;
+    if (reuse_buffers) {
+        // The window still has frame timestamps enabled if the old swapchain
+        // enabled them; let this one disable them again when it's destroyed.
+        swapchain->frame_timestamps_enabled =
+            old_swapchain->frame_timestamps_enabled;
+    }
+
     if (transform_hint != swapchain->pre_transform) {
         // Log that the app is not doing pre-rotation.
         android::GraphicsEnv::getInstance().setTargetStats(
@@ -2343,8 +2461,10 @@ static VkResult WorstPresentResult(VkResult a, VkResult b) {
 }
 
 // KHR_incremental_present aspect of QueuePresentKHR
-static void SetSwapchainSurfaceDamage(ANativeWindow *window, const VkPresentRegionKHR *pRegion) {
-    std::vector<android_native_rect_t> rects(pRegion->rectangleCount);
+static void SetSwapchainSurfaceDamage(Swapchain &swapchain, const VkPresentRegionKHR *pRegion) {
+    ANativeWindow *window = swapchain.surface.window.get();
+    std::vector<android_native_rect_t>& rects = swapchain.damage_rects;
+    rects.resize(pRegion->rectangleCount);
     for (auto i = 0u; i < pRegion->rectangleCount; i++) {
         auto const& rect = pRegion->pRectangles[i];
         if (rect.layer > 0) {
@@ -2372,6 +2492,8 @@ static void SetSwapchainFrameTimestamp(Swapchain &swapchain, const VkPresentTime
         native_window_enable_frame_timestamps(window, true);
         swapchain.frame_timestamps_enabled = true;
     }
+    // Keeps the record below from growing the vector on later presents.
+    swapchain.timing.reserve(MAX_TIMING_INFOS + 1);
 
     // Record the nativeFrameId so it can be later correlated to
     // this present.
@@ -2473,7 +2595,7 @@ static VkResult PresentOneSwapchain(
             }
 
             if (pRegion) {
-                SetSwapchainSurfaceDamage(window, pRegion);
+                SetSwapchainSurfaceDamage(swapchain, pRegion);
             }
             if (pTime) {
                 SetSwapchainFrameTimestamp(swapchain, pTime);
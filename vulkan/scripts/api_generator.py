@@ -129,6 +129,32 @@ def _define_extension_stub(cmd, f):
     f.write('}\n\n')
 
 
+def _define_lazy_stub(cmd, f):
+  """Emits a stub resolving an optional device function on its first call.
+
+  Args:
+    cmd: Vulkan function name.
+    f: Output file handle.
+  """
+  if (gencom.is_device_dispatch_table_entry(cmd) and
+      not gencom.is_command_required(cmd)):
+    ret = gencom.return_type_dict[cmd]
+    params = gencom.param_dict[cmd]
+    param_list = [''.join(i) for i in params]
+
+    f.write('VKAPI_ATTR ' + ret + ' lazy' + gencom.base_name(cmd) +
+            '(' + ', '.join(param_list) + ') {\n')
+    f.write(gencom.indent(1) + 'auto& data = GetData(' + params[0][1] +
+            ');\n')
+    f.write(gencom.indent(1))
+    if ret != 'void':
+      f.write('return ')
+    f.write('ResolveDeviceProc(data, &data.dispatch.' +
+            gencom.base_name(cmd) + ', "' + cmd + '")(' +
+            ', '.join(i[1] for i in params) + ');\n')
+    f.write('}\n\n')
+
+
 def _is_intercepted(cmd):
   """Returns true if a function is intercepted by vulkan::api.
 
@@ -260,8 +286,12 @@ def _api_dispatch(cmd, f):
 
   param_list = gencom.param_dict[cmd]
   handle = param_list[0][1]
-  f.write('GetData(' + handle + ').dispatch.' + gencom.base_name(cmd) +
-          '(' + ', '.join(i[1] for i in param_list) + ');\n')
+  entry = 'GetData(' + handle + ').dispatch.' + gencom.base_name(cmd)
+  if (gencom.is_device_dispatch_table_entry(cmd) and
+      not gencom.is_command_required(cmd)):
+    # Lazily resolved entries are stored concurrently by ResolveDeviceProc.
+    entry = '__atomic_load_n(&' + entry + ', __ATOMIC_RELAXED)'
+  f.write(entry + '(' + ', '.join(i[1] for i in param_list) + ');\n')
 
 
 def gen_cpp():
@@ -308,6 +338,18 @@ namespace api {
             data.dispatch.proc = disabled##proc; \\
     } while (0)
 
+// Optional device commands are resolved on their first call rather than when
+// the device is created.  Most of them are never called through the loader.
+#define INIT_PROC_LAZY(proc) data.dispatch.proc = lazy##proc
+
+#define INIT_PROC_EXT_LAZY(ext, proc)            \\
+    do {                                         \\
+        if (extensions[driver::ProcHook::ext])   \\
+            INIT_PROC_LAZY(proc);                \\
+        else                                     \\
+            data.dispatch.proc = disabled##proc; \\
+    } while (0)
+
 namespace {
 
 // clang-format off\n\n""")
@@ -315,6 +357,23 @@ namespace {
     for cmd in gencom.command_list:
       _define_extension_stub(cmd, f)
 
+    f.write("""\
+// Resolves an optional device command on its first call and replaces the lazy
+// stub in the dispatch table with it.
+template <typename PFN>
+PFN ResolveDeviceProc(DeviceData& data, PFN* proc, const char* name) {
+    PFN resolved = reinterpret_cast<PFN>(data.get_device_proc_addr(data.device, name));
+    ALOGE_IF(!resolved, "missing dev proc: %s", name);
+    // Threads racing to resolve the same command all store the same value.
+    __atomic_store_n(proc, resolved, __ATOMIC_RELAXED);
+    return resolved;
+}
+
+""")
+
+    for cmd in gencom.command_list:
+      _define_lazy_stub(cmd, f)
+
     f.write("""\
 // clang-format on
 
@@ -346,11 +405,14 @@ bool InitDispatchTable(
     auto& data = GetData(dev);
     bool success = true;
 
+    data.device = dev;
+    data.get_device_proc_addr = get_proc;
+
     // clang-format off\n""")
 
     for cmd in gencom.command_list:
       if gencom.is_device_dispatch_table_entry(cmd):
-        gencom.init_proc(cmd, f)
+        gencom.init_proc(cmd, f, lazy=True)
 
     f.write("""\
     // clang-format on
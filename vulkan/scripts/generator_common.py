@@ -307,22 +307,41 @@ def is_device_dispatch_table_entry(cmd):
   return is_function_exported(cmd) and is_device_dispatched(cmd)
 
 
-def init_proc(name, f):
-  """Emits code to invoke INIT_PROC or INIT_PROC_EXT.
+def is_command_required(name):
+  """Returns true if a command must be provided below the loader.
+
+  Args:
+    name: Vulkan function name.
+  """
+  if name in _OPTIONAL_COMMANDS:
+    return False
+  return version_dict[name] == 'VK_VERSION_1_0'
+
+
+def init_proc(name, f, lazy=False):
+  """Emits code to invoke INIT_PROC, INIT_PROC_EXT or their lazy variants.
 
   Args:
     name: Vulkan function name.
     f: Output file handle.
+    lazy: Whether optional commands are resolved on their first call.
   """
   f.write(indent(1))
+  if lazy and not is_command_required(name):
+    if name in extension_dict:
+      f.write('INIT_PROC_EXT_LAZY(' + base_ext_name(extension_dict[name]) +
+              ', ')
+    else:
+      f.write('INIT_PROC_LAZY(')
+    f.write(base_name(name) + ');\n')
+    return
+
   if name in extension_dict:
     f.write('INIT_PROC_EXT(' + base_ext_name(extension_dict[name]) + ', ')
   else:
     f.write('INIT_PROC(')
 
-  if name in _OPTIONAL_COMMANDS:
-    f.write('false, ')
-  elif version_dict[name] == 'VK_VERSION_1_0':
+  if is_command_required(name):
     f.write('true, ')
   else:
     f.write('false, ')